@@ -87,6 +87,11 @@ namespace BitFunnel
         // with this document.
         void AddPosting(Term const & term);
 
+        // Adds postings for each of termCount terms. This is faster than
+        // calling AddPosting() for each term, since the rows are written in
+        // address order.
+        void AddPostings(Term const * terms, size_t termCount);
+
         // Removes this document from the index. Queries initiated after
         // Expire() returns will not see this document. Queries already in
         // progress at the time Expire() is called may be able to see the
@@ -25,7 +25,8 @@
 #include <iosfwd>               // std::istream parameter.
 #include <memory>               // std::unique_ptr return type.
 
-#include "BitFunnel/Term.h"     // Term::IdfX10 parameter.
+#include "BitFunnel/Index/Row.h"    // Row::GetAlignment() default parameter.
+#include "BitFunnel/Term.h"         // Term::IdfX10 parameter.
 
 namespace BitFunnel
 {
@@ -65,18 +66,37 @@ namespace BitFunnel
             CreateIndexedIdfTable(std::istream& input,
                                   Term::IdfX10 defaultIdf);
 
+        // Memory maps the IndexedIdfTable file at path, so that it is
+        // queried in place rather than loaded.
+        std::unique_ptr<IIndexedIdfTable>
+            CreateIndexedIdfTable(char const * path,
+                                  Term::IdfX10 defaultIdf);
+
+        // activeSliceCount is the number of Slices in each Shard that
+        // documents are allocated from concurrently. Set it to the number of
+        // ingestion threads to give each thread its own Slice.
+        //
+        // rowAlignment is the byte alignment of each row in the slice
+        // buffers. It must be a power of two no less than
+        // Row::GetAlignment(). Use 32 or 64 to let the matcher use aligned
+        // vector loads. The sliceBufferAllocator's block size should come
+        // from GetMinimumBlockSize() with the same rowAlignment.
         std::unique_ptr<IIngestor>
             CreateIngestor(IDocumentDataSchema const & docDataSchema,
                            IRecycler& recycler,
                            ITermTableCollection const & termTables,
                            IShardDefinition const & shardDefinition,
-                           ISliceBufferAllocator& sliceBufferAllocator);
+                           ISliceBufferAllocator& sliceBufferAllocator,
+                           size_t activeSliceCount = 1,
+                           size_t rowAlignment = Row::GetAlignment());
 
         std::unique_ptr<IRecycler> CreateRecycler();
 
         std::unique_ptr<ISimpleIndex> CreateSimpleIndex(char const * directory,
                                                         size_t gramSize,
-                                                        bool generateTermToText);
+                                                        bool generateTermToText,
+                                                        size_t activeSliceCount = 1,
+                                                        size_t rowAlignment = Row::GetAlignment());
 
         std::unique_ptr<ISliceBufferAllocator>
             CreateSliceBufferAllocator(size_t blockSize, size_t blockCount);
@@ -25,13 +25,17 @@
 
 #include <stddef.h>
 
+#include "BitFunnel/Index/Row.h"    // Row::GetAlignment() default parameter.
+
 namespace BitFunnel
 {
     class IDocumentDataSchema;
     class ITermTable;
 
     // Returns the smallest block size required to allocate a slice that is
-    // configured by a specific schema and term table.
+    // configured by a specific schema and term table, with rows aligned to
+    // rowAlignment bytes.
     size_t GetMinimumBlockSize(IDocumentDataSchema const & schema,
-                               ITermTable const & termTable);
+                               ITermTable const & termTable,
+                               size_t rowAlignment = Row::GetAlignment());
 }
@@ -57,5 +57,12 @@ namespace BitFunnel
         // Term as it is constructed. The IIndexedIdfTable should be
         // representative of the distribution of terms in the corpus.
         virtual IIndexedIdfTable const & GetIdfTable() const = 0;
+
+        // Returns the number of GetIdfTable() lookups answered from its
+        // per-thread caches, and the number passed on to the underlying
+        // IIndexedIdfTable. Lookups made by threads that are still running
+        // are added to these counts periodically rather than immediately.
+        virtual size_t GetIdfCacheHitCount() const = 0;
+        virtual size_t GetIdfCacheMissCount() const = 0;
     };
 }
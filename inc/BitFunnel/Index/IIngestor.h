@@ -37,8 +37,8 @@ namespace BitFunnel
     class IDocumentCache;
     class IFileManager;
     class IRecycler;
+    class IShard;
     class ITokenManager;
-    class Shard;
     class TermToText;
 
     // BITFUNNELTYPES
@@ -131,7 +131,7 @@ namespace BitFunnel
 
         // Returns a number of Shards and a Shard with the given ShardId.
         virtual size_t GetShardCount() const = 0;
-        virtual Shard& GetShard(size_t shard) const = 0;
+        virtual IShard& GetShard(size_t shard) const = 0;
 
         virtual IRecycler& GetRecycler() const = 0;
 
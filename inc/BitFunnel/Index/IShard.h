@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // ptrdiff_t return value.
+#include <cstdint>                          // uint64_t return value.
+#include <vector>                           // std::vector return value.
+
+#include "BitFunnel/BitFunnelTypes.h"       // DocId, DocIndex return values.
+#include "BitFunnel/IInterface.h"           // Base class.
+#include "BitFunnel/Index/RowId.h"          // RowId parameter.
+
+
+namespace BitFunnel
+{
+    class ITermTable;
+
+    //*************************************************************************
+    //
+    // IShard is the view of a partition of the index that query planning
+    // and matching need. It describes where each row and DocId is located
+    // in the Shard's slice buffers and allows the host to replace the
+    // Shard's TermTable. Ingestion uses the concrete Shard instead.
+    //
+    //*************************************************************************
+    class IShard : public IInterface
+    {
+    public:
+        // Returns the TermTable used to map the Shard's Terms to RowIds.
+        virtual ITermTable const & GetTermTable() const = 0;
+
+        // Returns a number that identifies the TermTable currently in use.
+        // Generations are unique across all Shards and change every time
+        // SetTermTable() is called, so anything derived from the TermTable,
+        // e.g. a compiled query plan, can be keyed on the generation to
+        // detect that it is stale.
+        virtual uint64_t GetTermTableGeneration() const = 0;
+
+        // Replaces the TermTable used to map the Shard's Terms to RowIds. The
+        // new TermTable must have the same row counts at every rank and the
+        // same system rows as the current one, since the Shard's slice
+        // buffers are laid out for those rows; otherwise SetTermTable()
+        // throws. The caller must keep the previous TermTable alive until
+        // queries that started before the call have completed, and must not
+        // call SetTermTable() while documents are being added to the Shard.
+        virtual void SetTermTable(ITermTable const & termTable) = 0;
+
+        // Returns capacity of a single Slice in the Shard. All Slices in the
+        // Shard have the same capacity.
+        virtual DocIndex GetSliceCapacity() const = 0;
+
+        // Returns a vector of slice buffers for this shard.  The callers needs
+        // to obtain a Token from ITokenManager to protect the pointer to the
+        // list of slice buffers, as well as the buffers themselves.
+        virtual std::vector<void*> const & GetSliceBuffers() const = 0;
+
+        // Returns the offset of the row in the slice buffer in a shard.
+        virtual ptrdiff_t GetRowOffset(RowId rowId) const = 0;
+
+        // Returns the DocId of the document at index in a slice buffer.
+        virtual DocId GetDocId(void* sliceBuffer, DocIndex index) const = 0;
+    };
+}
@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <iosfwd>
 #include <string>
 #include <vector>
 
@@ -36,4 +37,55 @@ namespace BitFunnel
                       IIngestor& ingestor,
                       size_t threadCount,
                       bool cacheDocuments);
+
+
+    //*************************************************************************
+    //
+    // IngestionPipelineOptions sizes the stages of IngestChunksPipelined().
+    //
+    //*************************************************************************
+    class IngestionPipelineOptions
+    {
+    public:
+        // Uses one reader thread, threadCount parser and poster threads,
+        // 1MB blocks, and queues that hold four items per consuming thread.
+        IngestionPipelineOptions(size_t threadCount);
+
+        // Number of threads in each stage.
+        size_t m_readerCount;
+        size_t m_parserCount;
+        size_t m_posterCount;
+
+        // Approximate number of bytes of chunk data in each block handed to
+        // a parser. Blocks are split on document boundaries.
+        size_t m_blockSize;
+
+        // Capacity of the queue of blocks between the readers and parsers,
+        // and of the queue of parsed blocks of documents between the parsers
+        // and posters.
+        size_t m_blockQueueCapacity;
+        size_t m_documentQueueCapacity;
+    };
+
+
+    // Ingests the chunk files with a pipeline of three stages, each with its
+    // own threads, connected by bounded queues:
+    //   read:  maps each file, splits it into blocks of whole documents, and
+    //          faults the blocks into memory.
+    //   parse: tokenizes each block and hashes its terms and n-grams into
+    //          Documents.
+    //   post:  adds the Documents to the ingestor.
+    // Since blocks of a single file are spread across all of the parsers and
+    // posters, a few large files keep every thread busy. When a stage falls
+    // behind, its input queue fills and the stages before it wait, so memory
+    // use stays bounded.
+    //
+    // If statistics is not nullptr, a report of each stage's throughput and
+    // the time its threads spent waiting on their queues is written to it.
+    void IngestChunksPipelined(std::vector<std::string> const & filePaths,
+                               IConfiguration const & config,
+                               IIngestor& ingestor,
+                               IngestionPipelineOptions const & options,
+                               bool cacheDocuments,
+                               std::ostream * statistics);
 }
@@ -0,0 +1,76 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstddef>                          // size_t return value.
+
+#include "BitFunnel/BitFunnelTypes.h"       // Rank, ShardId parameters.
+#include "BitFunnel/IInterface.h"           // Base class.
+#include "BitFunnel/Index/RowId.h"          // RowId return value.
+#include "BitFunnel/Plan/AbstractRow.h"     // AbstractRow return value.
+
+
+namespace BitFunnel
+{
+    class ITermTable;
+
+    //*************************************************************************
+    //
+    // IPlanRows is an abstract base class or interface for classes that map
+    // the AbstractRows of a query plan to the physical RowIds in each of the
+    // shards of the index.
+    //
+    // During planning, each distinct row in a query is assigned an
+    // AbstractRow id via AddRow(). The planner then records, for every shard,
+    // which physical RowId plays the role of that AbstractRow. The matcher
+    // later uses this table to translate the shard-independent plan into row
+    // offsets within the slice buffers of a particular shard.
+    //
+    //*************************************************************************
+    class IPlanRows : public IInterface
+    {
+    public:
+        // Returns the number of shards covered by the plan.
+        virtual ShardId GetShardCount() const = 0;
+
+        // Returns the number of AbstractRows allocated so far.
+        virtual unsigned GetRowCount() const = 0;
+
+        // Returns the TermTable used to resolve terms for the specified shard.
+        virtual ITermTable const & GetTermTable(ShardId shard) const = 0;
+
+        // Returns true if no more AbstractRows can be added to the plan.
+        virtual bool IsFull() const = 0;
+
+        // Allocates a new AbstractRow at the specified rank. The caller is
+        // expected to fill in the corresponding physical RowId for each shard
+        // via PhysicalRow(). Throws if the plan is full.
+        virtual AbstractRow AddRow(Rank rank) = 0;
+
+        // Returns the physical RowId in the specified shard that corresponds
+        // to the AbstractRow with the specified id.
+        virtual RowId const & PhysicalRow(ShardId shard, unsigned id) const = 0;
+        virtual RowId & PhysicalRow(ShardId shard, unsigned id) = 0;
+    };
+}
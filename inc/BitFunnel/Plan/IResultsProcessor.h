@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // size_t parameter.
+#include <cstdint>                          // uint64_t parameter.
+
+#include "BitFunnel/IInterface.h"           // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // IResultsProcessor is an abstract base class or interface for classes
+    // that consume the output of a matcher.
+    //
+    // The matcher calls AddResult() each time a plan executes a Report
+    // primitive with a non-zero accumulator. The accumulator holds the
+    // matching bits for the 64 documents in the rank zero quadword at the
+    // specified offset. A plan may report the same offset more than once,
+    // and implementations are expected to combine such results. Once all of
+    // the quadwords in a slice have been processed, the matcher calls
+    // FinishIteration() with that slice's buffer.
+    //
+    // FinishIteration() returns true to terminate the match early, for
+    // example when a query's result budget has been spent. The matcher then
+    // stops without scanning the remaining slices.
+    //
+    //*************************************************************************
+    class IResultsProcessor : public IInterface
+    {
+    public:
+        // Records the matches in the rank zero quadword at offset.
+        virtual void AddResult(uint64_t accumulator, size_t offset) = 0;
+
+        // Called after the last AddResult() for sliceBuffer. Returns true if
+        // the matcher should stop instead of moving on to the next slice.
+        virtual bool FinishIteration(void * sliceBuffer) = 0;
+    };
+}
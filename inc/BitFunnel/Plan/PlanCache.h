@@ -0,0 +1,112 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                       // std::atomic member.
+#include <list>                         // std::list member.
+#include <memory>                       // std::shared_ptr return value.
+#include <mutex>                        // std::mutex member.
+#include <string>                       // std::string parameter.
+#include <unordered_map>                // std::unordered_map member.
+#include <utility>                      // std::pair parameterizes std::list.
+
+#include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    class CompiledQuery;
+    class IIngestor;
+    class TermMatchNode;
+
+    //*************************************************************************
+    //
+    // PlanCache is a thread-safe, size-bounded cache of compiled query plans,
+    // evicting the least recently used plan when it is full.
+    //
+    // Plans are keyed by a canonical form of the TermMatchNode tree in which
+    // nested And and Or nodes are flattened and their children sorted, so
+    // that queries such as "a b" and "b a" share a plan. A cached plan is
+    // discarded, and counted as an invalidation, when it is looked up after
+    // one of the shards it was compiled for has been given a new ITermTable,
+    // as reported by IShard::GetTermTableGeneration().
+    //
+    // Plans are held by std::shared_ptr so that a plan evicted by one thread
+    // stays alive while another thread is still running it. A PlanCache may
+    // be shared by several QueryPipelines on the same IIngestor.
+    //
+    //*************************************************************************
+    class PlanCache : NonCopyable
+    {
+    public:
+        // Constructs a cache that holds at most capacity plans. A capacity
+        // of zero disables caching.
+        PlanCache(size_t capacity);
+
+        ~PlanCache();
+
+        size_t GetCapacity() const;
+        size_t GetEntryCount() const;
+
+        size_t GetHitCount() const;
+        size_t GetMissCount() const;
+        size_t GetInvalidationCount() const;
+
+        // Returns hits / (hits + misses), or zero before the first lookup.
+        double GetHitRate() const;
+
+        // Removes every plan. The counters are not reset.
+        void Clear();
+
+        // Returns the key under which plans for query are cached.
+        static std::string GetCanonicalKey(TermMatchNode const & query);
+
+    private:
+        friend class QueryPipeline;
+
+        typedef std::shared_ptr<CompiledQuery const> Plan;
+
+        // Returns the plan cached under key, or nullptr if there is none or
+        // the cached plan is no longer current for ingestor.
+        Plan Find(std::string const & key, IIngestor const & ingestor);
+
+        // Caches plan under key, evicting the least recently used plan if
+        // the cache is full.
+        void Add(std::string const & key, Plan plan);
+
+        typedef std::list<std::pair<std::string, Plan>> EntryList;
+
+        const size_t m_capacity;
+
+        // Protects m_entries and m_index.
+        mutable std::mutex m_lock;
+
+        // Most recently used first.
+        EntryList m_entries;
+        std::unordered_map<std::string, EntryList::iterator> m_index;
+
+        std::atomic<size_t> m_hitCount;
+        std::atomic<size_t> m_missCount;
+        std::atomic<size_t> m_invalidationCount;
+    };
+}
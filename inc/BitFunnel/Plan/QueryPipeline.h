@@ -23,22 +23,176 @@
 #pragma once
 
 #include <memory>                               // std::unique_ptr embedded.
+#include <vector>                               // std::vector parameter.
 
 #include "BitFunnel/Allocators/IAllocator.h"    // Template parameter.
+#include "BitFunnel/BitFunnelTypes.h"           // DocId parameter.
+#include "BitFunnel/Plan/PlanCache.h"           // PlanCache embedded.
 
 
 namespace BitFunnel
 {
+    class CompiledQuery;
+    class IConfiguration;
+    class IIngestor;
+    class IWorkStealingPool;
+    class MatchLimit;
     class TermMatchNode;
 
+    //*************************************************************************
+    //
+    // QueryPipeline parses queries and matches them against the documents
+    // in an IIngestor.
+    //
+    // Match() converts the query to a RowMatchNode plan, rewrites and
+    // compiles it with the RankDown compiler, and then runs the compiled
+    // plan over the slice buffers of each shard. The plan is run as native
+    // code where the platform supports it, and with the
+    // ByteCodeInterpreter otherwise. Plans that are a simple conjunction of
+    // rank zero rows bypass the compiler and are matched by intersecting
+    // whole rows with the vectorized RowKernel.
+    //
+    // If the QueryPipeline is given an IWorkStealingPool, the slices of
+    // each shard are spread across the pool's threads, and each thread
+    // collects its matches in its own buffer. Small queries are run on the
+    // calling thread to avoid the cost of dispatching them.
+    //
+    // Compiled plans are kept in a PlanCache, so repeated queries skip
+    // planning and compilation. Each QueryPipeline has its own cache, but
+    // pipelines on the same IIngestor and IConfiguration can be pointed at
+    // a shared cache with SetPlanCache().
+    //
+    // A query may be given a Budget, which caps the number of matches and
+    // optionally the time spent matching. Once the budget is exhausted, the
+    // matchers stop scanning slices and Match() reports a partial result.
+    //
+    // QueryPipeline is not thread-safe. Use one instance per thread.
+    //
+    //*************************************************************************
     class QueryPipeline
     {
     public:
+        // Limits the work done by a call to Match(). Matching stops at the
+        // end of the first slice in which the number of matches reaches
+        // maxMatches or the deadline, maxSeconds after the start of the
+        // match, passes. A maxSeconds of zero means there is no deadline.
+        class Budget
+        {
+        public:
+            Budget(size_t maxMatches, double maxSeconds = 0.0);
+
+            size_t GetMaxMatches() const;
+            double GetMaxSeconds() const;
+
+        private:
+            size_t m_maxMatches;
+            double m_maxSeconds;
+        };
+
+        // Constructs a QueryPipeline that can only parse queries.
         QueryPipeline();
 
+        // Constructs a QueryPipeline that can parse and match queries. If
+        // useNativeCode is false, or native code is not supported on this
+        // platform, plans are run with the ByteCodeInterpreter. If threadPool
+        // is not nullptr, shards whose plan rows hold at least
+        // minParallelQuadwords quadwords are matched in parallel. The
+        // threadPool may be shared by several QueryPipelines.
+        QueryPipeline(IIngestor const & ingestor,
+                      IConfiguration const & configuration,
+                      bool useNativeCode = true,
+                      IWorkStealingPool * threadPool = nullptr,
+                      size_t minParallelQuadwords = c_minParallelQuadwords);
+
         TermMatchNode const * ParseQuery(char const * query);
 
+        // Returns the PlanCache used by Match() and MatchBatch(), or nullptr
+        // if caching is disabled.
+        PlanCache * GetPlanCache() const;
+
+        // Replaces the PlanCache, which must outlive the QueryPipeline. A
+        // nullptr disables caching.
+        void SetPlanCache(PlanCache * planCache);
+
+        // Frees the trees returned by earlier calls to ParseQuery(). Callers
+        // that parse a long stream of queries should call ResetQueries()
+        // after each query to keep from exhausting the parse tree allocator.
+        void ResetQueries();
+
+        // Appends the DocIds of the documents that match the query to
+        // matches. Throws if the pipeline was constructed without an
+        // IIngestor.
+        void Match(TermMatchNode const & query, std::vector<DocId>& matches);
+
+        // Appends the DocIds of at most budget.GetMaxMatches() documents that
+        // match the query to matches. Returns true if matching stopped
+        // because the budget was exhausted, in which case the matches may be
+        // incomplete.
+        bool Match(TermMatchNode const & query,
+                   std::vector<DocId>& matches,
+                   Budget const & budget);
+
+        // Matches a batch of queries in a single pass over the index. Each
+        // slice is matched against every query before moving on to the next
+        // slice, so the rows that the queries share, such as the
+        // document-active row, are read from memory once per batch instead
+        // of once per query. On return, matches[i] holds the DocIds of the
+        // documents that match queries[i].
+        void MatchBatch(std::vector<TermMatchNode const *> const & queries,
+                        std::vector<std::vector<DocId>>& matches);
+
+        // Returns the number of rows in the plan for the most recent call
+        // to Match(), or the total over the batch for MatchBatch().
+        size_t GetRowCount() const;
+
+        // Returns the number of quadwords in the plan's rows, summed over
+        // every slice in every shard, for the most recent call to Match() or
+        // MatchBatch().
+        // This is an upper bound on the quadwords the matcher reads, since
+        // the RankDown plan skips lower rank rows when higher rank rows are
+        // zero.
+        size_t GetQuadwordCount() const;
+
+        // Parameters for MatchTreeRewriter::Rewrite().
+        static const unsigned c_targetRowCount = 6;
+        static const unsigned c_targetCrossProductTermCount = 16;
+
+        // Default size, in quadwords of plan rows per shard, below which a
+        // query is not split across threads.
+        static const size_t c_minParallelQuadwords = 64 * 1024;
+
+        // Number of plans held by each QueryPipeline's own PlanCache.
+        static const size_t c_defaultPlanCacheCapacity = 1024;
+
     private:
+        // Matches the queries. If limits[i] is not nullptr, matching for
+        // queries[i] stops once it is exhausted.
+        void MatchBatch(std::vector<TermMatchNode const *> const & queries,
+                        std::vector<MatchLimit *> const & limits,
+                        std::vector<std::vector<DocId>>& matches);
+
+        // Returns the cached plan for query, compiling and caching it if
+        // there is none.
+        std::shared_ptr<CompiledQuery const> GetPlan(TermMatchNode const & query);
+
+        IIngestor const * m_ingestor;
+        IConfiguration const * m_configuration;
+        bool m_useNativeCode;
+
+        // Statistics for the most recent call to Match().
+        size_t m_rowCount;
+        size_t m_quadwordCount;
+
+        IWorkStealingPool * m_threadPool;
+        size_t m_minParallelQuadwords;
+
         std::unique_ptr<IAllocator> m_allocator;
+
+        // Scratch allocator for the plan trees built while compiling a
+        // query. Reset before each compilation.
+        std::unique_ptr<IAllocator> m_planAllocator;
+
+        PlanCache m_ownedPlanCache;
+        PlanCache * m_planCache;
     };
 }
@@ -66,6 +66,7 @@ namespace BitFunnel
     private:
         std::condition_variable m_enqueueCond;
         std::condition_variable m_dequeueCond;
+        std::condition_variable m_finishedCond;
         std::mutex m_lock;
 
         size_t m_capacity;
@@ -108,17 +109,21 @@ namespace BitFunnel
     template <typename T>
     void BlockingQueue<T>::Shutdown()
     {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_shutdown = true;
+        if (m_queue.empty())
         {
-            std::lock_guard<std::mutex> lock(m_lock);
-            m_shutdown = true;
-            if (m_queue.empty())
-            {
-                m_finished = true;
-            }
+            m_finished = true;
         }
         m_dequeueCond.notify_all();
         m_enqueueCond.notify_all();
-        while (!m_finished) {}
+
+        // Sleep, rather than spin, while the consumers drain the queue, so
+        // that the caller does not compete with them for a core.
+        while (!m_finished)
+        {
+            m_finishedCond.wait(lock);
+        }
     }
 
 
@@ -154,6 +159,7 @@ namespace BitFunnel
         if (m_shutdown && m_queue.empty())
         {
             m_finished = true;
+            m_finishedCond.notify_all();
             return false;
         }
         value = std::move(m_queue.front());
@@ -162,6 +168,7 @@ namespace BitFunnel
         if (m_shutdown && m_queue.empty())
         {
             m_finished = true;
+            m_finishedCond.notify_all();
         }
         return true;
     }
@@ -27,6 +27,7 @@
 
 #include "ITaskDistributor.h"
 #include "IThreadManager.h"
+#include "IWorkStealingPool.h"
 
 namespace BitFunnel
 {
@@ -48,5 +49,10 @@ namespace BitFunnel
             const std::vector<IThreadBase*>& threads);
 
         std::unique_ptr<ITokenManager> CreateTokenManager();
+
+        // Starts threadCount threads. The calling thread of each Run() also
+        // processes tasks, so threadCount may be zero.
+        std::unique_ptr<IWorkStealingPool>
+            CreateWorkStealingPool(size_t threadCount);
     }
 }
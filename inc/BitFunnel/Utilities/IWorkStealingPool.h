@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>     // size_t parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // IWorkStealingProcessor is an abstract base class or interface for
+    // objects that process the numbered tasks handed out by an
+    // IWorkStealingPool.
+    //
+    // ProcessTask() is called concurrently from several threads, but never
+    // concurrently for the same worker id, so implementations can keep
+    // per-worker state, such as result buffers, without locking.
+    //
+    //*************************************************************************
+    class IWorkStealingProcessor
+    {
+    public:
+        virtual ~IWorkStealingProcessor() {}
+
+        virtual void ProcessTask(size_t worker, size_t taskId) = 0;
+    };
+
+
+    //*************************************************************************
+    //
+    // IWorkStealingPool is an abstract base class or interface for a pool of
+    // long-lived threads that cooperate with the calling thread to process a
+    // range of numbered tasks.
+    //
+    // Each worker starts with a contiguous share of the task range and takes
+    // tasks from the front of its share. A worker that runs out of tasks
+    // steals the back half of another worker's remaining share, so the load
+    // balances itself when tasks take different amounts of time.
+    //
+    //*************************************************************************
+    class IWorkStealingPool
+    {
+    public:
+        virtual ~IWorkStealingPool() {}
+
+        // Returns the number of worker ids passed to ProcessTask(). This is
+        // one more than the number of threads in the pool, since the thread
+        // that calls Run() also processes tasks as worker 0.
+        virtual size_t GetWorkerCount() const = 0;
+
+        // Calls processor.ProcessTask() once for each task id in
+        // [0, taskCount) and returns when all of the tasks have been
+        // processed. If another thread's call to Run() is in progress, all
+        // of the tasks are processed on the calling thread as worker 0. If
+        // ProcessTask() throws, the remaining tasks are abandoned and the
+        // exception is rethrown on the calling thread.
+        virtual void Run(IWorkStealingProcessor & processor,
+                         size_t taskCount) = 0;
+    };
+}
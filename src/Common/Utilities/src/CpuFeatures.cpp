@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "CpuFeatures.h"
+
+
+namespace BitFunnel
+{
+    namespace CpuFeatures
+    {
+        //*********************************************************************
+        //
+        // Features records the instruction sets reported by the processor.
+        //
+        //*********************************************************************
+        class Features
+        {
+        public:
+            Features();
+
+            bool m_sse2;
+            bool m_avx2;
+            bool m_avx512f;
+        };
+
+
+        Features::Features()
+            : m_sse2(false),
+              m_avx2(false),
+              m_avx512f(false)
+        {
+#if defined(_M_X64)
+            // SSE2 is part of the x64 baseline.
+            m_sse2 = true;
+
+            int info[4];
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (osxsave)
+            {
+                // Check that the OS saves the YMM, and for AVX-512 the ZMM
+                // and opmask, registers on context switches.
+                const unsigned long long xcr0 = _xgetbv(0);
+                __cpuidex(info, 7, 0);
+                m_avx2 = ((xcr0 & 0x6) == 0x6) && ((info[1] & (1 << 5)) != 0);
+                m_avx512f = ((xcr0 & 0xE6) == 0xE6) && ((info[1] & (1 << 16)) != 0);
+            }
+#elif defined(__x86_64__)
+            // SSE2 is part of the x86-64 baseline. __builtin_cpu_supports()
+            // also checks for operating system support of the wider
+            // registers.
+            m_sse2 = true;
+
+            __builtin_cpu_init();
+            m_avx2 = __builtin_cpu_supports("avx2") != 0;
+            m_avx512f = __builtin_cpu_supports("avx512f") != 0;
+#endif
+        }
+
+
+        static Features const & GetFeatures()
+        {
+            static const Features c_features;
+            return c_features;
+        }
+
+
+        bool HasSSE2()
+        {
+            return GetFeatures().m_sse2;
+        }
+
+
+        bool HasAVX2()
+        {
+            return GetFeatures().m_avx2;
+        }
+
+
+        bool HasAVX512F()
+        {
+            return GetFeatures().m_avx512f;
+        }
+    }
+}
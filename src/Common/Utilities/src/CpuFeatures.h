@@ -0,0 +1,62 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+//*****************************************************************************
+//
+// Runtime detection of the x64 vector instruction sets.
+//
+// On x64, BITFUNNEL_CPU_X64 is defined and the compiler's intrinsics header
+// is included. BITFUNNEL_TARGET(isa) marks a function that is compiled for
+// the instruction set isa (e.g. "avx2"), even though the rest of the program
+// targets the x64 baseline. Such a function must only be called after
+// checking that the processor supports isa. With MSVC, which allows
+// intrinsics from any instruction set, BITFUNNEL_TARGET expands to nothing.
+//
+//*****************************************************************************
+
+#if defined(_M_X64)
+#define BITFUNNEL_CPU_X64
+#include <intrin.h>
+#define BITFUNNEL_TARGET(isa)
+#elif defined(__x86_64__)
+#define BITFUNNEL_CPU_X64
+#include <immintrin.h>
+#define BITFUNNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+namespace BitFunnel
+{
+    namespace CpuFeatures
+    {
+        // Each function returns true if both the processor and the operating
+        // system support the instruction set. The operating system must save
+        // the wider registers on context switches. The processor is queried
+        // once, on the first call. All of them return false on processors
+        // other than x64.
+        bool HasSSE2();
+        bool HasAVX2();
+        bool HasAVX512F();
+    }
+}
@@ -0,0 +1,249 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <algorithm>
+#include <Windows.h>    // For CreateFileMapping/MapViewOfFile.
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>      // For open.
+#include <sys/mman.h>   // For mmap/madvise/munmap.
+#include <sys/stat.h>   // For fstat.
+#include <unistd.h>     // For close, sysconf.
+#endif
+
+#include <sstream>
+
+#include "BitFunnel/Exceptions.h"
+#include "MemoryMappedFile.h"
+
+
+namespace BitFunnel
+{
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+    MemoryMappedFile::MemoryMappedFile(char const * path,
+                                       AccessPattern accessPattern)
+        : m_data(nullptr),
+          m_size(0),
+          m_file(INVALID_HANDLE_VALUE),
+          m_mapping(nullptr)
+    {
+        const DWORD flags =
+            (accessPattern == Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN :
+            (accessPattern == Random) ? FILE_FLAG_RANDOM_ACCESS :
+            FILE_ATTRIBUTE_NORMAL;
+
+        m_file = CreateFileA(path,
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             flags,
+                             nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            std::stringstream message;
+            message << "MemoryMappedFile: failed to open '" << path << "'.";
+            RecoverableError error(message.str());
+            throw error;
+        }
+
+        LARGE_INTEGER size;
+        GetFileSizeEx(m_file, &size);
+        m_size = static_cast<size_t>(size.QuadPart);
+
+        if (m_size > 0)
+        {
+            m_mapping = CreateFileMappingA(m_file,
+                                           nullptr,
+                                           PAGE_READONLY,
+                                           0,
+                                           0,
+                                           nullptr);
+            if (m_mapping != nullptr)
+            {
+                m_data = static_cast<char const *>(
+                    MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+
+            if (m_data == nullptr)
+            {
+                if (m_mapping != nullptr)
+                {
+                    CloseHandle(m_mapping);
+                }
+                CloseHandle(m_file);
+
+                std::stringstream message;
+                message << "MemoryMappedFile: failed to map '" << path << "'.";
+                RecoverableError error(message.str());
+                throw error;
+            }
+        }
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+        }
+        CloseHandle(m_file);
+    }
+
+
+    void MemoryMappedFile::WillNeed(size_t offset, size_t size) const
+    {
+        if (m_data != nullptr && offset < m_size)
+        {
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = const_cast<char *>(m_data) + offset;
+            range.NumberOfBytes = (std::min)(size, m_size - offset);
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        }
+    }
+
+
+    void MemoryMappedFile::DontNeed(size_t /*offset*/, size_t /*size*/) const
+    {
+        // Windows trims the pages of a read-only view on its own.
+    }
+#else
+    MemoryMappedFile::MemoryMappedFile(char const * path,
+                                       AccessPattern accessPattern)
+        : m_data(nullptr),
+          m_size(0)
+    {
+        const int file = open(path, O_RDONLY);
+        if (file == -1)
+        {
+            std::stringstream message;
+            message << "MemoryMappedFile: failed to open '" << path << "': "
+                    << std::strerror(errno);
+            RecoverableError error(message.str());
+            throw error;
+        }
+
+        struct stat status;
+        if (fstat(file, &status) == -1)
+        {
+            const int code = errno;
+            close(file);
+
+            std::stringstream message;
+            message << "MemoryMappedFile: failed to stat '" << path << "': "
+                    << std::strerror(code);
+            RecoverableError error(message.str());
+            throw error;
+        }
+        m_size = static_cast<size_t>(status.st_size);
+
+        if (m_size > 0)
+        {
+            void * data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data == MAP_FAILED)
+            {
+                const int code = errno;
+                close(file);
+
+                std::stringstream message;
+                message << "MemoryMappedFile: failed to map '" << path << "': "
+                        << std::strerror(code);
+                RecoverableError error(message.str());
+                throw error;
+            }
+            m_data = static_cast<char const *>(data);
+        }
+
+        // The mapping holds its own reference to the file.
+        close(file);
+
+        if (accessPattern == Sequential)
+        {
+            Advise(0, m_size, MADV_SEQUENTIAL);
+            WillNeed(0, m_size);
+        }
+        else if (accessPattern == Random)
+        {
+            Advise(0, m_size, MADV_RANDOM);
+        }
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+    }
+
+
+    void MemoryMappedFile::WillNeed(size_t offset, size_t size) const
+    {
+        Advise(offset, size, MADV_WILLNEED);
+    }
+
+
+    void MemoryMappedFile::DontNeed(size_t offset, size_t size) const
+    {
+        Advise(offset, size, MADV_DONTNEED);
+    }
+
+
+    void MemoryMappedFile::Advise(size_t offset, size_t size, int advice) const
+    {
+        if (m_data == nullptr || offset >= m_size)
+        {
+            return;
+        }
+
+        // madvise() requires a page aligned address, so round the start of
+        // the range down to a page boundary.
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t start = offset & ~(pageSize - 1);
+        const size_t end = (size > m_size - offset) ? m_size : offset + size;
+
+        // Advice is only a hint, so failures are ignored.
+        madvise(const_cast<char *>(m_data) + start, end - start, advice);
+    }
+#endif
+
+
+    char const * MemoryMappedFile::GetData() const
+    {
+        return m_data;
+    }
+
+
+    size_t MemoryMappedFile::GetSize() const
+    {
+        return m_size;
+    }
+}
@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                      // size_t members.
+
+#include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MemoryMappedFile maps the contents of a file read-only into the address
+    // space of the process, so that it can be parsed in place instead of
+    // being copied into a buffer first. The file is unmapped when the
+    // MemoryMappedFile is destroyed.
+    //
+    // The AccessPattern is passed on to the operating system as a hint.
+    // Sequential enables aggressive read-ahead and starts reading the file
+    // in the background as soon as it is mapped.
+    //
+    //*************************************************************************
+    class MemoryMappedFile : NonCopyable
+    {
+    public:
+        enum AccessPattern
+        {
+            Normal,
+            Sequential,
+            Random
+        };
+
+        // Throws a RecoverableError if the file cannot be opened or mapped.
+        MemoryMappedFile(char const * path, AccessPattern accessPattern);
+
+        ~MemoryMappedFile();
+
+        // Returns the start of the mapped file. Returns nullptr if the file
+        // is empty.
+        char const * GetData() const;
+
+        // Returns the size of the file in bytes.
+        size_t GetSize() const;
+
+        // Hints that the pages in [offset, offset + size) will be read soon.
+        void WillNeed(size_t offset, size_t size) const;
+
+        // Hints that the pages in [offset, offset + size) will not be read
+        // again, so the operating system may reclaim them.
+        void DontNeed(size_t offset, size_t size) const;
+
+    private:
+        char const * m_data;
+        size_t m_size;
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        void * m_file;
+        void * m_mapping;
+#else
+        void Advise(size_t offset, size_t size, int advice) const;
+#endif
+    };
+}
@@ -0,0 +1,285 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <limits>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "WorkStealingPool.h"
+
+
+namespace BitFunnel
+{
+    std::unique_ptr<IWorkStealingPool>
+        Factories::CreateWorkStealingPool(size_t threadCount)
+    {
+        return std::unique_ptr<IWorkStealingPool>(
+            new WorkStealingPool(threadCount));
+    }
+
+
+    WorkStealingPool::WorkStealingPool(size_t threadCount)
+      : m_ranges(new Range[threadCount + 1]),
+        m_workerCount(threadCount + 1),
+        m_generation(0),
+        m_activeThreadCount(0),
+        m_shutdown(false),
+        m_processor(nullptr),
+        m_abort(false)
+    {
+        for (size_t i = 0; i < m_workerCount; ++i)
+        {
+            m_ranges[i].m_value = Pack(0, 0);
+        }
+
+        // Worker 0 is the thread that calls Run().
+        for (size_t i = 1; i < m_workerCount; ++i)
+        {
+            m_threads.push_back(new Thread(*this, i));
+        }
+        m_threadManager = Factories::CreateThreadManager(m_threads);
+    }
+
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_shutdown = true;
+        }
+        m_startCondition.notify_all();
+        m_threadManager->WaitForThreads();
+
+        for (auto thread : m_threads)
+        {
+            delete thread;
+        }
+    }
+
+
+    size_t WorkStealingPool::GetWorkerCount() const
+    {
+        return m_workerCount;
+    }
+
+
+    void WorkStealingPool::Run(IWorkStealingProcessor & processor,
+                               size_t taskCount)
+    {
+        if (taskCount > std::numeric_limits<uint32_t>::max())
+        {
+            RecoverableError error("WorkStealingPool::Run(): too many tasks.");
+            throw error;
+        }
+
+        std::unique_lock<std::mutex> runLock(m_runLock, std::try_to_lock);
+        if (!runLock.owns_lock() || m_threads.empty() || taskCount < 2)
+        {
+            for (size_t taskId = 0; taskId < taskCount; ++taskId)
+            {
+                processor.ProcessTask(0, taskId);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            // Give each worker a contiguous share of the tasks.
+            for (size_t i = 0; i < m_workerCount; ++i)
+            {
+                m_ranges[i].m_value = Pack(taskCount * i / m_workerCount,
+                                           taskCount * (i + 1) / m_workerCount);
+            }
+
+            m_processor = &processor;
+            m_exception = nullptr;
+            m_abort = false;
+            m_activeThreadCount = m_threads.size();
+            ++m_generation;
+        }
+        m_startCondition.notify_all();
+
+        Work(0);
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            while (m_activeThreadCount > 0)
+            {
+                m_finishedCondition.wait(lock);
+            }
+            m_processor = nullptr;
+            exception = m_exception;
+            m_exception = nullptr;
+        }
+
+        if (exception != nullptr)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+
+    void WorkStealingPool::Work(size_t worker)
+    {
+        size_t taskId;
+        while (!m_abort)
+        {
+            if (TryTakeTask(worker, taskId))
+            {
+                try
+                {
+                    m_processor->ProcessTask(worker, taskId);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (m_exception == nullptr)
+                    {
+                        m_exception = std::current_exception();
+                    }
+                    m_abort = true;
+                }
+            }
+            else if (!TrySteal(worker))
+            {
+                break;
+            }
+        }
+    }
+
+
+    bool WorkStealingPool::TryTakeTask(size_t worker, size_t& taskId)
+    {
+        std::atomic<uint64_t> & range = m_ranges[worker].m_value;
+        uint64_t value = range.load();
+        for (;;)
+        {
+            const uint64_t begin = GetBegin(value);
+            const uint64_t end = GetEnd(value);
+            if (begin >= end)
+            {
+                return false;
+            }
+            if (range.compare_exchange_weak(value, Pack(begin + 1, end)))
+            {
+                taskId = static_cast<size_t>(begin);
+                return true;
+            }
+        }
+    }
+
+
+    bool WorkStealingPool::TrySteal(size_t worker)
+    {
+        for (size_t i = 1; i < m_workerCount; ++i)
+        {
+            std::atomic<uint64_t> & victim =
+                m_ranges[(worker + i) % m_workerCount].m_value;
+            uint64_t value = victim.load();
+            for (;;)
+            {
+                const uint64_t begin = GetBegin(value);
+                const uint64_t end = GetEnd(value);
+                if (begin >= end)
+                {
+                    break;
+                }
+
+                // Take the back half, rounding up so that a single remaining
+                // task can be stolen.
+                const uint64_t middle = begin + (end - begin) / 2;
+                if (victim.compare_exchange_weak(value, Pack(begin, middle)))
+                {
+                    // Only this worker takes tasks from its own range, and
+                    // thieves ignore it while it is empty, so a plain store
+                    // is safe.
+                    m_ranges[worker].m_value = Pack(middle, end);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+
+    uint64_t WorkStealingPool::Pack(uint64_t begin, uint64_t end)
+    {
+        return (end << 32) | begin;
+    }
+
+
+    uint64_t WorkStealingPool::GetBegin(uint64_t range)
+    {
+        return range & 0xffffffff;
+    }
+
+
+    uint64_t WorkStealingPool::GetEnd(uint64_t range)
+    {
+        return range >> 32;
+    }
+
+
+    //*************************************************************************
+    //
+    // WorkStealingPool::Thread
+    //
+    //*************************************************************************
+    WorkStealingPool::Thread::Thread(WorkStealingPool& pool, size_t worker)
+      : m_pool(pool),
+        m_worker(worker)
+    {
+    }
+
+
+    void WorkStealingPool::Thread::EntryPoint()
+    {
+        size_t generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_pool.m_lock);
+                while (!m_pool.m_shutdown && m_pool.m_generation == generation)
+                {
+                    m_pool.m_startCondition.wait(lock);
+                }
+                if (m_pool.m_shutdown)
+                {
+                    return;
+                }
+                generation = m_pool.m_generation;
+            }
+
+            m_pool.Work(m_worker);
+
+            {
+                std::lock_guard<std::mutex> lock(m_pool.m_lock);
+                if (--m_pool.m_activeThreadCount == 0)
+                {
+                    m_pool.m_finishedCondition.notify_all();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                                   // std::atomic member.
+#include <condition_variable>                       // std::condition_variable member.
+#include <exception>                                // std::exception_ptr member.
+#include <memory>                                   // std::unique_ptr member.
+#include <mutex>                                    // std::mutex member.
+#include <stdint.h>                                 // uint64_t member.
+#include <vector>                                   // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"                  // Inherits from NonCopyable.
+#include "BitFunnel/Utilities/IThreadManager.h"     // IThreadBase base class.
+#include "BitFunnel/Utilities/IWorkStealingPool.h"  // Inherits from IWorkStealingPool.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // WorkStealingPool
+    //
+    // Implementation of IWorkStealingPool.
+    //
+    // Each worker's remaining share of the task range is kept as a
+    // [begin, end) pair packed into a single 64-bit atomic, so that the
+    // owner taking a task from the front and a thief taking the back half
+    // are each a single compare-and-swap. The pool threads sleep on a
+    // condition variable between calls to Run().
+    //
+    //*************************************************************************
+    class WorkStealingPool : public IWorkStealingPool, NonCopyable
+    {
+    public:
+        WorkStealingPool(size_t threadCount);
+
+        // Stops and joins the pool threads. Must not be called while Run()
+        // is in progress.
+        ~WorkStealingPool();
+
+        //
+        // IWorkStealingPool methods.
+        //
+        virtual size_t GetWorkerCount() const override;
+
+        virtual void Run(IWorkStealingProcessor & processor,
+                         size_t taskCount) override;
+
+    private:
+        class Thread : public IThreadBase
+        {
+        public:
+            Thread(WorkStealingPool& pool, size_t worker);
+
+            virtual void EntryPoint() override;
+
+        private:
+            WorkStealingPool& m_pool;
+            size_t m_worker;
+        };
+
+        // Processes tasks as the specified worker until none remain.
+        void Work(size_t worker);
+
+        // Takes the task at the front of the worker's own range.
+        bool TryTakeTask(size_t worker, size_t& taskId);
+
+        // Moves the back half of another worker's range to the worker's own
+        // range. Returns false if every range is empty.
+        bool TrySteal(size_t worker);
+
+        static uint64_t Pack(uint64_t begin, uint64_t end);
+        static uint64_t GetBegin(uint64_t range);
+        static uint64_t GetEnd(uint64_t range);
+
+        // Each range occupies its own cache line so that a worker taking
+        // tasks does not slow down its neighbors.
+        class Range
+        {
+        public:
+            std::atomic<uint64_t> m_value;
+            char m_padding[64 - sizeof(std::atomic<uint64_t>)];
+        };
+
+        std::unique_ptr<Range[]> m_ranges;
+        size_t m_workerCount;
+
+        // Held for the duration of Run(). Concurrent calls that fail to
+        // acquire it run on the calling thread instead.
+        std::mutex m_runLock;
+
+        // Protects the members below, which coordinate the pool threads
+        // with Run().
+        std::mutex m_lock;
+        std::condition_variable m_startCondition;
+        std::condition_variable m_finishedCondition;
+        size_t m_generation;
+        size_t m_activeThreadCount;
+        bool m_shutdown;
+        IWorkStealingProcessor * m_processor;
+        std::exception_ptr m_exception;
+
+        // Set when a task throws, so the other workers stop early.
+        std::atomic<bool> m_abort;
+
+        std::vector<IThreadBase*> m_threads;
+        std::unique_ptr<IThreadManager> m_threadManager;
+    };
+}
@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "MemoryMappedFile.h"
+#include "TemporaryFile.h"
+
+
+namespace BitFunnel
+{
+    namespace MemoryMappedFileTest
+    {
+        static void WriteFile(TemporaryFile const & file,
+                              std::string const & contents)
+        {
+            std::ofstream output(file.GetPath(), std::ios::binary);
+            output.write(contents.data(),
+                         static_cast<std::streamsize>(contents.size()));
+        }
+
+
+        TEST(MemoryMappedFile, Contents)
+        {
+            // Use a file larger than a page, with embedded '\0' characters.
+            std::string contents;
+            for (unsigned i = 0; i < 10000; ++i)
+            {
+                contents.push_back(static_cast<char>(i % 251));
+            }
+            TemporaryFile file("MemoryMappedFileTest");
+            WriteFile(file, contents);
+
+            MemoryMappedFile::AccessPattern patterns[] = {
+                MemoryMappedFile::Normal,
+                MemoryMappedFile::Sequential,
+                MemoryMappedFile::Random
+            };
+
+            for (auto pattern : patterns)
+            {
+                MemoryMappedFile mapped(file.GetPath(), pattern);
+                ASSERT_EQ(contents.size(), mapped.GetSize());
+                EXPECT_EQ(contents,
+                          std::string(mapped.GetData(), mapped.GetSize()));
+
+                // Hints, including ranges that run off the end of the file,
+                // must not disturb the contents.
+                mapped.WillNeed(5000, 100000);
+                mapped.DontNeed(0, 4096);
+                mapped.DontNeed(100000, 1);
+                EXPECT_EQ(contents,
+                          std::string(mapped.GetData(), mapped.GetSize()));
+            }
+        }
+
+
+        TEST(MemoryMappedFile, Empty)
+        {
+            TemporaryFile file("MemoryMappedFileTest");
+            WriteFile(file, "");
+
+            MemoryMappedFile mapped(file.GetPath(), MemoryMappedFile::Sequential);
+            EXPECT_EQ(0u, mapped.GetSize());
+            EXPECT_EQ(nullptr, mapped.GetData());
+        }
+
+
+        TEST(MemoryMappedFile, MissingFile)
+        {
+            // The file is never written, so it does not exist.
+            TemporaryFile file("MemoryMappedFileTest");
+            EXPECT_THROW(MemoryMappedFile(file.GetPath(),
+                                          MemoryMappedFile::Normal),
+                         RecoverableError);
+        }
+    }
+}
@@ -0,0 +1,183 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/NonCopyable.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IWorkStealingPool.h"
+
+
+namespace BitFunnel
+{
+    namespace WorkStealingPoolTest
+    {
+        class Processor : public IWorkStealingProcessor, NonCopyable
+        {
+        public:
+            Processor(size_t workerCount, size_t taskCount)
+              : m_workerCount(workerCount),
+                m_taskCounts(new std::atomic<unsigned>[taskCount]),
+                m_busy(new std::atomic<bool>[workerCount]),
+                m_errorCount(0)
+            {
+                for (size_t i = 0; i < taskCount; ++i)
+                {
+                    m_taskCounts[i] = 0;
+                }
+                for (size_t i = 0; i < workerCount; ++i)
+                {
+                    m_busy[i] = false;
+                }
+            }
+
+            virtual void ProcessTask(size_t worker, size_t taskId) override
+            {
+                if (worker >= m_workerCount)
+                {
+                    ++m_errorCount;
+                    return;
+                }
+
+                // No two threads should ever use the same worker id at
+                // the same time.
+                if (m_busy[worker].exchange(true))
+                {
+                    ++m_errorCount;
+                }
+
+                ++m_taskCounts[taskId];
+
+                // Make some tasks slower than others so that workers have
+                // a reason to steal.
+                if (taskId % 7 == 0)
+                {
+                    std::this_thread::yield();
+                }
+
+                m_busy[worker] = false;
+            }
+
+            unsigned GetTaskCount(size_t taskId) const
+            {
+                return m_taskCounts[taskId];
+            }
+
+            unsigned GetErrorCount() const
+            {
+                return m_errorCount;
+            }
+
+        private:
+            size_t m_workerCount;
+            std::unique_ptr<std::atomic<unsigned>[]> m_taskCounts;
+            std::unique_ptr<std::atomic<bool>[]> m_busy;
+            std::atomic<unsigned> m_errorCount;
+        };
+
+
+        class ThrowingProcessor : public IWorkStealingProcessor
+        {
+        public:
+            virtual void ProcessTask(size_t /*worker*/, size_t taskId) override
+            {
+                if (taskId == 37)
+                {
+                    RecoverableError error("ThrowingProcessor");
+                    throw error;
+                }
+            }
+        };
+
+
+        void RunTasks(IWorkStealingPool & pool, size_t taskCount)
+        {
+            Processor processor(pool.GetWorkerCount(), taskCount);
+            pool.Run(processor, taskCount);
+
+            EXPECT_EQ(0u, processor.GetErrorCount());
+            for (size_t i = 0; i < taskCount; ++i)
+            {
+                ASSERT_EQ(1u, processor.GetTaskCount(i)) << "task " << i;
+            }
+        }
+
+
+        TEST(WorkStealingPool, EveryTaskOnce)
+        {
+            const size_t threadCounts[] = { 0, 1, 3, 8 };
+            const size_t taskCounts[] = { 0, 1, 2, 5, 100, 10000 };
+
+            for (auto threadCount : threadCounts)
+            {
+                auto pool = Factories::CreateWorkStealingPool(threadCount);
+                EXPECT_EQ(threadCount + 1, pool->GetWorkerCount());
+
+                for (auto taskCount : taskCounts)
+                {
+                    RunTasks(*pool, taskCount);
+                }
+            }
+        }
+
+
+        TEST(WorkStealingPool, ConcurrentRuns)
+        {
+            auto pool = Factories::CreateWorkStealingPool(4);
+
+            std::vector<std::thread> threads;
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                threads.push_back(std::thread([&pool] ()
+                {
+                    for (unsigned j = 0; j < 20; ++j)
+                    {
+                        RunTasks(*pool, 1000);
+                    }
+                }));
+            }
+
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+
+        TEST(WorkStealingPool, Exception)
+        {
+            auto pool = Factories::CreateWorkStealingPool(3);
+
+            ThrowingProcessor processor;
+            EXPECT_THROW(pool->Run(processor, 1000), RecoverableError);
+
+            // The pool remains usable after an exception.
+            RunTasks(*pool, 1000);
+        }
+    }
+}
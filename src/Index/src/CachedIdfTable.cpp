@@ -0,0 +1,194 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "CachedIdfTable.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // CachedIdfTable::Counters
+    //
+    //*************************************************************************
+    class CachedIdfTable::Counters
+    {
+    public:
+        Counters()
+          : m_hitCount(0),
+            m_missCount(0)
+        {
+        }
+
+        std::atomic<size_t> m_hitCount;
+        std::atomic<size_t> m_missCount;
+    };
+
+
+    //*************************************************************************
+    //
+    // CachedIdfTable::ThreadCache
+    //
+    //*************************************************************************
+    class CachedIdfTable::ThreadCache
+    {
+    public:
+        ThreadCache()
+          : m_hitCount(0),
+            m_missCount(0)
+        {
+            Clear();
+        }
+
+        ~ThreadCache()
+        {
+            Flush();
+        }
+
+        void Clear()
+        {
+            for (size_t i = 0; i < c_size; ++i)
+            {
+                m_entries[i].m_isValid = false;
+            }
+        }
+
+        // Gives the cache, empty, to the CachedIdfTable that owns counters,
+        // after adding the counts for its previous owner.
+        void SetOwner(std::shared_ptr<Counters> const & counters)
+        {
+            Flush();
+            Clear();
+            m_owner = counters;
+        }
+
+        // Adds the counts to the owner's totals, and resets them.
+        void Flush()
+        {
+            if (m_owner)
+            {
+                m_owner->m_hitCount += m_hitCount;
+                m_owner->m_missCount += m_missCount;
+            }
+            m_hitCount = 0;
+            m_missCount = 0;
+        }
+
+        class Entry
+        {
+        public:
+            Term::Hash m_hash;
+            Term::IdfX10 m_idf;
+            bool m_isValid;
+        };
+
+        static const size_t c_size = 1ull << c_log2CacheSize;
+
+        // Totals of the CachedIdfTable whose entries the cache holds.
+        std::shared_ptr<Counters> m_owner;
+
+        // Counts not yet added to the owner's totals.
+        size_t m_hitCount;
+        size_t m_missCount;
+
+        Entry m_entries[c_size];
+    };
+
+
+    //*************************************************************************
+    //
+    // CachedIdfTable
+    //
+    //*************************************************************************
+    CachedIdfTable::CachedIdfTable(IIndexedIdfTable const & idfTable)
+      : m_idfTable(idfTable),
+        m_counters(new Counters())
+    {
+    }
+
+
+    Term::IdfX10 CachedIdfTable::GetIdf(Term::Hash hash) const
+    {
+        ThreadCache& cache = GetThreadCache();
+
+        // Term hashes are well mixed, so the low bits select the entry.
+        ThreadCache::Entry& entry = cache.m_entries[hash & (ThreadCache::c_size - 1)];
+
+        if (entry.m_isValid && entry.m_hash == hash)
+        {
+            ++cache.m_hitCount;
+        }
+        else
+        {
+            entry.m_hash = hash;
+            entry.m_idf = m_idfTable.GetIdf(hash);
+            entry.m_isValid = true;
+            ++cache.m_missCount;
+        }
+
+        const Term::IdfX10 idf = entry.m_idf;
+
+        if (cache.m_hitCount + cache.m_missCount >= c_flushInterval)
+        {
+            cache.Flush();
+        }
+
+        return idf;
+    }
+
+
+    size_t CachedIdfTable::GetHitCount() const
+    {
+        ThreadCache& cache = GetCallingThreadCache();
+        return m_counters->m_hitCount +
+               ((cache.m_owner == m_counters) ? cache.m_hitCount : 0);
+    }
+
+
+    size_t CachedIdfTable::GetMissCount() const
+    {
+        ThreadCache& cache = GetCallingThreadCache();
+        return m_counters->m_missCount +
+               ((cache.m_owner == m_counters) ? cache.m_missCount : 0);
+    }
+
+
+    CachedIdfTable::ThreadCache& CachedIdfTable::GetCallingThreadCache()
+    {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+
+
+    CachedIdfTable::ThreadCache& CachedIdfTable::GetThreadCache() const
+    {
+        ThreadCache& cache = GetCallingThreadCache();
+
+        if (cache.m_owner != m_counters)
+        {
+            cache.SetOwner(m_counters);
+        }
+
+        return cache;
+    }
+}
@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <atomic>                               // std::atomic member.
+#include <memory>                               // std::shared_ptr member.
+#include <stddef.h>                             // size_t return value.
+
+#include "BitFunnel/Index/IIndexedIdfTable.h"   // Base class.
+#include "BitFunnel/NonCopyable.h"              // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // CachedIdfTable
+    //
+    // An IIndexedIdfTable that puts a small, direct-mapped, per-thread cache
+    // in front of another IIndexedIdfTable. Term construction looks up the
+    // IDF of every token, and most tokens are a few thousand common terms.
+    // The cache keeps their IDFs close at hand, so the lookup does not probe
+    // the much larger underlying table.
+    //
+    // Each thread has one cache, which belongs to the CachedIdfTable that
+    // used it most recently. A thread that alternates between
+    // CachedIdfTables empties its cache each time it switches.
+    //
+    // Each thread counts its own hits and misses, and adds them to the
+    // CachedIdfTable's totals every c_flushInterval lookups, when its cache
+    // switches to another CachedIdfTable, and when the thread exits. The
+    // totals are shared with the thread caches, so that a cache can add its
+    // counts after the CachedIdfTable has been destroyed.
+    //
+    // Thread safety: all methods are thread safe. The underlying table's
+    // GetIdf() must be thread safe.
+    //
+    //*************************************************************************
+    class CachedIdfTable : public IIndexedIdfTable, NonCopyable
+    {
+    public:
+        CachedIdfTable(IIndexedIdfTable const & idfTable);
+
+        virtual Term::IdfX10 GetIdf(Term::Hash hash) const override;
+
+        // Returns the number of lookups answered from the cache, and the
+        // number passed on to the underlying table. These include all of
+        // the calling thread's lookups, all of the lookups of threads that
+        // have exited, but only the lookups other threads have added to the
+        // totals.
+        size_t GetHitCount() const;
+        size_t GetMissCount() const;
+
+        // log2 of the number of entries in each thread's cache.
+        static const unsigned c_log2CacheSize = 12;
+
+        // Number of lookups between additions to the totals.
+        static const size_t c_flushInterval = 4096;
+
+    private:
+        class Counters;
+        class ThreadCache;
+
+        // Returns the calling thread's cache, which may belong to any
+        // CachedIdfTable.
+        static ThreadCache& GetCallingThreadCache();
+
+        // Returns the calling thread's cache, after flushing and emptying it
+        // if it belonged to another CachedIdfTable.
+        ThreadCache& GetThreadCache() const;
+
+        IIndexedIdfTable const & m_idfTable;
+
+        // Totals of the counts added by the thread caches. The thread caches
+        // also use the Counters to identify their owner. Since a cache holds
+        // a reference to its owner's Counters, their address is not reused
+        // by a later CachedIdfTable while any cache refers to them.
+        std::shared_ptr<Counters> m_counters;
+    };
+}
@@ -29,16 +29,16 @@
 namespace BitFunnel
 {
     ChunkIngestor::ChunkIngestor(
-        std::vector<char> const & chunkData,
+        char const * start,
+        char const * end,
         IConfiguration const & config,
         IIngestor& ingestor,
         bool cacheDocuments)
       : m_config(config),
         m_ingestor(ingestor),
-        m_cacheDocuments(cacheDocuments),
-        m_chunkData(chunkData)
+        m_cacheDocuments(cacheDocuments)
     {
-        ChunkReader(m_chunkData, *this);
+        ChunkReader(start, end, *this);
     }
 
 
@@ -49,7 +49,16 @@ namespace BitFunnel
 
     void ChunkIngestor::OnDocumentEnter(DocId id)
     {
-        m_currentDocument.reset(new Document(m_config, id));
+        // Unless the documents are cached, reuse the previous Document and
+        // its storage.
+        if (m_currentDocument == nullptr)
+        {
+            m_currentDocument.reset(new Document(m_config, id));
+        }
+        else
+        {
+            m_currentDocument->Reset(id);
+        }
     }
 
 
@@ -81,10 +90,6 @@ namespace BitFunnel
             m_ingestor.GetDocumentCache().Add(std::move(m_currentDocument),
                                               id);
         }
-        else
-        {
-            m_currentDocument.reset(nullptr);
-        }
     }
 
 
@@ -23,7 +23,6 @@
 #pragma once
 
 #include <memory>                       // std::unqiue_ptr member.
-#include <vector>                       // std::vector member.
 
 #include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
 #include "ChunkReader.h"                // Inherits from ChunkReader::IEvents.
@@ -40,7 +39,9 @@ namespace BitFunnel
     class ChunkIngestor : public NonCopyable, public ChunkReader::IEvents
     {
     public:
-        ChunkIngestor(std::vector<char> const& chunkData,
+        // Parses the chunk in [start, end) and ingests its documents.
+        ChunkIngestor(char const * start,
+                      char const * end,
                       IConfiguration const & configuration,
                       IIngestor& ingestor,
                       bool cacheDocuments);
@@ -67,7 +68,6 @@ namespace BitFunnel
         //
         // Other members
         //
-        std::vector<char> const& m_chunkData;
         std::unique_ptr<Document> m_currentDocument;
     };
 }
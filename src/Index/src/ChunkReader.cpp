@@ -33,9 +33,19 @@ namespace BitFunnel
 
 
     ChunkReader::ChunkReader(std::vector<char> const & input, IEvents& processor)
+        : ChunkReader(input.data(), input.data() + input.size(), processor)
+    {
+    }
+
+
+    ChunkReader::ChunkReader(char const * start,
+                             char const * end,
+                             IEvents& processor,
+                             DelimiterScanner::InstructionSet instructionSet)
         : m_processor(processor),
-          m_next(&input[0]),
-          m_end(&input[0] + input.size())
+          m_scanner(instructionSet),
+          m_next(start),
+          m_end(end)
     {
         if (m_next == m_end) {
             throw FatalError("Attempt to read empty chunk.");
@@ -51,6 +61,57 @@ namespace BitFunnel
     }
 
 
+    ChunkReader::ChunkReader(char const * start,
+                             char const * end,
+                             IEvents& processor,
+                             bool /*isFragment*/)
+        : m_processor(processor),
+          m_scanner(),
+          m_next(start),
+          m_end(end)
+    {
+        while (m_next != m_end) {
+            ProcessDocument();
+        }
+    }
+
+
+    void ChunkReader::ReadDocuments(char const * start,
+                                    char const * end,
+                                    IEvents& processor)
+    {
+        ChunkReader(start, end, processor, true);
+    }
+
+
+    char const * ChunkReader::FindDocumentBoundary(char const * position,
+                                                   char const * end)
+    {
+        // A term can't contain '\0', so the only place three '\0' appear in
+        // a row is where the terminator of a document's last stream, or of
+        // its last term, is followed by the terminator of the document. If
+        // the next character is not another '\0', which would terminate the
+        // chunk, it begins the next document.
+        unsigned zeroCount = 0;
+        for (char const * p = position; p < end; ++p)
+        {
+            if (*p == 0)
+            {
+                ++zeroCount;
+            }
+            else
+            {
+                if (zeroCount == 3)
+                {
+                    return p;
+                }
+                zeroCount = 0;
+            }
+        }
+        return end;
+    }
+
+
     void ChunkReader::ProcessDocument()
     {
         char const * start = m_next;
@@ -70,29 +131,47 @@ namespace BitFunnel
     {
         Term::StreamId id = GetStreamId();
         m_processor.OnStreamEnter(id);
-        while (PeekChar() != 0) {
-            m_processor.OnTerm(GetToken());
-        }
-
-        Consume(0);
-
-        m_processor.OnStreamExit();
-    }
 
+        // Each term is terminated by a '\0', and the stream is terminated by
+        // an empty term. Rather than walking each term a byte at a time,
+        // locate the delimiters for a batch of terms at once and then pass
+        // the terms to the processor.
+        char const * delimiters[c_termBatchSize];
+        char const * terms[c_termBatchSize];
+        bool endOfStream = false;
+        while (!endOfStream)
+        {
+            const size_t delimiterCount =
+                m_scanner.Find(m_next, m_end, delimiters, c_termBatchSize);
+            if (delimiterCount == 0)
+            {
+                throw FatalError("Attempt to read beyond end of buffer.");
+            }
 
-    char const * ChunkReader::GetToken()
-    {
-        char const * begin = m_next;
+            size_t termCount = 0;
+            for (size_t i = 0; i < delimiterCount; ++i)
+            {
+                if (delimiters[i] == m_next)
+                {
+                    endOfStream = true;
+                    break;
+                }
+                terms[termCount++] = m_next;
+                m_next = delimiters[i] + 1;
+            }
 
-        while (PeekChar() != 0) {
-            GetChar();
+            for (size_t i = 0; i < termCount; ++i)
+            {
+                m_processor.OnTerm(terms[i]);
+            }
         }
 
         Consume(0);
 
-        return begin;
+        m_processor.OnStreamExit();
     }
 
+
     DocId ChunkReader::GetDocId()
     {
         static_assert(sizeof(DocId) * 2 == c_docIdDigitCount,
@@ -29,6 +29,7 @@
 #include "BitFunnel/IInterface.h"               // Base class.
 #include "BitFunnel/NonCopyable.h"              // Base class.
 #include "BitFunnel/Term.h"                     // Term::StreamId parameter.
+#include "DelimiterScanner.h"                   // DelimiterScanner member.
 
 
 namespace BitFunnel
@@ -55,10 +56,42 @@ namespace BitFunnel
 
         ChunkReader(std::vector<char> const & input, IEvents& processor);
 
+        // Parses the chunk in [start, end) in place. The token pointers
+        // passed to the processor point into this range. Terms are located
+        // with a DelimiterScanner for the specified instruction set.
+        ChunkReader(char const * start,
+                    char const * end,
+                    IEvents& processor,
+                    DelimiterScanner::InstructionSet instructionSet =
+                        DelimiterScanner::GetBestInstructionSet());
+
+        // Parses the documents in [start, end) in place. The range must
+        // begin at the start of a document and end just after the end of a
+        // document, for example at boundaries returned by
+        // FindDocumentBoundary(). Unlike a whole chunk, the range does not
+        // end with an extra '\0', and the processor's OnFileEnter() and
+        // OnFileExit() methods are not called.
+        static void ReadDocuments(char const * start,
+                                  char const * end,
+                                  IEvents& processor);
+
+        // Returns the start of the first document that begins after
+        // position in a chunk that ends at end, or end if there is none. This
+        // allows a large chunk to be split into ranges that can be passed to
+        // ReadDocuments() on different threads. Documents with no streams
+        // are never reported as boundaries.
+        static char const * FindDocumentBoundary(char const * position,
+                                                 char const * end);
+
     private:
+        // Parses a range of whole documents for ReadDocuments().
+        ChunkReader(char const * start,
+                    char const * end,
+                    IEvents& processor,
+                    bool isFragment);
+
         void ProcessDocument();
         void ProcessStream();
-        char const * GetToken();
 
         DocId GetDocId();
         Term::StreamId GetStreamId();
@@ -70,11 +103,16 @@ namespace BitFunnel
 
         // Construtor parameters.
         IEvents& m_processor;
+        DelimiterScanner m_scanner;
 
         // Next character to be processed.
         char const * m_next;
 
         // Pointer to character beyond the end of m_input.
         char const * m_end;
+
+        // Maximum number of terms located by each call to
+        // DelimiterScanner::Find().
+        static const size_t c_termBatchSize = 64;
     };
 }
@@ -21,12 +21,13 @@
 // THE SOFTWARE.
 
 #include <iostream>         // TODO: Remove this temporary header.
-#include <fstream>
+#include <memory>
 #include <sstream>
 
 #include "BitFunnel/Exceptions.h"
 #include "ChunkIngestor.h"
 #include "ChunkTaskProcessor.h"
+#include "MemoryMappedFile.h"
 
 
 namespace BitFunnel
@@ -59,8 +60,18 @@ namespace BitFunnel
         std::cout << "ChunkTaskProcessor::ProcessTask: filePath:"
                   << m_filePaths[taskId] << std::endl;
 
-        std::ifstream inputStream(m_filePaths[taskId], std::ios::binary);
-        if (!inputStream.is_open())
+        // Parse the chunk directly from the page cache instead of copying it
+        // into a buffer first. The file is mapped for sequential access, so
+        // the operating system reads ahead of the parser, and it is unmapped
+        // when chunkFile goes out of scope.
+        std::unique_ptr<MemoryMappedFile> chunkFile;
+        try
+        {
+            chunkFile.reset(
+                new MemoryMappedFile(m_filePaths[taskId].c_str(),
+                                     MemoryMappedFile::Sequential));
+        }
+        catch (RecoverableError const &)
         {
             std::stringstream message;
             message << "Failed to open chunk file '"
@@ -69,13 +80,13 @@ namespace BitFunnel
             throw FatalError(message.str());
         }
 
-        std::vector<char> chunkData(
-            (std::istreambuf_iterator<char>(inputStream)),
-            std::istreambuf_iterator<char>());
-
         // NOTE: The act of constructing a ChunkIngestor causes the bytes in
-        // chunkData to be parsed into documents and ingested.
-        ChunkIngestor(chunkData, m_config, m_ingestor, m_cacheDocuments);
+        // the chunk to be parsed into documents and ingested.
+        ChunkIngestor(chunkFile->GetData(),
+                      chunkFile->GetData() + chunkFile->GetSize(),
+                      m_config,
+                      m_ingestor,
+                      m_cacheDocuments);
     }
 
 
@@ -73,4 +73,16 @@ namespace BitFunnel
     {
         return m_idfTable;
     }
+
+
+    size_t Configuration::GetIdfCacheHitCount() const
+    {
+        return m_idfTable.GetHitCount();
+    }
+
+
+    size_t Configuration::GetIdfCacheMissCount() const
+    {
+        return m_idfTable.GetMissCount();
+    }
 }
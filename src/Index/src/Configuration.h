@@ -25,6 +25,7 @@
 #include <memory>                               // Embeds std::unique_ptr.
 
 #include "BitFunnel/Index/IConfiguration.h"     // Inherits from IConfiguration.
+#include "CachedIdfTable.h"                     // Embeds CachedIdfTable.
 #include "TermToText.h"                         // Parameterizes std::unique_ptr.
 
 
@@ -52,11 +53,17 @@ namespace BitFunnel
         // Returns an IIndexedIdfTable used to set the IDF values in each
         // Term as it is constructed. The IIndexedIdfTable should be
         // representative of the distribution of terms in the corpus.
+        // The returned table caches the IDFs each thread looks up most.
         virtual IIndexedIdfTable const & GetIdfTable() const override;
 
+        // Returns the hit and miss counts of the table returned by
+        // GetIdfTable().
+        virtual size_t GetIdfCacheHitCount() const override;
+        virtual size_t GetIdfCacheMissCount() const override;
+
     private:
         size_t m_maxGramSize;
         std::unique_ptr<TermToText> m_termToText;
-        IIndexedIdfTable const & m_idfTable;
+        CachedIdfTable m_idfTable;
     };
 }
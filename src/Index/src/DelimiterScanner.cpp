@@ -0,0 +1,209 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "BitFunnel/Exceptions.h"
+#include "CpuFeatures.h"
+#include "DelimiterScanner.h"
+
+
+namespace BitFunnel
+{
+    // Scans [begin, end) one byte at a time. Also used to finish the bytes
+    // left over after the last full vector.
+    static size_t FindScalar(char const * begin,
+                             char const * end,
+                             char const ** delimiters,
+                             size_t capacity)
+    {
+        size_t count = 0;
+        for (char const * p = begin; p < end && count < capacity; ++p)
+        {
+            if (*p == 0)
+            {
+                delimiters[count++] = p;
+            }
+        }
+        return count;
+    }
+
+
+#ifdef BITFUNNEL_CPU_X64
+    static unsigned CountTrailingZeros(unsigned mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+
+    // Appends the positions of the bits set in mask, relative to base, to
+    // delimiters. Returns false if delimiters fills up.
+    static bool AppendDelimiters(unsigned mask,
+                                 char const * base,
+                                 char const ** delimiters,
+                                 size_t capacity,
+                                 size_t & count)
+    {
+        while (mask != 0)
+        {
+            delimiters[count++] = base + CountTrailingZeros(mask);
+            if (count == capacity)
+            {
+                return false;
+            }
+            mask &= mask - 1;
+        }
+        return true;
+    }
+
+
+    // SCAN_LOOP compares each full vector of [begin, end) with zero, using
+    // the EXPRESSION that evaluates to a bit mask of the zero bytes in the
+    // vector at p, and then hands the remaining bytes to FindScalar.
+#define SCAN_LOOP(VECTOR_SIZE, EXPRESSION)                                  \
+        size_t count = 0;                                                   \
+        if (capacity == 0)                                                  \
+        {                                                                   \
+            return 0;                                                       \
+        }                                                                   \
+        char const * p = begin;                                             \
+        for (; end - p >= VECTOR_SIZE; p += VECTOR_SIZE)                    \
+        {                                                                   \
+            const unsigned mask = static_cast<unsigned>(EXPRESSION);        \
+            if (!AppendDelimiters(mask, p, delimiters, capacity, count))    \
+            {                                                               \
+                return count;                                               \
+            }                                                               \
+        }                                                                   \
+        return count + FindScalar(p, end, delimiters + count, capacity - count);
+
+
+    BITFUNNEL_TARGET("sse2")
+    static size_t FindSSE2(char const * begin,
+                           char const * end,
+                           char const ** delimiters,
+                           size_t capacity)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        SCAN_LOOP(16,
+                  _mm_movemask_epi8(
+                      _mm_cmpeq_epi8(
+                          _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)),
+                          zero)));
+    }
+
+
+    BITFUNNEL_TARGET("avx2")
+    static size_t FindAVX2(char const * begin,
+                           char const * end,
+                           char const ** delimiters,
+                           size_t capacity)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        SCAN_LOOP(32,
+                  _mm256_movemask_epi8(
+                      _mm256_cmpeq_epi8(
+                          _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)),
+                          zero)));
+    }
+
+#undef SCAN_LOOP
+#endif
+
+
+    DelimiterScanner::DelimiterScanner()
+        : DelimiterScanner(GetBestInstructionSet())
+    {
+    }
+
+
+    DelimiterScanner::DelimiterScanner(InstructionSet instructionSet)
+        : m_instructionSet(instructionSet)
+    {
+        if (!IsSupported(instructionSet))
+        {
+            RecoverableError error("DelimiterScanner: instruction set not supported.");
+            throw error;
+        }
+
+        switch (instructionSet)
+        {
+#ifdef BITFUNNEL_CPU_X64
+        case SSE2:
+            m_find = FindSSE2;
+            break;
+        case AVX2:
+            m_find = FindAVX2;
+            break;
+#endif
+        default:
+            m_find = FindScalar;
+            break;
+        }
+    }
+
+
+    DelimiterScanner::InstructionSet DelimiterScanner::GetInstructionSet() const
+    {
+        return m_instructionSet;
+    }
+
+
+    DelimiterScanner::InstructionSet DelimiterScanner::GetBestInstructionSet()
+    {
+        // Checking the processor on every call would cost more than
+        // scanning a short chunk, so the answer is computed once.
+        static const InstructionSet c_best =
+            IsSupported(AVX2) ? AVX2 : (IsSupported(SSE2) ? SSE2 : Scalar);
+        return c_best;
+    }
+
+
+    bool DelimiterScanner::IsSupported(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+        case Scalar:
+            return true;
+        case SSE2:
+            return CpuFeatures::HasSSE2();
+        case AVX2:
+            return CpuFeatures::HasAVX2();
+        default:
+            return false;
+        }
+    }
+
+
+    size_t DelimiterScanner::Find(char const * begin,
+                                  char const * end,
+                                  char const ** delimiters,
+                                  size_t capacity) const
+    {
+        return m_find(begin, end, delimiters, capacity);
+    }
+}
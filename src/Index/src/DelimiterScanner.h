@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // size_t parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // DelimiterScanner finds the '\0' characters that delimit tokens in the
+    // chunk format, comparing 16 or 32 bytes at a time with vector
+    // instructions.
+    //
+    // The instruction set is selected at runtime. The default constructor
+    // picks the best one available. The Scalar scanner examines one byte at
+    // a time and serves as a reference for verifying the vector scanners.
+    //
+    //*************************************************************************
+    class DelimiterScanner
+    {
+    public:
+        enum InstructionSet
+        {
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        // Constructs a DelimiterScanner for the best available instruction
+        // set.
+        DelimiterScanner();
+
+        // Constructs a DelimiterScanner for a specific instruction set.
+        // Throws if the instruction set is not supported.
+        DelimiterScanner(InstructionSet instructionSet);
+
+        InstructionSet GetInstructionSet() const;
+
+        // Returns the best instruction set supported by the processor and
+        // the operating system.
+        static InstructionSet GetBestInstructionSet();
+
+        // Returns true if the instruction set can be used.
+        static bool IsSupported(InstructionSet instructionSet);
+
+        // Writes pointers to the first capacity '\0' characters in
+        // [begin, end) to delimiters, in order, and returns the number
+        // written. Never reads outside of [begin, end).
+        size_t Find(char const * begin,
+                    char const * end,
+                    char const ** delimiters,
+                    size_t capacity) const;
+
+    private:
+        typedef size_t (*Function)(char const * begin,
+                                   char const * end,
+                                   char const ** delimiters,
+                                   size_t capacity);
+
+        InstructionSet m_instructionSet;
+        Function m_find;
+    };
+}
@@ -48,6 +48,16 @@ namespace BitFunnel
     }
 
 
+    void Document::Reset(DocId id)
+    {
+        m_docId = id;
+        m_sourceByteSize = 0;
+        m_streamIsOpen = false;
+        m_ringBuffer.Reset();
+        m_postings.Clear();
+    }
+
+
     size_t Document::GetPostingCount() const
     {
         return m_postings.size();
@@ -62,17 +72,13 @@ namespace BitFunnel
 
     void Document::Ingest(DocumentHandle handle) const
     {
-        for (auto const & posting : m_postings)
-        {
-            handle.AddPosting(posting);
-        }
+        handle.AddPostings(m_postings.begin(), m_postings.size());
     }
 
 
     bool Document::Contains(Term & term) const
     {
-        auto it = m_postings.find(term);
-        return (it != m_postings.end());
+        return m_postings.Contains(term);
     }
 
 
@@ -169,6 +175,6 @@ namespace BitFunnel
 
     void Document::AddPosting(Term term)
     {
-        m_postings.insert(term);
+        m_postings.Add(term);
     }
 }
@@ -22,12 +22,11 @@
 
 #pragma once
 
-#include <unordered_set>                    // TODO: Remove this temporary include.
-
 #include "BitFunnel/BitFunnelTypes.h"       // DocId parameter.
 #include "BitFunnel/Index/IDocument.h"      // Inherits from IDocument.
 #include "BitFunnel/Utilities/RingBuffer.h" // RingBuffer member.
 #include "BitFunnel/Term.h"                 // Term template parameter.
+#include "PostingSet.h"                     // PostingSet member.
 
 
 namespace BitFunnel
@@ -45,6 +44,12 @@ namespace BitFunnel
         // document. The id could be supplied by another system.
         DocId GetDocId() const;
 
+        // Empties the document and gives it a new id, so that it can be
+        // reused for the next document. The storage for the postings is kept,
+        // so a Document that is reused for each document ingested by a
+        // thread stops allocating once it has held the largest document.
+        void Reset(DocId id);
+
         //
         // IDocument methods
         //
@@ -98,7 +103,7 @@ namespace BitFunnel
 
         IConfiguration const & m_configuration;
 
-        const DocId m_docId;
+        DocId m_docId;
 
         // Maximum size of ngrams that will be indexed.
         const size_t m_maxGramSize;
@@ -127,7 +132,6 @@ namespace BitFunnel
         // Only valid when m_streamIsOpen is true.
         Term::StreamId m_currentStreamId;
 
-        // TODO: Replace unordered_set with alloc free version.
-        std::unordered_set<Term, Term::Hasher> m_postings;
+        PostingSet m_postings;
     };
 }
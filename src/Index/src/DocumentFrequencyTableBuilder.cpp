@@ -28,21 +28,88 @@
 #include "DocumentFrequencyTable.h"
 #include "DocumentFrequencyTableBuilder.h"
 #include "IndexedIdfTable.h"
+#include "LoggerInterfaces/Logging.h"
 
 
 namespace BitFunnel
 {
-    void DocumentFrequencyTableBuilder::OnDocumentEnter()
+    DocumentFrequencyTableBuilder::DocumentFrequencyTableBuilder(size_t threadCount)
+      : m_threadCount(threadCount),
+        m_accumulators(new Accumulator[threadCount]),
+        m_documentCount(0)
     {
-        std::lock_guard<std::mutex> lock(m_lock);
-        m_cumulativeTermCounts.push_back(m_termCounts.size());
+        LogAssertB(threadCount > 0,
+                   "DocumentFrequencyTableBuilder needs at least one thread.");
     }
 
 
-    void DocumentFrequencyTableBuilder::OnTerm(Term t)
+    void DocumentFrequencyTableBuilder::OnDocumentEnter(size_t thread)
     {
-        std::lock_guard<std::mutex> lock(m_lock);
-        ++m_termCounts[t];
+        Accumulator& accumulator = m_accumulators[thread % m_threadCount];
+        std::lock_guard<std::mutex> lock(accumulator.m_lock);
+
+        const size_t document = m_documentCount++;
+        for (auto termCount : accumulator.m_pendingTerms)
+        {
+            termCount->m_firstDocument = document;
+        }
+        accumulator.m_pendingTerms.clear();
+    }
+
+
+    void DocumentFrequencyTableBuilder::OnTerm(size_t thread, Term t)
+    {
+        Accumulator& accumulator = m_accumulators[thread % m_threadCount];
+        std::lock_guard<std::mutex> lock(accumulator.m_lock);
+        accumulator.OnTerm(t);
+    }
+
+
+    void DocumentFrequencyTableBuilder::OnTerms(size_t thread,
+                                                Term const * terms,
+                                                size_t termCount)
+    {
+        Accumulator& accumulator = m_accumulators[thread % m_threadCount];
+        std::lock_guard<std::mutex> lock(accumulator.m_lock);
+        for (size_t i = 0; i < termCount; ++i)
+        {
+            accumulator.OnTerm(terms[i]);
+        }
+    }
+
+
+    void DocumentFrequencyTableBuilder::Accumulator::OnTerm(Term t)
+    {
+        auto result = m_termCounts.insert(
+            std::make_pair(t, TermCount { 0, c_pendingDocument }));
+        TermCount& termCount = result.first->second;
+        if (result.second)
+        {
+            m_pendingTerms.push_back(&termCount);
+        }
+        ++termCount.m_count;
+    }
+
+
+    void DocumentFrequencyTableBuilder::Merge(TermCounts& termCounts) const
+    {
+        for (size_t i = 0; i < m_threadCount; ++i)
+        {
+            Accumulator& accumulator = m_accumulators[i];
+            std::lock_guard<std::mutex> lock(accumulator.m_lock);
+            for (auto const & entry : accumulator.m_termCounts)
+            {
+                auto result = termCounts.insert(entry);
+                if (!result.second)
+                {
+                    TermCount& termCount = result.first->second;
+                    termCount.m_count += entry.second.m_count;
+                    termCount.m_firstDocument =
+                        (std::min)(termCount.m_firstDocument,
+                                   entry.second.m_firstDocument);
+                }
+            }
+        }
     }
 
 
@@ -53,11 +120,14 @@ namespace BitFunnel
     {
         DocumentFrequencyTable table;
 
+        TermCounts termCounts;
+        Merge(termCounts);
+
         // For each term count record, compute the document frequency then
         // add to entries if frequency is above threshold.
-        for (auto const & entry : m_termCounts)
+        for (auto const & entry : termCounts)
         {
-            double frequency = static_cast<double>(entry.second) / m_cumulativeTermCounts.size();
+            double frequency = static_cast<double>(entry.second.m_count) / m_documentCount;
             if (frequency >= truncateBelowFrequency)
             {
                 table.AddEntry(DocumentFrequencyTable::Entry(entry.first, frequency));
@@ -72,14 +142,16 @@ namespace BitFunnel
         std::ostream& output,
         double truncateBelowFrequency) const
     {
-        typedef std::pair<Term::Hash, Term::IdfX10> Entry;
-        std::vector<Entry> entries;
+        std::vector<IndexedIdfTable::Entry> entries;
+
+        TermCounts termCounts;
+        Merge(termCounts);
 
         // For each term count record, compute the document frequency then
         // add to entries if frequency is above threshold.
-        for (auto const & entry : m_termCounts)
+        for (auto const & entry : termCounts)
         {
-            double frequency = static_cast<double>(entry.second) / m_cumulativeTermCounts.size();
+            double frequency = static_cast<double>(entry.second.m_count) / m_documentCount;
             if (frequency >= truncateBelowFrequency)
             {
                 const Term::Hash hash = entry.first.GetRawHash();
@@ -90,19 +162,32 @@ namespace BitFunnel
             }
         }
 
-        IndexedIdfTable::WriteHeader(output, entries.size());
-        for (auto entry : entries)
-        {
-            IndexedIdfTable::WriteEntry(output, entry.first, entry.second);
-        }
+        IndexedIdfTable::Write(output, entries);
     }
 
 
     void DocumentFrequencyTableBuilder::WriteCumulativeTermCounts(std::ostream& output) const
     {
-        for (size_t i = 0; i < m_cumulativeTermCounts.size(); ++i)
+        TermCounts termCounts;
+        Merge(termCounts);
+
+        // Count the terms first seen in each document. Terms whose first
+        // document has not been recorded are not counted.
+        const size_t documentCount = m_documentCount;
+        std::vector<size_t> newTermCounts(documentCount, 0);
+        for (auto const & entry : termCounts)
+        {
+            if (entry.second.m_firstDocument < documentCount)
+            {
+                ++newTermCounts[entry.second.m_firstDocument];
+            }
+        }
+
+        size_t uniqueTermCount = 0;
+        for (size_t i = 0; i < documentCount; ++i)
         {
-            output << i << "," << m_cumulativeTermCounts[i] << std::endl;
+            uniqueTermCount += newTermCounts[i];
+            output << i << "," << uniqueTermCount << std::endl;
         }
     }
 }
@@ -1,11 +1,14 @@
 #pragma once
 
-#include <iosfwd>           // std::ostream parameter.
-#include <mutex>            // std::mutex embedded.
-#include <unordered_map>    // std::unordered_map member.
-#include <vector>           // std::vector member.
+#include <atomic>                   // std::atomic member.
+#include <iosfwd>                   // std::ostream parameter.
+#include <memory>                   // std::unique_ptr member.
+#include <mutex>                    // std::mutex embedded.
+#include <unordered_map>            // std::unordered_map member.
+#include <vector>                   // std::vector member.
 
-#include "BitFunnel/Term.h" // Term and Term::Hasher template parameters.
+#include "BitFunnel/NonCopyable.h"  // Base class.
+#include "BitFunnel/Term.h"         // Term and Term::Hasher template parameters.
 
 
 namespace BitFunnel
@@ -35,17 +38,34 @@ namespace BitFunnel
     // should not be called again until all terms in the current document have
     // been recorded via calls to OnTerm().
     //
+    // Each ingestion thread records its documents in its own Accumulator,
+    // selected by the thread parameter, so that threads do not contend on a
+    // shared map. The Accumulators are merged when the statistics are
+    // written. The documents recorded by all threads are numbered in the
+    // order of their OnDocumentEnter() calls, and a term is attributed to the
+    // next document recorded by the same thread. The Cumulative Term Count
+    // table is then the number of unique terms as of each document number.
+    //
     //*************************************************************************
-    class DocumentFrequencyTableBuilder
+    class DocumentFrequencyTableBuilder : NonCopyable
     {
     public:
+        // threadCount is the number of Accumulators. Threads whose thread
+        // parameters are equal modulo threadCount share an Accumulator.
+        DocumentFrequencyTableBuilder(size_t threadCount = 1);
+
+        // This method is threadsafe in the presense of multiple writers
+        // (ie. callers to OnDocumentEnter() and OnTerm()).
+        void OnDocumentEnter(size_t thread);
+
         // This method is threadsafe in the presense of multiple writers
         // (ie. callers to OnDocumentEnter() and OnTerm()).
-        void OnDocumentEnter();
+        void OnTerm(size_t thread, Term t);
 
+        // Records termCount terms with a single Accumulator lock.
         // This method is threadsafe in the presense of multiple writers
         // (ie. callers to OnDocumentEnter() and OnTerm()).
-        void OnTerm(Term t);
+        void OnTerms(size_t thread, Term const * terms, size_t termCount);
 
         // Writes the Document Frequency Table to a stream. The file format is
         // a sequence of entries, one per line. Each entry consists of the
@@ -85,8 +105,45 @@ namespace BitFunnel
         void WriteCumulativeTermCounts(std::ostream& output) const;
 
     private:
-        std::mutex m_lock;
-        std::vector<size_t> m_cumulativeTermCounts;
-        std::unordered_map<Term, size_t, Term::Hasher> m_termCounts;
+        class TermCount
+        {
+        public:
+            // Number of documents containing the term.
+            size_t m_count;
+
+            // Number of the first document containing the term, or
+            // c_pendingDocument until that document is recorded.
+            size_t m_firstDocument;
+        };
+
+        typedef std::unordered_map<Term, TermCount, Term::Hasher> TermCounts;
+
+        static const size_t c_pendingDocument = static_cast<size_t>(-1);
+
+        class Accumulator
+        {
+        public:
+            void OnTerm(Term t);
+
+            std::mutex m_lock;
+            TermCounts m_termCounts;
+
+            // Terms first seen since the previous OnDocumentEnter(). Elements
+            // of an unordered_map do not move when it rehashes.
+            std::vector<TermCount*> m_pendingTerms;
+
+            // Keeps Accumulators that are adjacent in memory from sharing a
+            // cache line.
+            char m_padding[64];
+        };
+
+        // Combines the Accumulators into a single table of term counts.
+        void Merge(TermCounts& termCounts) const;
+
+        const size_t m_threadCount;
+        std::unique_ptr<Accumulator[]> m_accumulators;
+
+        // Number of OnDocumentEnter() calls.
+        std::atomic<size_t> m_documentCount;
     };
 }
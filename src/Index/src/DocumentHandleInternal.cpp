@@ -86,6 +86,15 @@ namespace BitFunnel
     }
 
 
+    void DocumentHandle::AddPostings(Term const * terms, size_t termCount)
+    {
+        m_slice->GetShard().AddPostings(terms,
+                                        termCount,
+                                        m_index,
+                                        m_slice->GetSliceBuffer());
+    }
+
+
     void DocumentHandle::Expire()
     {
         const RowId documentActiveRow = m_slice->GetShard().GetDocumentActiveRowId();
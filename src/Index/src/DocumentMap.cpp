@@ -1,65 +1,273 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
 #include <sstream>
 
 #include "BitFunnel/Exceptions.h"
 #include "DocumentMap.h"
+#include "LoggerInterfaces/Logging.h"
 
 
 namespace BitFunnel
 {
+    //*************************************************************************
+    //
+    // DocumentMap
+    //
+    //*************************************************************************
+    DocumentMap::DocumentMap()
+      : m_shards(new Shard[c_shardCount])
+    {
+    }
+
+
     void DocumentMap::Add(DocumentHandleInternal handle)
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        const DocId id = handle.GetDocId();
+        const uint64_t hash = Hash(id);
+        Shard& shard = GetShard(hash);
 
-        DocId id = handle.GetDocId();
+        std::lock_guard<std::mutex> lock(shard.m_lock);
 
         // Verify that this DocId hasn't been added previously.
-        auto it = m_docIdToDocHandle.find(id);
-        if (it != m_docIdToDocHandle.end())
+        if (shard.m_table.load(std::memory_order_relaxed)->Find(id, hash) != nullptr)
         {
             std::stringstream message;
             message << "Ingestor::Add(): DocId " << id << " has already been added.";
 
             RecoverableError error(message.str());
+            throw error;
         }
 
-        m_docIdToDocHandle.insert(std::make_pair(id, handle));
+        shard.FreeRetiredTables();
+
+        // Keep at least a quarter of the slots empty so that probe sequences
+        // stay short.
+        Table* table = shard.m_table.load(std::memory_order_relaxed);
+        if ((shard.m_usedCount + 1) * 4 > table->m_capacity * 3)
+        {
+            Rebuild(shard);
+            table = shard.m_table.load(std::memory_order_relaxed);
+        }
+
+        Slot* slot = table->FindEmpty(hash);
+        slot->m_id = id;
+        slot->m_handle = handle;
+        slot->m_state.store(Filled, std::memory_order_release);
+
+        ++shard.m_filledCount;
+        ++shard.m_usedCount;
     }
 
 
     DocumentHandleInternal DocumentMap::Find(DocId id, bool& isFound) const
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        const uint64_t hash = Hash(id);
+        Shard& shard = GetShard(hash);
+
+        // Registering as a reader before loading the table keeps the table
+        // from being freed until the matching decrement. Both operations
+        // must be sequentially consistent with the writer's store to
+        // m_table and load of m_readerCount in FreeRetiredTables().
+        ++shard.m_readerCount;
+
+        DocumentHandleInternal handle;
+        Slot const * slot = shard.m_table.load()->Find(id, hash);
+        isFound = (slot != nullptr);
+        if (isFound)
+        {
+            handle = slot->m_handle;
+        }
 
+        --shard.m_readerCount;
+
+        return handle;
+    }
+
+
+    bool DocumentMap::Delete(DocId id)
+    {
         DocumentHandleInternal handle;
+        return Delete(id, handle);
+    }
+
+
+    bool DocumentMap::Delete(DocId id, DocumentHandleInternal& handle)
+    {
+        const uint64_t hash = Hash(id);
+        Shard& shard = GetShard(hash);
+
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+
+        Table* table = shard.m_table.load(std::memory_order_relaxed);
 
-        auto it = m_docIdToDocHandle.find(id);
-        if (it == m_docIdToDocHandle.end())
+        // Find() returns a const slot for readers. The writer holding the
+        // lock is the only thread that modifies slots.
+        Slot* slot = const_cast<Slot*>(table->Find(id, hash));
+        if (slot == nullptr)
         {
-            isFound = false;
+            return false;
         }
-        else
+
+        handle = slot->m_handle;
+        slot->m_state.store(Deleted, std::memory_order_release);
+        --shard.m_filledCount;
+
+        return true;
+    }
+
+
+    uint64_t DocumentMap::Hash(DocId id)
+    {
+        // Fibonacci hashing spreads sequential DocIds across shards and
+        // slots.
+        return static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull;
+    }
+
+
+    DocumentMap::Shard& DocumentMap::GetShard(uint64_t hash) const
+    {
+        // The shard comes from the high bits of the hash and the slot from
+        // the low bits.
+        return m_shards[hash >> (64 - c_log2ShardCount)];
+    }
+
+
+    void DocumentMap::Rebuild(Shard& shard) const
+    {
+        Table const & oldTable = *shard.m_table.load(std::memory_order_relaxed);
+
+        // Size the new table so that it is at most half full, not counting
+        // deleted slots, which are dropped.
+        size_t capacity = c_initialCapacity;
+        while (capacity < (shard.m_filledCount + 1) * 2)
         {
-            isFound = true;
-            handle = (*it).second;
+            capacity *= 2;
         }
 
-        return handle;
+        std::unique_ptr<Table> table(new Table(capacity));
+        for (size_t i = 0; i < oldTable.m_capacity; ++i)
+        {
+            Slot const & oldSlot = oldTable.m_slots[i];
+            if (oldSlot.m_state.load(std::memory_order_relaxed) == Filled)
+            {
+                Slot* slot = table->FindEmpty(Hash(oldSlot.m_id));
+                slot->m_id = oldSlot.m_id;
+                slot->m_handle = oldSlot.m_handle;
+                slot->m_state.store(Filled, std::memory_order_relaxed);
+            }
+        }
+        shard.m_usedCount = shard.m_filledCount;
+
+        // The store publishes the new table's slots to Find().
+        shard.m_retiredTables.emplace_back(shard.m_table.exchange(table.release()));
+        shard.FreeRetiredTables();
     }
 
 
-    bool DocumentMap::Delete(DocId id)
+    //*************************************************************************
+    //
+    // DocumentMap::Table
+    //
+    //*************************************************************************
+    DocumentMap::Table::Table(size_t capacity)
+      : m_capacity(capacity),
+        m_slots(new Slot[capacity])
     {
-        std::lock_guard<std::mutex> lock(m_lock);
+        LogAssertB((capacity & (capacity - 1)) == 0,
+                   "DocumentMap capacity must be a power of two.");
 
-        DocumentHandleInternal handle;
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            m_slots[i].m_state.store(Empty, std::memory_order_relaxed);
+        }
+    }
+
+
+    DocumentMap::Slot const *
+        DocumentMap::Table::Find(DocId id, uint64_t hash) const
+    {
+        const size_t mask = m_capacity - 1;
 
-        auto it = m_docIdToDocHandle.find(id);
-        bool found = (it != m_docIdToDocHandle.end());
-        if (found)
+        // Tables always have an empty slot, so the probe terminates.
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
         {
-            m_docIdToDocHandle.erase(it);
+            Slot const & slot = m_slots[i];
+            const uint8_t state = slot.m_state.load(std::memory_order_acquire);
+            if (state == Empty)
+            {
+                return nullptr;
+            }
+            else if (state == Filled && slot.m_id == id)
+            {
+                return &slot;
+            }
         }
+    }
+
+
+    DocumentMap::Slot* DocumentMap::Table::FindEmpty(uint64_t hash)
+    {
+        const size_t mask = m_capacity - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
+        {
+            if (m_slots[i].m_state.load(std::memory_order_relaxed) == Empty)
+            {
+                return &m_slots[i];
+            }
+        }
+    }
+
 
-        return found;
+    //*************************************************************************
+    //
+    // DocumentMap::Shard
+    //
+    //*************************************************************************
+    DocumentMap::Shard::Shard()
+      : m_table(new Table(c_initialCapacity)),
+        m_readerCount(0),
+        m_filledCount(0),
+        m_usedCount(0)
+    {
+    }
+
+
+    DocumentMap::Shard::~Shard()
+    {
+        delete m_table.load();
+    }
+
+
+    void DocumentMap::Shard::FreeRetiredTables()
+    {
+        // A Find() that loaded a retired table incremented m_readerCount
+        // before the table was replaced, and has not yet decremented it.
+        // Any Find() that increments m_readerCount after this load will see
+        // the current table.
+        if (!m_retiredTables.empty() && m_readerCount.load() == 0)
+        {
+            m_retiredTables.clear();
+        }
     }
 }
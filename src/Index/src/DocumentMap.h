@@ -1,18 +1,69 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
 #pragma once
 
+#include <atomic>                       // std::atomic member.
+#include <memory>                       // std::unique_ptr member.
 #include <mutex>                        // std::mutex member.
-#include <unordered_map>                // std::unordered_map member.
+#include <stddef.h>                     // size_t member.
+#include <stdint.h>                     // uint8_t member.
+#include <vector>                       // std::vector member.
 
 #include "BitFunnel/BitFunnelTypes.h"   // For DocId parameter.
 #include "BitFunnel/NonCopyable.h"      // Base class.
-#include "DocumentHandleInternal.h"     // DocHandleInternal template parameter.
+#include "DocumentHandleInternal.h"     // DocHandleInternal member.
 
 
 namespace BitFunnel
 {
+    //*************************************************************************
+    //
+    // DocumentMap maps each DocId to the DocumentHandleInternal of its
+    // document.
+    //
+    // The map is divided into c_shardCount shards, chosen by a hash of the
+    // DocId, so that Add() and Delete() calls for different documents rarely
+    // contend. Each shard is an open-addressing hash table with linear
+    // probing. Add() and Delete() take the shard's lock. Find() takes no
+    // lock and never waits for a writer.
+    //
+    // Find() can run without a lock because a slot is written only once for
+    // each table. Add() fills the slot's DocId and handle before it marks the
+    // slot as filled. Delete() marks the slot as deleted and leaves the slot
+    // unused until the table is rebuilt. When a table fills up, Add()
+    // builds a new table and publishes it with a single pointer store.
+    // The old table is freed once no Find() can still be reading it. Each
+    // shard counts its active readers for this purpose.
+    //
+    // Thread safety: all methods are thread safe.
+    //
+    //*************************************************************************
     class DocumentMap : NonCopyable
     {
     public:
+        DocumentMap();
+
         // Adds a new (DocId, DocumentHandleInternal) pair to the map. DocId is
         // obtained from DocumentHandleInternal::GetDocId(). Throws if the map 
         // already contains an entry for a given DocId.        
@@ -34,11 +85,92 @@ namespace BitFunnel
         // Returns true otherwise.
         bool Delete(DocId id);
 
+        // Same as Delete(DocId), but also copies the deleted entry's handle
+        // to handle. Exactly one of any number of concurrent calls for the
+        // same DocId will return true.
+        bool Delete(DocId id, DocumentHandleInternal& handle);
+
     private:
-        // Lock protecting operations on m_docIdToHandle.
-        // Made mutable to allow using it from const functions.
-        mutable std::mutex m_lock;
+        enum SlotState : uint8_t
+        {
+            Empty,
+            Filled,
+            Deleted
+        };
+
+        class Slot
+        {
+        public:
+            // Written with release semantics after m_id and m_handle.
+            std::atomic<uint8_t> m_state;
+            DocId m_id;
+            DocumentHandleInternal m_handle;
+        };
+
+        class Table : NonCopyable
+        {
+        public:
+            // capacity must be a power of two.
+            Table(size_t capacity);
+
+            // Returns the slot filled with id, or nullptr if there is none.
+            Slot const * Find(DocId id, uint64_t hash) const;
+
+            // Returns the first empty slot in the probe sequence for hash.
+            // The table must have an empty slot.
+            Slot* FindEmpty(uint64_t hash);
+
+            const size_t m_capacity;
+            std::unique_ptr<Slot[]> m_slots;
+        };
+
+        class Shard : NonCopyable
+        {
+        public:
+            Shard();
+            ~Shard();
+
+            // Frees the retired tables if no Find() is running. Must be
+            // called with m_lock held.
+            void FreeRetiredTables();
+
+            // Protects all members against concurrent Add() and Delete().
+            std::mutex m_lock;
+
+            // The table that Find() reads.
+            std::atomic<Table*> m_table;
+
+            // Number of Find() calls in progress on this shard.
+            std::atomic<size_t> m_readerCount;
+
+            // Tables replaced by m_table that Find() may still be reading.
+            std::vector<std::unique_ptr<Table>> m_retiredTables;
+
+            // Number of filled slots in m_table.
+            size_t m_filledCount;
+
+            // Number of filled or deleted slots in m_table.
+            size_t m_usedCount;
+
+            // Keeps shards that are adjacent in memory from sharing a cache
+            // line.
+            char m_padding[64];
+        };
+
+        static uint64_t Hash(DocId id);
+        Shard& GetShard(uint64_t hash) const;
+
+        // Replaces the shard's table with one that has room for at least
+        // one more document. Must be called with shard.m_lock held.
+        void Rebuild(Shard& shard) const;
+
+        // Number of shards. Must be a power of two.
+        static const unsigned c_log2ShardCount = 6;
+        static const size_t c_shardCount = 1ull << c_log2ShardCount;
+
+        // Number of slots in a new table. Must be a power of two.
+        static const size_t c_initialCapacity = 16;
 
-        std::unordered_map<DocId, DocumentHandleInternal> m_docIdToDocHandle;
+        std::unique_ptr<Shard[]> m_shards;
     };
 }
@@ -29,7 +29,8 @@
 namespace BitFunnel
 {
     size_t GetMinimumBlockSize(IDocumentDataSchema const & schema,
-                               ITermTable const & termTable)
+                               ITermTable const & termTable,
+                               size_t rowAlignment)
     {
         static const DocIndex capacity = 
             Row::DocumentsInRank0Row(1, termTable.GetMaxRankUsed());
@@ -37,6 +38,7 @@ namespace BitFunnel
         return Shard::InitializeDescriptors(nullptr,
                                             capacity,
                                             schema,
-                                            termTable);
+                                            termTable,
+                                            rowAlignment);
     }
 }
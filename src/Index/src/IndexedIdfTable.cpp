@@ -20,9 +20,17 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+
+#include <cstring>
+#include <istream>
+#include <sstream>
+
+#include "AlignedBuffer.h"
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/StreamUtilities.h"
 #include "IndexedIdfTable.h"
+#include "MemoryMappedFile.h"
 
 
 namespace BitFunnel
@@ -49,16 +57,30 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<IIndexedIdfTable>
+        Factories::CreateIndexedIdfTable(char const * path,
+                                         Term::IdfX10 defaultIdf)
+    {
+        return std::unique_ptr<IIndexedIdfTable>(
+            new IndexedIdfTable(path, defaultIdf));
+    }
+
+
     //*************************************************************************
     //
     // IndexedIdfTable
     //
     //*************************************************************************
+    const char IndexedIdfTable::c_magic[8] = { 'B', 'F', 'I', 'D', 'F', 'T', 'B', 'L' };
+
+    static_assert(sizeof(Term::IdfX10) == 1, "IndexedIdfTable::Bucket layout assumes one byte IdfX10.");
+
 
     // TODO: Proper implementation or remove.
     IndexedIdfTable::IndexedIdfTable()
         : m_defaultIdf(60)
     {
+        Allocate(1);
     }
 
 
@@ -66,44 +88,264 @@ namespace BitFunnel
                                      Term::IdfX10 defaultIdf)
         : m_defaultIdf(defaultIdf)
     {
+        static_assert(sizeof(Header) == 64, "IndexedIdfTable::Header must be 64 bytes.");
+        static_assert(sizeof(Bucket) == 64, "IndexedIdfTable::Bucket must be 64 bytes.");
+
         // TODO: Should defaultIdf be part of the file?
 
-        size_t count = StreamUtilities::ReadField<size_t>(input);
+        // Files in the older format start with an entry count, which is
+        // never equal to the magic.
+        Header header;
+        StreamUtilities::ReadBytes(input, header.m_magic, sizeof(header.m_magic));
+        if (memcmp(header.m_magic, c_magic, sizeof(c_magic)) != 0)
+        {
+            size_t entryCount;
+            memcpy(&entryCount, header.m_magic, sizeof(entryCount));
+            ReadOldFormat(input, entryCount);
+        }
+        else
+        {
+            StreamUtilities::ReadBytes(input,
+                                       header.m_magic + sizeof(header.m_magic),
+                                       sizeof(header) - sizeof(header.m_magic));
+            const size_t bucketCount = CheckHeader(header, 0);
+            Allocate(bucketCount);
+            StreamUtilities::ReadBytes(input,
+                                       m_buffer->GetBuffer(),
+                                       bucketCount * sizeof(Bucket));
+            CheckBuckets(header, m_buckets);
+        }
+    }
+
+
+    IndexedIdfTable::IndexedIdfTable(char const * path,
+                                     Term::IdfX10 defaultIdf)
+        : m_defaultIdf(defaultIdf)
+    {
+        std::unique_ptr<MemoryMappedFile>
+            file(new MemoryMappedFile(path, MemoryMappedFile::Random));
 
-        for (size_t i = 0; i < count; ++i)
+        if (file->GetSize() >= sizeof(c_magic) &&
+            memcmp(file->GetData(), c_magic, sizeof(c_magic)) != 0)
         {
-            const Term::Hash hash(StreamUtilities::ReadField<Term::Hash>(input));
-            const Term::IdfX10 idf(StreamUtilities::ReadField<Term::IdfX10>(input));
+            std::stringstream input(std::string(file->GetData(), file->GetSize()));
+            size_t entryCount = StreamUtilities::ReadField<size_t>(input);
+            ReadOldFormat(input, entryCount);
+            return;
+        }
 
-            m_terms.insert(std::make_pair(hash, idf));
+        if (file->GetSize() < sizeof(Header))
+        {
+            RecoverableError error("IndexedIdfTable: file too small.");
+            throw error;
         }
+
+        Header const & header = *reinterpret_cast<Header const *>(file->GetData());
+        const size_t bucketCount = CheckHeader(header, file->GetSize());
+
+        m_buckets = reinterpret_cast<Bucket const *>(file->GetData() + sizeof(Header));
+        m_bucketCount = bucketCount;
+        m_file = std::move(file);
     }
 
 
-    void IndexedIdfTable::WriteHeader(std::ostream& output, size_t entryCount)
+    IndexedIdfTable::~IndexedIdfTable()
     {
-        // TODO: Use FileHeader and version.
-        StreamUtilities::WriteField<size_t>(output, entryCount);
     }
 
 
-    void IndexedIdfTable::WriteEntry(std::ostream& output, Term::Hash hash, Term::IdfX10 idf)
+    void IndexedIdfTable::Write(std::ostream& output,
+                                std::vector<Entry> const & entries)
     {
-        StreamUtilities::WriteField<size_t>(output, hash);
-        StreamUtilities::WriteField<size_t>(output, idf);
+        const size_t bucketCount = GetBucketCount(entries.size());
+        std::vector<Bucket> buckets(bucketCount);
+        memset(buckets.data(), 0, bucketCount * sizeof(Bucket));
+
+        for (auto const & entry : entries)
+        {
+            Add(buckets.data(), bucketCount, entry.first, entry.second);
+        }
+
+        size_t entryCount = 0;
+        for (auto const & bucket : buckets)
+        {
+            entryCount += bucket.m_count;
+        }
+
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.m_magic, c_magic, sizeof(c_magic));
+        header.m_version = c_version;
+        header.m_bucketEntryCount = c_bucketEntryCount;
+        header.m_bucketCount = bucketCount;
+        header.m_entryCount = entryCount;
+
+        StreamUtilities::WriteBytes(output,
+                                    reinterpret_cast<char const *>(&header),
+                                    sizeof(header));
+        StreamUtilities::WriteBytes(output,
+                                    reinterpret_cast<char const *>(buckets.data()),
+                                    bucketCount * sizeof(Bucket));
     }
 
 
     Term::IdfX10 IndexedIdfTable::GetIdf(Term::Hash hash) const
     {
-        auto it = m_terms.find(hash);
-        if (it != m_terms.end())
+        // The stream constructor checks that some Bucket is less than full,
+        // so the probe ends before it wraps around. A memory mapped file is
+        // not scanned at load, so the bound and the clamp on the Bucket's
+        // count keep a corrupt file from looping or reading past a Bucket.
+        size_t i = GetBucket(hash, m_bucketCount);
+        for (size_t probe = 0; probe < m_bucketCount; ++probe)
         {
-            return (*it).second;
+            Bucket const & bucket = m_buckets[i];
+            const size_t count = bucket.m_count;
+            for (size_t j = 0; j < count && j < c_bucketEntryCount; ++j)
+            {
+                if (bucket.m_hashes[j] == hash)
+                {
+                    return bucket.m_idfs[j];
+                }
+            }
+
+            if (count < c_bucketEntryCount)
+            {
+                break;
+            }
+
+            if (++i == m_bucketCount)
+            {
+                i = 0;
+            }
         }
-        else
+
+        return m_defaultIdf;
+    }
+
+
+    size_t IndexedIdfTable::GetBucketCount(size_t entryCount)
+    {
+        // Fill Buckets to at most 3/4 on average. The extra Bucket ensures
+        // that at least one Bucket has room to end every probe.
+        const size_t bucketCount = entryCount * 4 / (c_bucketEntryCount * 3) + 1;
+
+        if (bucketCount > UINT32_MAX)
         {
-            return m_defaultIdf;
+            RecoverableError error("IndexedIdfTable: too many entries.");
+            throw error;
+        }
+
+        return bucketCount;
+    }
+
+
+    size_t IndexedIdfTable::GetBucket(Term::Hash hash, size_t bucketCount)
+    {
+        // Scales the high 32 bits of the hash to [0, bucketCount).
+        return static_cast<size_t>(((hash >> 32) * bucketCount) >> 32);
+    }
+
+
+    void IndexedIdfTable::Add(Bucket* buckets,
+                              size_t bucketCount,
+                              Term::Hash hash,
+                              Term::IdfX10 idf)
+    {
+        for (size_t i = GetBucket(hash, bucketCount); ; i = (i + 1) % bucketCount)
+        {
+            Bucket& bucket = buckets[i];
+            for (size_t j = 0; j < bucket.m_count; ++j)
+            {
+                if (bucket.m_hashes[j] == hash)
+                {
+                    return;
+                }
+            }
+
+            if (bucket.m_count < c_bucketEntryCount)
+            {
+                bucket.m_hashes[bucket.m_count] = hash;
+                bucket.m_idfs[bucket.m_count] = idf;
+                ++bucket.m_count;
+                return;
+            }
+        }
+    }
+
+
+    void IndexedIdfTable::Allocate(size_t bucketCount)
+    {
+        // AlignedBuffer is page aligned and zero filled.
+        m_buffer.reset(new AlignedBuffer(bucketCount * sizeof(Bucket), 6));
+        m_buckets = static_cast<Bucket const *>(m_buffer->GetBuffer());
+        m_bucketCount = bucketCount;
+    }
+
+
+    size_t IndexedIdfTable::CheckHeader(Header const & header, size_t fileSize)
+    {
+        if (header.m_version != c_version)
+        {
+            std::stringstream message;
+            message << "IndexedIdfTable: unsupported version " << header.m_version << ".";
+            RecoverableError error(message.str());
+            throw error;
+        }
+
+        const size_t bucketCount = header.m_bucketCount;
+        if (header.m_bucketEntryCount != c_bucketEntryCount ||
+            bucketCount == 0 ||
+            bucketCount > UINT32_MAX ||
+            header.m_entryCount >= bucketCount * c_bucketEntryCount ||
+            (fileSize != 0 && fileSize != sizeof(Header) + bucketCount * sizeof(Bucket)))
+        {
+            RecoverableError error("IndexedIdfTable: malformed header.");
+            throw error;
+        }
+
+        return bucketCount;
+    }
+
+
+    void IndexedIdfTable::CheckBuckets(Header const & header,
+                                       Bucket const * buckets)
+    {
+        size_t entryCount = 0;
+        bool hasRoom = false;
+        for (size_t i = 0; i < header.m_bucketCount; ++i)
+        {
+            const size_t count = buckets[i].m_count;
+            if (count > c_bucketEntryCount)
+            {
+                RecoverableError error("IndexedIdfTable: malformed bucket.");
+                throw error;
+            }
+            entryCount += count;
+            hasRoom |= (count < c_bucketEntryCount);
+        }
+
+        if (entryCount != header.m_entryCount || !hasRoom)
+        {
+            RecoverableError error("IndexedIdfTable: bucket counts do not match header.");
+            throw error;
+        }
+    }
+
+
+    void IndexedIdfTable::ReadOldFormat(std::istream& input, size_t entryCount)
+    {
+        const size_t bucketCount = GetBucketCount(entryCount);
+        Allocate(bucketCount);
+        Bucket* buckets = static_cast<Bucket*>(m_buffer->GetBuffer());
+
+        for (size_t i = 0; i < entryCount; ++i)
+        {
+            // Both fields were written as size_t.
+            const Term::Hash hash(StreamUtilities::ReadField<size_t>(input));
+            const Term::IdfX10 idf(static_cast<Term::IdfX10>(
+                StreamUtilities::ReadField<size_t>(input)));
+
+            Add(buckets, bucketCount, hash, idf);
         }
     }
 }
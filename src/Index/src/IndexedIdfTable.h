@@ -20,36 +20,147 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+
 #pragma once
 
 #include <iosfwd>                               // std::istream parameter.
-#include <unordered_map>                        // Embedded.
+#include <memory>                               // std::unique_ptr member.
+#include <stddef.h>                             // size_t member.
+#include <stdint.h>                             // uint32_t member.
+#include <utility>                              // std::pair template parameter.
+#include <vector>                               // std::vector parameter.
 
 #include "BitFunnel/Index/IIndexedIdfTable.h"   // Base class.
+#include "BitFunnel/NonCopyable.h"              // Base class.
 
 
 namespace BitFunnel
 {
-    class IndexedIdfTable : public IIndexedIdfTable
+    class AlignedBuffer;
+    class MemoryMappedFile;
+
+    //*************************************************************************
+    //
+    // IndexedIdfTable
+    //
+    // Maps Term::Hash to Term::IdfX10. Hashes that are not in the table map
+    // to a default IDF.
+    //
+    // The table is a flat hash table of 64-byte, cache line aligned Buckets.
+    // Each Bucket holds up to c_bucketEntryCount entries. A hash starts in
+    // the Bucket selected by scaling its high bits to the bucket count, and
+    // moves on to the next Bucket only when its Bucket is full. A lookup
+    // therefore usually touches a single cache line. Since the bucket count
+    // need not be a power of two, Buckets are kept about 3/4 full, or 12
+    // bytes per entry.
+    //
+    // The file format is the table itself, so the file can be memory mapped
+    // and queried in place. Mapping a file checks only its Header, so that
+    // opening a large table does not touch every page. Reading from a stream
+    // also checks the Buckets' counts. Either way, a probe never reads past
+    // the last Bucket and always terminates, even on a corrupt file:
+    //   Header (64 bytes): magic, version, bucket count, entry count.
+    //   Bucket[bucketCount] (64 bytes each).
+    // All fields are little endian.
+    //
+    // Files in the older format are also accepted. That format is an entry
+    // count followed by (hash, idf) pairs, with every field 8 bytes. The
+    // table is built in memory when such a file is loaded.
+    //
+    //*************************************************************************
+    class IndexedIdfTable : public IIndexedIdfTable, NonCopyable
     {
     public:
+        typedef std::pair<Term::Hash, Term::IdfX10> Entry;
+
         // TODO: Remove this temporary constructor.
         IndexedIdfTable();
 
+        // Constructs a table from a stream in either format.
         IndexedIdfTable(std::istream& input, Term::IdfX10 defaultIdf);
 
-        static void WriteHeader(std::ostream& output, size_t entryCount);
-        static void WriteEntry(std::ostream& output,
-                               Term::Hash hash, Term::IdfX10 idf);
+        // Memory maps a file in the current format. Files in the older
+        // format are read into memory instead. Throws a RecoverableError if
+        // the file cannot be mapped or is malformed.
+        IndexedIdfTable(char const * path, Term::IdfX10 defaultIdf);
+
+        ~IndexedIdfTable();
+
+        // Writes entries to a stream in the current format. When entries
+        // contains more than one Entry for a hash, the first is kept.
+        static void Write(std::ostream& output,
+                          std::vector<Entry> const & entries);
 
         //
         // IIndexedIdfTable methods.
         //
         virtual Term::IdfX10 GetIdf(Term::Hash hash) const override;
 
+        // Number of entries in each Bucket.
+        static const size_t c_bucketEntryCount = 7;
+
     private:
+        class Header
+        {
+        public:
+            char m_magic[8];
+            uint32_t m_version;
+            uint32_t m_bucketEntryCount;
+            uint64_t m_bucketCount;
+            uint64_t m_entryCount;
+            char m_unused[32];
+        };
+
+        class Bucket
+        {
+        public:
+            Term::Hash m_hashes[c_bucketEntryCount];
+            Term::IdfX10 m_idfs[c_bucketEntryCount];
+            uint8_t m_count;
+        };
+
+        // Returns the number of Buckets for a table of entryCount entries.
+        static size_t GetBucketCount(size_t entryCount);
+
+        // Returns the Bucket where the probe for hash starts.
+        static size_t GetBucket(Term::Hash hash, size_t bucketCount);
+
+        // Adds an entry to the Buckets, unless the hash is already present.
+        static void Add(Bucket* buckets,
+                        size_t bucketCount,
+                        Term::Hash hash,
+                        Term::IdfX10 idf);
+
+        // Allocates m_buffer and points m_buckets at it.
+        void Allocate(size_t bucketCount);
+
+        // Validates a header and returns the number of Buckets that follow
+        // it. fileSize is the number of bytes in the file, including the
+        // header, or 0 when it is not known.
+        static size_t CheckHeader(Header const & header, size_t fileSize);
+
+        // Validates the Buckets that follow header. Every Bucket must hold at
+        // most c_bucketEntryCount entries, their counts must add up to the
+        // header's entry count, and at least one Bucket must have room to
+        // end a probe.
+        static void CheckBuckets(Header const & header, Bucket const * buckets);
+
+        // Builds the table from the older format. The entry count has
+        // already been read.
+        void ReadOldFormat(std::istream& input, size_t entryCount);
+
+        static const char c_magic[8];
+        static const uint32_t c_version = 1;
+
         Term::IdfX10 m_defaultIdf;
 
-        std::unordered_map<Term::Hash, Term::IdfX10> m_terms;
+        Bucket const * m_buckets;
+        size_t m_bucketCount;
+
+        // Holds m_buckets for tables that are not memory mapped.
+        std::unique_ptr<AlignedBuffer> m_buffer;
+
+        // Holds m_buckets for memory mapped tables.
+        std::unique_ptr<MemoryMappedFile> m_file;
     };
 }
@@ -0,0 +1,603 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "BitFunnel/Index/IDocumentCache.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "ChunkReader.h"
+#include "IngestionPipeline.h"
+#include "MemoryMappedFile.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // IngestionPipelineOptions
+    //
+    //*************************************************************************
+    IngestionPipelineOptions::IngestionPipelineOptions(size_t threadCount)
+      : m_readerCount(1),
+        m_parserCount(threadCount),
+        m_posterCount(threadCount),
+        m_blockSize(1 << 20),
+        m_blockQueueCapacity(4 * threadCount),
+        m_documentQueueCapacity(4 * threadCount)
+    {
+    }
+
+
+    void IngestChunksPipelined(std::vector<std::string> const & filePaths,
+                               IConfiguration const & config,
+                               IIngestor& ingestor,
+                               IngestionPipelineOptions const & options,
+                               bool cacheDocuments,
+                               std::ostream * statistics)
+    {
+        IngestionPipeline pipeline(config, ingestor, options, cacheDocuments);
+        pipeline.Ingest(filePaths);
+
+        if (statistics != nullptr)
+        {
+            pipeline.PrintStatistics(*statistics);
+        }
+    }
+
+
+    //*************************************************************************
+    //
+    // IngestionPipeline::StageStatistics
+    //
+    //*************************************************************************
+    IngestionPipeline::StageStatistics::StageStatistics()
+      : m_blockCount(0),
+        m_byteCount(0),
+        m_documentCount(0),
+        m_busySeconds(0.0),
+        m_inputWaitSeconds(0.0),
+        m_outputWaitSeconds(0.0)
+    {
+    }
+
+
+    void IngestionPipeline::StageStatistics::Add(StageStatistics const & other)
+    {
+        m_blockCount += other.m_blockCount;
+        m_byteCount += other.m_byteCount;
+        m_documentCount += other.m_documentCount;
+        m_busySeconds += other.m_busySeconds;
+        m_inputWaitSeconds += other.m_inputWaitSeconds;
+        m_outputWaitSeconds += other.m_outputWaitSeconds;
+    }
+
+
+    //*************************************************************************
+    //
+    // IngestionPipeline::StageThread
+    //
+    // Runs one of the IngestionPipeline's thread methods and then merges the
+    // thread's statistics into the pipeline's totals for the stage.
+    //
+    //*************************************************************************
+    class IngestionPipeline::StageThread : public IThreadBase
+    {
+    public:
+        typedef void (IngestionPipeline::*Method)(StageStatistics&);
+
+        StageThread(IngestionPipeline& pipeline,
+                    Method method,
+                    StageStatistics& totals)
+          : m_pipeline(pipeline),
+            m_method(method),
+            m_totals(totals)
+        {
+        }
+
+
+        virtual void EntryPoint() override
+        {
+            StageStatistics statistics;
+            (m_pipeline.*m_method)(statistics);
+
+            std::lock_guard<std::mutex> lock(m_pipeline.m_lock);
+            m_totals.Add(statistics);
+        }
+
+    private:
+        IngestionPipeline& m_pipeline;
+        Method m_method;
+        StageStatistics& m_totals;
+    };
+
+
+    //*************************************************************************
+    //
+    // IngestionPipeline::Parser
+    //
+    // Builds a Document for each document in a Block. This is the same work
+    // that ChunkIngestor does, except that the Documents are handed to the
+    // post stage instead of being added to the ingestor right away.
+    //
+    //*************************************************************************
+    class IngestionPipeline::Parser : public ChunkReader::IEvents
+    {
+    public:
+        Parser(IConfiguration const & config, DocumentBlock& documents)
+          : m_config(config),
+            m_documents(documents),
+            m_currentDocument(nullptr)
+        {
+        }
+
+
+        virtual void OnFileEnter() override
+        {
+        }
+
+
+        virtual void OnDocumentEnter(DocId id) override
+        {
+            std::vector<std::unique_ptr<Document>> & documents =
+                m_documents.m_documents;
+            if (m_documents.m_documentCount < documents.size())
+            {
+                m_currentDocument = documents[m_documents.m_documentCount].get();
+                m_currentDocument->Reset(id);
+            }
+            else
+            {
+                documents.emplace_back(new Document(m_config, id));
+                m_currentDocument = documents.back().get();
+            }
+        }
+
+
+        virtual void OnStreamEnter(Term::StreamId id) override
+        {
+            m_currentDocument->OpenStream(id);
+        }
+
+
+        virtual void OnTerm(char const * term) override
+        {
+            m_currentDocument->AddTerm(term);
+        }
+
+
+        virtual void OnStreamExit() override
+        {
+            m_currentDocument->CloseStream();
+        }
+
+
+        virtual void OnDocumentExit(size_t bytesRead) override
+        {
+            m_currentDocument->CloseDocument(bytesRead);
+            ++m_documents.m_documentCount;
+        }
+
+
+        virtual void OnFileExit() override
+        {
+        }
+
+    private:
+        IConfiguration const & m_config;
+        DocumentBlock& m_documents;
+        Document* m_currentDocument;
+    };
+
+
+    //*************************************************************************
+    //
+    // IngestionPipeline
+    //
+    //*************************************************************************
+    IngestionPipeline::IngestionPipeline(IConfiguration const & config,
+                                         IIngestor& ingestor,
+                                         IngestionPipelineOptions const & options,
+                                         bool cacheDocuments)
+      : m_config(config),
+        m_ingestor(ingestor),
+        m_options(options),
+        m_cacheDocuments(cacheDocuments),
+        m_filePaths(nullptr),
+        m_nextFile(0),
+        m_failed(false),
+        m_elapsedSeconds(0.0)
+    {
+        if (m_options.m_readerCount == 0 ||
+            m_options.m_parserCount == 0 ||
+            m_options.m_posterCount == 0 ||
+            m_options.m_blockSize == 0 ||
+            m_options.m_blockQueueCapacity == 0 ||
+            m_options.m_documentQueueCapacity == 0)
+        {
+            RecoverableError error("IngestionPipeline: thread counts, block size, and queue capacities must be positive.");
+            throw error;
+        }
+    }
+
+
+    IngestionPipeline::~IngestionPipeline()
+    {
+    }
+
+
+    void IngestionPipeline::Ingest(std::vector<std::string> const & filePaths)
+    {
+        m_filePaths = &filePaths;
+        m_nextFile = 0;
+        m_failed = false;
+        m_error = nullptr;
+        for (auto & statistics : m_statistics)
+        {
+            statistics = StageStatistics();
+        }
+
+        m_blocks.reset(
+            new BlockingQueue<Block>(
+                static_cast<unsigned>(m_options.m_blockQueueCapacity)));
+        m_documents.reset(
+            new BlockingQueue<std::unique_ptr<DocumentBlock>>(
+                static_cast<unsigned>(m_options.m_documentQueueCapacity)));
+
+        Stopwatch stopwatch;
+
+        std::vector<std::unique_ptr<StageThread>> threads;
+        std::unique_ptr<IThreadManager> stages[StageCount];
+        const size_t counts[StageCount] = {
+            m_options.m_readerCount,
+            m_options.m_parserCount,
+            m_options.m_posterCount
+        };
+        const StageThread::Method methods[StageCount] = {
+            &IngestionPipeline::ReadThread,
+            &IngestionPipeline::ParseThread,
+            &IngestionPipeline::PostThread
+        };
+
+        // Start the consumers before the producers.
+        for (int stage = StageCount - 1; stage >= 0; --stage)
+        {
+            std::vector<IThreadBase*> stageThreads;
+            for (size_t i = 0; i < counts[stage]; ++i)
+            {
+                threads.emplace_back(new StageThread(*this,
+                                                     methods[stage],
+                                                     m_statistics[stage]));
+                stageThreads.push_back(threads.back().get());
+            }
+            stages[stage] = Factories::CreateThreadManager(stageThreads);
+        }
+
+        // Once a stage's threads have exited, shutting down its output
+        // queue lets the next stage drain the queue and exit.
+        stages[Read]->WaitForThreads();
+        m_blocks->Shutdown();
+        stages[Parse]->WaitForThreads();
+        m_documents->Shutdown();
+        stages[Post]->WaitForThreads();
+
+        m_elapsedSeconds = stopwatch.ElapsedTime();
+
+        if (m_error != nullptr)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+
+    void IngestionPipeline::ReadThread(StageStatistics& statistics)
+    {
+        for (;;)
+        {
+            const size_t index = m_nextFile++;
+            if (m_failed || index >= m_filePaths->size())
+            {
+                break;
+            }
+
+            try
+            {
+                ReadFile((*m_filePaths)[index], statistics);
+            }
+            catch (...)
+            {
+                OnError();
+            }
+        }
+    }
+
+
+    void IngestionPipeline::ReadFile(std::string const & path,
+                                     StageStatistics& statistics)
+    {
+        Stopwatch stopwatch;
+
+        std::shared_ptr<MemoryMappedFile>
+            file(new MemoryMappedFile(path.c_str(),
+                                      MemoryMappedFile::Sequential));
+
+        // A chunk is a sequence of documents followed by a '\0'.
+        char const * const chunkStart = file->GetData();
+        char const * const chunkEnd = chunkStart + file->GetSize();
+        if (chunkStart == chunkEnd || *(chunkEnd - 1) != 0)
+        {
+            std::stringstream message;
+            message << "IngestionPipeline: malformed chunk file '"
+                    << path
+                    << "'.";
+            throw FatalError(message.str());
+        }
+        char const * const documentsEnd = chunkEnd - 1;
+
+        char const * start = chunkStart;
+        while (start < documentsEnd && !m_failed)
+        {
+            char const * end = documentsEnd;
+            if (static_cast<size_t>(documentsEnd - start) > m_options.m_blockSize)
+            {
+                end = (std::min)(
+                    ChunkReader::FindDocumentBoundary(start + m_options.m_blockSize,
+                                                      chunkEnd),
+                    documentsEnd);
+            }
+
+            // Touch each page of the block so that the parsers find it in
+            // memory. The file was mapped for sequential access, so the
+            // operating system reads ahead of this loop.
+            const size_t c_pageSize = 4096;
+            char volatile sum = 0;
+            for (char const * p = start; p < end; p += c_pageSize)
+            {
+                sum += *p;
+            }
+
+            Block block;
+            block.m_file = file;
+            block.m_start = start;
+            block.m_end = end;
+
+            ++statistics.m_blockCount;
+            statistics.m_byteCount += end - start;
+            statistics.m_busySeconds += stopwatch.ElapsedTime();
+
+            stopwatch.Reset();
+            const bool enqueued = m_blocks->TryEnqueue(block);
+            statistics.m_outputWaitSeconds += stopwatch.ElapsedTime();
+            stopwatch.Reset();
+
+            if (!enqueued)
+            {
+                break;
+            }
+
+            start = end;
+        }
+
+        statistics.m_busySeconds += stopwatch.ElapsedTime();
+    }
+
+
+    void IngestionPipeline::ParseThread(StageStatistics& statistics)
+    {
+        Stopwatch stopwatch;
+        Block block;
+        while (m_blocks->TryDequeue(block))
+        {
+            statistics.m_inputWaitSeconds += stopwatch.ElapsedTime();
+            stopwatch.Reset();
+
+            // After a failure, keep draining the queue so that the readers
+            // are not left waiting on it.
+            if (!m_failed)
+            {
+                try
+                {
+                    std::unique_ptr<DocumentBlock> documents(AllocateDocumentBlock());
+                    documents->m_byteCount = block.m_end - block.m_start;
+
+                    Parser parser(m_config, *documents);
+                    ChunkReader::ReadDocuments(block.m_start, block.m_end, parser);
+
+                    // Release the block's reference to the file, so that it
+                    // can be unmapped while the documents are posted.
+                    block = Block();
+
+                    ++statistics.m_blockCount;
+                    statistics.m_byteCount += documents->m_byteCount;
+                    statistics.m_documentCount += documents->m_documentCount;
+                    statistics.m_busySeconds += stopwatch.ElapsedTime();
+
+                    stopwatch.Reset();
+                    m_documents->TryEnqueue(std::move(documents));
+                    statistics.m_outputWaitSeconds += stopwatch.ElapsedTime();
+                }
+                catch (...)
+                {
+                    OnError();
+                }
+            }
+
+            block = Block();
+            stopwatch.Reset();
+        }
+        statistics.m_inputWaitSeconds += stopwatch.ElapsedTime();
+    }
+
+
+    void IngestionPipeline::PostThread(StageStatistics& statistics)
+    {
+        Stopwatch stopwatch;
+        std::unique_ptr<DocumentBlock> documents;
+        while (m_documents->TryDequeue(documents))
+        {
+            statistics.m_inputWaitSeconds += stopwatch.ElapsedTime();
+            stopwatch.Reset();
+
+            if (!m_failed)
+            {
+                try
+                {
+                    for (size_t i = 0; i < documents->m_documentCount; ++i)
+                    {
+                        std::unique_ptr<Document> & document =
+                            documents->m_documents[i];
+                        const DocId id = document->GetDocId();
+                        m_ingestor.Add(id, *document);
+                        if (m_cacheDocuments)
+                        {
+                            m_ingestor.GetDocumentCache().Add(std::move(document),
+                                                              id);
+                        }
+                    }
+
+                    ++statistics.m_blockCount;
+                    statistics.m_byteCount += documents->m_byteCount;
+                    statistics.m_documentCount += documents->m_documentCount;
+                }
+                catch (...)
+                {
+                    OnError();
+                }
+            }
+
+            // Cached Documents now belong to the cache, so only blocks of
+            // uncached Documents can be reused.
+            if (m_cacheDocuments)
+            {
+                documents.reset();
+            }
+            else
+            {
+                ReleaseDocumentBlock(std::move(documents));
+            }
+            statistics.m_busySeconds += stopwatch.ElapsedTime();
+            stopwatch.Reset();
+        }
+        statistics.m_inputWaitSeconds += stopwatch.ElapsedTime();
+    }
+
+
+    std::unique_ptr<IngestionPipeline::DocumentBlock>
+        IngestionPipeline::AllocateDocumentBlock()
+    {
+        std::unique_ptr<DocumentBlock> documents;
+        {
+            std::lock_guard<std::mutex> lock(m_freeDocumentBlocksLock);
+            if (!m_freeDocumentBlocks.empty())
+            {
+                documents = std::move(m_freeDocumentBlocks.back());
+                m_freeDocumentBlocks.pop_back();
+            }
+        }
+
+        if (documents == nullptr)
+        {
+            documents.reset(new DocumentBlock());
+        }
+        documents->m_byteCount = 0;
+        documents->m_documentCount = 0;
+
+        return documents;
+    }
+
+
+    void IngestionPipeline::ReleaseDocumentBlock(std::unique_ptr<DocumentBlock> documents)
+    {
+        std::lock_guard<std::mutex> lock(m_freeDocumentBlocksLock);
+        m_freeDocumentBlocks.push_back(std::move(documents));
+    }
+
+
+    void IngestionPipeline::OnError()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_error == nullptr)
+        {
+            m_error = std::current_exception();
+        }
+        m_failed = true;
+    }
+
+
+    IngestionPipeline::StageStatistics const &
+        IngestionPipeline::GetStatistics(Stage stage) const
+    {
+        return m_statistics[stage];
+    }
+
+
+    void IngestionPipeline::PrintStatistics(std::ostream& out) const
+    {
+        static char const * const c_names[StageCount] = { "read", "parse", "post" };
+        const size_t counts[StageCount] = {
+            m_options.m_readerCount,
+            m_options.m_parserCount,
+            m_options.m_posterCount
+        };
+
+        out << "Ingestion pipeline: " << m_elapsedSeconds << "s" << std::endl;
+        out << "  stage   threads    blocks   documents       MB/s"
+            << "    busy%  starved%  blocked%" << std::endl;
+
+        for (int stage = 0; stage < StageCount; ++stage)
+        {
+            StageStatistics const & s = m_statistics[stage];
+            const double threadSeconds = counts[stage] * m_elapsedSeconds;
+            const double scale = (threadSeconds > 0.0) ? 100.0 / threadSeconds : 0.0;
+            const double megabytesPerSecond =
+                (m_elapsedSeconds > 0.0) ?
+                    s.m_byteCount / m_elapsedSeconds / (1 << 20) :
+                    0.0;
+
+            out << std::fixed << std::setprecision(1)
+                << "  " << std::left << std::setw(6) << c_names[stage]
+                << std::right
+                << std::setw(9) << counts[stage]
+                << std::setw(10) << s.m_blockCount
+                << std::setw(12) << s.m_documentCount
+                << std::setw(11) << megabytesPerSecond
+                << std::setw(9) << s.m_busySeconds * scale
+                << std::setw(10) << s.m_inputWaitSeconds * scale
+                << std::setw(10) << s.m_outputWaitSeconds * scale
+                << std::endl;
+        }
+
+        // The stage whose threads are busiest, and which rarely waits for
+        // input, limits the throughput of the pipeline. A stage whose
+        // threads are often blocked on output is being held back by the
+        // stage after it.
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6);
+    }
+}
@@ -0,0 +1,175 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                                   // std::atomic member.
+#include <exception>                                // std::exception_ptr member.
+#include <iosfwd>                                   // std::ostream parameter.
+#include <memory>                                   // std::shared_ptr member.
+#include <mutex>                                    // std::mutex member.
+#include <string>                                   // std::string parameter.
+#include <vector>                                   // std::vector member.
+
+#include "BitFunnel/Index/IngestChunks.h"           // IngestionPipelineOptions member.
+#include "BitFunnel/NonCopyable.h"                  // Inherits from NonCopyable.
+#include "BitFunnel/Utilities/BlockingQueue.h"      // BlockingQueue member.
+#include "Document.h"                               // std::unique_ptr<Document> parameterizes std::vector.
+
+
+namespace BitFunnel
+{
+    class IConfiguration;
+    class IIngestor;
+    class MemoryMappedFile;
+
+    //*************************************************************************
+    //
+    // IngestionPipeline implements IngestChunksPipelined(). See
+    // IngestChunks.h for a description of the stages.
+    //
+    // Each thread records its own StageStatistics, which are merged when the
+    // thread exits. If any stage throws, the pipeline stops reading, the
+    // remaining stages drain their queues without processing them, and
+    // Ingest() rethrows the first exception.
+    //
+    //*************************************************************************
+    class IngestionPipeline : NonCopyable
+    {
+    public:
+        IngestionPipeline(IConfiguration const & config,
+                          IIngestor& ingestor,
+                          IngestionPipelineOptions const & options,
+                          bool cacheDocuments);
+
+        ~IngestionPipeline();
+
+        // Ingests the files and returns once every document has been added
+        // to the ingestor.
+        void Ingest(std::vector<std::string> const & filePaths);
+
+        // Writes the statistics for the most recent call to Ingest().
+        void PrintStatistics(std::ostream& out) const;
+
+        class StageStatistics
+        {
+        public:
+            StageStatistics();
+
+            void Add(StageStatistics const & other);
+
+            // Number of blocks processed.
+            size_t m_blockCount;
+
+            // Number of bytes of chunk data in the blocks.
+            size_t m_byteCount;
+
+            // Number of documents in the blocks. Not counted by the read
+            // stage.
+            size_t m_documentCount;
+
+            // Thread-seconds spent processing blocks, waiting for a block to
+            // arrive on the input queue, and waiting for space on the output
+            // queue.
+            double m_busySeconds;
+            double m_inputWaitSeconds;
+            double m_outputWaitSeconds;
+        };
+
+        enum Stage
+        {
+            Read,
+            Parse,
+            Post,
+            StageCount
+        };
+
+        StageStatistics const & GetStatistics(Stage stage) const;
+
+    private:
+        // A range of whole documents in a mapped chunk file. The file stays
+        // mapped until every block that refers to it has been parsed.
+        class Block
+        {
+        public:
+            std::shared_ptr<MemoryMappedFile> m_file;
+            char const * m_start;
+            char const * m_end;
+        };
+
+        // The Documents parsed from a Block. The first m_documentCount
+        // entries of m_documents hold the Block's documents. When documents
+        // are not cached, DocumentBlocks are recycled after posting, and the
+        // Documents they hold are reused by later Blocks.
+        class DocumentBlock
+        {
+        public:
+            size_t m_byteCount;
+            size_t m_documentCount;
+            std::vector<std::unique_ptr<Document>> m_documents;
+        };
+
+        class StageThread;
+        class Parser;
+
+        void ReadThread(StageStatistics& statistics);
+        void ParseThread(StageStatistics& statistics);
+        void PostThread(StageStatistics& statistics);
+
+        // Splits a mapped chunk file into Blocks and enqueues them.
+        void ReadFile(std::string const & path, StageStatistics& statistics);
+
+        // Returns an empty DocumentBlock, reusing a posted one if possible.
+        std::unique_ptr<DocumentBlock> AllocateDocumentBlock();
+
+        // Makes a posted DocumentBlock available for reuse.
+        void ReleaseDocumentBlock(std::unique_ptr<DocumentBlock> documents);
+
+        // Records the first exception thrown by any stage.
+        void OnError();
+
+        IConfiguration const & m_config;
+        IIngestor& m_ingestor;
+        const IngestionPipelineOptions m_options;
+        bool m_cacheDocuments;
+
+        std::vector<std::string> const * m_filePaths;
+        std::atomic<size_t> m_nextFile;
+
+        std::unique_ptr<BlockingQueue<Block>> m_blocks;
+        std::unique_ptr<BlockingQueue<std::unique_ptr<DocumentBlock>>> m_documents;
+
+        // DocumentBlocks that have been posted. Their number is bounded by
+        // the capacity of m_documents plus the number of threads.
+        std::mutex m_freeDocumentBlocksLock;
+        std::vector<std::unique_ptr<DocumentBlock>> m_freeDocumentBlocks;
+
+        std::atomic<bool> m_failed;
+        std::exception_ptr m_error;
+
+        // Protects m_error and m_statistics.
+        std::mutex m_lock;
+
+        double m_elapsedSeconds;
+        StageStatistics m_statistics[StageCount];
+    };
+}
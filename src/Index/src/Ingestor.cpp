@@ -46,13 +46,17 @@ namespace BitFunnel
                               IRecycler& recycler,
                               ITermTableCollection const & termTables,
                               IShardDefinition const & shardDefinition,
-                              ISliceBufferAllocator& sliceBufferAllocator)
+                              ISliceBufferAllocator& sliceBufferAllocator,
+                              size_t activeSliceCount,
+                              size_t rowAlignment)
     {
         return std::unique_ptr<IIngestor>(new Ingestor(docDataSchema,
                                                        recycler,
                                                        termTables,
                                                        shardDefinition,
-                                                       sliceBufferAllocator));
+                                                       sliceBufferAllocator,
+                                                       activeSliceCount,
+                                                       rowAlignment));
     }
 
 
@@ -60,7 +64,9 @@ namespace BitFunnel
                        IRecycler& recycler,
                        ITermTableCollection const & termTables,
                        IShardDefinition const & shardDefinition,
-                       ISliceBufferAllocator& sliceBufferAllocator)
+                       ISliceBufferAllocator& sliceBufferAllocator,
+                       size_t activeSliceCount,
+                       size_t rowAlignment)
         : m_recycler(recycler),
           m_shardDefinition(shardDefinition),
           m_documentCount(0),   // TODO: This member is now redundant (with m_documentMap).
@@ -80,7 +86,9 @@ namespace BitFunnel
                               termTables.GetTermTable(shardId),
                               docDataSchema,
                               m_sliceBufferAllocator,
-                              m_sliceBufferAllocator.GetSliceBufferSize())));
+                              m_sliceBufferAllocator.GetSliceBufferSize(),
+                              activeSliceCount,
+                              rowAlignment)));
         }
     }
 
@@ -217,18 +225,13 @@ namespace BitFunnel
     {
         const Token token = m_tokenManager->RequestToken();
 
-        // Protecting from concurrent Delete operations. Even though individual
-        // function calls here are thread-safe, Delete on the same value of DocId
-        // is not, since it modifies the counters of the expired documents in the
-        // Slice.
-        std::lock_guard<std::mutex> lock(m_deleteDocumentLock);
-
-        bool isFound;
-        DocumentHandleInternal location = m_documentMap->Find(id, isFound);
+        // Only one of any concurrent Delete operations on the same DocId
+        // removes it from the map, so each document is expired only once.
+        DocumentHandleInternal location;
+        const bool isFound = m_documentMap->Delete(id, location);
 
         if (isFound)
         {
-            m_documentMap->Delete(id);
             location.Expire();
         }
 
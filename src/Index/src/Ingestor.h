@@ -24,7 +24,6 @@
 
 #include <atomic>                           // std::atomic member.
 #include <memory>                           // std::unique_ptr embedded.
-#include <mutex>                            // std::mutex member.
 #include <stddef.h>                         // size_t template parameter.
 #include <vector>                           // std::vector embedded.
 
@@ -57,7 +56,9 @@ namespace BitFunnel
                  IRecycler& recycle,
                  ITermTableCollection const & termTables,
                  IShardDefinition const & shardDefinition,
-                 ISliceBufferAllocator& sliceBufferAllocator);
+                 ISliceBufferAllocator& sliceBufferAllocator,
+                 size_t activeSliceCount,
+                 size_t rowAlignment);
 
         virtual ~Ingestor();
 
@@ -178,10 +179,6 @@ namespace BitFunnel
         // TokenManager which distributes tokens for thread synchronization.
         std::unique_ptr<ITokenManager> m_tokenManager;
 
-        // Lock protecting concurrent DeleteDocument operations.
-        std::mutex m_deleteDocumentLock;
-
-
         DocumentLengthHistogram m_histogram;
 
         // Allocator used to allocate memory for the slice buffers within
@@ -0,0 +1,157 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "LoggerInterfaces/Logging.h"
+#include "PostingSet.h"
+
+
+namespace BitFunnel
+{
+    PostingSet::PostingSet()
+      : m_slotMask(0),
+        m_slotBits(0),
+        m_generation(1)
+    {
+        m_slots.resize(c_initialSlotCount, Slot{ 0, 0 });
+        m_slotMask = c_initialSlotCount - 1;
+        while ((static_cast<size_t>(1) << m_slotBits) < c_initialSlotCount)
+        {
+            ++m_slotBits;
+        }
+    }
+
+
+    bool PostingSet::Add(Term const & term)
+    {
+        // Keep the load factor at or below one half.
+        if ((m_terms.size() + 1) * 2 > m_slots.size())
+        {
+            Grow();
+        }
+
+        size_t slot = GetSlot(term);
+        for (;;)
+        {
+            Slot& s = m_slots[slot];
+            if (s.m_generation != m_generation)
+            {
+                s.m_generation = m_generation;
+                s.m_index = static_cast<uint32_t>(m_terms.size());
+                m_terms.push_back(term);
+                return true;
+            }
+            if (m_terms[s.m_index] == term)
+            {
+                return false;
+            }
+            slot = (slot + 1) & m_slotMask;
+        }
+    }
+
+
+    bool PostingSet::Contains(Term const & term) const
+    {
+        size_t slot = GetSlot(term);
+        for (;;)
+        {
+            Slot const & s = m_slots[slot];
+            if (s.m_generation != m_generation)
+            {
+                return false;
+            }
+            if (m_terms[s.m_index] == term)
+            {
+                return true;
+            }
+            slot = (slot + 1) & m_slotMask;
+        }
+    }
+
+
+    void PostingSet::Clear()
+    {
+        m_terms.clear();
+
+        ++m_generation;
+        if (m_generation == 0)
+        {
+            // The generation wrapped around. Slots written 2^32 generations
+            // ago would otherwise appear to be in use.
+            for (auto & slot : m_slots)
+            {
+                slot.m_generation = 0;
+            }
+            m_generation = 1;
+        }
+    }
+
+
+    size_t PostingSet::size() const
+    {
+        return m_terms.size();
+    }
+
+
+    Term const * PostingSet::begin() const
+    {
+        return m_terms.data();
+    }
+
+
+    Term const * PostingSet::end() const
+    {
+        return m_terms.data() + m_terms.size();
+    }
+
+
+    size_t PostingSet::GetSlot(Term const & term) const
+    {
+        // Fibonacci hashing spreads the raw hash over the high bits, which
+        // then select the slot.
+        const uint64_t hash = term.GetRawHash() * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(hash >> (64 - m_slotBits));
+    }
+
+
+    void PostingSet::Grow()
+    {
+        LogAssertB(m_slots.size() * 2 <= (static_cast<size_t>(1) << 32),
+                   "PostingSet too large.");
+
+        m_slots.assign(m_slots.size() * 2, Slot{ 0, 0 });
+        m_slotMask = m_slots.size() - 1;
+        ++m_slotBits;
+        m_generation = 1;
+
+        for (size_t i = 0; i < m_terms.size(); ++i)
+        {
+            size_t slot = GetSlot(m_terms[i]);
+            while (m_slots[slot].m_generation == m_generation)
+            {
+                slot = (slot + 1) & m_slotMask;
+            }
+            m_slots[slot].m_generation = m_generation;
+            m_slots[slot].m_index = static_cast<uint32_t>(i);
+        }
+    }
+}
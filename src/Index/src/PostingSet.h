@@ -0,0 +1,109 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <stddef.h>                         // size_t return value.
+#include <stdint.h>                         // uint32_t template parameter.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Term.h"                 // Term template parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // PostingSet is the set of distinct Terms in a Document.
+    //
+    // It is an open-addressing hash set with linear probing. The Terms are
+    // kept in a dense array in the order they were added, and the hash table
+    // holds their positions in the array. Clear() empties the set without
+    // releasing its storage, so a PostingSet that is reused across documents
+    // stops allocating once it has grown to hold the largest document.
+    //
+    // Clear() takes constant time. Each slot of the hash table is stamped
+    // with the generation in which it was written, and Clear() just starts a
+    // new generation.
+    //
+    // Two Terms are the same posting if they are equal under
+    // Term::operator==, as with std::unordered_set<Term, Term::Hasher>.
+    //
+    // Thread safety: not thread safe.
+    //
+    //*************************************************************************
+    class PostingSet : NonCopyable
+    {
+    public:
+        PostingSet();
+
+        // Adds term to the set. Returns true if the term was added, or false
+        // if an equal term was already in the set.
+        bool Add(Term const & term);
+
+        // Returns true if the set contains a term equal to term.
+        bool Contains(Term const & term) const;
+
+        // Removes all of the terms, but keeps the storage for reuse.
+        void Clear();
+
+        // Returns the number of terms in the set.
+        size_t size() const;
+
+        // The terms, in the order they were added.
+        Term const * begin() const;
+        Term const * end() const;
+
+    private:
+        // Returns the first slot to probe for term.
+        size_t GetSlot(Term const & term) const;
+
+        // Doubles the size of the hash table and reinserts the terms.
+        void Grow();
+
+        class Slot
+        {
+        public:
+            // Value of m_generation when the slot was written. The slot is
+            // empty if this is not the current generation.
+            uint32_t m_generation;
+
+            // Position of the slot's term in m_terms.
+            uint32_t m_index;
+        };
+
+        static const size_t c_initialSlotCount = 64;
+
+        std::vector<Term> m_terms;
+        std::vector<Slot> m_slots;
+
+        // m_slots.size() - 1. The number of slots is a power of two.
+        size_t m_slotMask;
+
+        // log2 of the number of slots.
+        unsigned m_slotBits;
+
+        uint32_t m_generation;
+    };
+}
@@ -0,0 +1,184 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <atomic>
+#include <memory>
+
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTreatment.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Term.h"
+#include "LoggerInterfaces/Logging.h"
+#include "RowIdCache.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // RowIdCache::ThreadCache
+    //
+    //*************************************************************************
+    class RowIdCache::ThreadCache
+    {
+    public:
+        ThreadCache()
+          : m_ownerId(0),
+            m_lastSelected(0)
+        {
+            Clear();
+        }
+
+        void Clear()
+        {
+            for (size_t i = 0; i < c_size; ++i)
+            {
+                m_entries[i].m_isValid = false;
+            }
+        }
+
+        class Entry
+        {
+        public:
+            Term::Hash m_hash;
+            Term::GramSize m_gramSize;
+            Term::IdfX10 m_idf;
+            uint8_t m_rowCount;
+            bool m_isValid;
+            RowId m_rows[RowConfiguration::Entry::c_maxRowCount];
+        };
+
+        static const size_t c_size = 1ull << c_log2CacheSize;
+
+        // Id of the RowIdCache whose entries the cache holds.
+        uint64_t m_ownerId;
+
+        // When the thread last switched to this cache, in switches.
+        uint64_t m_lastSelected;
+
+        Entry m_entries[c_size];
+    };
+
+
+    static std::atomic<uint64_t> g_nextRowIdCacheId(1);
+
+
+    //*************************************************************************
+    //
+    // RowIdCache
+    //
+    //*************************************************************************
+    RowIdCache::RowIdCache(ITermTable const & termTable)
+      : m_termTable(termTable),
+        m_id(g_nextRowIdCacheId++)
+    {
+    }
+
+
+    RowId const * RowIdCache::GetRows(Term const & term, size_t& rowCount) const
+    {
+        ThreadCache& cache = GetThreadCache();
+
+        const Term::Hash hash = term.GetRawHash();
+        const Term::GramSize gramSize = term.GetGramSize();
+        const Term::IdfX10 idf = term.GetIdfMax();
+
+        // Term hashes are well mixed, so the low bits select the entry.
+        ThreadCache::Entry& entry = cache.m_entries[hash & (ThreadCache::c_size - 1)];
+
+        if (!entry.m_isValid ||
+            entry.m_hash != hash ||
+            entry.m_gramSize != gramSize ||
+            entry.m_idf != idf)
+        {
+            entry.m_hash = hash;
+            entry.m_gramSize = gramSize;
+            entry.m_idf = idf;
+            entry.m_rowCount = 0;
+
+            RowIdSequence rows(term, m_termTable);
+            for (auto const row : rows)
+            {
+                LogAssertB(entry.m_rowCount < RowConfiguration::Entry::c_maxRowCount,
+                           "RowIdCache: too many rows.");
+                entry.m_rows[entry.m_rowCount++] = row;
+            }
+
+            entry.m_isValid = true;
+        }
+
+        rowCount = entry.m_rowCount;
+        return entry.m_rows;
+    }
+
+
+    RowIdCache::ThreadCache& RowIdCache::GetThreadCache() const
+    {
+        thread_local std::unique_ptr<ThreadCache> caches[c_threadCacheCount];
+        thread_local ThreadCache* current = nullptr;
+        thread_local uint64_t switchCount = 0;
+
+        // Consecutive lookups almost always come from the same RowIdCache.
+        if (current != nullptr && current->m_ownerId == m_id)
+        {
+            return *current;
+        }
+
+        // Look for the cache tagged with this RowIdCache's id.
+        current = nullptr;
+        for (auto & cache : caches)
+        {
+            if (cache.get() != nullptr && cache->m_ownerId == m_id)
+            {
+                current = cache.get();
+                break;
+            }
+        }
+
+        // Otherwise allocate another cache, or take over the one that was
+        // selected least recently.
+        if (current == nullptr)
+        {
+            std::unique_ptr<ThreadCache>* victim = &caches[0];
+            for (auto & cache : caches)
+            {
+                if (cache.get() == nullptr)
+                {
+                    cache.reset(new ThreadCache());
+                    victim = &cache;
+                    break;
+                }
+                if (cache->m_lastSelected < (*victim)->m_lastSelected)
+                {
+                    victim = &cache;
+                }
+            }
+
+            current = victim->get();
+            current->Clear();
+            current->m_ownerId = m_id;
+        }
+
+        current->m_lastSelected = ++switchCount;
+        return *current;
+    }
+}
@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t parameter.
+#include <stdint.h>                     // uint64_t member.
+
+#include "BitFunnel/Index/RowId.h"      // RowId return value.
+#include "BitFunnel/NonCopyable.h"      // Base class.
+
+
+namespace BitFunnel
+{
+    class ITermTable;
+    class Term;
+
+    //*************************************************************************
+    //
+    // RowIdCache
+    //
+    // Resolves Terms to their RowIds through a small, direct-mapped,
+    // per-thread cache in front of an ITermTable. Ingestion resolves every
+    // posting, and most postings are a few thousand common terms. A cache
+    // hit returns the RowIds directly, without the TermTable probe and,
+    // for adhoc terms, the per-row hashing of RowIdSequence.
+    //
+    // The RowIds of a Term depend only on its raw hash, gram size and
+    // maximum IDF, which together form the cache key. The ITermTable must be
+    // sealed, so that the RowIds of a Term never change.
+    //
+    // Each thread has up to c_threadCacheCount caches of about 36KB each.
+    // Every cache is tagged with the id of the RowIdCache that owns it. A
+    // RowIdCache uses the cache tagged with its id, and when there is none,
+    // takes over the cache its thread has least recently switched to. This
+    // allows a thread to ingest into several Shards, each with its own
+    // RowIdCache, without emptying a cache for every document. A thread's
+    // caches are allocated as it starts using more RowIdCaches.
+    //
+    // Thread safety: all methods are thread safe. The ITermTable's reader
+    // methods must be thread safe.
+    //
+    //*************************************************************************
+    class RowIdCache : NonCopyable
+    {
+    public:
+        RowIdCache(ITermTable const & termTable);
+
+        // Returns the RowIds of term, and sets rowCount to their number. The
+        // RowIds remain valid until the calling thread's next call to
+        // GetRows() on any RowIdCache.
+        RowId const * GetRows(Term const & term, size_t& rowCount) const;
+
+        // log2 of the number of entries in each cache.
+        static const unsigned c_log2CacheSize = 9;
+
+        // Number of caches for each thread.
+        static const size_t c_threadCacheCount = 4;
+
+    private:
+        class ThreadCache;
+
+        // Returns the calling thread's cache for this RowIdCache, after
+        // emptying it if it belonged to another RowIdCache.
+        ThreadCache& GetThreadCache() const;
+
+        ITermTable const & m_termTable;
+
+        // Identifies this RowIdCache to the thread caches. Unlike the
+        // address, an id is never reused by a later RowIdCache.
+        const uint64_t m_id;
+    };
+}
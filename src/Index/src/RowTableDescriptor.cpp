@@ -23,24 +23,80 @@
 
 #include <cstring>
 
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <intrin.h>
+#endif
+
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/Row.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "LoggerInterfaces/Logging.h"
+#include "Rounding.h"
 #include "RowTableDescriptor.h"
 
 
 namespace BitFunnel
 {
+    // Sets the bits of mask in *word with an atomic fetch_or, unless they are
+    // already set. The plain read avoids a locked instruction for the many
+    // postings to shared and higher rank rows whose bits are already set.
+    static void AtomicOr(uint64_t* word, uint64_t mask)
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        if ((*static_cast<uint64_t volatile *>(word) & mask) != mask)
+        {
+            _InterlockedOr64(reinterpret_cast<__int64 volatile *>(word),
+                             static_cast<__int64>(mask));
+        }
+#else
+        if ((__atomic_load_n(word, __ATOMIC_RELAXED) & mask) != mask)
+        {
+            __atomic_fetch_or(word, mask, __ATOMIC_RELEASE);
+        }
+#endif
+    }
+
+
+    // Clears the bits not in mask from *word with an atomic fetch_and, unless
+    // they are already clear.
+    static void AtomicAnd(uint64_t* word, uint64_t mask)
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        if ((*static_cast<uint64_t volatile *>(word) & ~mask) != 0)
+        {
+            _InterlockedAnd64(reinterpret_cast<__int64 volatile *>(word),
+                              static_cast<__int64>(mask));
+        }
+#else
+        if ((__atomic_load_n(word, __ATOMIC_RELAXED) & ~mask) != 0)
+        {
+            __atomic_fetch_and(word, mask, __ATOMIC_RELEASE);
+        }
+#endif
+    }
+
+
+    static void PrefetchForWrite(void const * address)
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        _mm_prefetch(static_cast<char const *>(address), _MM_HINT_T0);
+#else
+        __builtin_prefetch(address, 1);
+#endif
+    }
+
+
     RowTableDescriptor::RowTableDescriptor(DocIndex capacity,
                                            RowIndex rowCount,
                                            Rank rank,
-                                           ptrdiff_t rowTableBufferOffset)
+                                           ptrdiff_t rowTableBufferOffset,
+                                           size_t rowAlignment)
         : m_capacity(capacity),
           m_rowCount(rowCount),
           m_rank(rank),
+          m_rowAlignment(rowAlignment),
           m_bufferOffset(rowTableBufferOffset),
-          m_bytesPerRow(Row::BytesInRow(capacity, rank))
+          m_bytesPerRow(GetBytesPerRow(capacity, rank, rowAlignment))
     {
         // Make sure capacity is properly rounded already.
         // TODO: fix.
@@ -56,6 +112,7 @@ namespace BitFunnel
         : m_capacity(other.m_capacity),
           m_rowCount(other.m_rowCount),
           m_rank(other.m_rank),
+          m_rowAlignment(other.m_rowAlignment),
           m_bufferOffset(other.m_bufferOffset),
           m_bytesPerRow(other.m_bytesPerRow)
     {
@@ -65,7 +122,9 @@ namespace BitFunnel
     void RowTableDescriptor::Initialize(void* sliceBuffer, ITermTable const & termTable) const
     {
         char* const rowTableBuffer = reinterpret_cast<char*>(sliceBuffer) + m_bufferOffset;
-        memset(rowTableBuffer, 0, GetBufferSize(m_capacity, m_rowCount, m_rank));
+        memset(rowTableBuffer,
+               0,
+               GetBufferSize(m_capacity, m_rowCount, m_rank, m_rowAlignment));
 
         // The "match-all" row needs to be initialized differently.
         RowIdSequence rows(termTable.GetMatchAllTerm(), termTable);
@@ -121,13 +180,56 @@ namespace BitFunnel
         uint64_t* const row = GetRowData(sliceBuffer, rowIndex);
         const size_t offset = QwordPositionFromDocIndex(docIndex);
 
-        // Note that the offset here is shifted left by 6.
-        // _interlockedbittestandset64(row + (offset >> 6), offset & 0x3F);
-
         uint64_t bitPos = docIndex & 0x3F;
         uint64_t bitMask = 1ull << bitPos;
-        uint64_t newVal = *(row + offset) | bitMask;
-        *(row + offset) = newVal;
+        AtomicOr(row + offset, bitMask);
+    }
+
+
+    void RowTableDescriptor::SetBits(void* sliceBuffer,
+                                     DocIndex docIndex,
+                                     RowIndex const * rows,
+                                     size_t rowCount) const
+    {
+        if (rowCount == 0)
+        {
+            return;
+        }
+
+        // Every row has the document's bit in the same word and at the same
+        // position, so the word for rows[i] is m_bytesPerRow * rows[i] bytes
+        // past the word for row 0.
+        char* const column = reinterpret_cast<char*>(
+            GetRowData(sliceBuffer, 0) + QwordPositionFromDocIndex(docIndex));
+        const uint64_t bitMask = 1ull << (docIndex & 0x3F);
+
+        // Number of rows to prefetch ahead of the row being written.
+        const size_t c_prefetchDistance = 8;
+        for (size_t i = 0; i < c_prefetchDistance && i < rowCount; ++i)
+        {
+            PrefetchForWrite(column + rows[i] * m_bytesPerRow);
+        }
+
+        RowIndex previous = rows[0];
+        for (size_t i = 0; i < rowCount; ++i)
+        {
+            const RowIndex row = rows[i];
+            LogAssertB(row < m_rowCount, "rowIndex out of range");
+            LogAssertB(i == 0 || row >= previous, "rows not sorted");
+
+            if (i + c_prefetchDistance < rowCount)
+            {
+                PrefetchForWrite(column + rows[i + c_prefetchDistance] * m_bytesPerRow);
+            }
+
+            // Duplicate rows share a word.
+            if (i == 0 || row != previous)
+            {
+                AtomicOr(reinterpret_cast<uint64_t*>(column + row * m_bytesPerRow),
+                         bitMask);
+            }
+            previous = row;
+        }
     }
 
 
@@ -138,13 +240,9 @@ namespace BitFunnel
         uint64_t* const row = GetRowData(sliceBuffer, rowIndex);
         const size_t offset = QwordPositionFromDocIndex(docIndex);
 
-        // Note that the offset here is shifted left by 6.
-        // _interlockedbittestandreset64(row + (offset >> 6), offset & 0x3F);
-
         uint64_t bitPos = docIndex & 0x3F;
         uint64_t bitMask = ~(1ull << bitPos);
-        uint64_t newVal = *(row + offset) & bitMask;
-        *(row + offset) = newVal;
+        AtomicAnd(row + offset, bitMask);
     }
 
 
@@ -157,14 +255,28 @@ namespace BitFunnel
     /* static */
     size_t RowTableDescriptor::GetBufferSize(DocIndex capacity,
                                              RowIndex rowCount,
-                                             Rank rank)
+                                             Rank rank,
+                                             size_t rowAlignment)
     {
         // Make sure capacity is properly rounded already.
         // TODO: fix.
         // LogAssertB(capacity == Row::DocumentsInRank0Row(capacity),
         //            "capacity not evenly rounded.");
 
-        return static_cast<unsigned>(Row::BytesInRow(capacity, rank) * rowCount);
+        return static_cast<unsigned>(GetBytesPerRow(capacity, rank, rowAlignment) * rowCount);
+    }
+
+
+    /* static */
+    size_t RowTableDescriptor::GetBytesPerRow(DocIndex capacity,
+                                              Rank rank,
+                                              size_t rowAlignment)
+    {
+        LogAssertB(rowAlignment >= Row::GetAlignment() &&
+                   (rowAlignment & (rowAlignment - 1)) == 0,
+                   "Row alignment must be a power of two no less than Row::GetAlignment().");
+
+        return RoundUp(Row::BytesInRow(capacity, rank), rowAlignment);
     }
 
 
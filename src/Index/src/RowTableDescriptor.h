@@ -26,6 +26,7 @@
 #include <cstddef>                      // size_t embedded.
 
 #include "BitFunnel/BitFunnelTypes.h"   // DocIndex parameter.
+#include "BitFunnel/Index/Row.h"        // Row::GetAlignment() default parameter.
 #include "BitFunnel/Index/RowId.h"      // RowIndex parameter.
 
 
@@ -44,6 +45,10 @@ namespace BitFunnel
     //
     // All methods except Initialize are thread safe. Initialize method is not
     // thread-safe with respect to calling *Bit methods at the same time.
+    // SetBit, SetBits and ClearBit modify each 64-bit word of a row with an
+    // interlocked operation, so documents that share a word may be ingested
+    // concurrently without losing bits. An interlocked operation is skipped
+    // when the word already has the desired value.
     //
     //*************************************************************************
     class RowTableDescriptor
@@ -52,11 +57,13 @@ namespace BitFunnel
         // Constructs a RowTableDescriptor with given dimensions.
         // rowTableBufferOffset represents the offset where this RowTable's
         // data starts within a larger slice buffer which is passed to other
-        // methods.
+        // methods. Each row is padded to a multiple of rowAlignment bytes,
+        // which must be a power of two no smaller than Row::GetAlignment().
         RowTableDescriptor(DocIndex capacity,
                            RowIndex rowCount,
                            Rank rank,
-                           ptrdiff_t bufferOffset);
+                           ptrdiff_t bufferOffset,
+                           size_t rowAlignment = Row::GetAlignment());
 
         // Copy constructor from another RowTableDescriptor. Required so that
         // RowTableDescriptor can be used in std::vector and that a Slice can
@@ -77,10 +84,20 @@ namespace BitFunnel
         // Gets a bit in the given row and column.
         uint64_t GetBit(void* sliceBuffer, RowIndex rowIndex, DocIndex docIndex) const;
 
-        // Sets a bit in the given row and column.
+        // Sets a bit in the given row and column, with an atomic fetch_or.
         void SetBit(void* sliceBuffer, RowIndex rowIndex, DocIndex docIndex) const;
 
-        // Clears a bit in the given row and column.
+        // Sets the bits in column docIndex of each of the rowCount rows in
+        // rows. The rows must be sorted in ascending order and may contain
+        // duplicates. The words are visited in address order, with each
+        // cache line prefetched ahead of use, and each word is updated with
+        // at most one atomic fetch_or, and none if the bit is already set.
+        void SetBits(void* sliceBuffer,
+                     DocIndex docIndex,
+                     RowIndex const * rows,
+                     size_t rowCount) const;
+
+        // Clears a bit in the given row and column, with an atomic fetch_and.
         void ClearBit(void* sliceBuffer, RowIndex rowIndex, DocIndex docIndex) const;
 
         // Returns the offset of a row with the given index, relative to the
@@ -93,10 +110,20 @@ namespace BitFunnel
 
         // Returns the byte size of the buffer required to host a RowTable with
         // given dimensions. This assists the caller in allocating large enough
-        // buffer for all RowTables.
+        // buffer for all RowTables. Passing a rowAlignment of 32 or 64 pads
+        // each row so that, when the RowTable itself starts on such a
+        // boundary, every row starts on a vector register or cache line
+        // boundary.
         static size_t GetBufferSize(DocIndex capacity,
                                     RowIndex rowCount,
-                                    Rank rank);
+                                    Rank rank,
+                                    size_t rowAlignment = Row::GetAlignment());
+
+        // Returns the number of bytes occupied by each row, including
+        // padding.
+        static size_t GetBytesPerRow(DocIndex capacity,
+                                     Rank rank,
+                                     size_t rowAlignment);
 
     private:
         // Declare but don't implement. This is required for a std::vector to
@@ -117,6 +144,7 @@ namespace BitFunnel
         const DocIndex m_capacity;
         const RowIndex m_rowCount;
         const Rank m_rank;
+        const size_t m_rowAlignment;
 
         // Offset where this RowTable starts in the slice buffer.
         const ptrdiff_t m_bufferOffset;
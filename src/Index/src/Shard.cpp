@@ -21,6 +21,9 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
+#include <atomic>
+
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/IRecycler.h"
 #include "BitFunnel/Index/ISliceBufferAllocator.h"
@@ -32,6 +35,7 @@
 #include "IRecyclable.h"
 #include "LoggerInterfaces/Logging.h"
 #include "Recycler.h"
+#include "Rounding.h"
 #include "Shard.h"
 
 
@@ -68,31 +72,68 @@ namespace BitFunnel
     }
 
 
+    // Returns a TermTable generation that has not been used by any Shard.
+    static uint64_t GetNextTermTableGeneration()
+    {
+        static std::atomic<uint64_t> nextGeneration(0);
+        return nextGeneration++;
+    }
+
+
+    // Returns a number that identifies the calling thread. Threads are
+    // numbered consecutively in the order in which they first allocate a
+    // document, so that threads which ingest concurrently are spread evenly
+    // across a Shard's ActiveSlices and frequency table accumulators.
+    static size_t GetThreadNumber()
+    {
+        static std::atomic<size_t> nextThreadNumber(0);
+        thread_local const size_t threadNumber = nextThreadNumber++;
+        return threadNumber;
+    }
+
+
+    Shard::ActiveSlice::ActiveSlice()
+      : m_slice(nullptr)
+    {
+    }
+
+
     Shard::Shard(IRecycler& recycler,
                  ITokenManager& tokenManager,
                  ITermTable const & termTable,
                  IDocumentDataSchema const & docDataSchema,
                  ISliceBufferAllocator& sliceBufferAllocator,
-                 size_t sliceBufferSize)
+                 size_t sliceBufferSize,
+                 size_t activeSliceCount,
+                 size_t rowAlignment)
         : m_recycler(recycler),
           m_tokenManager(tokenManager),
-          m_termTable(termTable),
+          m_termTable(&termTable),
+          m_termTableGeneration(GetNextTermTableGeneration()),
+          m_rowIdCache(new RowIdCache(termTable)),
           m_sliceBufferAllocator(sliceBufferAllocator),
           m_documentActiveRowId(RowIdForActiveDocument(termTable)),
-          m_activeSlice(nullptr),
+          m_activeSliceCount(activeSliceCount),
+          m_activeSlices(new ActiveSlice[activeSliceCount]),
           m_sliceBuffers(new std::vector<void*>()),
           m_sliceCapacity(GetCapacityForByteSize(sliceBufferSize,
                                                  docDataSchema,
-                                                 termTable)),
+                                                 termTable,
+                                                 rowAlignment)),
           m_sliceBufferSize(sliceBufferSize),
           // TODO: will need one global, not one per shard.
-          m_docFrequencyTableBuilder(new DocumentFrequencyTableBuilder())
+          m_docFrequencyTableBuilder(
+              new DocumentFrequencyTableBuilder(activeSliceCount))
     {
+        LogAssertB(activeSliceCount > 0,
+                   "Shard must have at least one active Slice.");
+
         const size_t bufferSize =
             InitializeDescriptors(this,
                                   m_sliceCapacity,
                                   docDataSchema,
-                                  termTable);
+                                  termTable,
+                                  rowAlignment);
 
         LogAssertB(bufferSize <= sliceBufferSize,
                    "Shard sliceBufferSize too small.");
@@ -106,17 +147,26 @@ namespace BitFunnel
 
     DocumentHandleInternal Shard::AllocateDocument(DocId id)
     {
-        std::lock_guard<std::mutex> lock(m_slicesLock);
+        ActiveSlice& active =
+            m_activeSlices[GetThreadNumber() % m_activeSliceCount];
+
+        std::lock_guard<std::mutex> lock(active.m_lock);
         DocIndex index;
-        if (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(index))
+        if (active.m_slice == nullptr || !active.m_slice->TryAllocateDocument(index))
         {
-            CreateNewActiveSlice();
+            active.m_slice = CreateNewActiveSlice();
 
-            LogAssertB(m_activeSlice->TryAllocateDocument(index),
+            LogAssertB(active.m_slice->TryAllocateDocument(index),
                        "Newly allocated slice has no space.");
         }
 
-        return DocumentHandleInternal(m_activeSlice, index, id);
+        return DocumentHandleInternal(active.m_slice, index, id);
+    }
+
+
+    size_t Shard::GetActiveSliceCount() const
+    {
+        return m_activeSliceCount;
     }
 
 
@@ -125,17 +175,19 @@ namespace BitFunnel
         return m_sliceBufferAllocator.Allocate(m_sliceBufferSize);
     }
 
-    // Must be called with m_slicesLock held.
-    void Shard::CreateNewActiveSlice()
+    // Must be called with the lock of the ActiveSlice that will hold the new
+    // Slice. Initializing the slice buffer does not require m_slicesLock.
+    Slice* Shard::CreateNewActiveSlice()
     {
         Slice* newSlice = new Slice(*this);
 
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+
         std::vector<void*>* oldSlices = m_sliceBuffers;
         std::vector<void*>* const newSlices = new std::vector<void*>(*m_sliceBuffers);
         newSlices->push_back(newSlice->GetSliceBuffer());
 
         m_sliceBuffers = newSlices;
-        m_activeSlice = newSlice;
 
         // TODO: think if this can be done outside of the lock.
         std::unique_ptr<IRecyclable>
@@ -144,13 +196,16 @@ namespace BitFunnel
                                                             m_tokenManager));
 
         m_recycler.ScheduleRecyling(recyclableSliceList);
+
+        return newSlice;
     }
 
 
     /* static */
     DocIndex Shard::GetCapacityForByteSize(size_t bufferSizeInBytes,
                                            IDocumentDataSchema const & schema,
-                                           ITermTable const & termTable)
+                                           ITermTable const & termTable,
+                                           size_t rowAlignment)
     {
         DocIndex capacity = 0;
         for (;;)
@@ -161,7 +216,8 @@ namespace BitFunnel
                 InitializeDescriptors(nullptr,
                                       newSuggestedCapacity,
                                       schema,
-                                      termTable);
+                                      termTable,
+                                      rowAlignment);
             if (newBufferSize > bufferSizeInBytes)
             {
                 break;
@@ -223,7 +279,60 @@ namespace BitFunnel
 
     ITermTable const & Shard::GetTermTable() const
     {
-        return m_termTable;
+        return *m_termTable;
+    }
+
+
+    uint64_t Shard::GetTermTableGeneration() const
+    {
+        return m_termTableGeneration;
+    }
+
+
+    void Shard::SetTermTable(ITermTable const & termTable)
+    {
+        ITermTable const & current = *m_termTable;
+
+        for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+        {
+            if (termTable.GetTotalRowCount(rank) !=
+                current.GetTotalRowCount(rank))
+            {
+                RecoverableError
+                    error("Shard::SetTermTable: TermTable has different row counts.");
+                throw error;
+            }
+        }
+
+        const Term systemTerms[] = {
+            current.GetDocumentActiveTerm(),
+            current.GetMatchAllTerm(),
+            current.GetMatchNoneTerm()
+        };
+        for (auto const & term : systemTerms)
+        {
+            RowIdSequence oldRows(term, current);
+            RowIdSequence newRows(term, termTable);
+            if (!std::equal(oldRows.begin(), oldRows.end(),
+                            newRows.begin(), newRows.end()))
+            {
+                RecoverableError
+                    error("Shard::SetTermTable: TermTable has different system rows.");
+                throw error;
+            }
+        }
+
+        // Publish the TermTable before its generation, so that a plan
+        // stamped with the new generation never uses the old TermTable.
+        m_rowIdCache.reset(new RowIdCache(termTable));
+        m_termTable = &termTable;
+        m_termTableGeneration = GetNextTermTableGeneration();
+    }
+
+
+    DocId Shard::GetDocId(void* sliceBuffer, DocIndex index) const
+    {
+        return m_docTable->GetDocId(sliceBuffer, index);
     }
 
 
@@ -239,7 +348,8 @@ namespace BitFunnel
     size_t Shard::InitializeDescriptors(Shard* shard,
                                         DocIndex sliceCapacity,
                                         IDocumentDataSchema const & docDataSchema,
-                                        ITermTable const & termTable)
+                                        ITermTable const & termTable,
+                                        size_t rowAlignment)
     {
         ptrdiff_t currentOffset = 0;
 
@@ -255,21 +365,30 @@ namespace BitFunnel
 
         for (Rank r = 0; r <= c_maxRankValue; ++r)
         {
-            // TODO: see if this alignment matters.
-            // currentOffset = RoundUp(currentOffset, c_rowTableByteAlignment);
+            currentOffset = static_cast<ptrdiff_t>(
+                RoundUp(static_cast<size_t>(currentOffset), rowAlignment));
 
             const RowIndex rowCount = termTable.GetTotalRowCount(r);
 
             if (shard != nullptr)
             {
-                shard->m_rowTables.emplace_back(sliceCapacity, rowCount, r, currentOffset);
+                shard->m_rowTables.emplace_back(sliceCapacity,
+                                                rowCount,
+                                                r,
+                                                currentOffset,
+                                                rowAlignment);
             }
 
-            currentOffset += RowTableDescriptor::GetBufferSize(sliceCapacity, rowCount, r);
+            currentOffset += RowTableDescriptor::GetBufferSize(sliceCapacity,
+                                                               rowCount,
+                                                               r,
+                                                               rowAlignment);
         }
 
         // A pointer to a Slice is placed at the end of the slice buffer.
         currentOffset += sizeof(void*);
+        currentOffset = static_cast<ptrdiff_t>(
+            RoundUp(static_cast<size_t>(currentOffset), rowAlignment));
 
         const size_t sliceBufferSize = static_cast<size_t>(currentOffset);
 
@@ -282,13 +401,26 @@ namespace BitFunnel
         std::vector<void*>* oldSlices = nullptr;
         size_t newSliceCount;
 
+        if (!slice.IsExpired())
         {
-            std::lock_guard<std::mutex> lock(m_slicesLock);
+            throw RecoverableError("Slice being recycled has not been fully expired");
+        }
 
-            if (!slice.IsExpired())
+        // A fully expired Slice is also full, so no further documents will
+        // be allocated from it. Once it has been removed from the
+        // ActiveSlices, no thread holds a pointer to it.
+        for (size_t i = 0; i < m_activeSliceCount; ++i)
+        {
+            ActiveSlice& active = m_activeSlices[i];
+            std::lock_guard<std::mutex> lock(active.m_lock);
+            if (active.m_slice == &slice)
             {
-                throw RecoverableError("Slice being recycled has not been fully expired");
+                active.m_slice = nullptr;
             }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_slicesLock);
 
             std::vector<void*>* const newSlices = new std::vector<void*>();
             newSlices->reserve(m_sliceBuffers.load()->size() - 1);
@@ -310,13 +442,6 @@ namespace BitFunnel
 
             oldSlices = m_sliceBuffers.load();
             m_sliceBuffers = newSlices;
-
-            if (m_activeSlice == &slice)
-            {
-                // If all of the above validations are true, then this was the
-                // last Slice in the Shard.
-                m_activeSlice = nullptr;
-            }
         }
 
         // Scheduling the Slice and the old list of slice buffers can be
@@ -342,18 +467,73 @@ namespace BitFunnel
     {
         if (m_docFrequencyTableBuilder.get() != nullptr)
         {
-            std::lock_guard<std::mutex> lock(m_temporaryFrequencyTableMutex);
-            m_docFrequencyTableBuilder->OnTerm(term);
+            m_docFrequencyTableBuilder->OnTerm(GetThreadNumber(), term);
         }
 
 
-        RowIdSequence rows(term, m_termTable);
+        size_t rowCount;
+        RowId const * rows = m_rowIdCache->GetRows(term, rowCount);
 
-        for (auto const row : rows)
+        for (size_t i = 0; i < rowCount; ++i)
         {
-            m_rowTables[row.GetRank()].SetBit(sliceBuffer,
-                                              row.GetIndex(),
-                                              index);
+            m_rowTables[rows[i].GetRank()].SetBit(sliceBuffer,
+                                                  rows[i].GetIndex(),
+                                                  index);
+        }
+    }
+
+
+    void Shard::AddPostings(Term const * terms,
+                            size_t termCount,
+                            DocIndex index,
+                            void* sliceBuffer)
+    {
+        if (m_docFrequencyTableBuilder.get() != nullptr)
+        {
+            m_docFrequencyTableBuilder->OnTerms(GetThreadNumber(), terms, termCount);
+        }
+
+        // Each RowId is encoded as a key whose high bits hold the rank, so
+        // that sorting the keys groups rows by rank and orders each group by
+        // row offset. The buffer is reused by each thread's documents.
+        const unsigned c_rankShift = 56;
+        const RowIndex c_rowIndexMask = (static_cast<RowIndex>(1) << c_rankShift) - 1;
+        static_assert(sizeof(RowIndex) * 8 > c_rankShift,
+                      "RowIndex too small to hold a rank and row index.");
+
+        thread_local std::vector<RowIndex> rows;
+        rows.clear();
+        for (size_t i = 0; i < termCount; ++i)
+        {
+            size_t rowCount;
+            RowId const * termRows = m_rowIdCache->GetRows(terms[i], rowCount);
+            for (size_t j = 0; j < rowCount; ++j)
+            {
+                rows.push_back((static_cast<RowIndex>(termRows[j].GetRank()) << c_rankShift) |
+                               termRows[j].GetIndex());
+            }
+        }
+
+        std::sort(rows.begin(), rows.end());
+
+        // Strip the rank from each group of keys and write the group's rows.
+        size_t start = 0;
+        while (start < rows.size())
+        {
+            const Rank rank = static_cast<Rank>(rows[start] >> c_rankShift);
+            size_t end = start;
+            while (end < rows.size() &&
+                   static_cast<Rank>(rows[end] >> c_rankShift) == rank)
+            {
+                rows[end] &= c_rowIndexMask;
+                ++end;
+            }
+
+            m_rowTables[rank].SetBits(sliceBuffer,
+                                      index,
+                                      rows.data() + start,
+                                      end - start);
+            start = end;
         }
     }
 
@@ -361,7 +541,7 @@ namespace BitFunnel
     void Shard::AssertFact(FactHandle fact, bool value, DocIndex index, void* sliceBuffer)
     {
         Term term(fact, 0u, 0u, 1u);
-        RowIdSequence rows(term, m_termTable);
+        RowIdSequence rows(term, *m_termTable);
         auto it = rows.begin();
 
         if (it == rows.end())
@@ -400,7 +580,7 @@ namespace BitFunnel
 
     void Shard::TemporaryRecordDocument()
     {
-        m_docFrequencyTableBuilder->OnDocumentEnter();
+        m_docFrequencyTableBuilder->OnDocumentEnter(GetThreadNumber());
     }
 
 
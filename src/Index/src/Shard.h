@@ -22,16 +22,20 @@
 
 #pragma once
 
+#include <atomic>                           // std::atomic member.
 
 #include <memory>                           // std::unique_ptr member.
+#include <mutex>                            // std::mutex member.
 #include <ostream>                          // TODO: Remove this temporary include.
 #include <vector>
 
+#include "BitFunnel/Index/IShard.h"         // Base class.
 #include "BitFunnel/NonCopyable.h"          // Base class.
 #include "BitFunnel/Term.h"
 #include "DocTableDescriptor.h"              // Required for embedded std::unique_ptr.
 #include "DocumentFrequencyTableBuilder.h"   // std::unique_ptr to this.
 #include "DocumentHandleInternal.h"          // Return value.
+#include "RowIdCache.h"                      // RowIdCache member.
 #include "RowTableDescriptor.h"              // Required for embedded std::vector.
 #include "Slice.h"                           // std::unique_ptr template parameter.
 
@@ -50,7 +54,7 @@ namespace BitFunnel
 
     //*************************************************************************
     //
-    // Shard is an implementation of the IShardIndex interface which represents
+    // Shard is an implementation of the IShard interface which represents
     // a partition of the index where documents share common properties. The
     // Shard maintains a collection of Slices, each of which holds set of
     // documents. The Shard may add or remove Slices as needed to adjust its
@@ -60,22 +64,43 @@ namespace BitFunnel
     // Thread safety: all public methods are thread safe.
     //
     //*************************************************************************
-    class Shard : private NonCopyable
+    class Shard : public IShard, private NonCopyable
     {
     public:
         // Constructs an empty Shard with no slices. sliceBufferSize must be
         // sufficient to hold the minimum capacity Slice. The minimum capacity
         // is determined by a value returned by Row::DocumentsInRank0Row(1).
+        //
+        // activeSliceCount is the number of Slices that documents are
+        // allocated from concurrently. With the default of one, every
+        // ingestion thread shares a single active Slice. With a larger count,
+        // ingestion threads are spread across the active Slices, so that
+        // when there are at least as many active Slices as ingestion threads,
+        // each thread allocates from a Slice of its own.
+        //
+        // rowAlignment is passed to InitializeDescriptors() to lay out the
+        // RowTables in each slice buffer.
         Shard(IRecycler& recycler,
               ITokenManager& tokenManager,
               ITermTable const & termTable,
               IDocumentDataSchema const & docDataSchema,
               ISliceBufferAllocator& sliceBufferAllocator,
-              size_t sliceBufferSize);
+              size_t sliceBufferSize,
+              size_t activeSliceCount = 1,
+              size_t rowAlignment = Row::GetAlignment());
 
         virtual ~Shard();
 
         void AddPosting(Term const & term, DocIndex index, void* sliceBuffer);
+
+        // Adds postings for all of a document's terms. The terms are first
+        // resolved to RowIds, which are sorted by rank and row so that the
+        // slice buffer is written in address order, with prefetching,
+        // rather than in the order of the terms.
+        void AddPostings(Term const * terms,
+                         size_t termCount,
+                         DocIndex index,
+                         void* sliceBuffer);
         void AssertFact(FactHandle fact, bool value, DocIndex index, void* sliceBuffer);
 
         void TemporaryRecordDocument();
@@ -86,23 +111,36 @@ namespace BitFunnel
 
 
         //
-        // IShardIndex APIs.
+        // IShard methods.
         //
 
         // Returns the Id of the shard.
         //virtual ShardId GetId() const override;
 
+        // Returns term table associated with this shard.
+        virtual ITermTable const & GetTermTable() const override;
+
+        // Returns a number that identifies the TermTable currently in use.
+        virtual uint64_t GetTermTableGeneration() const override;
+
+        // Replaces the TermTable. Throws if the new TermTable's rows are not
+        // laid out the same way as the current TermTable's.
+        virtual void SetTermTable(ITermTable const & termTable) override;
+
         // Returns capacity of a single Slice in the Shard. All Slices in the
         // Shard have the same capacity.
-        virtual DocIndex GetSliceCapacity() const;
+        virtual DocIndex GetSliceCapacity() const override;
 
         // Returns a vector of slice buffers for this shard.  The callers needs
         // to obtain a Token from ITokenManager to protect the pointer to the
         // list of slice buffers, as well as the buffers themselves.
-        virtual std::vector<void*> const & GetSliceBuffers() const;
+        virtual std::vector<void*> const & GetSliceBuffers() const override;
 
         // Returns the offset of the row in the slice buffer in a shard.
-        virtual ptrdiff_t GetRowOffset(RowId rowId) const;
+        virtual ptrdiff_t GetRowOffset(RowId rowId) const override;
+
+        // Returns the DocId of the document at index in a slice buffer.
+        virtual DocId GetDocId(void* sliceBuffer, DocIndex index) const override;
 
         // Returns the offset in the slice buffer where a pointer to the Slice
         // is stored. This is the same offset for all slices in the Shard.
@@ -119,16 +157,24 @@ namespace BitFunnel
         // this method throws.
         //
         // Implementation:
-        // with (m_slicesLock)
+        // active = m_activeSlices[thread number % m_activeSliceCount]
+        // with (active.m_lock)
         //   DocIndex docIndex;
-        //   while (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(docIndex))
+        //   if (active.m_slice == nullptr || !active.m_slice->TryAllocateDocument(docIndex))
         //   {
-        //       CreateNewActiveSlice();
+        //       active.m_slice = CreateNewActiveSlice();
+        //       active.m_slice->TryAllocateDocument(docIndex);
         //   }
         //
-        //   return DocumentHandleInternal(m_activeSlice, docIndex);
+        //   return DocumentHandleInternal(active.m_slice, docIndex);
+        //
+        // Only CreateNewActiveSlice() takes m_slicesLock.
         DocumentHandleInternal AllocateDocument(DocId id);
 
+        // Returns the number of Slices that documents are allocated from
+        // concurrently.
+        size_t GetActiveSliceCount() const;
+
         // Loads a Slice from a previously serialized state and adds it to the
         // list of Slices. As part of deserialization, LoadSlice loads
         // RowTable/DocTable descriptors from the stream and verifies that it is
@@ -151,9 +197,6 @@ namespace BitFunnel
         // copy of the vector of slices, is scheduled for recycling.
         void RecycleSlice(Slice& slice);
 
-        // Returns term table associated with this shard.
-        ITermTable const & GetTermTable() const;
-
         // Descriptor for RowTables and DocTable.
         DocTableDescriptor const & GetDocTable() const;
         RowTableDescriptor const & GetRowTable(Rank) const;
@@ -191,26 +234,54 @@ namespace BitFunnel
         // scenarios.
         // DESIGN NOTE: This is made public to help determine the block size for
         // the SliceBufferAllocator
+        // Each RowTable, and each row within it, starts at a multiple of
+        // rowAlignment bytes from the start of the slice buffer. The buffer
+        // size is also rounded up to rowAlignment so that consecutive slice
+        // buffers from the SliceBufferAllocator retain the alignment.
         static size_t InitializeDescriptors(Shard* shard,
                                             DocIndex sliceCapacity,
                                             IDocumentDataSchema const & docDataSchema,
-                                            ITermTable const & termTable);
+                                            ITermTable const & termTable,
+                                            size_t rowAlignment = Row::GetAlignment());
 
         // Calculates the number of documents which can be hosted in a slice
         // buffer of the given byte size.
         static DocIndex
             GetCapacityForByteSize(size_t bufferByteSize,
                                    IDocumentDataSchema const & schema,
-                                   ITermTable const & termTable);
+                                   ITermTable const & termTable,
+                                   size_t rowAlignment = Row::GetAlignment());
 
     private:
         // Tries to add a new slice. Throws if no memory in the allocator.
         // Implementation:
-        //   std::vector<void*>* newSlices = new std::vector<void*>(m_sliceBuffers);
         //   Slice* newSlice = new Slice(*this);
-        //   newSlices.push_back(newSlice->GetBuffer());
-        //   swap newSlices and m_sliceBuffers, schedule newSlices for recycling.
-        void CreateNewActiveSlice();
+        //   with (m_slicesLock)
+        //     std::vector<void*>* newSlices = new std::vector<void*>(m_sliceBuffers);
+        //     newSlices.push_back(newSlice->GetBuffer());
+        //     swap newSlices and m_sliceBuffers, schedule newSlices for recycling.
+        //   return newSlice;
+        Slice* CreateNewActiveSlice();
+
+        // One of the Slices that documents are currently being allocated
+        // from. m_lock serializes allocations from the Slice and the
+        // replacement of the Slice once it is full.
+        class ActiveSlice
+        {
+        public:
+            ActiveSlice();
+
+            std::mutex m_lock;
+
+            // Initially set to nullptr. The first call to AllocateDocument()
+            // that uses this ActiveSlice allocates a new Slice via
+            // CreateNewActiveSlice().
+            Slice* m_slice;
+
+            // Keeps ActiveSlices that are used by different threads off of
+            // each other's cache lines.
+            char m_padding[64];
+        };
 
         // Constructor parameters.
 
@@ -218,8 +289,15 @@ namespace BitFunnel
 
         ITokenManager& m_tokenManager;
 
-        // TermTable for this shard.
-        ITermTable const & m_termTable;
+        // TermTable for this shard. SetTermTable() may replace it while
+        // queries are running.
+        std::atomic<ITermTable const *> m_termTable;
+
+        // Identifies m_termTable. Drawn from a counter shared by all Shards.
+        std::atomic<uint64_t> m_termTableGeneration;
+
+        // Resolves the Terms of postings to RowIds in m_termTable.
+        std::unique_ptr<RowIdCache> m_rowIdCache;
 
         // Allocator that provides blocks of memory for Slice buffers.
         ISliceBufferAllocator& m_sliceBufferAllocator;
@@ -232,16 +310,16 @@ namespace BitFunnel
         const RowId m_documentActiveRowId;
 
 
-        // Lock protecting operations on the list of slices. Protects the
-        // AllocateDocument method.
+        // Lock protecting operations on the list of slices.
         // This lock is used in const member functions, as a result, it is
         // declared as mutable.
         mutable std::mutex m_slicesLock;
 
-        // Pointer to the current Slice where documents are being ingested to.
-        // Initially set to nullptr. First call to AllocateDocument() will
-        // allocate a new Slice via CreateNewActiveSlice().
-        Slice* m_activeSlice;
+        // The Slices where documents are being ingested to. Each ingestion
+        // thread uses the ActiveSlice at its thread number modulo
+        // m_activeSliceCount.
+        const size_t m_activeSliceCount;
+        std::unique_ptr<ActiveSlice[]> m_activeSlices;
 
         // Vector of pointers to slice buffers.
         //
@@ -299,7 +377,8 @@ namespace BitFunnel
         std::unique_ptr<DocTableDescriptor> m_docTable;
         std::vector<RowTableDescriptor> m_rowTables;
 
+        // Has one accumulator per active Slice, so that each ingestion
+        // thread records its statistics without contention.
         std::unique_ptr<DocumentFrequencyTableBuilder> m_docFrequencyTableBuilder;
-        std::mutex m_temporaryFrequencyTableMutex;
     };
 }
@@ -36,21 +36,31 @@ namespace BitFunnel
     std::unique_ptr<ISimpleIndex>
         Factories::CreateSimpleIndex(char const * directory,
                                      size_t gramSize,
-                                     bool generateTermToText)
+                                     bool generateTermToText,
+                                     size_t activeSliceCount,
+                                     size_t rowAlignment)
     {
         return std::unique_ptr<ISimpleIndex>(
-            new SimpleIndex(directory, gramSize, generateTermToText));
+            new SimpleIndex(directory,
+                            gramSize,
+                            generateTermToText,
+                            activeSliceCount,
+                            rowAlignment));
     }
 
 
     SimpleIndex::SimpleIndex(char const * directory,
                              size_t gramSize,
-                             bool generateTermToText)
+                             bool generateTermToText,
+                             size_t activeSliceCount,
+                             size_t rowAlignment)
         // TODO: Don't like passing *this to TaskFactory.
         // What if TaskFactory calls back before SimpleIndex is fully initialized?
         : m_directory(directory),
           m_gramSize(static_cast<Term::GramSize>(gramSize)),
-          m_generateTermToText(generateTermToText)
+          m_generateTermToText(generateTermToText),
+          m_activeSliceCount(activeSliceCount),
+          m_rowAlignment(rowAlignment)
     {
     }
 
@@ -113,9 +123,10 @@ namespace BitFunnel
             }
             else
             {
-                auto input = m_fileManager->IndexedIdfTable(0).OpenForRead();
                 Term::IdfX10 defaultIdf = 60;   // TODO: use proper value here.
-                m_idfTable = Factories::CreateIndexedIdfTable(*input, defaultIdf);
+                m_idfTable = Factories::CreateIndexedIdfTable(
+                    m_fileManager->IndexedIdfTable(0).GetName().c_str(),
+                    defaultIdf);
             }
         }
 
@@ -125,7 +136,9 @@ namespace BitFunnel
         // TODO: Need a blockSize that works for all term tables.
         const ShardId tempId = 0;
         const size_t blockSize =
-            GetMinimumBlockSize(*m_schema, m_termTables->GetTermTable(tempId));
+            GetMinimumBlockSize(*m_schema,
+                                m_termTables->GetTermTable(tempId),
+                                m_rowAlignment);
         std::cout << "Blocksize: " << blockSize << std::endl;
 
         const size_t initialBlockCount = 512;
@@ -136,7 +149,9 @@ namespace BitFunnel
                                                *m_recycler,
                                                *m_termTables,
                                                *m_shardDefinition,
-                                               *m_sliceAllocator);
+                                               *m_sliceAllocator,
+                                               m_activeSliceCount,
+                                               m_rowAlignment);
     }
 
 
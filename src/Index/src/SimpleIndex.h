@@ -47,7 +47,9 @@ namespace BitFunnel
     public:
         SimpleIndex(char const * directory,
                     size_t gramSize,
-                    bool generateTermtoText);
+                    bool generateTermtoText,
+                    size_t activeSliceCount,
+                    size_t rowAlignment);
 
         virtual ~SimpleIndex();
 
@@ -71,6 +73,8 @@ namespace BitFunnel
         std::string m_directory;
         Term::GramSize m_gramSize;
         bool m_generateTermToText;
+        size_t m_activeSliceCount;
+        size_t m_rowAlignment;
 
 
         //
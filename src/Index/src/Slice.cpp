@@ -34,10 +34,12 @@ namespace BitFunnel
           m_capacity(shard.GetSliceCapacity()),
           m_refCount(1),
           m_buffer(shard.AllocateSliceBuffer()),
-          m_unallocatedCount(shard.GetSliceCapacity()),
-          m_commitPendingCount(0),
+          m_docIndexState(shard.GetSliceCapacity()),
           m_expiredCount(0)
     {
+        LogAssertB(m_capacity <= c_unallocatedMask,
+                   "Slice capacity too large.");
+
         Initialize();
 
         // Perform start up initialization of the DocTable and RowTables after
@@ -72,15 +74,14 @@ namespace BitFunnel
 
     bool Slice::CommitDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
         GetShard().TemporaryRecordDocument();
 
-        LogAssertB(m_commitPendingCount > 0,
-                   "CommitDocument with m_commitPendingCount == 0");
+        const uint64_t oldState = m_docIndexState.fetch_sub(c_commitPendingOne);
 
-        --m_commitPendingCount;
+        LogAssertB(oldState >= c_commitPendingOne,
+                   "CommitDocument with commit pending count == 0");
 
-        return (m_unallocatedCount + m_commitPendingCount) == 0;
+        return oldState == c_commitPendingOne;
     }
 
 
@@ -97,17 +98,27 @@ namespace BitFunnel
 
     bool Slice::ExpireDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
-
-        // Cannot expire more than what was committed.
-        const DocIndex committedCount =
-            m_capacity - m_unallocatedCount - m_commitPendingCount;
-        LogAssertB(m_expiredCount < committedCount,
-                   "Slice expired more documents than committed.");
-
-        m_expiredCount++;
+        size_t expiredCount = m_expiredCount;
+        for (;;)
+        {
+            // Cannot expire more than what was committed. The committed count
+            // only grows, and the document being expired was committed
+            // before this call, so it is included here.
+            const uint64_t state = m_docIndexState;
+            const size_t committedCount = m_capacity
+                - static_cast<size_t>(state & c_unallocatedMask)
+                - static_cast<size_t>(state >> c_commitPendingShift);
+            LogAssertB(expiredCount < committedCount,
+                       "Slice expired more documents than committed.");
+
+            if (m_expiredCount.compare_exchange_weak(expiredCount,
+                                                     expiredCount + 1))
+            {
+                break;
+            }
+        }
 
-        return m_expiredCount == m_capacity;
+        return expiredCount + 1 == m_capacity;
     }
 
 
@@ -169,17 +180,23 @@ namespace BitFunnel
 
     bool Slice::TryAllocateDocument(size_t& index)
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
-
-        if (m_unallocatedCount == 0)
+        uint64_t state = m_docIndexState;
+        for (;;)
         {
-            return false;
+            const size_t unallocatedCount =
+                static_cast<size_t>(state & c_unallocatedMask);
+            if (unallocatedCount == 0)
+            {
+                return false;
+            }
+
+            // Move one document from unallocated to commit pending.
+            const uint64_t newState = state - 1 + c_commitPendingOne;
+            if (m_docIndexState.compare_exchange_weak(state, newState))
+            {
+                index = m_capacity - unallocatedCount;
+                return true;
+            }
         }
-
-        index = m_capacity - m_unallocatedCount;
-        m_unallocatedCount--;
-        m_commitPendingCount++;
-
-        return true;
     }
 }
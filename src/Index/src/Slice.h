@@ -25,7 +25,6 @@
 #include <atomic>
 #include <stddef.h>
 #include <stdint.h>
-#include <mutex>
 
 #include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
 #include "BitFunnel/BitFunnelTypes.h"   // for DocIndex, Rank.
@@ -168,13 +167,13 @@ namespace BitFunnel
         // Attempts to allocate a DocIndex. If Slice is not full, this method
         // returns true with index set to the allocated DocIndex. Otherwise
         // this method returns false.
-        // Thread safe.
+        // Thread safe and lock free.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   if (m_unallocated == 0) return false;
-        //   m_unallocatedCount--
-        //   m_commitPendingCount++
+        // atomically with m_docIndexState
+        //   if (unallocated == 0) return false;
+        //   unallocated--
+        //   commitPending++
         //   return true
         bool TryAllocateDocument(DocIndex& index);
 
@@ -182,13 +181,13 @@ namespace BitFunnel
         // DocIndex value. Returns true if this was the last document in this
         // slice to commit, in which case the caller is responsible of
         // scheduling the Slice for backup. Returns false otherwise.
-        // Thread safe.
+        // Thread safe and lock free.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   LogAssert(m_commitPendingCount > 0)
-        //   --m_commitPendingCount;
-        //   return (m_unallocated + m_commitPending) == 0;
+        // atomically with m_docIndexState
+        //   LogAssert(commitPending > 0)
+        //   --commitPending;
+        //   return (unallocated + commitPending) == 0;
         bool CommitDocument();
 
         // Hides document from future matching operations. May only be called
@@ -197,10 +196,11 @@ namespace BitFunnel
         // capacity of the Slice is now expired, in which case the caller is
         // responsible of recycling the Slice. Returns false otherwise.
         //
-        // Thread safe.
+        // Thread safe and lock free.
         //
         // Implementation:
-        // with (m_docIndexLock)
+        // atomically with m_expiredCount
+        //   LogAssert(m_expiredCount < committed count)
         //   m_expiredCount++;
         //   return m_expiredCount == m_capacity.
         bool ExpireDocument();
@@ -246,14 +246,6 @@ namespace BitFunnel
         // Capacity of the slice.
         const size_t m_capacity;
 
-        // Lock protecting operations on DocIndex members below to guarantee
-        // atomic state changes that depend on these values.
-        // There isn't a straightforward way to use std::atomic because
-        // ExpireDocument uses `m_unallocatedCount - m_commitPending`.
-        // DESIGN NOTE: made mutable in order to be able to acquire a lock from
-        // const methods.
-        mutable std::mutex m_docIndexLock;
-
         // Reference count of the Slice. Initially Slice is created with one
         // reference. Slice taken for a backup increases its reference count
         // by one for the duration of the backup writing and then is decreased
@@ -270,14 +262,24 @@ namespace BitFunnel
         // Slice. See the class comment for more details on buffer layout.
         void* const m_buffer;
 
-        // The number of unallocated DocIndex'es in the slice. When created,
-        // Slice starts with the value of m_capacity in this field and gradually
-        // goes down as documents are being ingested.
-        size_t m_unallocatedCount;
-
-        // The number of DocIndex'es that have been allocated but not yet
-        // committed by a call to CommitDocument().
-        size_t m_commitPendingCount;
+        // The number of unallocated DocIndex'es in the slice, and the number
+        // of DocIndex'es that have been allocated but not yet committed by a
+        // call to CommitDocument(), packed into a single word so that both
+        // can be updated atomically.
+        //
+        // The unallocated count is in the low 32 bits. When created, Slice
+        // starts with the value of m_capacity in this field and gradually
+        // goes down as documents are being ingested. The commit pending count
+        // is in the high 32 bits.
+        //
+        // Since the commit pending count can only be incremented together
+        // with a decrement of the unallocated count, the state word reaches
+        // zero exactly once, on the last call to CommitDocument().
+        std::atomic<uint64_t> m_docIndexState;
+
+        static const unsigned c_commitPendingShift = 32;
+        static const uint64_t c_unallocatedMask = (1ull << c_commitPendingShift) - 1;
+        static const uint64_t c_commitPendingOne = 1ull << c_commitPendingShift;
 
         // The number of DocIndex'es that have been expired from the slice.
         // When this value reaches m_capacity, the slice can be recycled.
@@ -62,15 +62,8 @@ namespace BitFunnel
         // If we're maintaining a term-to-text mapping.
         if (configuration.KeepTermText())
         {
-            auto & termToText = configuration.GetTermToText();
-
-            // If this term isn't already in the table.
-            auto const termText = termToText.Lookup(m_rawHash);
-            if (termText.size() == 0)
-            {
-                // Add the term to the table.
-                termToText.AddTerm(m_rawHash, std::string(text));
-            }
+            // Add the term to the table, unless it is already there.
+            configuration.GetTermToText().AddTerm(m_rawHash, text);
         }
     }
 
@@ -168,23 +161,11 @@ namespace BitFunnel
         // If we're maintaining a term-to-text mapping.
         if (configuration.KeepTermText())
         {
-            auto & termToText = configuration.GetTermToText();
-
-            // If this phrase isn't already in the table.
-            if (termToText.Lookup(m_rawHash).size() == 0)
-            {
-                // Concatenate old text with new text.
-                auto const left = termToText.Lookup(leftHash);
-                auto const right = termToText.Lookup(term.m_rawHash);
-                std::string phrase;
-                phrase.reserve(left.size() + 1 + right.size());
-                phrase.append(left);
-                phrase.push_back(' ');
-                phrase.append(right);
-
-                // Add the phrase to the IDF table.
-                termToText.AddTerm(m_rawHash, phrase);
-            }
+            // Record the phrase as a link to its parts. Its text is built
+            // only when it is looked up or written.
+            configuration.GetTermToText().AddPhrase(m_rawHash,
+                                                    leftHash,
+                                                    term.m_rawHash);
         }
     }
 
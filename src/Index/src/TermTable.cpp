@@ -21,13 +21,18 @@
 // THE SOFTWARE.
 
 
+#include <cstring>
+#include <istream>
 #include <math.h>
 #include <sstream>
+#include <streambuf>
 
+#include "AlignedBuffer.h"
 #include "BitFunnel/BitFunnelTypes.h"
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/StreamUtilities.h"
+#include "MemoryMappedFile.h"
 #include "TermTable.h"
 
 
@@ -51,13 +56,39 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // MemoryStreamBuffer
+    //
+    // A read-only std::streambuf over a block of memory. Used to parse the
+    // fields of a memory mapped TermTable file without copying it into an
+    // std::stringstream first.
+    //
+    //*************************************************************************
+    class MemoryStreamBuffer : public std::streambuf
+    {
+    public:
+        MemoryStreamBuffer(char const * data, size_t size)
+        {
+            char* start = const_cast<char*>(data);
+            setg(start, start, start + size);
+        }
+    };
+
+
     //*************************************************************************
     //
     // TermTable
     //
     //*************************************************************************
+    const char TermTable::c_magic[8] = { 'B', 'F', 'T', 'R', 'M', 'T', 'B', 'L' };
+
+
     TermTable::TermTable()
       : m_sealed(false),
+        m_buckets(nullptr),
+        m_bucketCount(0),
+        m_termCount(0),
         m_explicitRowCounts(c_maxRankValue + 1, 0),
         m_adhocRowCounts(c_maxRankValue + 1, 0),
         m_sharedRowCounts(c_maxRankValue + 1, 0),
@@ -86,41 +117,110 @@ namespace BitFunnel
 
     TermTable::TermTable(std::istream& input)
       : m_sealed(true),
-        m_start(0)
+        m_start(0),
+        m_buckets(nullptr),
+        m_bucketCount(0),
+        m_termCount(0)
     {
-        size_t count = StreamUtilities::ReadField<size_t>(input);
-        for (size_t i = 0; i < count; ++i)
+        static_assert(sizeof(Header) == 64, "TermTable::Header must be 64 bytes.");
+        static_assert(sizeof(Bucket) == 64, "TermTable::Bucket must be 64 bytes.");
+
+        // Files in the older format start with a term count, which is never
+        // equal to the magic.
+        Header header;
+        StreamUtilities::ReadBytes(input, header.m_magic, sizeof(header.m_magic));
+        if (memcmp(header.m_magic, c_magic, sizeof(c_magic)) != 0)
         {
-            const Term::Hash hash = StreamUtilities::ReadField<Term::Hash>(input);
-            const PackedRowIdSequence rows = StreamUtilities::ReadField<PackedRowIdSequence>(input);
+            size_t termCount;
+            memcpy(&termCount, header.m_magic, sizeof(termCount));
+            ReadOldTerms(input, termCount);
+        }
+        else
+        {
+            StreamUtilities::ReadBytes(input,
+                                       header.m_magic + sizeof(header.m_magic),
+                                       sizeof(header) - sizeof(header.m_magic));
+            const size_t bucketCount = CheckHeader(header, 0);
+            Allocate(bucketCount);
+            StreamUtilities::ReadBytes(input,
+                                       m_buffer->GetBuffer(),
+                                       bucketCount * sizeof(Bucket));
+            CheckBuckets(header, m_buckets);
+            m_termCount = header.m_termCount;
+        }
 
-            m_termHashToRows.insert(std::make_pair(hash, rows));
+        ReadFields(input);
+    }
+
+
+    TermTable::TermTable(char const * path)
+      : m_sealed(true),
+        m_start(0),
+        m_buckets(nullptr),
+        m_bucketCount(0),
+        m_termCount(0)
+    {
+        std::unique_ptr<MemoryMappedFile>
+            file(new MemoryMappedFile(path, MemoryMappedFile::Random));
+        char const * data = file->GetData();
+        const size_t size = file->GetSize();
+
+        if (size < sizeof(c_magic) || memcmp(data, c_magic, sizeof(c_magic)) != 0)
+        {
+            MemoryStreamBuffer buffer(data, size);
+            std::istream input(&buffer);
+            const size_t termCount = StreamUtilities::ReadField<size_t>(input);
+            ReadOldTerms(input, termCount);
+            ReadFields(input);
+            return;
         }
 
-        m_ranksInUse = StreamUtilities::ReadField<RanksInUse>(input);
-        m_maxRankInUse = StreamUtilities::ReadField<Rank>(input);
-        m_adhocRows = StreamUtilities::ReadField<AdhocRecipes>(input);
-        m_rowIds = StreamUtilities::ReadVector<RowId>(input);
-        m_explicitRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
-        m_adhocRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
-        m_sharedRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
-        m_factRowCount = StreamUtilities::ReadField<RowIndex>(input);
+        if (size < sizeof(Header))
+        {
+            RecoverableError error("TermTable: file too small.");
+            throw error;
+        }
 
-        m_sealed = true;
+        Header const & header = *reinterpret_cast<Header const *>(data);
+        const size_t bucketCount = CheckHeader(header, size);
+
+        // The fields after the Buckets are read once, front to back.
+        const size_t fieldsOffset = sizeof(Header) + bucketCount * sizeof(Bucket);
+        file->WillNeed(fieldsOffset, size - fieldsOffset);
+        MemoryStreamBuffer buffer(data + fieldsOffset, size - fieldsOffset);
+        std::istream input(&buffer);
+        ReadFields(input);
+
+        m_buckets = reinterpret_cast<Bucket const *>(data + sizeof(Header));
+        m_bucketCount = bucketCount;
+        m_termCount = header.m_termCount;
+        m_file = std::move(file);
+    }
+
+
+    TermTable::~TermTable()
+    {
     }
 
 
     void TermTable::Write(std::ostream& output) const
     {
-        StreamUtilities::WriteField<size_t>(output, m_termHashToRows.size());
-        for (auto entry : m_termHashToRows)
-        {
-            const Term::Hash hash = entry.first;
-            const PackedRowIdSequence rows = entry.second;
+        ThrowIfSealed(false);
 
-            StreamUtilities::WriteField<Term::Hash>(output, hash);
-            StreamUtilities::WriteField<PackedRowIdSequence>(output, rows);
-        }
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.m_magic, c_magic, sizeof(c_magic));
+        header.m_version = c_version;
+        header.m_bucketEntryCount = c_bucketEntryCount;
+        header.m_bucketCount = m_bucketCount;
+        header.m_termCount = m_termCount;
+
+        StreamUtilities::WriteBytes(output,
+                                    reinterpret_cast<char const *>(&header),
+                                    sizeof(header));
+        StreamUtilities::WriteBytes(output,
+                                    reinterpret_cast<char const *>(m_buckets),
+                                    m_bucketCount * sizeof(Bucket));
 
         StreamUtilities::WriteField<RanksInUse>(output, m_ranksInUse);
         StreamUtilities::WriteField<Rank>(output, m_maxRankInUse);
@@ -244,6 +344,14 @@ namespace BitFunnel
                 m_rowIds[r] = RowId(rowId, m_adhocRowCounts[rowId.GetRank()]);
             }
         }
+
+        // Move the explicit terms into the Buckets used by GetRows().
+        Allocate(GetBucketCount(m_termHashToRows.size()));
+        for (auto const & entry : m_termHashToRows)
+        {
+            Add(entry.first, entry.second);
+        }
+        m_termHashToRows.clear();
     }
 
 
@@ -286,10 +394,10 @@ namespace BitFunnel
         }
         else
         {
-            auto it = m_termHashToRows.find(term.GetRawHash());
-            if (it != m_termHashToRows.end())
+            PackedRowIdSequence const * rows = Find(hash);
+            if (rows != nullptr)
             {
-                return (*it).second;
+                return *rows;
             }
             else
             {
@@ -414,6 +522,16 @@ namespace BitFunnel
         equals = equals && (m_ranksInUse == other.m_ranksInUse);
         equals = equals && (m_maxRankInUse == other.m_maxRankInUse);
         equals = equals && (m_termHashToRows == other.m_termHashToRows);
+        equals = equals && (m_termCount == other.m_termCount);
+        for (size_t i = 0; equals && i < m_bucketCount; ++i)
+        {
+            Bucket const & bucket = m_buckets[i];
+            for (size_t j = 0; equals && j < bucket.m_count; ++j)
+            {
+                PackedRowIdSequence const * rows = other.Find(bucket.m_hashes[j]);
+                equals = (rows != nullptr) && (*rows == bucket.m_rows[j]);
+            }
+        }
         equals = equals && (m_adhocRows == other.m_adhocRows);
         equals = equals && (m_rowIds == other.m_rowIds);
         equals = equals && (m_explicitRowCounts == other.m_explicitRowCounts);
@@ -425,6 +543,181 @@ namespace BitFunnel
     }
 
 
+    PackedRowIdSequence const * TermTable::Find(Term::Hash hash) const
+    {
+        if (m_buckets == nullptr)
+        {
+            auto it = m_termHashToRows.find(hash);
+            return (it == m_termHashToRows.end()) ? nullptr : &(*it).second;
+        }
+
+        // Sealing and the stream constructor ensure that some Bucket is less
+        // than full, so the probe ends before it wraps around. A memory
+        // mapped file is not scanned at load, so the bound and the clamp on
+        // the Bucket's count keep a corrupt file from looping or reading
+        // past a Bucket.
+        size_t i = GetBucket(hash, m_bucketCount);
+        for (size_t probe = 0; probe < m_bucketCount; ++probe)
+        {
+            Bucket const & bucket = m_buckets[i];
+            const size_t count = bucket.m_count;
+            for (size_t j = 0; j < count && j < c_bucketEntryCount; ++j)
+            {
+                if (bucket.m_hashes[j] == hash)
+                {
+                    return &bucket.m_rows[j];
+                }
+            }
+
+            if (count < c_bucketEntryCount)
+            {
+                break;
+            }
+
+            if (++i == m_bucketCount)
+            {
+                i = 0;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    size_t TermTable::GetBucketCount(size_t termCount)
+    {
+        // Fill Buckets to at most 3/4 on average. The extra Bucket ensures
+        // that at least one Bucket has room to end every probe.
+        const size_t bucketCount = termCount * 4 / (c_bucketEntryCount * 3) + 1;
+
+        if (bucketCount > UINT32_MAX)
+        {
+            RecoverableError error("TermTable: too many terms.");
+            throw error;
+        }
+
+        return bucketCount;
+    }
+
+
+    size_t TermTable::GetBucket(Term::Hash hash, size_t bucketCount)
+    {
+        // Scales the high 32 bits of the hash to [0, bucketCount).
+        return static_cast<size_t>(((hash >> 32) * bucketCount) >> 32);
+    }
+
+
+    void TermTable::Allocate(size_t bucketCount)
+    {
+        // AlignedBuffer is page aligned and zero filled.
+        m_buffer.reset(new AlignedBuffer(bucketCount * sizeof(Bucket), 6));
+        m_buckets = static_cast<Bucket const *>(m_buffer->GetBuffer());
+        m_bucketCount = bucketCount;
+        m_termCount = 0;
+    }
+
+
+    void TermTable::Add(Term::Hash hash, PackedRowIdSequence rows)
+    {
+        Bucket* buckets = static_cast<Bucket*>(m_buffer->GetBuffer());
+        for (size_t i = GetBucket(hash, m_bucketCount); ; i = (i + 1) % m_bucketCount)
+        {
+            Bucket& bucket = buckets[i];
+            for (size_t j = 0; j < bucket.m_count; ++j)
+            {
+                if (bucket.m_hashes[j] == hash)
+                {
+                    return;
+                }
+            }
+
+            if (bucket.m_count < c_bucketEntryCount)
+            {
+                bucket.m_hashes[bucket.m_count] = hash;
+                bucket.m_rows[bucket.m_count] = rows;
+                ++bucket.m_count;
+                ++m_termCount;
+                return;
+            }
+        }
+    }
+
+
+    size_t TermTable::CheckHeader(Header const & header, size_t fileSize)
+    {
+        if (header.m_version != c_version)
+        {
+            std::stringstream message;
+            message << "TermTable: unsupported version " << header.m_version << ".";
+            RecoverableError error(message.str());
+            throw error;
+        }
+
+        const size_t bucketCount = header.m_bucketCount;
+        if (header.m_bucketEntryCount != c_bucketEntryCount ||
+            bucketCount == 0 ||
+            bucketCount > UINT32_MAX ||
+            header.m_termCount >= bucketCount * c_bucketEntryCount ||
+            (fileSize != 0 && fileSize < sizeof(Header) + bucketCount * sizeof(Bucket)))
+        {
+            RecoverableError error("TermTable: malformed header.");
+            throw error;
+        }
+
+        return bucketCount;
+    }
+
+
+    void TermTable::CheckBuckets(Header const & header, Bucket const * buckets)
+    {
+        size_t termCount = 0;
+        bool hasRoom = false;
+        for (size_t i = 0; i < header.m_bucketCount; ++i)
+        {
+            const size_t count = buckets[i].m_count;
+            if (count > c_bucketEntryCount)
+            {
+                RecoverableError error("TermTable: malformed bucket.");
+                throw error;
+            }
+            termCount += count;
+            hasRoom |= (count < c_bucketEntryCount);
+        }
+
+        if (termCount != header.m_termCount || !hasRoom)
+        {
+            RecoverableError error("TermTable: bucket counts do not match header.");
+            throw error;
+        }
+    }
+
+
+    void TermTable::ReadOldTerms(std::istream& input, size_t termCount)
+    {
+        Allocate(GetBucketCount(termCount));
+        for (size_t i = 0; i < termCount; ++i)
+        {
+            const Term::Hash hash = StreamUtilities::ReadField<Term::Hash>(input);
+            const PackedRowIdSequence rows = StreamUtilities::ReadField<PackedRowIdSequence>(input);
+
+            Add(hash, rows);
+        }
+    }
+
+
+    void TermTable::ReadFields(std::istream& input)
+    {
+        m_ranksInUse = StreamUtilities::ReadField<RanksInUse>(input);
+        m_maxRankInUse = StreamUtilities::ReadField<Rank>(input);
+        m_adhocRows = StreamUtilities::ReadField<AdhocRecipes>(input);
+        m_rowIds = StreamUtilities::ReadVector<RowId>(input);
+        m_explicitRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
+        m_adhocRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
+        m_sharedRowCounts = StreamUtilities::ReadVector<RowIndex>(input);
+        m_factRowCount = StreamUtilities::ReadField<RowIndex>(input);
+    }
+
+
     void TermTable::ThrowIfSealed(bool value) const
     {
         if (m_sealed == value)
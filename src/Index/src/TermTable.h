@@ -22,8 +22,11 @@
 
 #pragma once
 
-#include <unordered_map>                // std::unordered_map member.
 #include <array>                        // std::array member.
+#include <iosfwd>                       // std::istream parameter.
+#include <memory>                       // std::unique_ptr member.
+#include <stdint.h>                     // uint32_t member.
+#include <unordered_map>                // std::unordered_map member.
 #include <vector>                       // std::vector member.
 
 #include "BitFunnel/Index/ITermTable.h" // Base class.
@@ -33,6 +36,36 @@
 
 namespace BitFunnel
 {
+    class AlignedBuffer;
+    class MemoryMappedFile;
+
+    //*************************************************************************
+    //
+    // TermTable
+    //
+    // Explicit terms are collected in an std::unordered_map while the
+    // TermTable is being built. Seal() moves them into a flat hash table of
+    // 64-byte, cache line aligned Buckets, each holding up to
+    // c_bucketEntryCount (hash, PackedRowIdSequence) entries. A hash starts
+    // in the Bucket selected by scaling its high bits to the bucket count
+    // and moves on to the next Bucket only when its Bucket is full, so
+    // GetRows() usually touches a single cache line.
+    //
+    // Write() stores the Buckets verbatim, so a TermTable file can be
+    // memory mapped and the Buckets used in place. Mapping a file checks
+    // only its Header, so that opening a large table does not touch every
+    // Bucket. Reading from a stream also checks the Buckets' counts. Either
+    // way, a probe never reads past the last Bucket and always terminates,
+    // even on a corrupt file:
+    //   Header (64 bytes): magic, version, bucket count, term count.
+    //   Bucket[bucketCount] (64 bytes each).
+    //   The remaining fields, in the same format as older files.
+    //
+    // Files in the older format, which start with a count of (hash,
+    // PackedRowIdSequence) pairs, are also accepted. Their Buckets are built
+    // at load time.
+    //
+    //*************************************************************************
     class TermTable : public ITermTable
     {
     public:
@@ -42,6 +75,13 @@ namespace BitFunnel
         // Write() method.
         TermTable(std::istream& input);
 
+        // Memory maps a file previously written by the Write() method. Files
+        // in the older format are read into memory instead. Throws a
+        // RecoverableError if the file cannot be mapped or is malformed.
+        TermTable(char const * path);
+
+        ~TermTable();
+
         // Writes the contents of the ITermTable to a stream.
         virtual void Write(std::ostream& output) const override;
 
@@ -131,11 +171,70 @@ namespace BitFunnel
         // of the adhoc term recipes.
         bool operator==(TermTable const & other) const;
 
+        // Number of entries in each Bucket.
+        static const size_t c_bucketEntryCount = 5;
+
     private:
+        class Header
+        {
+        public:
+            char m_magic[8];
+            uint32_t m_version;
+            uint32_t m_bucketEntryCount;
+            uint64_t m_bucketCount;
+            uint64_t m_termCount;
+            char m_unused[32];
+        };
+
+        class Bucket
+        {
+        public:
+            Term::Hash m_hashes[c_bucketEntryCount];
+            PackedRowIdSequence m_rows[c_bucketEntryCount];
+            uint32_t m_count;
+        };
+
         void ThrowIfSealed(bool value) const;
 
         static Term CreateSystemTerm(SystemTerm term);
 
+        // Returns the Bucket entry for hash, or nullptr if hash is not an
+        // explicit term.
+        PackedRowIdSequence const * Find(Term::Hash hash) const;
+
+        // Returns the number of Buckets for a table of termCount terms.
+        static size_t GetBucketCount(size_t termCount);
+
+        // Returns the Bucket where the probe for hash starts.
+        static size_t GetBucket(Term::Hash hash, size_t bucketCount);
+
+        // Allocates m_buffer and points m_buckets at it.
+        void Allocate(size_t bucketCount);
+
+        // Adds an explicit term to the Buckets in m_buffer.
+        void Add(Term::Hash hash, PackedRowIdSequence rows);
+
+        // Validates a header and returns the number of Buckets that follow
+        // it. fileSize is the number of bytes in the file, including the
+        // header, or 0 when it is not known.
+        static size_t CheckHeader(Header const & header, size_t fileSize);
+
+        // Validates the Buckets that follow header. Every Bucket must hold at
+        // most c_bucketEntryCount terms, their counts must add up to the
+        // header's term count, and at least one Bucket must have room to end
+        // a probe.
+        static void CheckBuckets(Header const & header, Bucket const * buckets);
+
+        // Reads the explicit terms in the older format. The term count has
+        // already been read.
+        void ReadOldTerms(std::istream& input, size_t termCount);
+
+        // Reads the fields that follow the explicit terms.
+        void ReadFields(std::istream& input);
+
+        static const char c_magic[8];
+        static const uint32_t c_version = 1;
+
         bool m_sealed;
 
         RowIndex m_start;
@@ -144,13 +243,20 @@ namespace BitFunnel
         RanksInUse m_ranksInUse{};
         Rank m_maxRankInUse;
 
-        // TODO: Is the term table big enough that we would benefit from
-        // a more compact class than std::pair<RowIndex, RowIndex>>? Would this
-        // even lead to a benefit if we didn't replace std::unordered_map with
-        // a better hash table? Should measure actual memory use for this data
-        // structure.
+        // Explicit terms added before Seal().
         std::unordered_map<Term::Hash, PackedRowIdSequence> m_termHashToRows;
 
+        // Explicit terms after Seal(). m_buckets is nullptr before Seal().
+        Bucket const * m_buckets;
+        size_t m_bucketCount;
+        size_t m_termCount;
+
+        // Holds m_buckets for TermTables that are not memory mapped.
+        std::unique_ptr<AlignedBuffer> m_buffer;
+
+        // Holds m_buckets for memory mapped TermTables.
+        std::unique_ptr<MemoryMappedFile> m_file;
+
         typedef
             std::array<
                 std::array<PackedRowIdSequence,
@@ -20,8 +20,6 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <istream>
-
 #include "BitFunnel/IFileManager.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/ITermTable.h"
@@ -66,9 +64,11 @@ namespace BitFunnel
     {
         for (ShardId shard = 0; shard < shardCount; ++shard)
         {
-            auto input = fileManager.TermTable(0).OpenForRead();
+            // Memory map the TermTable so that startup does not depend on
+            // the number of terms.
+            auto name = fileManager.TermTable(0).GetName();
             m_termTables.emplace_back(
-                std::unique_ptr<ITermTable>(new TermTable(*input)));
+                std::unique_ptr<ITermTable>(new TermTable(name.c_str())));
         }
     }
 
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <cstring>
+
 #include "CsvTsv/Csv.h"
 #include "TermToText.h"
 
@@ -27,11 +29,13 @@
 namespace BitFunnel
 {
     TermToText::TermToText()
+      : m_shards(new Shard[c_shardCount])
     {
     }
 
 
     TermToText::TermToText(std::istream & input)
+      : m_shards(new Shard[c_shardCount])
     {
         CsvTsv::CsvTableParser parser(input);
         CsvTsv::TableReader reader(parser);
@@ -78,11 +82,31 @@ namespace BitFunnel
         writer.DefineColumn(text);
         writer.WritePrologue();
 
-        for (auto & entry : m_termToText)
+        std::vector<Term::Hash> hashes;
+        std::string termText;
+        for (size_t i = 0; i < c_shardCount; ++i)
         {
-            hash = entry.first;
-            text = entry.second;
-            writer.WriteDataRow();
+            // Copy the shard's hashes so that AppendText() can lock the
+            // shards holding the parts of phrases.
+            hashes.clear();
+            {
+                Shard& shard = m_shards[i];
+                std::lock_guard<std::mutex> lock(shard.m_lock);
+                for (auto const & entry : shard.m_entries)
+                {
+                    hashes.push_back(entry.first);
+                }
+            }
+
+            for (auto h : hashes)
+            {
+                termText.clear();
+                AppendText(h, termText);
+
+                hash = h;
+                text = termText;
+                writer.WriteDataRow();
+            }
         }
 
         writer.WriteEpilogue();
@@ -91,24 +115,193 @@ namespace BitFunnel
 
     void TermToText::AddTerm(Term::Hash hash, std::string const & text)
     {
-        auto it = m_termToText.find(hash);
-        if (it == m_termToText.end())
+        AddText(hash, text.c_str(), text.size());
+    }
+
+
+    void TermToText::AddTerm(Term::Hash hash, char const * text)
+    {
+        AddText(hash, text, strlen(text));
+    }
+
+
+    void TermToText::AddPhrase(Term::Hash hash,
+                               Term::Hash leftHash,
+                               Term::Hash rightHash)
+    {
+        Shard& shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+
+        auto result = shard.m_entries.emplace(hash, Entry());
+        if (result.second)
         {
-            m_termToText.insert(std::make_pair(hash, text));
+            Entry& entry = result.first->second;
+            entry.m_isPhrase = true;
+            entry.m_text = nullptr;
+            entry.m_length = 0;
+            entry.m_leftHash = leftHash;
+            entry.m_rightHash = rightHash;
         }
     }
 
 
     std::string const & TermToText::Lookup(Term::Hash hash) const
     {
-        auto it = m_termToText.find(hash);
-        if (it == m_termToText.end())
+        Shard& shard = GetShard(hash);
+        {
+            std::lock_guard<std::mutex> lock(shard.m_lock);
+            auto it = shard.m_entries.find(hash);
+            if (it == shard.m_entries.end())
+            {
+                return m_emptyString;
+            }
+            if (it->second.m_lookupText != nullptr)
+            {
+                return *it->second.m_lookupText;
+            }
+        }
+
+        // Build the text without holding the lock, since the parts of a
+        // phrase may be in other shards.
+        std::unique_ptr<std::string> text(new std::string());
+        AppendText(hash, *text);
+
+        // Entries are never removed, and unordered_map does not move them.
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+        Entry const & entry = shard.m_entries.find(hash)->second;
+        if (entry.m_lookupText == nullptr)
         {
-            return m_emptyString;
+            entry.m_lookupText = std::move(text);
         }
-        else
+        return *entry.m_lookupText;
+    }
+
+
+    void TermToText::AddText(Term::Hash hash, char const * text, size_t length)
+    {
+        Shard& shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+
+        auto result = shard.m_entries.emplace(hash, Entry());
+        if (result.second)
         {
-            return (*it).second;
+            Entry& entry = result.first->second;
+            entry.m_isPhrase = false;
+            entry.m_text = shard.CopyText(text, length);
+            entry.m_length = length;
+            entry.m_leftHash = 0;
+            entry.m_rightHash = 0;
         }
     }
+
+
+    void TermToText::AppendText(Term::Hash hash, std::string& text) const
+    {
+        // A phrase has at most c_maxGramSize words, so its tree of links has
+        // at most 2 * c_maxGramSize - 1 entries. Visiting no more than that
+        // bounds the walk even if colliding hashes make the links cyclic.
+        size_t remaining = 2 * Term::c_maxGramSize - 1;
+        bool first = true;
+
+        // Parts still to be appended, rightmost at the bottom.
+        std::vector<Term::Hash> pending(1, hash);
+        while (!pending.empty() && remaining > 0)
+        {
+            const Term::Hash current = pending.back();
+            pending.pop_back();
+            --remaining;
+
+            bool isPhrase = false;
+            char const * termText = nullptr;
+            size_t length = 0;
+            std::string const * lookupText = nullptr;
+            Term::Hash leftHash = 0;
+            Term::Hash rightHash = 0;
+            {
+                Shard& shard = GetShard(current);
+                std::lock_guard<std::mutex> lock(shard.m_lock);
+                auto it = shard.m_entries.find(current);
+                if (it == shard.m_entries.end())
+                {
+                    continue;
+                }
+                isPhrase = it->second.m_isPhrase;
+                termText = it->second.m_text;
+                length = it->second.m_length;
+                lookupText = it->second.m_lookupText.get();
+                leftHash = it->second.m_leftHash;
+                rightHash = it->second.m_rightHash;
+            }
+
+            if (isPhrase && lookupText == nullptr)
+            {
+                pending.push_back(rightHash);
+                pending.push_back(leftHash);
+                continue;
+            }
+
+            if (!first)
+            {
+                text.push_back(' ');
+            }
+            first = false;
+
+            // Arena text and lookup text are never moved or freed, so they
+            // can be read without the lock. A phrase that has already been
+            // looked up is appended whole, without walking its parts.
+            if (!isPhrase)
+            {
+                text.append(termText, length);
+            }
+            else
+            {
+                text.append(*lookupText);
+            }
+        }
+    }
+
+
+    TermToText::Shard& TermToText::GetShard(Term::Hash hash) const
+    {
+        return m_shards[hash % c_shardCount];
+    }
+
+
+    //*************************************************************************
+    //
+    // TermToText::Shard
+    //
+    //*************************************************************************
+    TermToText::Shard::Shard()
+      : m_next(nullptr),
+        m_remaining(0)
+    {
+    }
+
+
+    char const * TermToText::Shard::CopyText(char const * text, size_t length)
+    {
+        // Empty text needs no space, and there may not be a block yet.
+        if (length == 0)
+        {
+            return "";
+        }
+
+        if (length > m_remaining)
+        {
+            // Text longer than a block gets a block of its own.
+            const size_t blockSize =
+                (length > c_arenaBlockSize) ? length : c_arenaBlockSize;
+            m_blocks.emplace_back(new char[blockSize]);
+            m_next = m_blocks.back().get();
+            m_remaining = blockSize;
+        }
+
+        char* copy = m_next;
+        memcpy(copy, text, length);
+        m_next += length;
+        m_remaining -= length;
+
+        return copy;
+    }
 }
@@ -23,11 +23,15 @@
 #pragma once
 
 #include <iosfwd>                           // std::istream parameter.
-#include <memory>                           // std::unique_ptr
+#include <memory>                           // std::unique_ptr member.
+#include <mutex>                            // std::mutex member.
+#include <stddef.h>                         // size_t member.
 #include <string>                           // std::string template parameter.
-#include <unordered_map>                    // std::unordered_map embedded.
+#include <unordered_map>                    // std::unordered_map member.
+#include <vector>                           // std::vector member.
 
 #include "BitFunnel/Index/ITermToText.h"    // Base class.
+#include "BitFunnel/NonCopyable.h"          // Base class.
 #include "BitFunnel/Term.h"                 // Term::Hash parameter.
 
 
@@ -41,8 +45,17 @@ namespace BitFunnel
     // of the term. Used primarily for debugging and understanding index data
     // structures.
     //
+    // TermToText is filled during ingestion, so adding terms is cheap. The
+    // map is divided into shards by hash, and each shard has its own lock.
+    // Term text is copied into arena blocks owned by the shard, rather than
+    // into individual std::strings. Phrases are recorded as links to the
+    // hashes of their left and right parts, and their text is only built
+    // when it is looked up or written.
+    //
+    // Thread safety: all methods are thread safe.
+    //
     //*************************************************************************
-    class TermToText : public ITermToText
+    class TermToText : public ITermToText, NonCopyable
     {
     public:
         // Constructs an empty map. New (Term::Hash, std::string) pairs can
@@ -64,16 +77,79 @@ namespace BitFunnel
         // additions for the same Term::Hash will be ignored.
         void AddTerm(Term::Hash hash, std::string const & text);
 
+        // Same as AddTerm(Term::Hash, std::string const &) for a zero
+        // terminated string.
+        void AddTerm(Term::Hash hash, char const * text);
+
+        // Adds a mapping from a phrase's hash to the text of the term with
+        // hash leftHash, followed by a space, followed by the text of the term
+        // with hash rightHash. As with AddTerm(), only the first mapping for
+        // a Term::Hash is recorded.
+        void AddPhrase(Term::Hash hash, Term::Hash leftHash, Term::Hash rightHash);
+
         // Returns the text for a particular Term::Hash, if that hash is in the
         // map. Otherwise returns an empty string.
         virtual std::string const & Lookup(Term::Hash hash) const override;
 
     private:
+        class Entry
+        {
+        public:
+            // True if the entry is a phrase, whose text is made from the
+            // text of its parts.
+            bool m_isPhrase;
+
+            // The term's text, in its shard's arena. Unused for a phrase.
+            char const * m_text;
+            size_t m_length;
+
+            // The parts of a phrase.
+            Term::Hash m_leftHash;
+            Term::Hash m_rightHash;
+
+            // Text returned by Lookup(), created on first use. Never reset
+            // once set, so references to it remain valid.
+            mutable std::unique_ptr<std::string> m_lookupText;
+        };
+
+        class Shard : NonCopyable
+        {
+        public:
+            Shard();
+
+            // Returns a copy of text in the arena. Never returns nullptr,
+            // even for empty text. Must be called with m_lock held.
+            char const * CopyText(char const * text, size_t length);
+
+            std::mutex m_lock;
+            std::unordered_map<Term::Hash, Entry> m_entries;
+
+            // Arena blocks. Text is never freed before the TermToText.
+            std::vector<std::unique_ptr<char[]>> m_blocks;
+            char* m_next;
+            size_t m_remaining;
+
+            // Keeps shards that are adjacent in memory from sharing a cache
+            // line.
+            char m_padding[64];
+        };
+
+        void AddText(Term::Hash hash, char const * text, size_t length);
+
+        // Appends the text for hash to text, building the text of phrases
+        // from their parts. Walks at most the number of links that a phrase
+        // of Term::c_maxGramSize words can have.
+        void AppendText(Term::Hash hash, std::string& text) const;
+
+        Shard& GetShard(Term::Hash hash) const;
+
+        static const size_t c_shardCount = 64;
+        static const size_t c_arenaBlockSize = 64 * 1024;
+
         // Empty string returned by Lookup() when hash is not in the map.
         // Implemented as a member because Lookup() returns a const reference.
         const std::string m_emptyString;
 
-        // Term::Hash ==> std::string map.
-        std::unordered_map<Term::Hash, std::string> m_termToText;
+        std::unique_ptr<Shard[]> m_shards;
     };
 }
@@ -0,0 +1,203 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "CachedIdfTable.h"
+
+
+namespace BitFunnel
+{
+    namespace CachedIdfTableTest
+    {
+        // IIndexedIdfTable whose IDF is a function of the hash, and which
+        // counts its lookups.
+        class CountingIdfTable : public IIndexedIdfTable
+        {
+        public:
+            CountingIdfTable()
+              : m_lookupCount(0)
+            {
+            }
+
+            static Term::IdfX10 ExpectedIdf(Term::Hash hash)
+            {
+                return static_cast<Term::IdfX10>((hash >> 20) % 60);
+            }
+
+            virtual Term::IdfX10 GetIdf(Term::Hash hash) const override
+            {
+                ++m_lookupCount;
+                return ExpectedIdf(hash);
+            }
+
+            mutable std::atomic<size_t> m_lookupCount;
+        };
+
+
+        TEST(CachedIdfTable, HitsAndMisses)
+        {
+            CountingIdfTable idfTable;
+            CachedIdfTable cache(idfTable);
+
+            const Term::Hash c_cacheSize = 1ull << CachedIdfTable::c_log2CacheSize;
+
+            // Hashes that share an entry evict each other.
+            const Term::Hash a = 123;
+            const Term::Hash b = a + c_cacheSize;
+
+            EXPECT_EQ(CountingIdfTable::ExpectedIdf(a), cache.GetIdf(a));
+            EXPECT_EQ(CountingIdfTable::ExpectedIdf(a), cache.GetIdf(a));
+            EXPECT_EQ(CountingIdfTable::ExpectedIdf(b), cache.GetIdf(b));
+            EXPECT_EQ(CountingIdfTable::ExpectedIdf(a), cache.GetIdf(a));
+
+            EXPECT_EQ(1u, cache.GetHitCount());
+            EXPECT_EQ(3u, cache.GetMissCount());
+            EXPECT_EQ(3u, idfTable.m_lookupCount);
+
+            // A hash of zero is cached like any other.
+            cache.GetIdf(0);
+            cache.GetIdf(0);
+            EXPECT_EQ(2u, cache.GetHitCount());
+            EXPECT_EQ(4u, cache.GetMissCount());
+        }
+
+
+        TEST(CachedIdfTable, SwitchTables)
+        {
+            CountingIdfTable idfTable1;
+            CachedIdfTable cache1(idfTable1);
+            CountingIdfTable idfTable2;
+            CachedIdfTable cache2(idfTable2);
+
+            cache1.GetIdf(1);
+            cache1.GetIdf(1);
+            EXPECT_EQ(1u, idfTable1.m_lookupCount);
+
+            // The thread's cache now belongs to cache2, so cache1's entries
+            // are not returned by cache2.
+            cache2.GetIdf(1);
+            EXPECT_EQ(1u, idfTable2.m_lookupCount);
+
+            cache1.GetIdf(1);
+            EXPECT_EQ(2u, idfTable1.m_lookupCount);
+
+            // Counts are added to the totals of the previous owner when the
+            // cache switches tables.
+            EXPECT_EQ(1u, cache1.GetHitCount());
+            EXPECT_EQ(2u, cache1.GetMissCount());
+            EXPECT_EQ(0u, cache2.GetHitCount());
+            EXPECT_EQ(1u, cache2.GetMissCount());
+        }
+
+
+        // A thread's counts are added to the totals when it exits, even if
+        // the CachedIdfTable has been destroyed by then.
+        TEST(CachedIdfTable, ThreadExit)
+        {
+            CountingIdfTable idfTable;
+            CachedIdfTable cache(idfTable);
+
+            std::thread thread([&cache]()
+            {
+                cache.GetIdf(1);
+                cache.GetIdf(1);
+                cache.GetIdf(2);
+            });
+            thread.join();
+
+            EXPECT_EQ(1u, cache.GetHitCount());
+            EXPECT_EQ(2u, cache.GetMissCount());
+
+            std::unique_ptr<CachedIdfTable> temporary(new CachedIdfTable(idfTable));
+            std::thread orphan([&temporary]()
+            {
+                temporary->GetIdf(1);
+                temporary.reset();
+            });
+            orphan.join();
+        }
+
+
+        // The counts of the table that Term construction uses are reachable
+        // through IConfiguration.
+        TEST(CachedIdfTable, Configuration)
+        {
+            CountingIdfTable idfTable;
+            auto configuration =
+                Factories::CreateConfiguration(1, false, idfTable);
+
+            configuration->GetIdfTable().GetIdf(1);
+            configuration->GetIdfTable().GetIdf(1);
+            EXPECT_EQ(1u, configuration->GetIdfCacheHitCount());
+            EXPECT_EQ(1u, configuration->GetIdfCacheMissCount());
+        }
+
+
+        TEST(CachedIdfTable, Concurrent)
+        {
+            const size_t c_threadCount = 4;
+            const size_t c_lookupsPerThread = 100000;
+
+            CountingIdfTable idfTable;
+            CachedIdfTable cache(idfTable);
+            std::atomic<size_t> errorCount(0);
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&cache, &errorCount, t]()
+                {
+                    for (size_t i = 0; i < c_lookupsPerThread; ++i)
+                    {
+                        // Mostly a small set of common hashes.
+                        const Term::Hash hash =
+                            ((i % 10 == 0) ? i * 7919 + t : i % 1000) * 0x9E3779B97F4A7C15ull;
+                        if (cache.GetIdf(hash) != CountingIdfTable::ExpectedIdf(hash))
+                        {
+                            ++errorCount;
+                        }
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            EXPECT_EQ(0u, errorCount);
+
+            // Each thread added its counts when it exited.
+            EXPECT_EQ(c_threadCount * c_lookupsPerThread,
+                      cache.GetHitCount() + cache.GetMissCount());
+            EXPECT_GT(cache.GetHitCount(), cache.GetMissCount());
+        }
+    }
+}
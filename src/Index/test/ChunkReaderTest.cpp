@@ -21,11 +21,16 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <stddef.h>
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
 #include "Mocks/ChunkEventTracer.h"
 
 
@@ -203,5 +208,134 @@ namespace BitFunnel
                 EXPECT_EQ(trace.str(), tracer.Trace());
             });
         }
+
+
+        // Returns a chunk of 20 documents with streams long enough to span
+        // several vectors and several term batches.
+        static std::vector<char> CreateLongChunk()
+        {
+            std::string text;
+            for (unsigned d = 0; d < 20; ++d)
+            {
+                char docId[17];
+                snprintf(docId, sizeof(docId), "%016x", d);
+                text.append(docId);
+                text.push_back('\0');
+
+                for (unsigned stream = 0; stream < 3; ++stream)
+                {
+                    text.append((stream == 0) ? "00" : (stream == 1) ? "01" : "02");
+                    text.push_back('\0');
+
+                    // Streams of 0 to 199 terms, of 1 to 40 characters.
+                    const unsigned termCount = (d * 37 + stream * 11) % 200;
+                    for (unsigned t = 0; t < termCount; ++t)
+                    {
+                        text.append(1 + (d + t * 7) % 40,
+                                    static_cast<char>('a' + t % 26));
+                        text.push_back('\0');
+                    }
+                    text.push_back('\0');
+                }
+                text.push_back('\0');
+            }
+            text.push_back('\0');
+
+            return std::vector<char>(text.begin(), text.end());
+        }
+
+
+        // Verify that every DelimiterScanner produces the same events as the
+        // scalar scanner.
+        TEST(ChunkReader, InstructionSets)
+        {
+            std::vector<char> const chunk = CreateLongChunk();
+
+            Mocks::ChunkEventTracer expected(chunk, DelimiterScanner::Scalar);
+
+            DelimiterScanner::InstructionSet instructionSets[] = {
+                DelimiterScanner::SSE2,
+                DelimiterScanner::AVX2
+            };
+            for (auto instructionSet : instructionSets)
+            {
+                if (DelimiterScanner::IsSupported(instructionSet))
+                {
+                    Mocks::ChunkEventTracer tracer(chunk, instructionSet);
+                    EXPECT_EQ(expected.Trace(), tracer.Trace());
+                }
+            }
+        }
+
+
+        // Split a chunk at the document boundaries following a variety of
+        // positions, and verify that parsing the pieces with ReadDocuments()
+        // produces the same documents as parsing the whole chunk.
+        TEST(ChunkReader, ReadDocuments)
+        {
+            std::vector<char> const chunk = CreateLongChunk();
+            char const * const chunkStart = chunk.data();
+            char const * const chunkEnd = chunkStart + chunk.size();
+
+            // The trace of the whole chunk, without the file events.
+            Mocks::ChunkEventTracer whole(chunk);
+            std::string expected = whole.Trace();
+            const std::string enter = "OnFileEnter\n";
+            const std::string exit = "OnFileExit\n";
+            ASSERT_EQ(enter, expected.substr(0, enter.size()));
+            ASSERT_EQ(exit, expected.substr(expected.size() - exit.size()));
+            expected = expected.substr(enter.size(),
+                                       expected.size() - enter.size() - exit.size());
+
+            // Every document starts with its 16 digit id.
+            std::vector<char const *> documentStarts;
+            for (char const * p = chunkStart;
+                 p < chunkEnd;
+                 p = ChunkReader::FindDocumentBoundary(p + 1, chunkEnd))
+            {
+                documentStarts.push_back(p);
+            }
+            ASSERT_EQ(20u, documentStarts.size());
+            for (unsigned d = 0; d < documentStarts.size(); ++d)
+            {
+                char docId[17];
+                snprintf(docId, sizeof(docId), "%016x", d);
+                EXPECT_EQ(std::string(docId), std::string(documentStarts[d], 16));
+            }
+
+            // The documents end before the chunk's final '\0'.
+            char const * const documentsEnd = chunkEnd - 1;
+            const size_t blockSizes[] = { 1, 100, 1000, 5000, chunk.size() };
+            for (auto blockSize : blockSizes)
+            {
+                Mocks::ChunkEventTracer pieces;
+                char const * start = chunkStart;
+                while (start < documentsEnd)
+                {
+                    char const * end = documentsEnd;
+                    if (static_cast<size_t>(documentsEnd - start) > blockSize)
+                    {
+                        end = (std::min)(
+                            ChunkReader::FindDocumentBoundary(start + blockSize,
+                                                              chunkEnd),
+                            documentsEnd);
+                    }
+                    ChunkReader::ReadDocuments(start, end, pieces);
+                    start = end;
+                }
+                EXPECT_EQ(expected, pieces.Trace());
+            }
+        }
+
+
+        // A chunk that ends in the middle of a stream is rejected.
+        TEST(ChunkReader, Truncated)
+        {
+            std::vector<char> const chunk = ToCharVector(
+                "00000000000000f0\0"
+                "20\0Dogs\0are");
+
+            EXPECT_THROW(Mocks::ChunkEventTracer tracer(chunk), FatalError);
+        }
     }
 }
@@ -0,0 +1,112 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "DelimiterScanner.h"
+#include "Random.h"
+
+
+namespace BitFunnel
+{
+    namespace DelimiterScannerTest
+    {
+        static const DelimiterScanner::InstructionSet c_instructionSets[] = {
+            DelimiterScanner::Scalar,
+            DelimiterScanner::SSE2,
+            DelimiterScanner::AVX2
+        };
+
+
+        TEST(DelimiterScanner, BestInstructionSet)
+        {
+            DelimiterScanner scanner;
+            EXPECT_EQ(DelimiterScanner::GetBestInstructionSet(),
+                      scanner.GetInstructionSet());
+            EXPECT_TRUE(DelimiterScanner::IsSupported(DelimiterScanner::Scalar));
+        }
+
+
+        // Compares each instruction set with a byte at a time search over
+        // every combination of start offset, length, and capacity, so that
+        // the vector loops and the scalar tail are both exercised.
+        TEST(DelimiterScanner, Find)
+        {
+            const size_t c_bufferSize = 200;
+            std::vector<char> buffer(c_bufferSize);
+            RandomInt<unsigned> random(12345, 0, 7);
+            for (auto & c : buffer)
+            {
+                // Make roughly one byte in eight a delimiter.
+                c = (random() == 0) ? 0 : 'x';
+            }
+
+            std::vector<char const *> expected;
+            std::vector<char const *> delimiters(c_bufferSize);
+
+            for (auto instructionSet : c_instructionSets)
+            {
+                if (!DelimiterScanner::IsSupported(instructionSet))
+                {
+                    continue;
+                }
+
+                DelimiterScanner scanner(instructionSet);
+                for (size_t begin = 0; begin < 40; ++begin)
+                {
+                    for (size_t end = begin; end <= c_bufferSize; end += 7)
+                    {
+                        size_t capacities[] = { 0, 1, 5, c_bufferSize };
+                        for (auto capacity : capacities)
+                        {
+                            expected.clear();
+                            for (size_t i = begin;
+                                 i < end && expected.size() < capacity;
+                                 ++i)
+                            {
+                                if (buffer[i] == 0)
+                                {
+                                    expected.push_back(&buffer[i]);
+                                }
+                            }
+
+                            const size_t count =
+                                scanner.Find(buffer.data() + begin,
+                                             buffer.data() + end,
+                                             delimiters.data(),
+                                             capacity);
+
+                            ASSERT_EQ(expected.size(), count);
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                ASSERT_EQ(expected[i], delimiters[i]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "DocumentFrequencyTable.h"
+#include "DocumentFrequencyTableBuilder.h"
+
+
+namespace BitFunnel
+{
+    namespace DocumentFrequencyTableBuilderTest
+    {
+        static Term MakeTerm(Term::Hash hash)
+        {
+            return Term(hash, 0, 0, 1);
+        }
+
+
+        // Documents recorded by two threads, interleaved. Each term is
+        // counted as of the next document recorded by its own thread.
+        TEST(DocumentFrequencyTableBuilder, MergeThreads)
+        {
+            DocumentFrequencyTableBuilder builder(2);
+
+            // Terms 1 and 2 in document 0 from thread 0.
+            builder.OnTerm(0, MakeTerm(1));
+            builder.OnTerm(0, MakeTerm(2));
+
+            // Terms 2 and 3 in document 1 from thread 1. Thread 1 sees its
+            // terms before thread 0 records document 0.
+            Term terms[] = { MakeTerm(2), MakeTerm(3) };
+            builder.OnTerms(1, terms, 2);
+
+            builder.OnDocumentEnter(0);
+            builder.OnDocumentEnter(1);
+
+            // Terms 1 and 4 in document 2 from thread 0.
+            builder.OnTerm(0, MakeTerm(1));
+            builder.OnTerm(0, MakeTerm(4));
+            builder.OnDocumentEnter(0);
+
+            // Term 5 is never followed by a document, so it is not counted
+            // in the cumulative term counts.
+            builder.OnTerm(1, MakeTerm(5));
+
+            std::stringstream cumulative;
+            builder.WriteCumulativeTermCounts(cumulative);
+            EXPECT_EQ("0,2\n1,3\n2,4\n", cumulative.str());
+
+            std::stringstream frequencies;
+            builder.WriteFrequencies(frequencies, 0.0, nullptr);
+            DocumentFrequencyTable table(frequencies);
+
+            const double expected[] = { 0, 2.0 / 3, 2.0 / 3, 1.0 / 3, 1.0 / 3, 1.0 / 3 };
+            ASSERT_EQ(5u, table.size());
+            for (auto const & entry : table)
+            {
+                const Term::Hash hash = entry.GetTerm().GetRawHash();
+                ASSERT_LT(hash, 6u);
+                EXPECT_NEAR(expected[hash], entry.GetFrequency(), 1e-6);
+            }
+        }
+
+
+        // Threads recording concurrently get the same document frequencies
+        // as a single thread.
+        TEST(DocumentFrequencyTableBuilder, ConcurrentThreads)
+        {
+            const size_t c_threadCount = 4;
+            const size_t c_documentsPerThread = 1000;
+            DocumentFrequencyTableBuilder builder(c_threadCount);
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&builder, t]()
+                {
+                    for (size_t d = 0; d < c_documentsPerThread; ++d)
+                    {
+                        // Term h appears in every document whose number is a
+                        // multiple of h.
+                        for (Term::Hash h = 1; h <= 10; ++h)
+                        {
+                            if (d % h == 0)
+                            {
+                                builder.OnTerm(t, MakeTerm(h));
+                            }
+                        }
+                        builder.OnDocumentEnter(t);
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            std::stringstream cumulative;
+            builder.WriteCumulativeTermCounts(cumulative);
+            size_t lineCount = 0;
+            std::string line;
+            std::string lastLine;
+            while (std::getline(cumulative, line))
+            {
+                ++lineCount;
+                lastLine = line;
+            }
+            EXPECT_EQ(c_threadCount * c_documentsPerThread, lineCount);
+            EXPECT_EQ(std::to_string(lineCount - 1) + ",10", lastLine);
+
+            std::stringstream frequencies;
+            builder.WriteFrequencies(frequencies, 0.0, nullptr);
+            DocumentFrequencyTable table(frequencies);
+
+            ASSERT_EQ(10u, table.size());
+            for (auto const & entry : table)
+            {
+                const Term::Hash h = entry.GetTerm().GetRawHash();
+                const size_t documents = (c_documentsPerThread + h - 1) / h;
+                EXPECT_NEAR(static_cast<double>(documents) / c_documentsPerThread,
+                            entry.GetFrequency(),
+                            1e-6);
+            }
+        }
+    }
+}
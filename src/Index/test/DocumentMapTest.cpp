@@ -0,0 +1,234 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/Helpers.h"
+#include "BitFunnel/Index/IRecycler.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/Token.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "DocumentDataSchema.h"
+#include "DocumentMap.h"
+#include "Shard.h"
+#include "TrackingSliceBufferAllocator.h"
+
+
+namespace BitFunnel
+{
+    namespace DocumentMapTest
+    {
+        // Allocates documents with consecutive DocIds from a Shard, so that
+        // DocumentMap can read their DocIds.
+        class DocumentSource
+        {
+        public:
+            DocumentSource()
+              : m_recycler(Factories::CreateRecycler()),
+                m_tokenManager(Factories::CreateTokenManager()),
+                m_termTable(Factories::CreateTermTable())
+            {
+                m_background = std::async(std::launch::async,
+                                          &IRecycler::Run,
+                                          m_recycler.get());
+                m_termTable->Seal();
+
+                const size_t blockSize =
+                    GetMinimumBlockSize(m_docDataSchema, *m_termTable);
+                m_allocator.reset(new TrackingSliceBufferAllocator(blockSize));
+                m_shard.reset(new Shard(*m_recycler,
+                                        *m_tokenManager,
+                                        *m_termTable,
+                                        m_docDataSchema,
+                                        *m_allocator,
+                                        blockSize));
+            }
+
+            ~DocumentSource()
+            {
+                m_tokenManager->Shutdown();
+                m_recycler->Shutdown();
+                m_background.wait();
+            }
+
+            std::vector<DocumentHandleInternal> Allocate(size_t count)
+            {
+                std::vector<DocumentHandleInternal> handles;
+                for (DocId id = 0; id < count; ++id)
+                {
+                    handles.push_back(m_shard->AllocateDocument(id));
+                }
+                return handles;
+            }
+
+        private:
+            std::unique_ptr<IRecycler> m_recycler;
+            std::future<void> m_background;
+            std::unique_ptr<ITokenManager> m_tokenManager;
+            std::unique_ptr<ITermTable> m_termTable;
+            DocumentDataSchema m_docDataSchema;
+            std::unique_ptr<TrackingSliceBufferAllocator> m_allocator;
+            std::unique_ptr<Shard> m_shard;
+        };
+
+
+        TEST(DocumentMap, AddFindDelete)
+        {
+            DocumentSource source;
+            auto handles = source.Allocate(10);
+
+            DocumentMap map;
+            for (auto const & handle : handles)
+            {
+                map.Add(handle);
+            }
+            EXPECT_THROW(map.Add(handles[3]), RecoverableError);
+
+            bool isFound = false;
+            DocumentHandleInternal handle = map.Find(3, isFound);
+            EXPECT_TRUE(isFound);
+            EXPECT_EQ(handles[3].GetSlice(), handle.GetSlice());
+            EXPECT_EQ(handles[3].GetIndex(), handle.GetIndex());
+
+            map.Find(10, isFound);
+            EXPECT_FALSE(isFound);
+
+            EXPECT_TRUE(map.Delete(3, handle));
+            EXPECT_EQ(handles[3].GetIndex(), handle.GetIndex());
+            EXPECT_FALSE(map.Delete(3));
+            map.Find(3, isFound);
+            EXPECT_FALSE(isFound);
+
+            // A deleted DocId may be added again.
+            map.Add(handles[3]);
+            map.Find(3, isFound);
+            EXPECT_TRUE(isFound);
+        }
+
+
+        TEST(DocumentMap, GrowAndRebuild)
+        {
+            const size_t c_documentCount = 5000;
+            DocumentSource source;
+            auto handles = source.Allocate(c_documentCount);
+
+            // Repeatedly adding and deleting documents fills tables with
+            // deleted slots, which forces rebuilds as well as growth.
+            DocumentMap map;
+            for (unsigned pass = 0; pass < 3; ++pass)
+            {
+                for (auto const & handle : handles)
+                {
+                    map.Add(handle);
+                }
+
+                for (DocId id = 0; id < c_documentCount; ++id)
+                {
+                    bool isFound = false;
+                    DocumentHandleInternal handle = map.Find(id, isFound);
+                    ASSERT_TRUE(isFound);
+                    EXPECT_EQ(handles[id].GetIndex(), handle.GetIndex());
+                    EXPECT_EQ(handles[id].GetSlice(), handle.GetSlice());
+                }
+
+                for (DocId id = 0; id < c_documentCount; ++id)
+                {
+                    EXPECT_TRUE(map.Delete(id));
+                }
+            }
+        }
+
+
+        TEST(DocumentMap, ConcurrentFindDuringAddAndDelete)
+        {
+            const size_t c_documentCount = 20000;
+            const size_t c_writerCount = 2;
+            const size_t c_readerCount = 2;
+            DocumentSource source;
+            auto handles = source.Allocate(c_documentCount);
+
+            // Each writer adds and then deletes its own DocIds while readers
+            // look up all DocIds. A reader may or may not find a document,
+            // but any handle it finds must be the document's handle.
+            DocumentMap map;
+            std::atomic<size_t> writersRunning(c_writerCount);
+            std::atomic<size_t> mismatchCount(0);
+
+            std::vector<std::thread> threads;
+            for (size_t w = 0; w < c_writerCount; ++w)
+            {
+                threads.emplace_back([&, w]()
+                {
+                    for (DocId id = w; id < c_documentCount; id += c_writerCount)
+                    {
+                        map.Add(handles[id]);
+                    }
+                    for (DocId id = w; id < c_documentCount; id += 2 * c_writerCount)
+                    {
+                        map.Delete(id);
+                    }
+                    --writersRunning;
+                });
+            }
+            for (size_t r = 0; r < c_readerCount; ++r)
+            {
+                threads.emplace_back([&]()
+                {
+                    while (writersRunning > 0)
+                    {
+                        for (DocId id = 0; id < c_documentCount; ++id)
+                        {
+                            bool isFound = false;
+                            DocumentHandleInternal handle = map.Find(id, isFound);
+                            if (isFound &&
+                                (handle.GetSlice() != handles[id].GetSlice() ||
+                                 handle.GetIndex() != handles[id].GetIndex()))
+                            {
+                                ++mismatchCount;
+                            }
+                        }
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            EXPECT_EQ(0u, mismatchCount);
+            for (DocId id = 0; id < c_documentCount; ++id)
+            {
+                bool isFound = false;
+                map.Find(id, isFound);
+                EXPECT_EQ((id % (2 * c_writerCount)) >= c_writerCount, isFound);
+            }
+        }
+    }
+}
@@ -0,0 +1,240 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Utilities/StreamUtilities.h"
+#include "IndexedIdfTable.h"
+#include "TemporaryFile.h"
+
+
+namespace BitFunnel
+{
+    namespace IndexedIdfTableTest
+    {
+        const Term::IdfX10 c_defaultIdf = 60;
+
+        static std::vector<IndexedIdfTable::Entry> MakeEntries(size_t count)
+        {
+            std::vector<IndexedIdfTable::Entry> entries;
+            for (size_t i = 0; i < count; ++i)
+            {
+                // Hashes that share their high bits, and so their first
+                // Bucket, as well as spread out hashes.
+                const Term::Hash hash = (i % 2 == 0) ?
+                    i : i * 0x9E3779B97F4A7C15ull;
+                entries.push_back(std::make_pair(hash, static_cast<Term::IdfX10>(i % 50)));
+            }
+            return entries;
+        }
+
+
+        static void VerifyEntries(IIndexedIdfTable const & table,
+                                  std::vector<IndexedIdfTable::Entry> const & entries)
+        {
+            for (auto const & entry : entries)
+            {
+                EXPECT_EQ(entry.second, table.GetIdf(entry.first));
+            }
+            EXPECT_EQ(c_defaultIdf, table.GetIdf(0xFFFFFFFFFFFFFFFFull));
+            EXPECT_EQ(c_defaultIdf, table.GetIdf(1ull << 40));
+        }
+
+
+        TEST(IndexedIdfTable, RoundTrip)
+        {
+            for (size_t count : { 0, 1, 7, 8, 1000 })
+            {
+                auto entries = MakeEntries(count);
+
+                std::stringstream stream;
+                IndexedIdfTable::Write(stream, entries);
+                IndexedIdfTable table(stream, c_defaultIdf);
+
+                VerifyEntries(table, entries);
+            }
+        }
+
+
+        TEST(IndexedIdfTable, DuplicateHashes)
+        {
+            std::vector<IndexedIdfTable::Entry> entries;
+            entries.push_back(std::make_pair(123ull, static_cast<Term::IdfX10>(10)));
+            entries.push_back(std::make_pair(123ull, static_cast<Term::IdfX10>(20)));
+
+            std::stringstream stream;
+            IndexedIdfTable::Write(stream, entries);
+            IndexedIdfTable table(stream, c_defaultIdf);
+
+            EXPECT_EQ(10u, table.GetIdf(123ull));
+        }
+
+
+        // The format written before IndexedIdfTable had a header: an entry
+        // count, then (hash, idf) pairs, all as size_t.
+        TEST(IndexedIdfTable, OldFormat)
+        {
+            auto entries = MakeEntries(100);
+
+            std::stringstream stream;
+            StreamUtilities::WriteField<size_t>(stream, entries.size());
+            for (auto const & entry : entries)
+            {
+                StreamUtilities::WriteField<size_t>(stream, entry.first);
+                StreamUtilities::WriteField<size_t>(stream, entry.second);
+            }
+
+            IndexedIdfTable table(stream, c_defaultIdf);
+            VerifyEntries(table, entries);
+        }
+
+
+        TEST(IndexedIdfTable, MemoryMapped)
+        {
+            auto entries = MakeEntries(1000);
+            TemporaryFile file("IndexedIdfTableTest");
+            char const * path = file.GetPath();
+
+            {
+                std::ofstream output(path, std::ios::binary);
+                IndexedIdfTable::Write(output, entries);
+            }
+
+            auto table = Factories::CreateIndexedIdfTable(path, c_defaultIdf);
+            VerifyEntries(*table, entries);
+
+            // A truncated file is rejected.
+            {
+                std::stringstream stream;
+                IndexedIdfTable::Write(stream, entries);
+                std::string truncated = stream.str();
+                truncated.resize(truncated.size() - 1);
+                std::ofstream output(path, std::ios::binary);
+                output << truncated;
+            }
+            EXPECT_THROW(IndexedIdfTable(path, c_defaultIdf), RecoverableError);
+        }
+
+
+        // Accessors for the entry count of a Bucket in a file image written
+        // by IndexedIdfTable::Write(). The Header and each Bucket are 64
+        // bytes, and a Bucket's count is its last byte.
+        static uint8_t GetBucketCount(std::string const & image, size_t bucket)
+        {
+            return static_cast<uint8_t>(image[64 + bucket * 64 + 63]);
+        }
+
+
+        static void SetBucketCount(std::string& image, size_t bucket, uint8_t count)
+        {
+            image[64 + bucket * 64 + 63] = static_cast<char>(count);
+        }
+
+
+        // Changes the entry count in the Header of a file image.
+        static void SetEntryCount(std::string& image, uint64_t count)
+        {
+            memcpy(&image[24], &count, sizeof(count));
+        }
+
+
+        // Loading the image from a stream checks the Buckets and throws.
+        // Memory mapping the image checks only the Header, so if the Header
+        // is accepted, lookups must still stay within the table and
+        // terminate.
+        static void ExpectRejected(std::string const & image)
+        {
+            std::stringstream stream(image);
+            EXPECT_THROW(IndexedIdfTable(stream, c_defaultIdf), RecoverableError);
+
+            TemporaryFile file("IndexedIdfTableTest");
+            {
+                std::ofstream output(file.GetPath(), std::ios::binary);
+                output << image;
+            }
+            std::unique_ptr<IndexedIdfTable> table;
+            try
+            {
+                table.reset(new IndexedIdfTable(file.GetPath(), c_defaultIdf));
+            }
+            catch (RecoverableError const &)
+            {
+                return;
+            }
+            for (auto const & entry : MakeEntries(2000))
+            {
+                table->GetIdf(entry.first);
+            }
+        }
+
+
+        // Bucket counts are checked when a table is read from a stream. A
+        // memory mapped table is not scanned, but its probes are bounded.
+        TEST(IndexedIdfTable, CorruptBuckets)
+        {
+            std::stringstream stream;
+            IndexedIdfTable::Write(stream, MakeEntries(1000));
+            const std::string image = stream.str();
+
+            // A Bucket that claims more entries than it holds.
+            {
+                std::string corrupt = image;
+                SetBucketCount(corrupt, 0, IndexedIdfTable::c_bucketEntryCount + 1);
+                ExpectRejected(corrupt);
+            }
+
+            // Bucket counts that do not add up to the Header's entry count.
+            {
+                std::string corrupt = image;
+                size_t bucket = 0;
+                while (GetBucketCount(corrupt, bucket) == 0)
+                {
+                    ++bucket;
+                }
+                SetBucketCount(corrupt,
+                               bucket,
+                               GetBucketCount(corrupt, bucket) - 1);
+                ExpectRejected(corrupt);
+            }
+
+            // Full Buckets everywhere, so that no probe would end.
+            {
+                std::stringstream small;
+                IndexedIdfTable::Write(small, MakeEntries(1));
+                std::string corrupt = small.str();
+                ASSERT_EQ(64u + 64u, corrupt.size());
+                SetBucketCount(corrupt, 0, IndexedIdfTable::c_bucketEntryCount);
+                SetEntryCount(corrupt, IndexedIdfTable::c_bucketEntryCount);
+                ExpectRejected(corrupt);
+            }
+        }
+    }
+}
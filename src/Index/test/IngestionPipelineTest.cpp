@@ -0,0 +1,278 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IShardDefinition.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
+#include "BitFunnel/Index/IIndexedIdfTable.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IngestChunks.h"
+#include "BitFunnel/Index/IRecycler.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "IngestionPipeline.h"
+#include "Shard.h"
+#include "TemporaryFile.h"
+
+
+namespace BitFunnel
+{
+    namespace IngestionPipelineTest
+    {
+        // Creates an IIngestor whose TermTable has only the system rows.
+        class TestIndex : public ITermTableCollection
+        {
+        public:
+            TestIndex()
+              : m_recycler(Factories::CreateRecycler()),
+                m_idfTable(Factories::CreateIndexedIdfTable()),
+                m_schema(Factories::CreateDocumentDataSchema()),
+                m_shardDefinition(Factories::CreateShardDefinition()),
+                m_termTable(Factories::CreateTermTable())
+            {
+                m_recyclerThread = std::async(std::launch::async,
+                                              &IRecycler::Run,
+                                              m_recycler.get());
+
+                m_configuration = Factories::CreateConfiguration(1,
+                                                                 false,
+                                                                 *m_idfTable);
+                m_termTable->Seal();
+
+                const size_t blockSize =
+                    Shard::InitializeDescriptors(nullptr,
+                                                 c_sliceCapacity,
+                                                 *m_schema,
+                                                 *m_termTable);
+                m_sliceBufferAllocator =
+                    Factories::CreateSliceBufferAllocator(blockSize, 16);
+
+                m_ingestor = Factories::CreateIngestor(*m_schema,
+                                                       *m_recycler,
+                                                       *this,
+                                                       *m_shardDefinition,
+                                                       *m_sliceBufferAllocator);
+            }
+
+
+            ~TestIndex()
+            {
+                m_ingestor.reset();
+                m_recycler->Shutdown();
+                m_recyclerThread.wait();
+            }
+
+
+            IConfiguration const & GetConfiguration() const
+            {
+                return *m_configuration;
+            }
+
+
+            IIngestor & GetIngestor() const
+            {
+                return *m_ingestor;
+            }
+
+
+            virtual ITermTable & GetTermTable(ShardId /*shard*/) const override
+            {
+                return *m_termTable;
+            }
+
+
+            virtual size_t size() const override
+            {
+                return m_shardDefinition->GetShardCount();
+            }
+
+        private:
+            static const DocIndex c_sliceCapacity = 4096;
+
+            std::unique_ptr<IRecycler> m_recycler;
+            std::future<void> m_recyclerThread;
+
+            std::unique_ptr<IIndexedIdfTable> m_idfTable;
+            std::unique_ptr<IConfiguration> m_configuration;
+            std::unique_ptr<IDocumentDataSchema> m_schema;
+            std::unique_ptr<IShardDefinition> m_shardDefinition;
+            std::unique_ptr<ITermTable> m_termTable;
+            std::unique_ptr<ISliceBufferAllocator> m_sliceBufferAllocator;
+            std::unique_ptr<IIngestor> m_ingestor;
+        };
+
+
+        // Writes a chunk file in the temporary directory, and removes the
+        // file when destroyed.
+        class ChunkFile : public TemporaryFile
+        {
+        public:
+            // Writes documents with ids [firstId, firstId + documentCount).
+            ChunkFile(char const * name, DocId firstId, size_t documentCount)
+              : TemporaryFile(name),
+                m_documentBytes(0)
+            {
+                std::stringstream chunk;
+                for (DocId id = firstId; id < firstId + documentCount; ++id)
+                {
+                    std::stringstream document;
+                    document << std::hex;
+                    document.width(16);
+                    document.fill('0');
+                    document << id << '\0';
+
+                    document << "00" << '\0';
+                    for (unsigned t = 0; t < id % 50; ++t)
+                    {
+                        document << "term" << (id * 7 + t) % 97 << '\0';
+                    }
+                    document << '\0' << '\0';
+
+                    m_documentBytes += document.str().size();
+                    chunk << document.str();
+                }
+                chunk << '\0';
+
+                std::ofstream output(GetPath(), std::ios::binary);
+                output << chunk.str();
+            }
+
+            size_t GetDocumentBytes() const
+            {
+                return m_documentBytes;
+            }
+
+        private:
+            size_t m_documentBytes;
+        };
+
+
+        // Ingest two chunk files with a variety of stage sizes and block
+        // sizes, and verify that every document is added exactly once.
+        TEST(IngestionPipeline, Ingest)
+        {
+            ChunkFile file1("IngestionPipelineTest1", 0, 1000);
+            ChunkFile file2("IngestionPipelineTest2", 1000, 500);
+            const std::vector<std::string> paths = {
+                file1.GetPath(),
+                file2.GetPath()
+            };
+            const size_t documentCount = 1500;
+            const size_t documentBytes =
+                file1.GetDocumentBytes() + file2.GetDocumentBytes();
+
+            const size_t threadCounts[] = { 1, 3 };
+            const size_t blockSizes[] = { 1, 1000, 1 << 20 };
+            for (auto threadCount : threadCounts)
+            {
+                for (auto blockSize : blockSizes)
+                {
+                    TestIndex index;
+                    IIngestor & ingestor = index.GetIngestor();
+
+                    IngestionPipelineOptions options(threadCount);
+                    options.m_readerCount = threadCount;
+                    options.m_blockSize = blockSize;
+                    options.m_blockQueueCapacity = 1;
+
+                    IngestionPipeline pipeline(index.GetConfiguration(),
+                                               ingestor,
+                                               options,
+                                               true);
+                    pipeline.Ingest(paths);
+
+                    for (DocId id = 0; id < documentCount; ++id)
+                    {
+                        EXPECT_TRUE(ingestor.Contains(id));
+                    }
+                    EXPECT_FALSE(ingestor.Contains(documentCount));
+                    EXPECT_EQ(documentBytes,
+                              ingestor.GetTotalSouceBytesIngested());
+
+                    // Each stage saw every byte, and the parse and post
+                    // stages saw every document.
+                    IngestionPipeline::Stage stages[] = {
+                        IngestionPipeline::Read,
+                        IngestionPipeline::Parse,
+                        IngestionPipeline::Post
+                    };
+                    for (auto stage : stages)
+                    {
+                        auto const & statistics = pipeline.GetStatistics(stage);
+                        EXPECT_EQ(documentBytes, statistics.m_byteCount);
+                        if (stage != IngestionPipeline::Read)
+                        {
+                            EXPECT_EQ(documentCount, statistics.m_documentCount);
+                        }
+                    }
+                    if (blockSize == 1)
+                    {
+                        EXPECT_EQ(documentCount,
+                                  pipeline.GetStatistics(IngestionPipeline::Read).m_blockCount);
+                    }
+
+                    std::stringstream report;
+                    pipeline.PrintStatistics(report);
+                    EXPECT_NE(std::string::npos, report.str().find("parse"));
+                }
+            }
+        }
+
+
+        // An error in one file stops the pipeline, and is rethrown by
+        // Ingest().
+        TEST(IngestionPipeline, MissingFile)
+        {
+            ChunkFile file("IngestionPipelineTest3", 0, 100);
+            const std::vector<std::string> paths = {
+                file.GetPath(),
+                "IngestionPipelineTestMissing.chunk"
+            };
+
+            TestIndex index;
+            IngestionPipelineOptions options(2);
+            options.m_blockSize = 100;
+
+            EXPECT_THROW(IngestChunksPipelined(paths,
+                                               index.GetConfiguration(),
+                                               index.GetIngestor(),
+                                               options,
+                                               false,
+                                               nullptr),
+                         RecoverableError);
+        }
+    }
+}
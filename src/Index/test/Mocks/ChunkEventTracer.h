@@ -37,12 +37,28 @@ namespace BitFunnel
         class ChunkEventTracer : public ChunkReader::IEvents
         {
         public:
+            // Records events from ChunkReader::ReadDocuments().
+            ChunkEventTracer()
+            {
+            }
+
+
             ChunkEventTracer(std::vector<char> const & chunkData)
             {
                 ChunkReader(chunkData, *this);
             }
 
 
+            ChunkEventTracer(std::vector<char> const & chunkData,
+                             DelimiterScanner::InstructionSet instructionSet)
+            {
+                ChunkReader(chunkData.data(),
+                            chunkData.data() + chunkData.size(),
+                            *this,
+                            instructionSet);
+            }
+
+
             std::string Trace()
             {
                 return m_trace.str();
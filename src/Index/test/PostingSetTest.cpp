@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Term.h"
+#include "PostingSet.h"
+
+
+namespace BitFunnel
+{
+    namespace PostingSetTest
+    {
+        // Returns a term with the given raw hash in stream 0.
+        static Term CreateTerm(uint64_t hash, Term::GramSize gramSize = 1)
+        {
+            return Term(hash, 0, 0, gramSize);
+        }
+
+
+        TEST(PostingSet, Deduplication)
+        {
+            PostingSet postings;
+            EXPECT_EQ(0u, postings.size());
+            EXPECT_EQ(postings.begin(), postings.end());
+
+            EXPECT_TRUE(postings.Add(CreateTerm(123)));
+            EXPECT_FALSE(postings.Add(CreateTerm(123)));
+            EXPECT_TRUE(postings.Add(CreateTerm(123, 2)));
+            EXPECT_TRUE(postings.Add(CreateTerm(456)));
+
+            EXPECT_EQ(3u, postings.size());
+            EXPECT_TRUE(postings.Contains(CreateTerm(123)));
+            EXPECT_TRUE(postings.Contains(CreateTerm(123, 2)));
+            EXPECT_TRUE(postings.Contains(CreateTerm(456)));
+            EXPECT_FALSE(postings.Contains(CreateTerm(789)));
+        }
+
+
+        TEST(PostingSet, GrowAndClear)
+        {
+            const uint64_t c_termCount = 1000;
+            PostingSet postings;
+
+            for (unsigned pass = 0; pass < 3; ++pass)
+            {
+                // Terms are added in insertion order, with a stride that
+                // produces many collisions in the table.
+                for (uint64_t i = 0; i < c_termCount; ++i)
+                {
+                    EXPECT_TRUE(postings.Add(CreateTerm((i + pass) << 32)));
+                }
+                ASSERT_EQ(c_termCount, postings.size());
+
+                uint64_t i = 0;
+                for (Term const & term : postings)
+                {
+                    EXPECT_EQ(CreateTerm((i + pass) << 32), term);
+                    ++i;
+                }
+
+                postings.Clear();
+                EXPECT_EQ(0u, postings.size());
+                EXPECT_FALSE(postings.Contains(CreateTerm(static_cast<uint64_t>(pass) << 32)));
+            }
+        }
+
+
+        TEST(PostingSet, MatchesUnorderedSet)
+        {
+            PostingSet postings;
+            std::unordered_set<Term, Term::Hasher> expected;
+
+            uint64_t random = 12345;
+            for (unsigned document = 0; document < 100; ++document)
+            {
+                postings.Clear();
+                expected.clear();
+
+                for (unsigned i = 0; i < document * 3; ++i)
+                {
+                    random = random * 6364136223846793005ull + 1442695040888963407ull;
+                    const Term term = CreateTerm((random >> 40) % 200,
+                                                 static_cast<Term::GramSize>(1 + (random & 1)));
+                    EXPECT_EQ(expected.insert(term).second, postings.Add(term));
+                }
+
+                ASSERT_EQ(expected.size(), postings.size());
+                for (Term const & term : postings)
+                {
+                    EXPECT_EQ(1u, expected.count(term));
+                }
+            }
+        }
+    }
+}
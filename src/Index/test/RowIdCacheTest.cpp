@@ -0,0 +1,237 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "RowIdCache.h"
+#include "TermTable.h"
+
+
+namespace BitFunnel
+{
+    namespace RowIdCacheTest
+    {
+        const size_t c_explicitTermCount = 100;
+        const Term::Hash c_firstHash = 1000;
+
+        // Configures a sealed TermTable with explicit terms with hashes
+        // starting at c_firstHash, and adhoc recipes for every (idf,
+        // gramSize). rowOffset varies the rows between TermTables.
+        static void ConfigureTermTable(TermTable& termTable, RowIndex rowOffset)
+        {
+            const size_t explicitRowCount = 200;
+            const size_t adhocRowCount = 300;
+
+            for (size_t i = 0; i < c_explicitTermCount; ++i)
+            {
+                termTable.OpenTerm();
+                for (size_t r = 0; r <= (i % 4); ++r)
+                {
+                    termTable.AddRowId(RowId(0, 0, (i + r + rowOffset) % explicitRowCount));
+                }
+                termTable.CloseTerm(c_firstHash + i);
+            }
+
+            for (Term::IdfX10 idf = 0; idf <= Term::c_maxIdfX10Value; ++idf)
+            {
+                for (Term::GramSize gramSize = 0; gramSize <= Term::c_maxGramSize; ++gramSize)
+                {
+                    termTable.OpenTerm();
+                    for (size_t r = 0; r <= (idf + gramSize) % 3; ++r)
+                    {
+                        termTable.AddRowId(RowId(0, 0, 0));
+                    }
+                    termTable.CloseAdhocTerm(idf, gramSize);
+                }
+            }
+
+            termTable.SetRowCounts(0, explicitRowCount, adhocRowCount);
+            termTable.SetFactCount(0);
+            termTable.Seal();
+        }
+
+
+        // Verifies that the cache returns the same RowIds as RowIdSequence.
+        static void VerifyRows(Term const & term,
+                               RowIdCache const & cache,
+                               ITermTable const & termTable)
+        {
+            std::vector<RowId> expected;
+            RowIdSequence rows(term, termTable);
+            for (auto const row : rows)
+            {
+                expected.push_back(row);
+            }
+
+            size_t rowCount;
+            RowId const * observed = cache.GetRows(term, rowCount);
+            ASSERT_EQ(expected.size(), rowCount);
+            for (size_t i = 0; i < rowCount; ++i)
+            {
+                EXPECT_EQ(expected[i], observed[i]);
+            }
+        }
+
+
+        // Looks up explicit, adhoc, and system terms, twice each, so that the
+        // second lookup of each term can be answered from the cache.
+        static void VerifyTerms(RowIdCache const & cache,
+                                ITermTable const & termTable)
+        {
+            for (size_t pass = 0; pass < 2; ++pass)
+            {
+                for (size_t i = 0; i < c_explicitTermCount; ++i)
+                {
+                    VerifyRows(Term(c_firstHash + i, 0, 0), cache, termTable);
+                }
+
+                // The same adhoc hash at different IDFs and gram sizes
+                // shares a cache entry, but not its RowIds.
+                for (Term::IdfX10 idf = 0; idf <= Term::c_maxIdfX10Value; ++idf)
+                {
+                    for (Term::GramSize gramSize = 1; gramSize <= Term::c_maxGramSize; ++gramSize)
+                    {
+                        VerifyRows(Term(123456789ull, 0, idf, gramSize), cache, termTable);
+                    }
+                }
+
+                VerifyRows(termTable.GetDocumentActiveTerm(), cache, termTable);
+                VerifyRows(termTable.GetMatchAllTerm(), cache, termTable);
+            }
+        }
+
+
+        // A TermTable that counts the lookups that reach it.
+        class CountingTermTable : public TermTable
+        {
+        public:
+            CountingTermTable()
+              : m_lookupCount(0)
+            {
+            }
+
+            virtual PackedRowIdSequence GetRows(const Term& term) const override
+            {
+                ++m_lookupCount;
+                return TermTable::GetRows(term);
+            }
+
+            mutable std::atomic<size_t> m_lookupCount;
+        };
+
+
+        TEST(RowIdCache, MatchesRowIdSequence)
+        {
+            TermTable termTable;
+            ConfigureTermTable(termTable, 0);
+            RowIdCache cache(termTable);
+
+            VerifyTerms(cache, termTable);
+        }
+
+
+        // Caches for different TermTables, used alternately from the same
+        // threads, must not return each other's RowIds. There are more
+        // caches than each thread has, so some share a thread cache.
+        TEST(RowIdCache, MultipleCaches)
+        {
+            const size_t c_cacheCount = RowIdCache::c_threadCacheCount + 2;
+            const size_t c_threadCount = 4;
+
+            std::vector<std::unique_ptr<TermTable>> termTables;
+            std::vector<std::unique_ptr<RowIdCache>> caches;
+            for (size_t i = 0; i < c_cacheCount; ++i)
+            {
+                termTables.emplace_back(new TermTable());
+                ConfigureTermTable(*termTables.back(), i);
+                caches.emplace_back(new RowIdCache(*termTables.back()));
+            }
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    for (size_t i = 0; i < c_cacheCount * 2; ++i)
+                    {
+                        const size_t c = (i + t) % c_cacheCount;
+                        VerifyTerms(*caches[c], *termTables[c]);
+                    }
+                });
+            }
+
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+
+        // A thread keeps a cache for each of up to c_threadCacheCount
+        // RowIdCaches, whatever their ids, so alternating between them does
+        // not empty their caches.
+        TEST(RowIdCache, CacheSelection)
+        {
+            const size_t c_cacheCount = RowIdCache::c_threadCacheCount;
+
+            // Ids a multiple of c_threadCacheCount apart would share a cache
+            // if caches were selected by id alone.
+            std::vector<std::unique_ptr<CountingTermTable>> termTables;
+            std::vector<std::unique_ptr<RowIdCache>> caches;
+            for (size_t i = 0; i < c_cacheCount * c_cacheCount; ++i)
+            {
+                termTables.emplace_back(new CountingTermTable());
+                ConfigureTermTable(*termTables.back(), i);
+                caches.emplace_back(new RowIdCache(*termTables.back()));
+            }
+
+            std::thread thread([&]()
+            {
+                for (size_t pass = 0; pass < 3; ++pass)
+                {
+                    for (size_t i = 0; i < c_explicitTermCount; ++i)
+                    {
+                        const Term term(c_firstHash + i, 0, 0);
+                        for (size_t c = 0; c < caches.size(); c += c_cacheCount)
+                        {
+                            size_t rowCount;
+                            caches[c]->GetRows(term, rowCount);
+                            EXPECT_EQ((i % 4) + 1, rowCount);
+                        }
+                    }
+                }
+            });
+            thread.join();
+
+            for (size_t c = 0; c < caches.size(); c += c_cacheCount)
+            {
+                EXPECT_EQ(c_explicitTermCount, termTables[c]->m_lookupCount);
+            }
+        }
+    }
+}
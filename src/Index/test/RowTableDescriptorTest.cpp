@@ -23,10 +23,184 @@
 
 #include "gtest/gtest.h"
 
+#include <thread>
+#include <vector>
+
+#include "BitFunnel/Index/Row.h"
+#include "RowTableDescriptor.h"
+
 
 namespace BitFunnel
 {
-    TEST(RowTableDescriptor, Placeholder)
+    namespace RowTableDescriptorTest
     {
+        TEST(RowTableDescriptor, DefaultAlignment)
+        {
+            const DocIndex c_capacity = Row::DocumentsInRank0Row(1);
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                EXPECT_EQ(RowTableDescriptor::GetBufferSize(c_capacity, 10, rank),
+                          Row::BytesInRow(c_capacity, rank) * 10);
+            }
+        }
+
+
+        TEST(RowTableDescriptor, RowAlignment)
+        {
+            const DocIndex c_capacity = Row::DocumentsInRank0Row(1);
+            const RowIndex c_rowCount = 5;
+
+            for (size_t alignment : { 32, 64 })
+            {
+                for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+                {
+                    const size_t bytesPerRow =
+                        RowTableDescriptor::GetBytesPerRow(c_capacity, rank, alignment);
+                    EXPECT_EQ(bytesPerRow % alignment, 0u);
+                    EXPECT_GE(bytesPerRow, Row::BytesInRow(c_capacity, rank));
+                    EXPECT_EQ(RowTableDescriptor::GetBufferSize(c_capacity,
+                                                                c_rowCount,
+                                                                rank,
+                                                                alignment),
+                              bytesPerRow * c_rowCount);
+
+                    // Rows start on aligned offsets and bits in adjacent rows
+                    // are independent.
+                    const ptrdiff_t c_bufferOffset = 128;
+                    RowTableDescriptor rowTable(c_capacity,
+                                                c_rowCount,
+                                                rank,
+                                                c_bufferOffset,
+                                                alignment);
+
+                    std::vector<uint64_t> buffer(
+                        (c_bufferOffset + bytesPerRow * c_rowCount) / sizeof(uint64_t));
+                    for (RowIndex row = 0; row < c_rowCount; ++row)
+                    {
+                        EXPECT_EQ(rowTable.GetRowOffset(row) % alignment, 0u);
+                        rowTable.SetBit(buffer.data(), row, row);
+                    }
+
+                    for (RowIndex row = 0; row < c_rowCount; ++row)
+                    {
+                        for (DocIndex doc = 0; doc < c_rowCount; ++doc)
+                        {
+                            EXPECT_EQ(rowTable.GetBit(buffer.data(), row, doc),
+                                      (row == doc) ? 1u : 0u);
+                        }
+                    }
+                }
+            }
+        }
+
+
+        // SetBits() sets the same bits as SetBit() on each row, including
+        // rows listed more than once.
+        TEST(RowTableDescriptor, SetBits)
+        {
+            const DocIndex c_capacity = Row::DocumentsInRank0Row(4);
+            const RowIndex c_rowCount = 40;
+            const std::vector<RowIndex> rows = { 0, 1, 1, 5, 17, 17, 17, 38, 39 };
+
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                RowTableDescriptor rowTable(c_capacity, c_rowCount, rank, 0);
+                const size_t bufferSize =
+                    RowTableDescriptor::GetBufferSize(c_capacity, c_rowCount, rank);
+                std::vector<uint64_t> expected(bufferSize / sizeof(uint64_t));
+                std::vector<uint64_t> actual(bufferSize / sizeof(uint64_t));
+
+                for (DocIndex doc = 0; doc < c_capacity; doc += 37)
+                {
+                    for (auto row : rows)
+                    {
+                        rowTable.SetBit(expected.data(), row, doc);
+                    }
+                    rowTable.SetBits(actual.data(), doc, rows.data(), rows.size());
+                    EXPECT_EQ(expected, actual);
+                }
+
+                // An empty list of rows changes nothing.
+                rowTable.SetBits(actual.data(), 1, rows.data(), 0);
+                EXPECT_EQ(expected, actual);
+
+                // ClearBit() undoes SetBits().
+                for (DocIndex doc = 0; doc < c_capacity; doc += 37)
+                {
+                    for (auto row : rows)
+                    {
+                        rowTable.ClearBit(actual.data(), row, doc);
+                    }
+                }
+                EXPECT_EQ(std::vector<uint64_t>(actual.size()), actual);
+            }
+        }
+
+
+        // Threads that set and clear bits of different documents that share
+        // words don't lose each other's updates.
+        TEST(RowTableDescriptor, ConcurrentSetAndClear)
+        {
+            const DocIndex c_capacity = Row::DocumentsInRank0Row(4096);
+            const RowIndex c_rowCount = 16;
+            const size_t c_threadCount = 8;
+            const Rank rank = 0;
+
+            RowTableDescriptor rowTable(c_capacity, c_rowCount, rank, 0);
+            std::vector<uint64_t> buffer(
+                RowTableDescriptor::GetBufferSize(c_capacity, c_rowCount, rank) /
+                sizeof(uint64_t));
+
+            std::vector<RowIndex> rows;
+            for (RowIndex row = 0; row < c_rowCount; ++row)
+            {
+                rows.push_back(row);
+            }
+
+            // Each thread owns the documents congruent to its number, sets
+            // their bits in every row, and then clears them in the odd rows.
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    for (DocIndex doc = t; doc < c_capacity; doc += c_threadCount)
+                    {
+                        if (doc % 2 == 0)
+                        {
+                            rowTable.SetBits(buffer.data(), doc, rows.data(), rows.size());
+                        }
+                        else
+                        {
+                            for (auto row : rows)
+                            {
+                                rowTable.SetBit(buffer.data(), row, doc);
+                            }
+                        }
+                    }
+                    for (DocIndex doc = t; doc < c_capacity; doc += c_threadCount)
+                    {
+                        for (RowIndex row = 1; row < c_rowCount; row += 2)
+                        {
+                            rowTable.ClearBit(buffer.data(), row, doc);
+                        }
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            for (RowIndex row = 0; row < c_rowCount; ++row)
+            {
+                for (DocIndex doc = 0; doc < c_capacity; ++doc)
+                {
+                    ASSERT_EQ((row % 2 == 0) ? 1u : 0u,
+                              rowTable.GetBit(buffer.data(), row, doc))
+                        << "row " << row << ", doc " << doc;
+                }
+            }
+        }
     }
 }
@@ -20,7 +20,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <cstring>
 #include <future>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -114,5 +118,211 @@ namespace BitFunnel
             recycler->Shutdown();
             background.wait();
         }
+
+
+        // With one active Slice per thread, each thread fills Slices of its
+        // own, and commit and expire accounting still recycles every Slice.
+        TEST(Shard, ActiveSlicePerThread)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            const size_t c_threadCount = 4;
+            Shard shard(*recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        c_threadCount);
+            EXPECT_EQ(c_threadCount, shard.GetActiveSliceCount());
+
+            const DocIndex sliceCapacity = shard.GetSliceCapacity();
+            const size_t c_slicesPerThread = 3;
+
+            std::vector<std::vector<DocumentHandleInternal>> handles(c_threadCount);
+            // Use new threads, rather than std::async, which may reuse threads
+            // that have already been numbered.
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    for (DocIndex i = 0; i < sliceCapacity * c_slicesPerThread; ++i)
+                    {
+                        const DocId id = t * sliceCapacity * c_slicesPerThread + i;
+                        handles[t].push_back(shard.AllocateDocument(id));
+                        handles[t].back().GetSlice()->CommitDocument();
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            // The threads are numbered consecutively, so each one used a
+            // different ActiveSlice, and filled its Slices in order.
+            std::set<Slice*> slices;
+            for (auto const & threadHandles : handles)
+            {
+                for (size_t i = 0; i < threadHandles.size(); ++i)
+                {
+                    EXPECT_EQ(i % sliceCapacity, threadHandles[i].GetIndex());
+                    if (i % sliceCapacity == 0)
+                    {
+                        EXPECT_TRUE(slices.insert(threadHandles[i].GetSlice()).second);
+                    }
+                    else
+                    {
+                        EXPECT_EQ(threadHandles[i - 1].GetSlice(),
+                                  threadHandles[i].GetSlice());
+                    }
+                }
+            }
+            EXPECT_EQ(c_threadCount * c_slicesPerThread, slices.size());
+            EXPECT_EQ(c_threadCount * c_slicesPerThread,
+                      trackingAllocator->GetInUseBuffersCount());
+
+            for (auto slice : slices)
+            {
+                for (DocIndex i = 0; i < sliceCapacity; ++i)
+                {
+                    slice->ExpireDocument();
+                }
+                shard.RecycleSlice(*slice);
+            }
+
+            while(trackingAllocator->GetInUseBuffersCount() != 0u) {}
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        // AddPostings() sets the same bits as a call to AddPosting() for each
+        // term.
+        TEST(Shard, AddPostings)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto tokenManager = Factories::CreateTokenManager();
+
+            // Every adhoc term has two rank 0 rows and two rank 3 rows.
+            auto termTable = Factories::CreateTermTable();
+            const std::vector<Rank> recipe = { 0, 3, 0, 3 };
+            for (Term::IdfX10 idf = 0; idf <= Term::c_maxIdfX10Value; ++idf)
+            {
+                for (Term::GramSize gramSize = 0; gramSize <= Term::c_maxGramSize; ++gramSize)
+                {
+                    termTable->OpenTerm();
+                    for (auto rank : recipe)
+                    {
+                        termTable->AddRowId(RowId(0, rank, 0));
+                    }
+                    termTable->CloseAdhocTerm(idf, gramSize);
+                }
+            }
+            termTable->SetRowCounts(0, ITermTable::SystemTerm::Count, 500);
+            termTable->SetRowCounts(3, 0, 100);
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+            const size_t blockSize =
+                Shard::InitializeDescriptors(nullptr,
+                                             4096,
+                                             docDataSchema,
+                                             *termTable);
+            TrackingSliceBufferAllocator allocator(blockSize);
+            Shard shard(*recycler, *tokenManager, *termTable, docDataSchema, allocator, blockSize);
+
+            Slice expected(shard);
+            Slice actual(shard);
+
+            for (DocIndex doc = 0; doc < shard.GetSliceCapacity(); doc += 97)
+            {
+                std::vector<Term> terms;
+                for (unsigned i = 0; i < doc % 300; ++i)
+                {
+                    terms.push_back(Term(doc * 1000003 + i * 7919,
+                                         0,
+                                         static_cast<Term::IdfX10>(i % 60)));
+                }
+
+                for (auto const & term : terms)
+                {
+                    shard.AddPosting(term, doc, expected.GetSliceBuffer());
+                }
+                shard.AddPostings(terms.data(),
+                                  terms.size(),
+                                  doc,
+                                  actual.GetSliceBuffer());
+            }
+
+            EXPECT_EQ(0, memcmp(expected.GetSliceBuffer(),
+                                actual.GetSliceBuffer(),
+                                shard.GetSlicePtrOffset()));
+
+            tokenManager->Shutdown();
+        }
+
+
+        // With a rowAlignment of 32 or 64, every row starts on a multiple of
+        // rowAlignment bytes from the start of the slice buffer, and slice
+        // buffers are a multiple of rowAlignment bytes long.
+        TEST(Shard, RowAlignment)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto tokenManager = Factories::CreateTokenManager();
+
+            auto termTable = Factories::CreateTermTable();
+            termTable->SetRowCounts(0, ITermTable::SystemTerm::Count, 7);
+            termTable->SetRowCounts(3, 0, 5);
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            for (size_t alignment : { 32, 64 })
+            {
+                const size_t blockSize =
+                    GetMinimumBlockSize(docDataSchema, *termTable, alignment);
+                EXPECT_EQ(0u, blockSize % alignment);
+
+                TrackingSliceBufferAllocator allocator(blockSize);
+                Shard shard(*recycler,
+                            *tokenManager,
+                            *termTable,
+                            docDataSchema,
+                            allocator,
+                            blockSize,
+                            1,
+                            alignment);
+
+                for (Rank rank : { 0, 3 })
+                {
+                    const RowIndex rowCount = termTable->GetTotalRowCount(rank);
+                    for (RowIndex row = 0; row < rowCount; ++row)
+                    {
+                        const ptrdiff_t offset =
+                            shard.GetRowOffset(RowId(0, rank, row));
+                        EXPECT_EQ(0u, static_cast<size_t>(offset) % alignment);
+                    }
+                }
+            }
+
+            tokenManager->Shutdown();
+        }
     }
 }
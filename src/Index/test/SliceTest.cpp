@@ -20,14 +20,186 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IRecycler.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/Token.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "DocumentDataSchema.h"
+#include "Shard.h"
+#include "Slice.h"
+#include "TrackingSliceBufferAllocator.h"
+
 
 namespace BitFunnel
 {
-    // Most (all?) Slice functionality is tested via either ShardTest or
+    // Most Slice functionality is tested via either ShardTest or
     // DocumentHandleTest.
-    TEST(Slice, Placeholder)
+    namespace SliceTest
     {
+        // Many threads allocate, commit, and expire all of the documents in
+        // a series of Slices. Every DocIndex must be allocated exactly once,
+        // and exactly one thread must see the last commit and the last
+        // expiration of each Slice.
+        TEST(Slice, ConcurrentAccounting)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                Shard::InitializeDescriptors(nullptr,
+                                             4096,
+                                             docDataSchema,
+                                             *termTable);
+
+            TrackingSliceBufferAllocator allocator(blockSize);
+            Shard shard(*recycler, *tokenManager, *termTable, docDataSchema, allocator, blockSize);
+
+            const DocIndex capacity = shard.GetSliceCapacity();
+            ASSERT_GE(capacity, 4096u);
+
+            const size_t c_threadCount = 8;
+            const size_t c_sliceCount = 20;
+
+            for (size_t s = 0; s < c_sliceCount; ++s)
+            {
+                Slice slice(shard);
+
+                std::vector<std::atomic<unsigned>> allocations(capacity);
+                for (auto & count : allocations)
+                {
+                    count = 0;
+                }
+                std::atomic<unsigned> lastCommitCount(0);
+                std::atomic<unsigned> lastExpireCount(0);
+                std::atomic<size_t> committedCount(0);
+
+                std::vector<std::thread> threads;
+                for (size_t t = 0; t < c_threadCount; ++t)
+                {
+                    threads.emplace_back([&]()
+                    {
+                        // Allocate and commit until the Slice is full.
+                        std::vector<DocIndex> indexes;
+                        DocIndex index;
+                        while (slice.TryAllocateDocument(index))
+                        {
+                            ++allocations[index];
+                            indexes.push_back(index);
+                            if (slice.CommitDocument())
+                            {
+                                ++lastCommitCount;
+                            }
+                            ++committedCount;
+                        }
+
+                        // Wait for every document to be committed, then
+                        // expire the documents this thread allocated.
+                        while (committedCount != capacity)
+                        {
+                            std::this_thread::yield();
+                        }
+                        for (size_t i = 0; i < indexes.size(); ++i)
+                        {
+                            if (slice.ExpireDocument())
+                            {
+                                ++lastExpireCount;
+                            }
+                        }
+                    });
+                }
+                for (auto & thread : threads)
+                {
+                    thread.join();
+                }
+
+                for (DocIndex i = 0; i < capacity; ++i)
+                {
+                    ASSERT_EQ(1u, allocations[i]) << "DocIndex " << i;
+                }
+                EXPECT_EQ(1u, lastCommitCount);
+                EXPECT_EQ(1u, lastExpireCount);
+                EXPECT_TRUE(slice.IsExpired());
+
+                DocIndex index;
+                EXPECT_FALSE(slice.TryAllocateDocument(index));
+            }
+
+            EXPECT_EQ(0u, allocator.GetInUseBuffersCount());
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        // The last commit is reported only once the Slice is full.
+        TEST(Slice, LastCommit)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+            const size_t blockSize =
+                Shard::InitializeDescriptors(nullptr,
+                                             4096,
+                                             docDataSchema,
+                                             *termTable);
+            TrackingSliceBufferAllocator allocator(blockSize);
+            Shard shard(*recycler, *tokenManager, *termTable, docDataSchema, allocator, blockSize);
+
+            Slice slice(shard);
+            const DocIndex capacity = shard.GetSliceCapacity();
+
+            // Committing every allocated document of a partially full Slice
+            // is not the last commit.
+            DocIndex index;
+            ASSERT_TRUE(slice.TryAllocateDocument(index));
+            EXPECT_EQ(0u, index);
+            ASSERT_TRUE(slice.TryAllocateDocument(index));
+            EXPECT_EQ(1u, index);
+            EXPECT_FALSE(slice.CommitDocument());
+            EXPECT_FALSE(slice.CommitDocument());
+
+            for (DocIndex i = 2; i < capacity; ++i)
+            {
+                ASSERT_TRUE(slice.TryAllocateDocument(index));
+                EXPECT_EQ(i, index);
+            }
+            EXPECT_FALSE(slice.TryAllocateDocument(index));
+
+            for (DocIndex i = 2; i < capacity - 1; ++i)
+            {
+                EXPECT_FALSE(slice.CommitDocument());
+            }
+            EXPECT_TRUE(slice.CommitDocument());
+
+            for (DocIndex i = 0; i < capacity - 1; ++i)
+            {
+                EXPECT_FALSE(slice.ExpireDocument());
+                EXPECT_FALSE(slice.IsExpired());
+            }
+            EXPECT_TRUE(slice.ExpireDocument());
+            EXPECT_TRUE(slice.IsExpired());
+
+            tokenManager->Shutdown();
+        }
     }
 }
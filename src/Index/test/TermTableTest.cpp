@@ -20,11 +20,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <cstring>
+#include <fstream>
 #include <sstream>
 
 #include "gtest/gtest.h"
 
+#include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Utilities/StreamUtilities.h"
+#include "TemporaryFile.h"
 #include "TermTable.h"
 
 
@@ -430,9 +435,199 @@ namespace BitFunnel
         //
         //*********************************************************************
 
+        // Enough terms to fill many Buckets. The hashes are spread over the
+        // high bits, which select the Bucket.
+        const size_t c_roundTripTermCount = 1000;
+        const Term::Hash c_hashStep = 0x9e3779b97f4a7c15ull;
+
+
+        static void AddRoundTripTerms(TermTable & termTable)
+        {
+            const size_t explicitRowCount = 100;
+            const size_t adhocRowCount = 200;
+
+            for (size_t i = 0; i < c_roundTripTermCount; ++i)
+            {
+                termTable.OpenTerm();
+                for (size_t r = 0; r <= (i % 3); ++r)
+                {
+                    termTable.AddRowId(RowId(0, 0, (i + r) % explicitRowCount));
+                }
+                termTable.CloseTerm((i + 1) * c_hashStep);
+            }
+            termTable.SetRowCounts(0, explicitRowCount, adhocRowCount);
+            termTable.SetFactCount(0);
+            termTable.Seal();
+        }
+
+
+        static void VerifyRoundTripTerms(TermTable const & termTable)
+        {
+            for (size_t i = 0; i < c_roundTripTermCount; ++i)
+            {
+                Term term((i + 1) * c_hashStep, 0, 0);
+                PackedRowIdSequence rows = termTable.GetRows(term);
+                EXPECT_EQ(rows.GetType(), PackedRowIdSequence::Type::Explicit);
+                EXPECT_EQ(rows.GetEnd() - rows.GetStart(), (i % 3) + 1);
+            }
+
+            // Hashes that are not explicit terms use the adhoc recipes.
+            Term adhoc(c_hashStep / 2, 0, 0);
+            EXPECT_EQ(termTable.GetRows(adhoc).GetType(),
+                      PackedRowIdSequence::Type::Adhoc);
+        }
+
+
+        static void WriteFile(char const * path, std::string const & contents)
+        {
+            std::ofstream output(path, std::ios::binary);
+            output << contents;
+        }
+
+
         TEST(TermTable, RoundTrip)
         {
-            // TODO: Implement this test.
+            TermTable termTable;
+            AddRoundTripTerms(termTable);
+
+            std::stringstream stream;
+            termTable.Write(stream);
+
+            TermTable termTable2(stream);
+            EXPECT_EQ(termTable, termTable2);
+            VerifyRoundTripTerms(termTable2);
+
+            TemporaryFile file("TermTableTest");
+            WriteFile(file.GetPath(), stream.str());
+            {
+                TermTable termTable3(file.GetPath());
+                EXPECT_EQ(termTable, termTable3);
+                VerifyRoundTripTerms(termTable3);
+            }
+
+            // A file cut off in the Buckets is rejected.
+            WriteFile(file.GetPath(), stream.str().substr(0, 200));
+            EXPECT_THROW(TermTable termTable4(file.GetPath()), RecoverableError);
+        }
+
+
+        // The format written before TermTable had a header: a count of
+        // explicit terms, then (hash, PackedRowIdSequence) pairs, then the
+        // same fields that follow the Buckets in the current format.
+        TEST(TermTable, OldFormat)
+        {
+            TermTable termTable;
+            AddRoundTripTerms(termTable);
+
+            std::stringstream current;
+            termTable.Write(current);
+            const std::string image = current.str();
+
+            // The Header is 64 bytes, with the bucket count at offset 16, and
+            // each Bucket is 64 bytes.
+            uint64_t bucketCount;
+            memcpy(&bucketCount, &image[16], sizeof(bucketCount));
+            const size_t fieldsOffset = 64 + bucketCount * 64;
+
+            std::stringstream old;
+            StreamUtilities::WriteField<size_t>(old, 3 + c_roundTripTermCount);
+
+            // The explicit terms include the system terms, which the
+            // TermTable constructor gives the first three explicit rows.
+            // GetRows() does not return these entries, since it treats the
+            // lowest hashes as facts.
+            const Term::Hash systemTerms[] = {
+                ITermTable::SystemTerm::DocumentActive,
+                ITermTable::SystemTerm::MatchAll,
+                ITermTable::SystemTerm::MatchNone
+            };
+            for (size_t i = 0; i < 3; ++i)
+            {
+                StreamUtilities::WriteField<Term::Hash>(old, systemTerms[i]);
+                StreamUtilities::WriteField<PackedRowIdSequence>(
+                    old,
+                    PackedRowIdSequence(i, i + 1, PackedRowIdSequence::Type::Explicit));
+            }
+
+            for (size_t i = 0; i < c_roundTripTermCount; ++i)
+            {
+                const Term::Hash hash = (i + 1) * c_hashStep;
+                StreamUtilities::WriteField<Term::Hash>(old, hash);
+                StreamUtilities::WriteField<PackedRowIdSequence>(
+                    old,
+                    termTable.GetRows(Term(hash, 0, 0)));
+            }
+            old << image.substr(fieldsOffset);
+
+            TemporaryFile file("TermTableTest");
+            WriteFile(file.GetPath(), old.str());
+
+            TermTable termTable2(old);
+            EXPECT_EQ(termTable, termTable2);
+            VerifyRoundTripTerms(termTable2);
+
+            TermTable termTable3(file.GetPath());
+            EXPECT_EQ(termTable, termTable3);
+            VerifyRoundTripTerms(termTable3);
+        }
+
+
+        // Bucket counts are checked when a TermTable is loaded, since a
+        // probe relies on them to stay within the table and to terminate.
+        // Loading the image from a stream checks the Buckets and throws.
+        // Memory mapping the image checks only the Header, so lookups must
+        // still stay within the Buckets and terminate.
+        static void ExpectRejected(std::string const & image)
+        {
+            std::stringstream stream(image);
+            EXPECT_THROW(TermTable termTable(stream), RecoverableError);
+
+            TemporaryFile file("TermTableTest");
+            WriteFile(file.GetPath(), image);
+            TermTable termTable(file.GetPath());
+            for (size_t i = 0; i <= c_roundTripTermCount; ++i)
+            {
+                termTable.GetRows(Term(i * c_hashStep + 1, 0, 0));
+                termTable.GetRows(Term((i + 1) * c_hashStep, 0, 0));
+            }
+        }
+
+
+        // Bucket counts are checked when a TermTable is read from a stream.
+        // A memory mapped TermTable is not scanned, but its probes are
+        // bounded.
+        TEST(TermTable, CorruptBuckets)
+        {
+            TermTable termTable;
+            AddRoundTripTerms(termTable);
+
+            std::stringstream stream;
+            termTable.Write(stream);
+            std::string image = stream.str();
+
+            // The bucket count is at offset 16 of the 64 byte Header, and
+            // each Bucket's count is the last 4 bytes of its 64 bytes.
+            uint64_t bucketCount;
+            memcpy(&bucketCount, &image[16], sizeof(bucketCount));
+
+            // Gives the first Bucket more terms than a Bucket holds.
+            {
+                std::string corrupt = image;
+                const uint32_t count = TermTable::c_bucketEntryCount + 1;
+                memcpy(&corrupt[64 + 60], &count, sizeof(count));
+                ExpectRejected(corrupt);
+            }
+
+            // Fills every Bucket, so that no probe would end.
+            {
+                std::string corrupt = image;
+                const uint32_t count = TermTable::c_bucketEntryCount;
+                for (size_t i = 0; i < bucketCount; ++i)
+                {
+                    memcpy(&corrupt[64 + i * 64 + 60], &count, sizeof(count));
+                }
+                ExpectRejected(corrupt);
+            }
         }
     }
 }
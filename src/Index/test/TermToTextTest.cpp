@@ -21,6 +21,8 @@
 // THE SOFTWARE.
 
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -76,5 +78,135 @@ namespace BitFunnel
                 EXPECT_TRUE(expected.compare(observed) == 0);
             }
         }
+
+
+        // Phrases are recorded as links to their parts, which may themselves
+        // be phrases, and their text is built on lookup and on write.
+        TEST(TermToText, Phrases)
+        {
+            TermToText terms;
+            terms.AddTerm(1ull, "one");
+            terms.AddTerm(2ull, "two");
+            terms.AddPhrase(12ull, 1ull, 2ull);
+
+            // The parts of a phrase may be added after the phrase.
+            terms.AddPhrase(123ull, 12ull, 3ull);
+            terms.AddTerm(3ull, "three");
+
+            // Only the first mapping for a hash is recorded.
+            terms.AddPhrase(1ull, 2ull, 3ull);
+            terms.AddTerm(12ull, "twelve");
+
+            EXPECT_EQ("one", terms.Lookup(1ull));
+            EXPECT_EQ("one two", terms.Lookup(12ull));
+            EXPECT_EQ("one two three", terms.Lookup(123ull));
+            EXPECT_EQ("", terms.Lookup(4ull));
+
+            std::stringstream stream;
+            terms.Write(stream);
+            TermToText terms2(stream);
+            EXPECT_EQ("one two", terms2.Lookup(12ull));
+            EXPECT_EQ("one two three", terms2.Lookup(123ull));
+        }
+
+
+        // An empty term is not mistaken for a phrase, even when it is the
+        // first text in its shard. Its parts would be hash 0 twice.
+        TEST(TermToText, EmptyTerm)
+        {
+            TermToText terms;
+            terms.AddTerm(5ull, "");
+            terms.AddTerm(0ull, "zero");
+            terms.AddTerm(6ull, "six");
+
+            EXPECT_EQ("", terms.Lookup(5ull));
+            EXPECT_EQ("zero", terms.Lookup(0ull));
+            EXPECT_EQ("six", terms.Lookup(6ull));
+
+            terms.AddPhrase(56ull, 5ull, 6ull);
+            EXPECT_EQ(" six", terms.Lookup(56ull));
+        }
+
+
+        // Colliding hashes can make phrase links cyclic. Building the text
+        // of such a phrase must stop, while a phrase of Term::c_maxGramSize
+        // words is still built in full.
+        TEST(TermToText, CyclicPhrases)
+        {
+            const size_t maxGramSize = Term::c_maxGramSize;
+
+            TermToText terms;
+            terms.AddTerm(1ull, "one");
+            terms.AddPhrase(11ull, 11ull, 1ull);
+            terms.AddPhrase(22ull, 33ull, 1ull);
+            terms.AddPhrase(33ull, 22ull, 1ull);
+
+            auto wordCount = [](std::string const & text)
+            {
+                std::stringstream words(text);
+                std::string word;
+                size_t count = 0;
+                while (words >> word)
+                {
+                    ++count;
+                }
+                return count;
+            };
+
+            EXPECT_LE(wordCount(terms.Lookup(11ull)), maxGramSize);
+            EXPECT_LE(wordCount(terms.Lookup(22ull)), maxGramSize);
+
+            std::stringstream stream;
+            terms.Write(stream);
+
+            // Phrases are built from the left, as Term does.
+            std::string expected = "one";
+            Term::Hash phrase = 1ull;
+            for (size_t i = 1; i < maxGramSize; ++i)
+            {
+                terms.AddPhrase(100ull + i, phrase, 1ull);
+                phrase = 100ull + i;
+                expected += " one";
+            }
+            EXPECT_EQ(expected, terms.Lookup(phrase));
+        }
+
+
+        // Threads adding overlapping terms and phrases concurrently.
+        TEST(TermToText, Concurrent)
+        {
+            const size_t c_threadCount = 4;
+            const Term::Hash c_termCount = 10000;
+            const Term::Hash c_phraseBase = 1ull << 32;
+
+            TermToText terms;
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&terms]()
+                {
+                    for (Term::Hash hash = 0; hash < c_termCount; ++hash)
+                    {
+                        terms.AddTerm(hash, std::to_string(hash));
+                        if (hash > 0)
+                        {
+                            terms.AddPhrase(c_phraseBase + hash, hash - 1, hash);
+                            terms.Lookup(c_phraseBase + hash - 1);
+                        }
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            for (Term::Hash hash = 1; hash < c_termCount; ++hash)
+            {
+                EXPECT_EQ(std::to_string(hash), terms.Lookup(hash));
+                EXPECT_EQ(std::to_string(hash - 1) + " " + std::to_string(hash),
+                          terms.Lookup(c_phraseBase + hash));
+            }
+        }
     }
 }
@@ -0,0 +1,272 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <limits>
+
+#include "BitFunnel/Exceptions.h"
+#include "ByteCodeGenerator.h"
+#include "LoggerInterfaces/Logging.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ByteCodeGenerator::Instruction
+    //
+    //*************************************************************************
+    ByteCodeGenerator::Instruction::Instruction(Opcode opcode,
+                                                unsigned row,
+                                                int32_t value)
+        : m_opcode(opcode),
+          m_unused(0),
+          m_row(static_cast<uint16_t>(row)),
+          m_value(value)
+    {
+    }
+
+
+    //*************************************************************************
+    //
+    // ByteCodeGenerator
+    //
+    //*************************************************************************
+    const size_t ByteCodeGenerator::c_unplaced;
+
+
+    ByteCodeGenerator::ByteCodeGenerator()
+        : m_pushCount(0),
+          m_callCount(0),
+          m_sealed(false)
+    {
+    }
+
+
+    void ByteCodeGenerator::Seal()
+    {
+        LogAssertB(!m_sealed, "ByteCodeGenerator already sealed.");
+
+        Emit(EndOp, 0, 0);
+
+        for (auto & instruction : m_code)
+        {
+            switch (instruction.m_opcode)
+            {
+            case CallOp:
+            case JmpOp:
+            case JnzOp:
+            case JzOp:
+                {
+                    size_t target = m_labels[instruction.m_value];
+                    if (target == c_unplaced)
+                    {
+                        RecoverableError error("ByteCodeGenerator::Seal(): label never placed.");
+                        throw error;
+                    }
+                    instruction.m_value = static_cast<int32_t>(target);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        m_sealed = true;
+    }
+
+
+    std::vector<ByteCodeGenerator::Instruction> const &
+        ByteCodeGenerator::GetCode() const
+    {
+        LogAssertB(m_sealed, "ByteCodeGenerator not sealed.");
+        return m_code;
+    }
+
+
+    size_t ByteCodeGenerator::GetMaxStackDepth() const
+    {
+        // Plans never recurse and every Push is balanced by a Pop, AndStack,
+        // or OrStack, so the depth can never exceed the number of Push
+        // instructions.
+        return m_pushCount;
+    }
+
+
+    size_t ByteCodeGenerator::GetMaxCallDepth() const
+    {
+        return m_callCount;
+    }
+
+
+    //
+    // ICodeGenerator methods.
+    //
+    void ByteCodeGenerator::AndRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        EmitRow(inverted ? AndRowInvertedOp : AndRowOp, id, rankDelta);
+    }
+
+
+    void ByteCodeGenerator::LoadRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        EmitRow(inverted ? LoadRowInvertedOp : LoadRowOp, id, rankDelta);
+    }
+
+
+    void ByteCodeGenerator::LeftShiftOffset(size_t shift)
+    {
+        Emit(LeftShiftOffsetOp, 0, static_cast<int32_t>(shift));
+    }
+
+
+    void ByteCodeGenerator::RightShiftOffset(size_t shift)
+    {
+        Emit(RightShiftOffsetOp, 0, static_cast<int32_t>(shift));
+    }
+
+
+    void ByteCodeGenerator::IncrementOffset()
+    {
+        Emit(IncrementOffsetOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::Push()
+    {
+        ++m_pushCount;
+        Emit(PushOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::Pop()
+    {
+        Emit(PopOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::AndStack()
+    {
+        Emit(AndStackOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::Constant(int value)
+    {
+        Emit(ConstantOp, 0, value);
+    }
+
+
+    void ByteCodeGenerator::Not()
+    {
+        Emit(NotOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::OrStack()
+    {
+        Emit(OrStackOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::UpdateFlags()
+    {
+        // The interpreter tests the accumulator directly in Jz and Jnz, so
+        // there are no flags to update.
+    }
+
+
+    void ByteCodeGenerator::Report()
+    {
+        Emit(ReportOp, 0, 0);
+    }
+
+
+    ICodeGenerator::Label ByteCodeGenerator::AllocateLabel()
+    {
+        m_labels.push_back(c_unplaced);
+        return static_cast<Label>(m_labels.size() - 1);
+    }
+
+
+    void ByteCodeGenerator::PlaceLabel(Label label)
+    {
+        LogAssertB(label < m_labels.size(), "Label out of range.");
+        LogAssertB(m_labels[label] == c_unplaced, "Label placed twice.");
+        m_labels[label] = m_code.size();
+    }
+
+
+    void ByteCodeGenerator::Call(Label label)
+    {
+        ++m_callCount;
+        EmitJump(CallOp, label);
+    }
+
+
+    void ByteCodeGenerator::Jmp(Label label)
+    {
+        EmitJump(JmpOp, label);
+    }
+
+
+    void ByteCodeGenerator::Jnz(Label label)
+    {
+        EmitJump(JnzOp, label);
+    }
+
+
+    void ByteCodeGenerator::Jz(Label label)
+    {
+        EmitJump(JzOp, label);
+    }
+
+
+    void ByteCodeGenerator::Return()
+    {
+        Emit(ReturnOp, 0, 0);
+    }
+
+
+    void ByteCodeGenerator::Emit(Opcode opcode, size_t row, int32_t value)
+    {
+        LogAssertB(!m_sealed, "ByteCodeGenerator already sealed.");
+        m_code.emplace_back(opcode, static_cast<unsigned>(row), value);
+    }
+
+
+    void ByteCodeGenerator::EmitRow(Opcode opcode, size_t id, size_t rankDelta)
+    {
+        if (id > (std::numeric_limits<uint16_t>::max)())
+        {
+            RecoverableError error("ByteCodeGenerator: row id out of range.");
+            throw error;
+        }
+        Emit(opcode, id, static_cast<int32_t>(rankDelta));
+    }
+
+
+    void ByteCodeGenerator::EmitJump(Opcode opcode, Label label)
+    {
+        LogAssertB(label < m_labels.size(), "Label out of range.");
+        Emit(opcode, 0, static_cast<int32_t>(label));
+    }
+}
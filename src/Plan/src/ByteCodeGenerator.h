@@ -0,0 +1,148 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>                          // uint8_t, etc. members.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/ICodeGenerator.h"  // Inherits from ICodeGenerator.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ByteCodeGenerator is an ICodeGenerator that records the matching
+    // primitives as a compact array of Instructions for execution by the
+    // ByteCodeInterpreter.
+    //
+    // Labels are recorded during code generation and resolved to instruction
+    // indices by Seal(), which must be called before the code is executed.
+    //
+    //*************************************************************************
+    class ByteCodeGenerator : public ICodeGenerator, NonCopyable
+    {
+    public:
+        enum Opcode : uint8_t
+        {
+            AndRowOp,
+            AndRowInvertedOp,
+            LoadRowOp,
+            LoadRowInvertedOp,
+            LeftShiftOffsetOp,
+            RightShiftOffsetOp,
+            IncrementOffsetOp,
+            PushOp,
+            PopOp,
+            AndStackOp,
+            ConstantOp,
+            NotOp,
+            OrStackOp,
+            ReportOp,
+            CallOp,
+            JmpOp,
+            JnzOp,
+            JzOp,
+            ReturnOp,
+            EndOp
+        };
+
+
+        // Instructions are packed into eight bytes so that a typical plan
+        // fits in a handful of cache lines. For row instructions, m_row is
+        // the AbstractRow id and m_value is the rank delta. For shifts,
+        // m_value is the shift count. For control flow, m_value is the
+        // target label before Seal() and the target instruction index
+        // after.
+        class Instruction
+        {
+        public:
+            Instruction(Opcode opcode, unsigned row, int32_t value);
+
+            Opcode m_opcode;
+            uint8_t m_unused;
+            uint16_t m_row;
+            int32_t m_value;
+        };
+
+
+        ByteCodeGenerator();
+
+        // Resolves labels and appends the final End instruction. No
+        // primitives may be emitted after Seal().
+        void Seal();
+
+        // Returns the instructions. Valid only after Seal().
+        std::vector<Instruction> const & GetCode() const;
+
+        // Returns upper bounds on the depths of the value stack and call
+        // stack needed to execute the code.
+        size_t GetMaxStackDepth() const;
+        size_t GetMaxCallDepth() const;
+
+        //
+        // ICodeGenerator methods.
+        //
+        virtual void AndRow(size_t id, bool inverted, size_t rankDelta) override;
+        virtual void LoadRow(size_t id, bool inverted, size_t rankDelta) override;
+
+        virtual void LeftShiftOffset(size_t shift) override;
+        virtual void RightShiftOffset(size_t shift) override;
+        virtual void IncrementOffset() override;
+
+        virtual void Push() override;
+        virtual void Pop() override;
+
+        virtual void AndStack() override;
+        virtual void Constant(int value) override;
+        virtual void Not() override;
+        virtual void OrStack() override;
+        virtual void UpdateFlags() override;
+
+        virtual void Report() override;
+
+        virtual Label AllocateLabel() override;
+        virtual void PlaceLabel(Label label) override;
+        virtual void Call(Label label) override;
+        virtual void Jmp(Label label) override;
+        virtual void Jnz(Label label) override;
+        virtual void Jz(Label label) override;
+        virtual void Return() override;
+
+    private:
+        void Emit(Opcode opcode, size_t row, int32_t value);
+        void EmitRow(Opcode opcode, size_t id, size_t rankDelta);
+        void EmitJump(Opcode opcode, Label label);
+
+        std::vector<Instruction> m_code;
+
+        // Instruction index for each label, or c_unplaced.
+        std::vector<size_t> m_labels;
+        static const size_t c_unplaced = static_cast<size_t>(-1);
+
+        size_t m_pushCount;
+        size_t m_callCount;
+        bool m_sealed;
+    };
+}
@@ -0,0 +1,164 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "ByteCodeInterpreter.h"
+#include "LoggerInterfaces/Logging.h"
+
+
+namespace BitFunnel
+{
+    ByteCodeInterpreter::ByteCodeInterpreter(ByteCodeGenerator const & code)
+        : m_code(code.GetCode().data()),
+          m_resultsProcessor(nullptr),
+          m_rowOffsets(nullptr),
+          m_valueStack(code.GetMaxStackDepth() + 1),
+          m_callStack(code.GetMaxCallDepth() + 1)
+    {
+    }
+
+
+    void ByteCodeInterpreter::Run(char * const * sliceBuffers,
+                                  size_t sliceCount,
+                                  size_t iterationsPerSlice,
+                                  ptrdiff_t const * rowOffsets,
+                                  IResultsProcessor& resultsProcessor)
+    {
+        m_resultsProcessor = &resultsProcessor;
+        m_rowOffsets = rowOffsets;
+
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            char * const sliceBuffer = sliceBuffers[i];
+            for (size_t offset = 0; offset < iterationsPerSlice; ++offset)
+            {
+                RunOneIteration(sliceBuffer, offset);
+            }
+            if (resultsProcessor.FinishIteration(sliceBuffer))
+            {
+                break;
+            }
+        }
+    }
+
+
+    void ByteCodeInterpreter::RunOneIteration(char const * sliceBuffer,
+                                              size_t offset)
+    {
+        ByteCodeGenerator::Instruction const * ip = m_code;
+        uint64_t * sp = m_valueStack.data();
+        ByteCodeGenerator::Instruction const ** rp = m_callStack.data();
+        uint64_t accumulator = 0;
+
+        for (;;)
+        {
+            ByteCodeGenerator::Instruction const & instruction = *ip++;
+            switch (instruction.m_opcode)
+            {
+            case ByteCodeGenerator::AndRowOp:
+                accumulator &= *reinterpret_cast<uint64_t const *>(
+                    sliceBuffer
+                    + m_rowOffsets[instruction.m_row]
+                    + ((offset >> instruction.m_value) << 3));
+                break;
+            case ByteCodeGenerator::AndRowInvertedOp:
+                accumulator &= ~*reinterpret_cast<uint64_t const *>(
+                    sliceBuffer
+                    + m_rowOffsets[instruction.m_row]
+                    + ((offset >> instruction.m_value) << 3));
+                break;
+            case ByteCodeGenerator::LoadRowOp:
+                accumulator = *reinterpret_cast<uint64_t const *>(
+                    sliceBuffer
+                    + m_rowOffsets[instruction.m_row]
+                    + ((offset >> instruction.m_value) << 3));
+                break;
+            case ByteCodeGenerator::LoadRowInvertedOp:
+                accumulator = ~*reinterpret_cast<uint64_t const *>(
+                    sliceBuffer
+                    + m_rowOffsets[instruction.m_row]
+                    + ((offset >> instruction.m_value) << 3));
+                break;
+            case ByteCodeGenerator::LeftShiftOffsetOp:
+                offset <<= instruction.m_value;
+                break;
+            case ByteCodeGenerator::RightShiftOffsetOp:
+                offset >>= instruction.m_value;
+                break;
+            case ByteCodeGenerator::IncrementOffsetOp:
+                ++offset;
+                break;
+            case ByteCodeGenerator::PushOp:
+                *sp++ = accumulator;
+                break;
+            case ByteCodeGenerator::PopOp:
+                accumulator = *--sp;
+                break;
+            case ByteCodeGenerator::AndStackOp:
+                accumulator &= *--sp;
+                break;
+            case ByteCodeGenerator::ConstantOp:
+                accumulator =
+                    static_cast<uint64_t>(static_cast<int64_t>(instruction.m_value));
+                break;
+            case ByteCodeGenerator::NotOp:
+                accumulator = ~accumulator;
+                break;
+            case ByteCodeGenerator::OrStackOp:
+                accumulator |= *--sp;
+                break;
+            case ByteCodeGenerator::ReportOp:
+                if (accumulator != 0)
+                {
+                    m_resultsProcessor->AddResult(accumulator, offset);
+                }
+                break;
+            case ByteCodeGenerator::CallOp:
+                *rp++ = ip;
+                ip = m_code + instruction.m_value;
+                break;
+            case ByteCodeGenerator::JmpOp:
+                ip = m_code + instruction.m_value;
+                break;
+            case ByteCodeGenerator::JnzOp:
+                if (accumulator != 0)
+                {
+                    ip = m_code + instruction.m_value;
+                }
+                break;
+            case ByteCodeGenerator::JzOp:
+                if (accumulator == 0)
+                {
+                    ip = m_code + instruction.m_value;
+                }
+                break;
+            case ByteCodeGenerator::ReturnOp:
+                ip = *--rp;
+                break;
+            case ByteCodeGenerator::EndOp:
+                return;
+            default:
+                LogAbortB("ByteCodeInterpreter: bad opcode.");
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // ptrdiff_t, size_t members.
+#include <cstdint>                          // uint64_t members.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "ByteCodeGenerator.h"              // ByteCodeGenerator::Instruction member.
+
+
+namespace BitFunnel
+{
+    class IResultsProcessor;
+
+    //*************************************************************************
+    //
+    // ByteCodeInterpreter executes the code recorded by a ByteCodeGenerator
+    // against the slice buffers of a single shard.
+    //
+    // The plan is run once for each quadword at the plan's initial rank, in
+    // each slice. Rows are located by adding the row's offset, from the
+    // rowOffsets array indexed by AbstractRow id, to the start of the slice
+    // buffer. Results are delivered to an IResultsProcessor, which is
+    // notified after the last quadword of each slice.
+    //
+    // DESIGN NOTE: Dispatch is a single switch statement over eight byte
+    // instructions, and the value and call stacks are preallocated to the
+    // depths reported by the ByteCodeGenerator, so the inner loop performs
+    // no allocations and touches only the code, the stacks, and the rows.
+    // The stacks are allocated once, in the constructor, so an interpreter
+    // can be kept and Run() on many ranges of slices without allocating.
+    //
+    //*************************************************************************
+    class ByteCodeInterpreter : NonCopyable
+    {
+    public:
+        // The code must remain valid for the lifetime of the interpreter.
+        ByteCodeInterpreter(ByteCodeGenerator const & code);
+
+        // Runs the plan over every slice, or until the resultsProcessor
+        // requests termination. The rowOffsets array is indexed by
+        // AbstractRow id. The caller must hold a Token to prevent the slice
+        // buffers from being recycled.
+        void Run(char * const * sliceBuffers,
+                 size_t sliceCount,
+                 size_t iterationsPerSlice,
+                 ptrdiff_t const * rowOffsets,
+                 IResultsProcessor& resultsProcessor);
+
+    private:
+        // Runs the plan for the quadword at the specified offset in the
+        // slice.
+        void RunOneIteration(char const * sliceBuffer, size_t offset);
+
+        ByteCodeGenerator::Instruction const * m_code;
+
+        // Parameters of the current call to Run().
+        IResultsProcessor* m_resultsProcessor;
+        ptrdiff_t const * m_rowOffsets;
+
+        std::vector<uint64_t> m_valueStack;
+        std::vector<ByteCodeGenerator::Instruction const *> m_callStack;
+    };
+}
@@ -158,13 +158,34 @@ namespace BitFunnel
         formatter.OpenObjectField(c_childrenFieldName);
         formatter.OpenList();
 
-        FormatList(*this, formatter);
+        FormatChild(GetLeft(), formatter);
+        FormatChild(GetRight(), formatter);
 
         formatter.CloseList();
         formatter.CloseObject();
     }
 
 
+    void CompileNode::Binary::FormatChild(CompileNode const & child,
+                                          IObjectFormatter& formatter) const
+    {
+        // DESIGN NOTE: FormatList() can't be used here because it would
+        // flatten any Binary child, merging an OrTree under an AndTree into
+        // the AndTree's list.
+        if (child.GetType() == GetType())
+        {
+            Binary const & binary = dynamic_cast<Binary const &>(child);
+            binary.FormatChild(binary.GetLeft(), formatter);
+            binary.FormatChild(binary.GetRight(), formatter);
+        }
+        else
+        {
+            formatter.OpenListItem();
+            child.Format(formatter);
+        }
+    }
+
+
     void CompileNode::Binary::Compile(ICodeGenerator & /*codeGenerator*/) const
     {
     }
@@ -122,6 +122,11 @@ namespace BitFunnel
         static char const * c_childrenFieldName;
 
     private:
+        // Formats a child as one or more list items. Chains of the same
+        // binary operator are flattened into a single list.
+        void FormatChild(CompileNode const & child,
+                         IObjectFormatter& formatter) const;
+
         // WARNING: The persistence format depends on the order in which the
         // following two members are declared. If the order is changed, it is
         // neccesary to update the corresponding code in the constructor and
@@ -0,0 +1,192 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Plan/QueryPipeline.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "CompiledQuery.h"
+#include "CompileNode.h"
+#include "ConjunctionMatcher.h"
+#include "MatchTreeRewriter.h"
+#include "NativeCodeGenerator.h"
+#include "RankDownCompiler.h"
+#include "TermPlanConverter.h"
+
+
+namespace BitFunnel
+{
+    static std::vector<uint64_t> GetTermTableGenerations(IIngestor const & ingestor)
+    {
+        std::vector<uint64_t> generations;
+        for (ShardId shardId = 0; shardId < ingestor.GetShardCount(); ++shardId)
+        {
+            generations.push_back(
+                ingestor.GetShard(shardId).GetTermTableGeneration());
+        }
+        return generations;
+    }
+
+
+    CompiledQuery::CompiledQuery(TermMatchNode const & query,
+                                 IIngestor const & ingestor,
+                                 IConfiguration const & configuration,
+                                 bool useNativeCode,
+                                 IAllocator & allocator)
+      : m_ingestor(ingestor),
+        m_termTableGenerations(GetTermTableGenerations(ingestor)),
+        m_planRows(ingestor),
+        m_isConjunction(false)
+    {
+        RowMatchNode const & rowPlan =
+            TermPlanConverter::BuildRowPlan(query,
+                                            configuration,
+                                            m_planRows,
+                                            allocator);
+
+        RowMatchNode const & rewritten =
+            MatchTreeRewriter::Rewrite(rowPlan,
+                                       QueryPipeline::c_targetRowCount,
+                                       QueryPipeline::c_targetCrossProductTermCount,
+                                       allocator);
+
+        CompileNode const * compileTree = nullptr;
+        Rank initialRank = 0;
+
+        m_isConjunction = ConjunctionMatcher::GetRows(rewritten, m_conjunction);
+        if (!m_isConjunction)
+        {
+            RankDownCompiler compiler(allocator);
+            compileTree = &compiler.Compile(rewritten);
+            initialRank = compiler.GetInitialRank();
+
+            if (!useNativeCode)
+            {
+                compileTree->Compile(m_byteCode);
+                m_byteCode.Seal();
+            }
+        }
+
+        for (ShardId shardId = 0; shardId < ingestor.GetShardCount(); ++shardId)
+        {
+            IShard & shard = ingestor.GetShard(shardId);
+
+            std::unique_ptr<ShardPlan> plan(new ShardPlan());
+            plan->m_rowOffsets.resize(m_planRows.GetRowCount());
+            plan->m_quadwordsPerSlice = 0;
+            plan->m_iterationsPerSlice =
+                shard.GetSliceCapacity() >> (6 + initialRank);
+
+            for (unsigned id = 0; id < plan->m_rowOffsets.size(); ++id)
+            {
+                RowId const & row = m_planRows.PhysicalRow(shardId, id);
+                plan->m_rowOffsets[id] = shard.GetRowOffset(row);
+                plan->m_quadwordsPerSlice +=
+                    shard.GetSliceCapacity() >> (6 + row.GetRank());
+            }
+
+            if (compileTree != nullptr && useNativeCode)
+            {
+                plan->m_nativeCode.reset(
+                    new NativeCodeGenerator(plan->m_rowOffsets.data(),
+                                            plan->m_rowOffsets.size(),
+                                            plan->m_iterationsPerSlice));
+                compileTree->Compile(*plan->m_nativeCode);
+                plan->m_nativeCode->Seal();
+            }
+
+            m_shards.push_back(std::move(plan));
+        }
+    }
+
+
+    CompiledQuery::~CompiledQuery()
+    {
+    }
+
+
+    std::vector<AbstractRow> const * CompiledQuery::GetConjunction() const
+    {
+        return m_isConjunction ? &m_conjunction : nullptr;
+    }
+
+
+    ByteCodeGenerator const & CompiledQuery::GetByteCode() const
+    {
+        return m_byteCode;
+    }
+
+
+    unsigned CompiledQuery::GetRowCount() const
+    {
+        return m_planRows.GetRowCount();
+    }
+
+
+    SliceMatcher::ShardContext
+        CompiledQuery::GetShardContext(ShardId shardId,
+                                       std::vector<void*> const & sliceBuffers) const
+    {
+        IShard & shard = m_ingestor.GetShard(shardId);
+        ShardPlan const & plan = *m_shards[shardId];
+
+        SliceMatcher::ShardContext context;
+        context.m_shard = &shard;
+        context.m_sliceBuffers =
+            reinterpret_cast<char * const *>(sliceBuffers.data());
+        context.m_sliceCount = sliceBuffers.size();
+        context.m_rowOffsets = plan.m_rowOffsets.data();
+        context.m_iterationsPerSlice = plan.m_iterationsPerSlice;
+        context.m_nativeCode = plan.m_nativeCode.get();
+
+        return context;
+    }
+
+
+    size_t CompiledQuery::GetQuadwordCount(ShardId shardId,
+                                           size_t sliceCount) const
+    {
+        return sliceCount * m_shards[shardId]->m_quadwordsPerSlice;
+    }
+
+
+    bool CompiledQuery::IsCurrent(IIngestor const & ingestor) const
+    {
+        if (&ingestor != &m_ingestor ||
+            ingestor.GetShardCount() != m_termTableGenerations.size())
+        {
+            return false;
+        }
+
+        for (ShardId shardId = 0; shardId < m_termTableGenerations.size(); ++shardId)
+        {
+            if (ingestor.GetShard(shardId).GetTermTableGeneration() !=
+                m_termTableGenerations[shardId])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
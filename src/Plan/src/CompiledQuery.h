@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // ptrdiff_t, size_t members.
+#include <cstdint>                          // uint64_t template parameter.
+#include <memory>                           // std::unique_ptr member.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/BitFunnelTypes.h"       // ShardId parameter.
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/AbstractRow.h"     // AbstractRow parameterizes std::vector.
+#include "ByteCodeGenerator.h"              // ByteCodeGenerator member.
+#include "PlanRows.h"                       // PlanRows member.
+#include "SliceMatcher.h"                   // SliceMatcher::ShardContext return value.
+
+
+namespace BitFunnel
+{
+    class IAllocator;
+    class IConfiguration;
+    class IIngestor;
+    class NativeCodeGenerator;
+    class TermMatchNode;
+
+    //*************************************************************************
+    //
+    // CompiledQuery holds a query that has been planned, rewritten, and
+    // compiled for matching, along with the per-shard state that the
+    // SliceMatchers need in order to run it.
+    //
+    // Plans that satisfy ConjunctionMatcher::IsConjunction() are not
+    // compiled. Otherwise the plan is compiled to byte code once, or to
+    // native code once for each shard, since native code embeds the row
+    // offsets.
+    //
+    // A CompiledQuery does not change after construction, so it may be
+    // shared by several threads and cached across calls to Match(). It
+    // remains valid as long as each shard's TermTable generation is the one
+    // it had when the query was compiled.
+    //
+    //*************************************************************************
+    class CompiledQuery : NonCopyable
+    {
+    public:
+        // The allocator holds the intermediate plan trees and may be reset
+        // once the constructor returns.
+        CompiledQuery(TermMatchNode const & query,
+                      IIngestor const & ingestor,
+                      IConfiguration const & configuration,
+                      bool useNativeCode,
+                      IAllocator & allocator);
+
+        ~CompiledQuery();
+
+        // Returns the rows of the plan if it is a conjunction, and nullptr
+        // otherwise.
+        std::vector<AbstractRow> const * GetConjunction() const;
+
+        // Returns the byte code. The byte code is empty for conjunctions and
+        // when using native code.
+        ByteCodeGenerator const & GetByteCode() const;
+
+        // Returns the number of rows in the plan.
+        unsigned GetRowCount() const;
+
+        // Returns the context for running the query against sliceBuffers,
+        // a snapshot of the specified shard's slice buffers. The caller
+        // must hold a Token for as long as the context is in use.
+        SliceMatcher::ShardContext
+            GetShardContext(ShardId shardId,
+                            std::vector<void*> const & sliceBuffers) const;
+
+        // Returns the number of quadwords in the plan rows, summed over
+        // sliceCount slices of the specified shard.
+        size_t GetQuadwordCount(ShardId shardId, size_t sliceCount) const;
+
+        // Returns true if the query was compiled against ingestor and each
+        // of its shards still has the TermTable generation it had at compile
+        // time.
+        bool IsCurrent(IIngestor const & ingestor) const;
+
+    private:
+        class ShardPlan
+        {
+        public:
+            std::vector<ptrdiff_t> m_rowOffsets;
+            size_t m_quadwordsPerSlice;
+            size_t m_iterationsPerSlice;
+            std::unique_ptr<NativeCodeGenerator> m_nativeCode;
+        };
+
+        IIngestor const & m_ingestor;
+
+        // Recorded before m_planRows consults the TermTables, so that a
+        // TermTable replaced during compilation leaves the query stale.
+        std::vector<uint64_t> m_termTableGenerations;
+
+        PlanRows m_planRows;
+        bool m_isConjunction;
+        std::vector<AbstractRow> m_conjunction;
+        ByteCodeGenerator m_byteCode;
+
+        std::vector<std::unique_ptr<ShardPlan>> m_shards;
+    };
+}
@@ -0,0 +1,141 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "ConjunctionMatcher.h"
+#include "LoggerInterfaces/Logging.h"
+#include "RowKernel.h"
+
+
+namespace BitFunnel
+{
+    ConjunctionMatcher::ConjunctionMatcher(std::vector<AbstractRow> const & rows,
+                                           RowKernel const & kernel)
+        : m_kernel(kernel),
+          m_abstractRows(rows)
+    {
+        LogAssertB(!m_abstractRows.empty(),
+                   "ConjunctionMatcher: expected a conjunction.");
+
+        m_inverted.reset(new bool[m_abstractRows.size()]);
+        for (size_t i = 0; i < m_abstractRows.size(); ++i)
+        {
+            m_inverted[i] = m_abstractRows[i].IsInverted();
+        }
+        m_rows.resize(m_abstractRows.size());
+    }
+
+
+    bool ConjunctionMatcher::IsConjunction(RowMatchNode const & root)
+    {
+        std::vector<AbstractRow> rows;
+        return GetRows(root, rows);
+    }
+
+
+    bool ConjunctionMatcher::GetRows(RowMatchNode const & root,
+                                     std::vector<AbstractRow> & rows)
+    {
+        rows.clear();
+        return CollectRows(root, rows) == 1 && !rows.empty();
+    }
+
+
+    void ConjunctionMatcher::Run(char * const * sliceBuffers,
+                                 size_t sliceCount,
+                                 size_t qwordsPerSlice,
+                                 ptrdiff_t const * rowOffsets,
+                                 IResultsProcessor& resultsProcessor)
+    {
+        // Pad the bitmap so that it can start on a vector boundary, which
+        // lets the RowKernel use aligned loads and stores on aligned rows.
+        const size_t alignment = m_kernel.GetAlignment();
+        m_bitmap.resize(qwordsPerSlice + alignment / sizeof(uint64_t));
+        const uintptr_t address = reinterpret_cast<uintptr_t>(m_bitmap.data());
+        uint64_t * const bitmap = m_bitmap.data() +
+            (((alignment - address % alignment) % alignment) / sizeof(uint64_t));
+
+        for (size_t slice = 0; slice < sliceCount; ++slice)
+        {
+            char * const sliceBuffer = sliceBuffers[slice];
+            for (size_t i = 0; i < m_abstractRows.size(); ++i)
+            {
+                m_rows[i] = reinterpret_cast<uint64_t const *>(
+                    sliceBuffer + rowOffsets[m_abstractRows[i].GetId()]);
+            }
+
+            const size_t matchCount = m_kernel.And(m_rows.data(),
+                                                   m_inverted.get(),
+                                                   m_rows.size(),
+                                                   qwordsPerSlice,
+                                                   bitmap);
+            if (matchCount > 0)
+            {
+                for (size_t offset = 0; offset < qwordsPerSlice; ++offset)
+                {
+                    if (bitmap[offset] != 0)
+                    {
+                        resultsProcessor.AddResult(bitmap[offset], offset);
+                    }
+                }
+            }
+
+            if (resultsProcessor.FinishIteration(sliceBuffer))
+            {
+                break;
+            }
+        }
+    }
+
+
+    int ConjunctionMatcher::CollectRows(RowMatchNode const & node,
+                                        std::vector<AbstractRow> & rows)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                const int left = CollectRows(andNode.GetLeft(), rows);
+                const int right = CollectRows(andNode.GetRight(), rows);
+                return (left < 0 || right < 0) ? -1 : left + right;
+            }
+        case RowMatchNode::RowMatch:
+            {
+                AbstractRow const & row =
+                    dynamic_cast<RowMatchNode::Row const &>(node).GetRow();
+                if (row.GetRank() != 0 || row.GetRankDelta() != 0)
+                {
+                    return -1;
+                }
+                rows.push_back(row);
+                return 0;
+            }
+        case RowMatchNode::ReportMatch:
+            return (dynamic_cast<RowMatchNode::Report const &>(node).GetChild() == nullptr) ? 1 : -1;
+        default:
+            return -1;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // ptrdiff_t, size_t parameters.
+#include <cstdint>                          // uint64_t parameterizes std::vector.
+#include <memory>                           // std::unique_ptr member.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/AbstractRow.h"     // AbstractRow parameterizes std::vector.
+
+
+namespace BitFunnel
+{
+    class IResultsProcessor;
+    class RowKernel;
+    class RowMatchNode;
+
+    //*************************************************************************
+    //
+    // ConjunctionMatcher matches plans that are a simple and-expression of
+    // rank zero rows by intersecting entire rows with a RowKernel, instead
+    // of running the RankDown plan one quadword at a time.
+    //
+    // Use GetRows() to determine whether a rewritten RowMatchNode tree can be
+    // handled by the ConjunctionMatcher, and to extract its rows.
+    //
+    //*************************************************************************
+    class ConjunctionMatcher : NonCopyable
+    {
+    public:
+        // The rows must have been extracted from a conjunction by GetRows().
+        ConjunctionMatcher(std::vector<AbstractRow> const & rows,
+                           RowKernel const & kernel);
+
+        // Returns true if the tree consists only of And nodes, rank zero
+        // rows, and a single Report with no child.
+        static bool IsConjunction(RowMatchNode const & root);
+
+        // If the tree satisfies IsConjunction(), replaces the contents of
+        // rows with the tree's rows and returns true. Otherwise returns
+        // false.
+        static bool GetRows(RowMatchNode const & root,
+                            std::vector<AbstractRow> & rows);
+
+        // Intersects the rows in each slice and passes non-zero quadwords to
+        // the resultsProcessor, stopping early if the resultsProcessor
+        // requests termination. The rowOffsets array is indexed by
+        // AbstractRow id. The caller must hold a Token to prevent the slice
+        // buffers from being recycled.
+        void Run(char * const * sliceBuffers,
+                 size_t sliceCount,
+                 size_t qwordsPerSlice,
+                 ptrdiff_t const * rowOffsets,
+                 IResultsProcessor& resultsProcessor);
+
+    private:
+        // Appends the rows in the tree to rows. Returns the number of Report
+        // nodes, or -1 if the tree is not a conjunction.
+        static int CollectRows(RowMatchNode const & node,
+                               std::vector<AbstractRow> & rows);
+
+        RowKernel const & m_kernel;
+
+        std::vector<AbstractRow> m_abstractRows;
+        std::unique_ptr<bool[]> m_inverted;
+
+        std::vector<uint64_t const *> m_rows;
+        std::vector<uint64_t> m_bitmap;
+    };
+}
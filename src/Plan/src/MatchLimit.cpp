@@ -0,0 +1,62 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "MatchLimit.h"
+
+
+namespace BitFunnel
+{
+    MatchLimit::MatchLimit(size_t maxMatches, double maxSeconds)
+        : m_maxMatches(maxMatches),
+          m_hasDeadline(maxSeconds > 0.0),
+          m_deadline(std::chrono::steady_clock::now() +
+                     std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(m_hasDeadline ? maxSeconds : 0.0))),
+          m_matchCount(0),
+          m_isExhausted(false)
+    {
+    }
+
+
+    bool MatchLimit::Add(size_t matchCount)
+    {
+        const size_t total = (m_matchCount += matchCount);
+        if (total >= m_maxMatches ||
+            (m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline))
+        {
+            m_isExhausted = true;
+        }
+        return m_isExhausted;
+    }
+
+
+    bool MatchLimit::IsExhausted() const
+    {
+        return m_isExhausted;
+    }
+
+
+    size_t MatchLimit::GetMaxMatches() const
+    {
+        return m_maxMatches;
+    }
+}
@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <atomic>                   // std::atomic member.
+#include <chrono>                   // std::chrono::steady_clock member.
+#include <cstddef>                  // size_t parameter.
+
+#include "BitFunnel/NonCopyable.h"  // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MatchLimit tracks a query's result budget: a maximum number of matches
+    // and an optional deadline. The ResultsProcessors for a query share one
+    // MatchLimit, possibly across threads, and report the number of matches
+    // found in each slice. Once either limit is reached, the MatchLimit is
+    // exhausted and the matchers stop scanning.
+    //
+    //*************************************************************************
+    class MatchLimit : NonCopyable
+    {
+    public:
+        // A maxSeconds of zero or less means there is no deadline. The
+        // deadline is measured from construction.
+        MatchLimit(size_t maxMatches, double maxSeconds);
+
+        // Records matchCount new matches and checks the deadline. Returns
+        // true if the budget is exhausted.
+        bool Add(size_t matchCount);
+
+        bool IsExhausted() const;
+
+        size_t GetMaxMatches() const;
+
+    private:
+        const size_t m_maxMatches;
+        const bool m_hasDeadline;
+        const std::chrono::steady_clock::time_point m_deadline;
+
+        std::atomic<size_t> m_matchCount;
+        std::atomic<bool> m_isExhausted;
+    };
+}
@@ -0,0 +1,530 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>                        // std::max.
+#include <cstring>                          // memcpy.
+#include <limits>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "LoggerInterfaces/Logging.h"
+#include "NativeCodeGenerator.h"
+
+#if !defined(BITFUNNEL_PLATFORM_WINDOWS) && defined(__x86_64__)
+#define BITFUNNEL_NATIVE_CODE
+#include <sys/mman.h>  // For mmap/mprotect/munmap.
+#endif
+
+
+namespace BitFunnel
+{
+    // x86-64 register numbers.
+    static const unsigned c_rax = 0;
+    static const unsigned c_rcx = 1;
+    static const unsigned c_r13 = 13;
+
+    // Opcodes for "op r64, r/m64".
+    static const uint8_t c_mov = 0x8B;
+    static const uint8_t c_and = 0x23;
+
+
+    const size_t NativeCodeGenerator::c_unplaced;
+
+
+    NativeCodeGenerator::NativeCodeGenerator(ptrdiff_t const * rowOffsets,
+                                             size_t rowCount,
+                                             size_t iterationsPerSlice)
+        : m_rowOffsets(rowOffsets),
+          m_rowCount(rowCount),
+          m_iterationsPerSlice(iterationsPerSlice),
+          m_sliceLoop(0),
+          m_iterationLoop(0),
+          m_emptyBranch(0),
+          m_reportCount(0),
+          m_shift(0),
+          m_maxShift(0),
+          m_executable(nullptr),
+          m_executableSize(0)
+    {
+        if (!IsSupported())
+        {
+            RecoverableError error("NativeCodeGenerator: not supported on this platform.");
+            throw error;
+        }
+
+        if (iterationsPerSlice == 0 ||
+            iterationsPerSlice > (std::numeric_limits<int32_t>::max)())
+        {
+            RecoverableError error("NativeCodeGenerator: bad iterations per slice.");
+            throw error;
+        }
+
+        EmitPrologue();
+    }
+
+
+    NativeCodeGenerator::~NativeCodeGenerator()
+    {
+#ifdef BITFUNNEL_NATIVE_CODE
+        if (m_executable != nullptr)
+        {
+            munmap(m_executable, m_executableSize);
+        }
+#endif
+    }
+
+
+    bool NativeCodeGenerator::IsSupported()
+    {
+#ifdef BITFUNNEL_NATIVE_CODE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+
+    void NativeCodeGenerator::Seal()
+    {
+        LogAssertB(m_executable == nullptr, "NativeCodeGenerator already sealed.");
+
+        EmitEpilogue();
+
+        for (auto const & fixup : m_fixups)
+        {
+            const size_t target = m_labels[fixup.second];
+            if (target == c_unplaced)
+            {
+                RecoverableError error("NativeCodeGenerator::Seal(): label never placed.");
+                throw error;
+            }
+            Patch32(fixup.first, target);
+        }
+
+#ifdef BITFUNNEL_NATIVE_CODE
+        // Write the code into read/write pages, then make them read/execute
+        // so that the pages are never writable and executable at once.
+        m_executableSize = m_code.size();
+        void * buffer = mmap(nullptr,
+                             m_executableSize,
+                             PROT_READ | PROT_WRITE,
+                             MAP_ANON | MAP_PRIVATE,
+                             -1,  // No file descriptor.
+                             0);
+        if (buffer == MAP_FAILED)
+        {
+            FatalError error("NativeCodeGenerator: mmap failed.");
+            throw error;
+        }
+
+        memcpy(buffer, m_code.data(), m_code.size());
+
+        if (mprotect(buffer, m_executableSize, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(buffer, m_executableSize);
+            FatalError error("NativeCodeGenerator: mprotect failed.");
+            throw error;
+        }
+
+        m_executable = buffer;
+#endif
+    }
+
+
+    void NativeCodeGenerator::Run(char * const * sliceBuffers,
+                                  size_t sliceCount,
+                                  IResultsProcessor& resultsProcessor) const
+    {
+        std::vector<uint64_t> results;
+        Run(sliceBuffers, sliceCount, resultsProcessor, results);
+    }
+
+
+    void NativeCodeGenerator::Run(char * const * sliceBuffers,
+                                  size_t sliceCount,
+                                  IResultsProcessor& resultsProcessor,
+                                  std::vector<uint64_t>& results) const
+    {
+        LogAssertB(m_executable != nullptr, "NativeCodeGenerator not sealed.");
+
+        // Each Report executes at most once per rank zero quadword.
+        const size_t maxResults =
+            (m_iterationsPerSlice << m_maxShift) * m_reportCount;
+        const size_t resultsSize = (std::max)(maxResults, size_t(1)) * 2;
+        if (results.size() < resultsSize)
+        {
+            results.resize(resultsSize);
+        }
+
+        Context context;
+        context.m_results = results.data();
+        context.m_finishSlice = &FinishSlice;
+        context.m_resultsProcessor = &resultsProcessor;
+        context.m_sliceBuffers = sliceBuffers;
+
+        Function function = reinterpret_cast<Function>(m_executable);
+        function(sliceBuffers, sliceCount, &context);
+
+        if (context.m_exception)
+        {
+            std::rethrow_exception(context.m_exception);
+        }
+    }
+
+
+    size_t NativeCodeGenerator::GetCodeSize() const
+    {
+        return m_code.size();
+    }
+
+
+    bool NativeCodeGenerator::FinishSlice(Context & context,
+                                          size_t slice,
+                                          size_t resultCount) noexcept
+    {
+        try
+        {
+            IResultsProcessor & resultsProcessor = *context.m_resultsProcessor;
+            uint64_t const * results = context.m_results;
+            for (size_t i = 0; i < resultCount; ++i)
+            {
+                resultsProcessor.AddResult(results[2 * i + 1],
+                                           static_cast<size_t>(results[2 * i]));
+            }
+            return resultsProcessor.FinishIteration(context.m_sliceBuffers[slice]);
+        }
+        catch (...)
+        {
+            context.m_exception = std::current_exception();
+            return true;
+        }
+    }
+
+
+    //
+    // ICodeGenerator methods.
+    //
+    void NativeCodeGenerator::AndRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        if (inverted)
+        {
+            EmitRowOperation(c_mov, c_rcx, id, rankDelta);
+            Emit({ 0x48, 0xF7, 0xD1 });         // not rcx
+            Emit({ 0x48, 0x21, 0xC8 });         // and rax, rcx
+        }
+        else
+        {
+            EmitRowOperation(c_and, c_rax, id, rankDelta);
+        }
+    }
+
+
+    void NativeCodeGenerator::LoadRow(size_t id, bool inverted, size_t rankDelta)
+    {
+        EmitRowOperation(c_mov, c_rax, id, rankDelta);
+        if (inverted)
+        {
+            Emit({ 0x48, 0xF7, 0xD0 });         // not rax
+        }
+    }
+
+
+    void NativeCodeGenerator::LeftShiftOffset(size_t shift)
+    {
+        LogAssertB(shift < 64, "Shift out of range.");
+        Emit({ 0x49, 0xC1, 0xE5, static_cast<uint8_t>(shift) });   // shl r13, shift
+
+        m_shift += shift;
+        m_maxShift = (std::max)(m_maxShift, m_shift);
+    }
+
+
+    void NativeCodeGenerator::RightShiftOffset(size_t shift)
+    {
+        LogAssertB(shift < 64, "Shift out of range.");
+        Emit({ 0x49, 0xC1, 0xED, static_cast<uint8_t>(shift) });   // shr r13, shift
+
+        m_shift -= (std::min)(m_shift, shift);
+    }
+
+
+    void NativeCodeGenerator::IncrementOffset()
+    {
+        Emit({ 0x49, 0xFF, 0xC5 });             // inc r13
+    }
+
+
+    void NativeCodeGenerator::Push()
+    {
+        Emit({ 0x50 });                         // push rax
+    }
+
+
+    void NativeCodeGenerator::Pop()
+    {
+        Emit({ 0x58 });                         // pop rax
+    }
+
+
+    void NativeCodeGenerator::AndStack()
+    {
+        Emit({ 0x59 });                         // pop rcx
+        Emit({ 0x48, 0x21, 0xC8 });             // and rax, rcx
+    }
+
+
+    void NativeCodeGenerator::Constant(int value)
+    {
+        Emit({ 0x48, 0xC7, 0xC0 });             // mov rax, imm32
+        Emit32(static_cast<uint32_t>(value));
+    }
+
+
+    void NativeCodeGenerator::Not()
+    {
+        Emit({ 0x48, 0xF7, 0xD0 });             // not rax
+    }
+
+
+    void NativeCodeGenerator::OrStack()
+    {
+        Emit({ 0x59 });                         // pop rcx
+        Emit({ 0x48, 0x09, 0xC8 });             // or rax, rcx
+    }
+
+
+    void NativeCodeGenerator::UpdateFlags()
+    {
+        // Jz and Jnz test the accumulator themselves.
+    }
+
+
+    void NativeCodeGenerator::Report()
+    {
+        ++m_reportCount;
+
+        Emit({ 0x48, 0x85, 0xC0 });             // test rax, rax
+        Emit({ 0x74, 0x0B });                   // jz +11
+        Emit({ 0x4D, 0x89, 0x2E });             // mov [r14], r13
+        Emit({ 0x49, 0x89, 0x46, 0x08 });       // mov [r14 + 8], rax
+        Emit({ 0x49, 0x83, 0xC6, 0x10 });       // add r14, 16
+    }
+
+
+    ICodeGenerator::Label NativeCodeGenerator::AllocateLabel()
+    {
+        m_labels.push_back(c_unplaced);
+        return static_cast<Label>(m_labels.size() - 1);
+    }
+
+
+    void NativeCodeGenerator::PlaceLabel(Label label)
+    {
+        LogAssertB(label < m_labels.size(), "Label out of range.");
+        LogAssertB(m_labels[label] == c_unplaced, "Label placed twice.");
+        m_labels[label] = m_code.size();
+    }
+
+
+    void NativeCodeGenerator::Call(Label label)
+    {
+        EmitJump({ 0xE8 }, label);              // call rel32
+    }
+
+
+    void NativeCodeGenerator::Jmp(Label label)
+    {
+        EmitJump({ 0xE9 }, label);              // jmp rel32
+    }
+
+
+    void NativeCodeGenerator::Jnz(Label label)
+    {
+        Emit({ 0x48, 0x85, 0xC0 });             // test rax, rax
+        EmitJump({ 0x0F, 0x85 }, label);        // jnz rel32
+    }
+
+
+    void NativeCodeGenerator::Jz(Label label)
+    {
+        Emit({ 0x48, 0x85, 0xC0 });             // test rax, rax
+        EmitJump({ 0x0F, 0x84 }, label);        // jz rel32
+    }
+
+
+    void NativeCodeGenerator::Return()
+    {
+        Emit({ 0xC3 });                         // ret
+    }
+
+
+    //
+    // Private methods.
+    //
+    void NativeCodeGenerator::EmitPrologue()
+    {
+        // Save the callee-saved registers. With the return address, this
+        // leaves the stack 8 bytes off of 16 byte alignment, which the 24
+        // bytes of locals restores for the call to FinishSlice.
+        Emit({ 0x53 });                         // push rbx
+        Emit({ 0x55 });                         // push rbp
+        Emit({ 0x41, 0x54 });                   // push r12
+        Emit({ 0x41, 0x55 });                   // push r13
+        Emit({ 0x41, 0x56 });                   // push r14
+        Emit({ 0x41, 0x57 });                   // push r15
+        Emit({ 0x48, 0x83, 0xEC, 0x18 });       // sub rsp, 24
+
+        Emit({ 0x48, 0x89, 0x3C, 0x24 });       // mov [rsp], rdi
+        Emit({ 0x48, 0x89, 0x74, 0x24, 0x08 }); // mov [rsp + 8], rsi
+        Emit({ 0x48, 0x89, 0xD5 });             // mov rbp, rdx
+        Emit({ 0x31, 0xDB });                   // xor ebx, ebx
+
+        Emit({ 0x48, 0x85, 0xF6 });             // test rsi, rsi
+        Emit({ 0x0F, 0x84 });                   // jz done
+        m_emptyBranch = m_code.size();
+        Emit32(0);
+
+        m_sliceLoop = m_code.size();
+        Emit({ 0x48, 0x8B, 0x04, 0x24 });       // mov rax, [rsp]
+        Emit({ 0x4C, 0x8B, 0x24, 0xD8 });       // mov r12, [rax + rbx * 8]
+        Emit({ 0x4C, 0x8B, 0x75, 0x00 });       // mov r14, [rbp]
+        Emit({ 0x45, 0x31, 0xFF });             // xor r15d, r15d
+
+        m_iterationLoop = m_code.size();
+        Emit({ 0x4D, 0x89, 0xFD });             // mov r13, r15
+    }
+
+
+    void NativeCodeGenerator::EmitEpilogue()
+    {
+        Emit({ 0x49, 0xFF, 0xC7 });             // inc r15
+        Emit({ 0x49, 0x81, 0xFF });             // cmp r15, iterations
+        Emit32(static_cast<uint32_t>(m_iterationsPerSlice));
+        Emit({ 0x0F, 0x82 });                   // jb iterationLoop
+        Emit32(0);
+        Patch32(m_code.size() - 4, m_iterationLoop);
+
+        // FinishSlice(*context, slice, (r14 - context->m_results) / 16).
+        Emit({ 0x48, 0x89, 0xEF });             // mov rdi, rbp
+        Emit({ 0x48, 0x89, 0xDE });             // mov rsi, rbx
+        Emit({ 0x4C, 0x89, 0xF2 });             // mov rdx, r14
+        Emit({ 0x48, 0x2B, 0x55, 0x00 });       // sub rdx, [rbp]
+        Emit({ 0x48, 0xC1, 0xEA, 0x04 });       // shr rdx, 4
+        Emit({ 0xFF, 0x55, 0x08 });             // call [rbp + 8]
+
+        // FinishSlice() returns true to stop early.
+        Emit({ 0x84, 0xC0 });                   // test al, al
+        Emit({ 0x0F, 0x85 });                   // jnz done
+        const size_t stopBranch = m_code.size();
+        Emit32(0);
+
+        Emit({ 0x48, 0xFF, 0xC3 });             // inc rbx
+        Emit({ 0x48, 0x3B, 0x5C, 0x24, 0x08 }); // cmp rbx, [rsp + 8]
+        Emit({ 0x0F, 0x82 });                   // jb sliceLoop
+        Emit32(0);
+        Patch32(m_code.size() - 4, m_sliceLoop);
+
+        Patch32(m_emptyBranch, m_code.size());
+        Patch32(stopBranch, m_code.size());
+        Emit({ 0x48, 0x83, 0xC4, 0x18 });       // add rsp, 24
+        Emit({ 0x41, 0x5F });                   // pop r15
+        Emit({ 0x41, 0x5E });                   // pop r14
+        Emit({ 0x41, 0x5D });                   // pop r13
+        Emit({ 0x41, 0x5C });                   // pop r12
+        Emit({ 0x5D });                         // pop rbp
+        Emit({ 0x5B });                         // pop rbx
+        Emit({ 0xC3 });                         // ret
+    }
+
+
+    void NativeCodeGenerator::EmitRowOperation(uint8_t opcode,
+                                               unsigned reg,
+                                               size_t id,
+                                               size_t rankDelta)
+    {
+        LogAssertB(id < m_rowCount, "Row id out of range.");
+        const ptrdiff_t displacement = m_rowOffsets[id];
+        if (displacement < (std::numeric_limits<int32_t>::min)() ||
+            displacement > (std::numeric_limits<int32_t>::max)())
+        {
+            RecoverableError error("NativeCodeGenerator: row offset out of range.");
+            throw error;
+        }
+
+        unsigned index = c_r13;
+        if (rankDelta > 0)
+        {
+            LogAssertB(rankDelta < 64, "Rank delta out of range.");
+            Emit({ 0x4C, 0x89, 0xE9 });         // mov rcx, r13
+            Emit({ 0x48, 0xC1, 0xE9, static_cast<uint8_t>(rankDelta) });  // shr rcx, rankDelta
+            index = c_rcx;
+        }
+
+        // op reg, [r12 + index * 8 + disp32]
+        const uint8_t rex = static_cast<uint8_t>(0x49 |
+                                                 ((reg >> 3) << 2) |
+                                                 ((index >> 3) << 1));
+        const uint8_t modrm = static_cast<uint8_t>(0x84 | ((reg & 7) << 3));
+        const uint8_t sib = static_cast<uint8_t>(0xC4 | ((index & 7) << 3));
+        Emit({ rex, opcode, modrm, sib });
+        Emit32(static_cast<uint32_t>(displacement));
+    }
+
+
+    void NativeCodeGenerator::EmitJump(std::vector<uint8_t> const & opcode,
+                                       Label label)
+    {
+        LogAssertB(label < m_labels.size(), "Label out of range.");
+        Emit(opcode);
+        m_fixups.push_back(std::make_pair(m_code.size(), label));
+        Emit32(0);
+    }
+
+
+    void NativeCodeGenerator::Emit(std::vector<uint8_t> const & bytes)
+    {
+        LogAssertB(m_executable == nullptr, "NativeCodeGenerator already sealed.");
+        m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+    }
+
+
+    void NativeCodeGenerator::Emit32(uint32_t value)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            m_code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+
+    void NativeCodeGenerator::Patch32(size_t position, size_t target)
+    {
+        // Displacements are relative to the end of the 32-bit field.
+        const int64_t displacement =
+            static_cast<int64_t>(target) - static_cast<int64_t>(position + 4);
+        const uint32_t value = static_cast<uint32_t>(static_cast<int32_t>(displacement));
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            m_code[position + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+}
@@ -0,0 +1,214 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // ptrdiff_t, size_t members.
+#include <cstdint>                          // uint8_t, uint64_t members.
+#include <exception>                        // std::exception_ptr member.
+#include <utility>                          // std::pair parameterizes std::vector.
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/ICodeGenerator.h"  // Inherits from ICodeGenerator.
+
+
+namespace BitFunnel
+{
+    class IResultsProcessor;
+
+    //*************************************************************************
+    //
+    // NativeCodeGenerator is an ICodeGenerator that emits x86-64 machine
+    // code for a plan into executable memory.
+    //
+    // The generated function contains the complete matching loop for one
+    // shard: an outer loop over slice buffers and an inner loop over the
+    // quadwords at the plan's initial rank. The shard's row offsets and the
+    // rank shifts are encoded as immediates, so a NativeCodeGenerator must be
+    // created for each shard. Report writes (offset, accumulator) pairs to a
+    // results buffer, which is handed to the IResultsProcessor at the end of
+    // each slice.
+    //
+    // Register usage within the generated code:
+    //   rax  accumulator
+    //   rcx  scratch
+    //   rbx  slice index
+    //   rbp  pointer to the Run() context
+    //   r12  current slice buffer
+    //   r13  current quadword offset
+    //   r14  results buffer write pointer
+    //   r15  iteration counter
+    // The value stack and the call stack share the machine stack.
+    //
+    // Native code is only available for x86-64 on POSIX platforms. Use
+    // IsSupported() to check before constructing a NativeCodeGenerator.
+    //
+    //*************************************************************************
+    class NativeCodeGenerator : public ICodeGenerator, NonCopyable
+    {
+    public:
+        // rowOffsets is indexed by AbstractRow id and gives each row's
+        // offset in the shard's slice buffers. The plan will be run
+        // iterationsPerSlice times per slice.
+        NativeCodeGenerator(ptrdiff_t const * rowOffsets,
+                            size_t rowCount,
+                            size_t iterationsPerSlice);
+
+        ~NativeCodeGenerator();
+
+        // Returns true if native code generation is available on this
+        // platform.
+        static bool IsSupported();
+
+        // Resolves labels, appends the loop epilogue, and copies the code
+        // into executable memory. No primitives may be emitted after Seal().
+        void Seal();
+
+        // Runs the generated code over the slice buffers, stopping early if
+        // the resultsProcessor requests termination. The caller must
+        // hold a Token to prevent the slice buffers from being recycled.
+        //
+        // The generated code collects each slice's results in the results
+        // buffer before passing them to the resultsProcessor. The buffer is
+        // grown as needed, so a caller that keeps it across calls does not
+        // allocate on each call. The overload without the buffer allocates
+        // one for the call.
+        void Run(char * const * sliceBuffers,
+                 size_t sliceCount,
+                 IResultsProcessor& resultsProcessor,
+                 std::vector<uint64_t>& results) const;
+        void Run(char * const * sliceBuffers,
+                 size_t sliceCount,
+                 IResultsProcessor& resultsProcessor) const;
+
+        // Returns the number of bytes of generated machine code.
+        size_t GetCodeSize() const;
+
+        //
+        // ICodeGenerator methods.
+        //
+        virtual void AndRow(size_t id, bool inverted, size_t rankDelta) override;
+        virtual void LoadRow(size_t id, bool inverted, size_t rankDelta) override;
+
+        virtual void LeftShiftOffset(size_t shift) override;
+        virtual void RightShiftOffset(size_t shift) override;
+        virtual void IncrementOffset() override;
+
+        virtual void Push() override;
+        virtual void Pop() override;
+
+        virtual void AndStack() override;
+        virtual void Constant(int value) override;
+        virtual void Not() override;
+        virtual void OrStack() override;
+        virtual void UpdateFlags() override;
+
+        virtual void Report() override;
+
+        virtual Label AllocateLabel() override;
+        virtual void PlaceLabel(Label label) override;
+        virtual void Call(Label label) override;
+        virtual void Jmp(Label label) override;
+        virtual void Jnz(Label label) override;
+        virtual void Jz(Label label) override;
+        virtual void Return() override;
+
+    private:
+        // Context passed to the generated code. The generated code reads
+        // m_results and m_finishSlice, so these must remain the first two
+        // fields.
+        class Context
+        {
+        public:
+            uint64_t * m_results;
+            bool (*m_finishSlice)(Context & context,
+                                  size_t slice,
+                                  size_t resultCount);
+            IResultsProcessor * m_resultsProcessor;
+            char * const * m_sliceBuffers;
+
+            // Exception thrown by the IResultsProcessor, if any.
+            std::exception_ptr m_exception;
+        };
+
+        // Called by the generated code at the end of each slice. Returns
+        // true if the generated code should stop.
+        //
+        // DESIGN NOTE: Exceptions must not unwind through the generated
+        // code, which has no unwind information. FinishSlice() catches any
+        // exception thrown by the IResultsProcessor, saves it in the Context
+        // and stops the generated code. Run() rethrows it once the generated
+        // code has returned.
+        static bool FinishSlice(Context & context,
+                                size_t slice,
+                                size_t resultCount) noexcept;
+
+        typedef void (*Function)(char * const * sliceBuffers,
+                                 size_t sliceCount,
+                                 Context * context);
+
+        void EmitPrologue();
+        void EmitEpilogue();
+
+        // Emits an instruction of the form "op reg, [r12 + offset*8 + disp]"
+        // where offset is the current offset shifted right by rankDelta.
+        void EmitRowOperation(uint8_t opcode,
+                              unsigned reg,
+                              size_t id,
+                              size_t rankDelta);
+
+        // Emits a control transfer with a 32-bit displacement to a label.
+        void EmitJump(std::vector<uint8_t> const & opcode, Label label);
+
+        void Emit(std::vector<uint8_t> const & bytes);
+        void Emit32(uint32_t value);
+        void Patch32(size_t position, size_t target);
+
+        ptrdiff_t const * m_rowOffsets;
+        size_t m_rowCount;
+        size_t m_iterationsPerSlice;
+
+        std::vector<uint8_t> m_code;
+
+        // Code position for each label, or c_unplaced.
+        std::vector<size_t> m_labels;
+        static const size_t c_unplaced = static_cast<size_t>(-1);
+
+        // (position of rel32, label) pairs resolved in Seal().
+        std::vector<std::pair<size_t, Label>> m_fixups;
+
+        // Positions of the loop heads and of the branch that skips an
+        // empty shard.
+        size_t m_sliceLoop;
+        size_t m_iterationLoop;
+        size_t m_emptyBranch;
+
+        // Used to bound the number of results reported per slice.
+        size_t m_reportCount;
+        size_t m_shift;
+        size_t m_maxShift;
+
+        void * m_executable;
+        size_t m_executableSize;
+    };
+}
@@ -0,0 +1,266 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "BitFunnel/Plan/PlanCache.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "CompiledQuery.h"
+#include "LoggerInterfaces/Logging.h"
+#include "StringVector.h"
+
+
+namespace BitFunnel
+{
+    static void AppendCanonicalKey(TermMatchNode const & node,
+                                   std::ostream & key);
+
+
+    // Appends the canonical keys of the operands of a chain of And or Or
+    // nodes of the specified type to operands.
+    static void CollectOperands(TermMatchNode const & node,
+                                TermMatchNode::NodeType type,
+                                std::vector<std::string> & operands)
+    {
+        if (node.GetType() == type)
+        {
+            TermMatchNode const & left = (type == TermMatchNode::AndMatch) ?
+                dynamic_cast<TermMatchNode::And const &>(node).GetLeft() :
+                dynamic_cast<TermMatchNode::Or const &>(node).GetLeft();
+            TermMatchNode const & right = (type == TermMatchNode::AndMatch) ?
+                dynamic_cast<TermMatchNode::And const &>(node).GetRight() :
+                dynamic_cast<TermMatchNode::Or const &>(node).GetRight();
+
+            CollectOperands(left, type, operands);
+            CollectOperands(right, type, operands);
+        }
+        else
+        {
+            std::stringstream key;
+            AppendCanonicalKey(node, key);
+            operands.push_back(key.str());
+        }
+    }
+
+
+    // Writes text with a length prefix so that no choice of term text can
+    // be confused with the punctuation of the key.
+    static void AppendText(char const * text, std::ostream & key)
+    {
+        const std::string s(text);
+        key << s.size() << ':' << s;
+    }
+
+
+    static void AppendCanonicalKey(TermMatchNode const & node,
+                                   std::ostream & key)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+        case TermMatchNode::OrMatch:
+            {
+                // And and Or are associative and commutative, so flatten
+                // chains of them and sort the operands.
+                std::vector<std::string> operands;
+                CollectOperands(node, node.GetType(), operands);
+                std::sort(operands.begin(), operands.end());
+
+                key << ((node.GetType() == TermMatchNode::AndMatch) ? '&' : '|')
+                    << '(';
+                for (auto const & operand : operands)
+                {
+                    key << operand << ',';
+                }
+                key << ')';
+            }
+            break;
+        case TermMatchNode::NotMatch:
+            key << "!(";
+            AppendCanonicalKey(
+                dynamic_cast<TermMatchNode::Not const &>(node).GetChild(),
+                key);
+            key << ')';
+            break;
+        case TermMatchNode::PhraseMatch:
+            {
+                TermMatchNode::Phrase const & phrase =
+                    dynamic_cast<TermMatchNode::Phrase const &>(node);
+                StringVector const & grams = phrase.GetGrams();
+
+                key << "p" << static_cast<unsigned>(phrase.GetStreamId())
+                    << '[';
+                for (unsigned i = 0; i < grams.GetSize(); ++i)
+                {
+                    AppendText(grams[i], key);
+                }
+                key << ']';
+            }
+            break;
+        case TermMatchNode::UnigramMatch:
+            {
+                TermMatchNode::Unigram const & unigram =
+                    dynamic_cast<TermMatchNode::Unigram const &>(node);
+                key << "u" << static_cast<unsigned>(unigram.GetStreamId())
+                    << '.';
+                AppendText(unigram.GetText(), key);
+            }
+            break;
+        case TermMatchNode::FactMatch:
+            key << "f"
+                << dynamic_cast<TermMatchNode::Fact const &>(node).GetFact()
+                << '.';
+            break;
+        default:
+            LogAbortB("PlanCache: invalid TermMatchNode type.");
+        }
+    }
+
+
+    PlanCache::PlanCache(size_t capacity)
+        : m_capacity(capacity),
+          m_hitCount(0),
+          m_missCount(0),
+          m_invalidationCount(0)
+    {
+    }
+
+
+    PlanCache::~PlanCache()
+    {
+    }
+
+
+    size_t PlanCache::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+
+    size_t PlanCache::GetEntryCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_entries.size();
+    }
+
+
+    size_t PlanCache::GetHitCount() const
+    {
+        return m_hitCount;
+    }
+
+
+    size_t PlanCache::GetMissCount() const
+    {
+        return m_missCount;
+    }
+
+
+    size_t PlanCache::GetInvalidationCount() const
+    {
+        return m_invalidationCount;
+    }
+
+
+    double PlanCache::GetHitRate() const
+    {
+        const size_t hits = m_hitCount;
+        const size_t lookups = hits + m_missCount;
+        return (lookups == 0) ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+
+
+    void PlanCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_index.clear();
+        m_entries.clear();
+    }
+
+
+    std::string PlanCache::GetCanonicalKey(TermMatchNode const & query)
+    {
+        std::stringstream key;
+        AppendCanonicalKey(query, key);
+        return key.str();
+    }
+
+
+    PlanCache::Plan PlanCache::Find(std::string const & key,
+                                    IIngestor const & ingestor)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto it = m_index.find(key);
+            if (it != m_index.end())
+            {
+                if (it->second->second->IsCurrent(ingestor))
+                {
+                    // Move the entry to the front of the LRU list.
+                    m_entries.splice(m_entries.begin(), m_entries, it->second);
+                    ++m_hitCount;
+                    return m_entries.front().second;
+                }
+
+                m_entries.erase(it->second);
+                m_index.erase(it);
+                ++m_invalidationCount;
+            }
+        }
+
+        ++m_missCount;
+        return nullptr;
+    }
+
+
+    void PlanCache::Add(std::string const & key, Plan plan)
+    {
+        if (m_capacity == 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // Another thread may have compiled the same query in the meantime.
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            it->second->second = plan;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return;
+        }
+
+        if (m_entries.size() == m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+
+        m_entries.emplace_front(key, plan);
+        m_index[key] = m_entries.begin();
+    }
+}
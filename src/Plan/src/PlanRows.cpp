@@ -0,0 +1,97 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "LoggerInterfaces/Logging.h"
+#include "PlanRows.h"
+
+
+namespace BitFunnel
+{
+    PlanRows::PlanRows(IIngestor const & ingestor)
+      : m_ingestor(ingestor),
+        m_rowCount(0),
+        m_rows(ingestor.GetShardCount() * c_maxRowsPerQuery)
+    {
+    }
+
+
+    ShardId PlanRows::GetShardCount() const
+    {
+        return m_ingestor.GetShardCount();
+    }
+
+
+    unsigned PlanRows::GetRowCount() const
+    {
+        return m_rowCount;
+    }
+
+
+    ITermTable const & PlanRows::GetTermTable(ShardId shard) const
+    {
+        LogAssertB(shard < m_ingestor.GetShardCount(), "ShardId out of range.");
+        return m_ingestor.GetShard(shard).GetTermTable();
+    }
+
+
+    bool PlanRows::IsFull() const
+    {
+        return m_rowCount == c_maxRowsPerQuery;
+    }
+
+
+    AbstractRow PlanRows::AddRow(Rank rank)
+    {
+        if (IsFull())
+        {
+            RecoverableError error("PlanRows::AddRow: query requires too many rows.");
+            throw error;
+        }
+
+        return AbstractRow(m_rowCount++, rank, false);
+    }
+
+
+    RowId const & PlanRows::PhysicalRow(ShardId shard, unsigned id) const
+    {
+        return m_rows[GetSlot(shard, id)];
+    }
+
+
+    RowId & PlanRows::PhysicalRow(ShardId shard, unsigned id)
+    {
+        return m_rows[GetSlot(shard, id)];
+    }
+
+
+    size_t PlanRows::GetSlot(ShardId shard, unsigned id) const
+    {
+        LogAssertB(shard < m_ingestor.GetShardCount(), "ShardId out of range.");
+        LogAssertB(id < m_rowCount, "AbstractRow id out of range.");
+
+        return shard * c_maxRowsPerQuery + id;
+    }
+}
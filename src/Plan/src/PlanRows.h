@@ -0,0 +1,77 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/IPlanRows.h"       // Inherits from IPlanRows.
+
+
+namespace BitFunnel
+{
+    class IIngestor;
+
+    //*************************************************************************
+    //
+    // PlanRows is the standard implementation of IPlanRows. It records the
+    // physical RowIds for each AbstractRow in a plan, for each shard in an
+    // IIngestor.
+    //
+    // DESIGN NOTE: Storage for the maximum number of rows in every shard is
+    // allocated once, in the constructor, so that planning a query does not
+    // perform an allocation per row.
+    //
+    //*************************************************************************
+    class PlanRows : public IPlanRows, NonCopyable
+    {
+    public:
+        PlanRows(IIngestor const & ingestor);
+
+        //
+        // IPlanRows methods.
+        //
+        virtual ShardId GetShardCount() const override;
+        virtual unsigned GetRowCount() const override;
+        virtual ITermTable const & GetTermTable(ShardId shard) const override;
+        virtual bool IsFull() const override;
+        virtual AbstractRow AddRow(Rank rank) override;
+        virtual RowId const & PhysicalRow(ShardId shard, unsigned id) const override;
+        virtual RowId & PhysicalRow(ShardId shard, unsigned id) override;
+
+        // Maximum number of AbstractRows in a single plan.
+        static const unsigned c_maxRowsPerQuery = 500;
+
+    private:
+        size_t GetSlot(ShardId shard, unsigned id) const;
+
+        IIngestor const & m_ingestor;
+
+        unsigned m_rowCount;
+
+        // Physical RowIds, organized as c_maxRowsPerQuery consecutive entries
+        // for each shard.
+        std::vector<RowId> m_rows;
+    };
+}
@@ -23,14 +23,66 @@
 #include <sstream>
 
 #include "Allocator.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/Token.h"
 #include "BitFunnel/Plan/QueryPipeline.h"
+#include "CompiledQuery.h"
+#include "MatchLimit.h"
+#include "NativeCodeGenerator.h"
 #include "QueryParser.h"
+#include "RowKernel.h"
+#include "SliceMatcher.h"
 
 
 namespace BitFunnel
 {
+    // Returns true if every query has a limit and every limit is exhausted.
+    static bool AllExhausted(std::vector<MatchLimit *> const & limits)
+    {
+        for (auto limit : limits)
+        {
+            if (limit == nullptr || !limit->IsExhausted())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
     QueryPipeline::QueryPipeline()
-        : m_allocator(new Allocator(4096))
+        : m_ingestor(nullptr),
+          m_configuration(nullptr),
+          m_useNativeCode(false),
+          m_rowCount(0),
+          m_quadwordCount(0),
+          m_threadPool(nullptr),
+          m_minParallelQuadwords(0),
+          m_allocator(new Allocator(4096)),
+          m_ownedPlanCache(0),
+          m_planCache(nullptr)
+    {
+    }
+
+
+    QueryPipeline::QueryPipeline(IIngestor const & ingestor,
+                                 IConfiguration const & configuration,
+                                 bool useNativeCode,
+                                 IWorkStealingPool * threadPool,
+                                 size_t minParallelQuadwords)
+        : m_ingestor(&ingestor),
+          m_configuration(&configuration),
+          m_useNativeCode(useNativeCode && NativeCodeGenerator::IsSupported()),
+          m_rowCount(0),
+          m_quadwordCount(0),
+          m_threadPool(threadPool),
+          m_minParallelQuadwords(minParallelQuadwords),
+          m_allocator(new Allocator(4096)),
+          m_planAllocator(new Allocator(256 * 1024)),
+          m_ownedPlanCache(c_defaultPlanCacheCapacity),
+          m_planCache(&m_ownedPlanCache)
     {
     }
 
@@ -41,4 +93,225 @@ namespace BitFunnel
         QueryParser parser(s, *m_allocator);
         return parser.Parse();
     }
+
+
+    void QueryPipeline::ResetQueries()
+    {
+        m_allocator->Reset();
+    }
+
+
+    PlanCache * QueryPipeline::GetPlanCache() const
+    {
+        return m_planCache;
+    }
+
+
+    void QueryPipeline::SetPlanCache(PlanCache * planCache)
+    {
+        m_planCache = planCache;
+    }
+
+
+    //*************************************************************************
+    //
+    // QueryPipeline::Budget
+    //
+    //*************************************************************************
+    QueryPipeline::Budget::Budget(size_t maxMatches, double maxSeconds)
+        : m_maxMatches(maxMatches),
+          m_maxSeconds(maxSeconds)
+    {
+    }
+
+
+    size_t QueryPipeline::Budget::GetMaxMatches() const
+    {
+        return m_maxMatches;
+    }
+
+
+    double QueryPipeline::Budget::GetMaxSeconds() const
+    {
+        return m_maxSeconds;
+    }
+
+
+    //*************************************************************************
+    //
+    // QueryPipeline
+    //
+    //*************************************************************************
+    void QueryPipeline::Match(TermMatchNode const & query,
+                              std::vector<DocId>& matches)
+    {
+        std::vector<TermMatchNode const *> queries(1, &query);
+        std::vector<MatchLimit *> limits(1, nullptr);
+        std::vector<std::vector<DocId>> batchMatches;
+        MatchBatch(queries, limits, batchMatches);
+
+        matches.insert(matches.end(),
+                       batchMatches[0].begin(),
+                       batchMatches[0].end());
+    }
+
+
+    bool QueryPipeline::Match(TermMatchNode const & query,
+                              std::vector<DocId>& matches,
+                              Budget const & budget)
+    {
+        MatchLimit limit(budget.GetMaxMatches(), budget.GetMaxSeconds());
+
+        std::vector<TermMatchNode const *> queries(1, &query);
+        std::vector<MatchLimit *> limits(1, &limit);
+        std::vector<std::vector<DocId>> batchMatches;
+        MatchBatch(queries, limits, batchMatches);
+
+        // Slices finish as a unit, and several threads may finish slices
+        // at once, so the matchers can overshoot the limit.
+        std::vector<DocId> & results = batchMatches[0];
+        if (results.size() > budget.GetMaxMatches())
+        {
+            results.resize(budget.GetMaxMatches());
+        }
+        matches.insert(matches.end(), results.begin(), results.end());
+
+        return limit.IsExhausted();
+    }
+
+
+    void QueryPipeline::MatchBatch(std::vector<TermMatchNode const *> const & queries,
+                                   std::vector<std::vector<DocId>>& matches)
+    {
+        std::vector<MatchLimit *> limits(queries.size(), nullptr);
+        MatchBatch(queries, limits, matches);
+    }
+
+
+    void QueryPipeline::MatchBatch(std::vector<TermMatchNode const *> const & queries,
+                                   std::vector<MatchLimit *> const & limits,
+                                   std::vector<std::vector<DocId>>& matches)
+    {
+        if (m_ingestor == nullptr)
+        {
+            RecoverableError error("QueryPipeline::MatchBatch(): no ingestor.");
+            throw error;
+        }
+
+        m_rowCount = 0;
+        m_quadwordCount = 0;
+
+        const size_t workerCount =
+            (m_threadPool == nullptr) ? 1 : m_threadPool->GetWorkerCount();
+        const RowKernel kernel;
+
+        std::vector<std::shared_ptr<CompiledQuery const>> plans;
+        std::vector<std::unique_ptr<SliceMatcherSet>> matchers;
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            plans.push_back(GetPlan(*queries[i]));
+            m_rowCount += plans.back()->GetRowCount();
+
+            matchers.emplace_back(
+                new SliceMatcherSet(workerCount,
+                                    plans.back()->GetConjunction(),
+                                    kernel,
+                                    &plans.back()->GetByteCode(),
+                                    limits[i]));
+        }
+
+        // The Token keeps the slice buffers from being recycled while the
+        // plans run.
+        const Token token = m_ingestor->GetTokenManager().RequestToken();
+
+        for (ShardId shardId = 0; shardId < m_ingestor->GetShardCount(); ++shardId)
+        {
+            if (AllExhausted(limits))
+            {
+                break;
+            }
+
+            // RecycleSlice() may publish a new vector of slice buffers at
+            // any time, so every plan must use the same snapshot. The Token
+            // keeps the snapshot alive.
+            std::vector<void*> const & sliceBuffers =
+                m_ingestor->GetShard(shardId).GetSliceBuffers();
+            const size_t sliceCount = sliceBuffers.size();
+
+            SliceMatcherBatch batch;
+            size_t quadwordCount = 0;
+            for (size_t i = 0; i < plans.size(); ++i)
+            {
+                matchers[i]->SetShard(plans[i]->GetShardContext(shardId,
+                                                                sliceBuffers));
+                quadwordCount += plans[i]->GetQuadwordCount(shardId, sliceCount);
+                batch.Add(*matchers[i]);
+            }
+            m_quadwordCount += quadwordCount;
+
+            // Queries that touch little data, such as those made up of rare
+            // terms in high rank rows, run on the calling thread, since
+            // dispatching them to the pool would cost more than it saves.
+            if (m_threadPool != nullptr &&
+                sliceCount > 1 &&
+                quadwordCount >= m_minParallelQuadwords)
+            {
+                m_threadPool->Run(batch, sliceCount);
+            }
+            else
+            {
+                batch.Run(0, sliceCount);
+            }
+        }
+
+        matches.resize(queries.size());
+        for (size_t i = 0; i < matchers.size(); ++i)
+        {
+            matchers[i]->GetMatches(matches[i]);
+        }
+    }
+
+
+    std::shared_ptr<CompiledQuery const>
+        QueryPipeline::GetPlan(TermMatchNode const & query)
+    {
+        // Byte code and native code plans are not interchangeable, so they
+        // are cached under different keys.
+        std::string key;
+        std::shared_ptr<CompiledQuery const> plan;
+        if (m_planCache != nullptr)
+        {
+            key = (m_useNativeCode ? "n" : "b") +
+                PlanCache::GetCanonicalKey(query);
+            plan = m_planCache->Find(key, *m_ingestor);
+        }
+
+        if (plan == nullptr)
+        {
+            m_planAllocator->Reset();
+            plan.reset(new CompiledQuery(query,
+                                         *m_ingestor,
+                                         *m_configuration,
+                                         m_useNativeCode,
+                                         *m_planAllocator));
+            if (m_planCache != nullptr)
+            {
+                m_planCache->Add(key, plan);
+            }
+        }
+
+        return plan;
+    }
+
+
+    size_t QueryPipeline::GetRowCount() const
+    {
+        return m_rowCount;
+    }
+
+
+    size_t QueryPipeline::GetQuadwordCount() const
+    {
+        return m_quadwordCount;
+    }
 }
@@ -0,0 +1,313 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>                        // std::max.
+#include <new>                              // Placement new.
+
+#include "BitFunnel/Allocators/IAllocator.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "CompileNode.h"
+#include "RankDownCompiler.h"
+
+
+namespace BitFunnel
+{
+    RankDownCompiler::RankDownCompiler(IAllocator& allocator)
+      : m_allocator(allocator),
+        m_initialRank(0)
+    {
+    }
+
+
+    CompileNode const & RankDownCompiler::Compile(RowMatchNode const & root)
+    {
+        m_initialRank = GetMaximumRank(root);
+        return CompileChain(root, m_initialRank, false, nullptr);
+    }
+
+
+    Rank RankDownCompiler::GetInitialRank() const
+    {
+        return m_initialRank;
+    }
+
+
+    Rank RankDownCompiler::GetMaximumRank(RowMatchNode const & root)
+    {
+        switch (root.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & node =
+                    dynamic_cast<RowMatchNode::And const &>(root);
+                Rank rank = GetMaximumRank(node.GetRight());
+                if (node.GetLeft().GetType() == RowMatchNode::RowMatch)
+                {
+                    AbstractRow const & row =
+                        dynamic_cast<RowMatchNode::Row const &>(node.GetLeft()).GetRow();
+                    rank = (std::max)(rank, row.GetRank());
+                }
+                else if (node.GetLeft().GetType() == RowMatchNode::AndMatch)
+                {
+                    rank = (std::max)(rank, GetMaximumRank(node.GetLeft()));
+                }
+                return rank;
+            }
+        case RowMatchNode::OrMatch:
+            {
+                RowMatchNode::Or const & node =
+                    dynamic_cast<RowMatchNode::Or const &>(root);
+                return (std::max)(GetMaximumRank(node.GetLeft()),
+                                  GetMaximumRank(node.GetRight()));
+            }
+        default:
+            // Everything else is evaluated at rank zero.
+            return 0;
+        }
+    }
+
+
+    CompileNode const & RankDownCompiler::CompileChain(RowMatchNode const & node,
+                                                       Rank rank,
+                                                       bool isLoaded,
+                                                       RowMatchNode const * filter)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                RowMatchNode const & left = andNode.GetLeft();
+
+                if (left.GetType() == RowMatchNode::AndMatch)
+                {
+                    // The MatchTreeRewriter joins its rank zero and rank N
+                    // and-chains with an And node, so the left side may be
+                    // an and-chain itself. Rotate And(And(a, b), c) into
+                    // And(a, And(b, c)) to keep the chain right-nested.
+                    RowMatchNode::And const & leftAnd =
+                        dynamic_cast<RowMatchNode::And const &>(left);
+                    RowMatchNode const & right =
+                        *new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                            RowMatchNode::And(leftAnd.GetRight(), andNode.GetRight());
+                    RowMatchNode const & rotated =
+                        *new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                            RowMatchNode::And(leftAnd.GetLeft(), right);
+                    return CompileChain(rotated, rank, isLoaded, filter);
+                }
+                else if (left.GetType() == RowMatchNode::RowMatch)
+                {
+                    AbstractRow const & row =
+                        dynamic_cast<RowMatchNode::Row const &>(left).GetRow();
+
+                    if (row.GetRank() < rank)
+                    {
+                        // Rank down to the row's rank before evaluating it.
+                        CompileNode const & child =
+                            CompileChain(node, row.GetRank(), isLoaded, filter);
+                        return *new (m_allocator.Allocate(sizeof(CompileNode::RankDown)))
+                            CompileNode::RankDown(rank - row.GetRank(), child);
+                    }
+
+                    // A row with a rank higher than the current rank is
+                    // evaluated at the current rank, using its RankDelta to
+                    // compute its offset.
+                    AbstractRow const current =
+                        (row.GetRank() == rank) ?
+                        row :
+                        AbstractRow(row, row.GetRank() + row.GetRankDelta() - rank);
+
+                    CompileNode const & child =
+                        CompileChain(andNode.GetRight(), rank, true, filter);
+
+                    if (isLoaded)
+                    {
+                        return *new (m_allocator.Allocate(sizeof(CompileNode::AndRowJz)))
+                            CompileNode::AndRowJz(current, child);
+                    }
+                    else
+                    {
+                        return *new (m_allocator.Allocate(sizeof(CompileNode::LoadRowJz)))
+                            CompileNode::LoadRowJz(current, child);
+                    }
+                }
+                else if (ContainsReport(left))
+                {
+                    RecoverableError error("RankDownCompiler: unexpected Report in and-expression.");
+                    throw error;
+                }
+                else
+                {
+                    // Subtrees other than simple rows are deferred to the
+                    // next Report node, where they are evaluated at rank
+                    // zero.
+                    RowMatchNode const * combined = &left;
+                    if (filter != nullptr)
+                    {
+                        combined = new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                            RowMatchNode::And(left, *filter);
+                    }
+                    return CompileChain(andNode.GetRight(), rank, isLoaded, combined);
+                }
+            }
+        case RowMatchNode::OrMatch:
+            {
+                if (!ContainsReport(node))
+                {
+                    RecoverableError error("RankDownCompiler: expected Report in or-expression.");
+                    throw error;
+                }
+
+                RowMatchNode::Or const & orNode =
+                    dynamic_cast<RowMatchNode::Or const &>(node);
+
+                CompileNode const & left =
+                    CompileChain(orNode.GetLeft(), rank, isLoaded, filter);
+                CompileNode const & right =
+                    CompileChain(orNode.GetRight(), rank, isLoaded, filter);
+
+                return *new (m_allocator.Allocate(sizeof(CompileNode::Or)))
+                    CompileNode::Or(left, right);
+            }
+        case RowMatchNode::ReportMatch:
+            {
+                if (!isLoaded)
+                {
+                    RecoverableError error("RankDownCompiler: no rows before Report.");
+                    throw error;
+                }
+
+                RowMatchNode const * child =
+                    dynamic_cast<RowMatchNode::Report const &>(node).GetChild();
+                if (filter != nullptr)
+                {
+                    if (child == nullptr)
+                    {
+                        child = filter;
+                    }
+                    else
+                    {
+                        child = new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                            RowMatchNode::And(*filter, *child);
+                    }
+                }
+
+                CompileNode const * compiledChild =
+                    (child == nullptr) ? nullptr : &CompileRankZero(*child);
+
+                CompileNode const & report =
+                    *new (m_allocator.Allocate(sizeof(CompileNode::Report)))
+                        CompileNode::Report(compiledChild);
+
+                if (rank == 0)
+                {
+                    return report;
+                }
+                else
+                {
+                    return *new (m_allocator.Allocate(sizeof(CompileNode::RankDown)))
+                        CompileNode::RankDown(rank, report);
+                }
+            }
+        default:
+            RecoverableError error("RankDownCompiler: unexpected node in and-chain.");
+            throw error;
+        }
+    }
+
+
+    CompileNode const & RankDownCompiler::CompileRankZero(RowMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                CompileNode const & left = CompileRankZero(andNode.GetLeft());
+                CompileNode const & right = CompileRankZero(andNode.GetRight());
+                return *new (m_allocator.Allocate(sizeof(CompileNode::AndTree)))
+                    CompileNode::AndTree(left, right);
+            }
+        case RowMatchNode::NotMatch:
+            {
+                RowMatchNode::Not const & notNode =
+                    dynamic_cast<RowMatchNode::Not const &>(node);
+                CompileNode const & child = CompileRankZero(notNode.GetChild());
+                return *new (m_allocator.Allocate(sizeof(CompileNode::Not)))
+                    CompileNode::Not(child);
+            }
+        case RowMatchNode::OrMatch:
+            {
+                RowMatchNode::Or const & orNode =
+                    dynamic_cast<RowMatchNode::Or const &>(node);
+                CompileNode const & left = CompileRankZero(orNode.GetLeft());
+                CompileNode const & right = CompileRankZero(orNode.GetRight());
+                return *new (m_allocator.Allocate(sizeof(CompileNode::OrTree)))
+                    CompileNode::OrTree(left, right);
+            }
+        case RowMatchNode::RowMatch:
+            {
+                AbstractRow const & row =
+                    dynamic_cast<RowMatchNode::Row const &>(node).GetRow();
+                AbstractRow const rankZero =
+                    (row.GetRank() == 0) ?
+                    row :
+                    AbstractRow(row, row.GetRank() + row.GetRankDelta());
+                return *new (m_allocator.Allocate(sizeof(CompileNode::LoadRow)))
+                    CompileNode::LoadRow(rankZero);
+            }
+        default:
+            RecoverableError error("RankDownCompiler: unexpected node in rank zero expression.");
+            throw error;
+        }
+    }
+
+
+    bool RankDownCompiler::ContainsReport(RowMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode =
+                    dynamic_cast<RowMatchNode::And const &>(node);
+                return ContainsReport(andNode.GetLeft()) ||
+                       ContainsReport(andNode.GetRight());
+            }
+        case RowMatchNode::OrMatch:
+            {
+                RowMatchNode::Or const & orNode =
+                    dynamic_cast<RowMatchNode::Or const &>(node);
+                return ContainsReport(orNode.GetLeft()) ||
+                       ContainsReport(orNode.GetRight());
+            }
+        case RowMatchNode::ReportMatch:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include "BitFunnel/BitFunnelTypes.h"       // Rank return value.
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    class CompileNode;
+    class IAllocator;
+    class RowMatchNode;
+
+    //*************************************************************************
+    //
+    // RankDownCompiler translates a RowMatchNode tree, in the form produced
+    // by the MatchTreeRewriter, into a tree of CompileNodes that implements
+    // the RankDown matching algorithm.
+    //
+    // The matcher runs the compiled plan once for each quadword at the
+    // initial rank, which is the highest rank of any row on the and-chain
+    // at the root of the tree. Rows on the chain are intersected in order.
+    // Each time the chain reaches a row of lower rank, a RankDown node
+    // splits the current quadword into the 2^delta quadwords it covers at
+    // the lower rank. Rows at higher rank are therefore loaded and
+    // intersected first, and most lower rank rows are skipped when the
+    // higher rank intersection is zero.
+    //
+    // Or nodes that lead to Report nodes become Or nodes which run both
+    // branches from the same accumulator. Report nodes are always evaluated
+    // at rank zero. The expression under a Report, along with any other
+    // subtrees that are not simple rows, is compiled with AndTree, OrTree,
+    // Not, and LoadRow nodes.
+    //
+    //*************************************************************************
+    class RankDownCompiler : NonCopyable
+    {
+    public:
+        RankDownCompiler(IAllocator& allocator);
+
+        // Compiles the tree. CompileNodes are allocated from the allocator
+        // passed to the constructor.
+        CompileNode const & Compile(RowMatchNode const & root);
+
+        // Returns the initial rank for the most recent call to Compile().
+        Rank GetInitialRank() const;
+
+        // Returns the highest rank of any row that will be evaluated by the
+        // RankDown portion of the compiled tree.
+        static Rank GetMaximumRank(RowMatchNode const & root);
+
+    private:
+        // Compiles the node at a position in the and-chain where the
+        // current rank is rank. The isLoaded parameter is true if a row has
+        // already been loaded into the accumulator. The filter parameter
+        // holds subtrees deferred to the next Report node.
+        CompileNode const & CompileChain(RowMatchNode const & node,
+                                         Rank rank,
+                                         bool isLoaded,
+                                         RowMatchNode const * filter);
+
+        // Compiles an expression to be evaluated entirely at rank zero.
+        CompileNode const & CompileRankZero(RowMatchNode const & node);
+
+        // Returns true if there is a Report node in the tree.
+        static bool ContainsReport(RowMatchNode const & node);
+
+        IAllocator& m_allocator;
+
+        Rank m_initialRank;
+    };
+}
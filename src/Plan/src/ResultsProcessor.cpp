@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>                        // std::sort.
+
+#include "BitFunnel/Index/IShard.h"
+#include "LoggerInterfaces/Logging.h"
+#include "MatchLimit.h"
+#include "ResultsProcessor.h"
+
+
+namespace BitFunnel
+{
+    ResultsProcessor::ResultsProcessor(std::vector<DocId>& matches)
+        : m_matches(matches),
+          m_shard(nullptr),
+          m_limit(nullptr)
+    {
+    }
+
+
+    void ResultsProcessor::SetLimit(MatchLimit * limit)
+    {
+        m_limit = limit;
+    }
+
+
+    void ResultsProcessor::SetShard(IShard const & shard)
+    {
+        m_shard = &shard;
+    }
+
+
+    void ResultsProcessor::AddResult(uint64_t accumulator, size_t offset)
+    {
+        m_results.push_back(std::make_pair(offset, accumulator));
+    }
+
+
+    bool ResultsProcessor::FinishIteration(void * sliceBuffer)
+    {
+        const size_t matchCount = m_matches.size();
+
+        if (!m_results.empty())
+        {
+            AddMatches(sliceBuffer);
+        }
+
+        return (m_limit != nullptr) &&
+               m_limit->Add(m_matches.size() - matchCount);
+    }
+
+
+    void ResultsProcessor::AddMatches(void * sliceBuffer)
+    {
+        LogAssertB(m_shard != nullptr, "ResultsProcessor: shard not set.");
+
+        std::sort(m_results.begin(), m_results.end());
+
+        size_t i = 0;
+        while (i < m_results.size())
+        {
+            const size_t offset = m_results[i].first;
+            uint64_t accumulator = 0;
+            while (i < m_results.size() && m_results[i].first == offset)
+            {
+                accumulator |= m_results[i].second;
+                ++i;
+            }
+
+            for (size_t bit = 0; accumulator != 0; ++bit, accumulator >>= 1)
+            {
+                if ((accumulator & 1) != 0)
+                {
+                    const DocIndex index = static_cast<DocIndex>(offset * 64 + bit);
+                    m_matches.push_back(m_shard->GetDocId(sliceBuffer, index));
+                }
+            }
+        }
+
+        m_results.clear();
+    }
+}
@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <utility>                              // std::pair parameterizes std::vector.
+#include <vector>                               // std::vector member.
+
+#include "BitFunnel/BitFunnelTypes.h"           // DocId parameterizes std::vector.
+#include "BitFunnel/NonCopyable.h"              // Inherits from NonCopyable.
+#include "BitFunnel/Plan/IResultsProcessor.h"   // Inherits from IResultsProcessor.
+
+
+namespace BitFunnel
+{
+    class MatchLimit;
+    class IShard;
+
+    //*************************************************************************
+    //
+    // ResultsProcessor is an IResultsProcessor that translates the matches
+    // reported for each slice into DocIds.
+    //
+    // A plan with an or-expression at the top may report the same quadword
+    // once for each branch of the or. ResultsProcessor buffers the results
+    // for the current slice and combines results with the same offset in
+    // FinishIteration() so that each matching document is returned once.
+    //
+    // If a MatchLimit is supplied, FinishIteration() charges the slice's
+    // matches against it and requests termination once it is exhausted.
+    //
+    //*************************************************************************
+    class ResultsProcessor : public IResultsProcessor, NonCopyable
+    {
+    public:
+        // Matching DocIds are appended to matches.
+        ResultsProcessor(std::vector<DocId>& matches);
+
+        // Sets the shard that owns the slice buffers passed to subsequent
+        // calls to FinishIteration().
+        void SetShard(IShard const & shard);
+
+        // Sets the MatchLimit shared by the query's ResultsProcessors. The
+        // limit may be nullptr, which is the default.
+        void SetLimit(MatchLimit * limit);
+
+        //
+        // IResultsProcessor methods.
+        //
+        virtual void AddResult(uint64_t accumulator, size_t offset) override;
+        virtual bool FinishIteration(void * sliceBuffer) override;
+
+    private:
+        // Converts the buffered results for the slice to DocIds.
+        void AddMatches(void * sliceBuffer);
+
+        std::vector<DocId>& m_matches;
+        IShard const * m_shard;
+        MatchLimit * m_limit;
+
+        // (offset, accumulator) pairs for the current slice.
+        std::vector<std::pair<size_t, uint64_t>> m_results;
+    };
+}
@@ -0,0 +1,454 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>                        // std::min.
+
+#include "BitFunnel/Exceptions.h"
+#include "CpuFeatures.h"
+#include "LoggerInterfaces/Logging.h"
+#include "RowKernel.h"
+
+
+namespace BitFunnel
+{
+    // Number of quadwords processed per tile. Chosen so that the tile, plus
+    // a tile's worth of one row, fits comfortably in the L1 cache.
+    static const size_t c_tileSize = 512;
+
+
+    //*************************************************************************
+    //
+    // Scalar kernels. These are used for the InstructionSet::Scalar and to
+    // finish the quadwords left over after the last full vector.
+    //
+    //*************************************************************************
+    static void CopyScalar(uint64_t const * source, size_t count, uint64_t * destination)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[i] = source[i];
+        }
+    }
+
+
+    static void CopyInvertedScalar(uint64_t const * source, size_t count, uint64_t * destination)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[i] = ~source[i];
+        }
+    }
+
+
+    static void AndScalar(uint64_t const * source, size_t count, uint64_t * destination)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[i] &= source[i];
+        }
+    }
+
+
+    static void AndNotScalar(uint64_t const * source, size_t count, uint64_t * destination)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[i] &= ~source[i];
+        }
+    }
+
+
+    static void OrScalar(uint64_t const * source, size_t count, uint64_t * destination)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[i] |= source[i];
+        }
+    }
+
+
+    static size_t PopCount(uint64_t const * bitmap, size_t count)
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+#ifdef _MSC_VER
+            total += __popcnt64(bitmap[i]);
+#else
+            total += static_cast<size_t>(__builtin_popcountll(bitmap[i]));
+#endif
+        }
+        return total;
+    }
+
+
+#ifdef BITFUNNEL_CPU_X64
+    //*************************************************************************
+    //
+    // Vector kernels.
+    //
+    // VECTOR_LOOP applies EXPRESSION to each full vector of source (s) and
+    // destination (d) and then hands the remaining quadwords to the scalar
+    // kernel. COPY_LOOP does the same for the copy kernels, whose
+    // EXPRESSION depends only on the source. They do not load the
+    // destination, which may not have been written yet.
+    //
+    // KERNEL defines two versions of each kernel. NAME uses unaligned loads
+    // and stores. NAME##Aligned uses aligned loads and stores, and requires
+    // source and destination to start on a vector boundary.
+    //
+    //*************************************************************************
+#define VECTOR_LOOP(TYPE, LOAD, STORE, EXPRESSION, SCALAR)                  \
+    const size_t c_width = sizeof(TYPE) / sizeof(uint64_t);                 \
+    size_t i = 0;                                                           \
+    for (; i + c_width <= count; i += c_width)                              \
+    {                                                                       \
+        TYPE const s = LOAD(reinterpret_cast<TYPE const *>(source + i));    \
+        TYPE const d = LOAD(reinterpret_cast<TYPE const *>(destination + i)); \
+        STORE(reinterpret_cast<TYPE *>(destination + i), EXPRESSION);       \
+    }                                                                       \
+    SCALAR(source + i, count - i, destination + i);
+
+#define COPY_LOOP(TYPE, LOAD, STORE, EXPRESSION, SCALAR)                    \
+    const size_t c_width = sizeof(TYPE) / sizeof(uint64_t);                 \
+    size_t i = 0;                                                           \
+    for (; i + c_width <= count; i += c_width)                              \
+    {                                                                       \
+        TYPE const s = LOAD(reinterpret_cast<TYPE const *>(source + i));    \
+        STORE(reinterpret_cast<TYPE *>(destination + i), EXPRESSION);       \
+    }                                                                       \
+    SCALAR(source + i, count - i, destination + i);
+
+#define KERNEL(NAME, ISA, LOOP, TYPE, LOADU, STOREU, LOAD, STORE, EXPRESSION, SCALAR) \
+    BITFUNNEL_TARGET(ISA)                                                   \
+    static void NAME(uint64_t const * source, size_t count, uint64_t * destination) \
+    {                                                                       \
+        LOOP(TYPE, LOADU, STOREU, EXPRESSION, SCALAR)                       \
+    }                                                                       \
+                                                                            \
+    BITFUNNEL_TARGET(ISA)                                                   \
+    static void NAME##Aligned(uint64_t const * source, size_t count, uint64_t * destination) \
+    {                                                                       \
+        LOOP(TYPE, LOAD, STORE, EXPRESSION, SCALAR)                         \
+    }
+
+    //
+    // SSE2
+    //
+#define SSE2_KERNEL(NAME, LOOP, EXPRESSION, SCALAR)                         \
+    KERNEL(NAME##SSE2, "sse2", LOOP, __m128i,                               \
+           _mm_loadu_si128, _mm_storeu_si128,                               \
+           _mm_load_si128, _mm_store_si128,                                 \
+           EXPRESSION, SCALAR)
+
+    SSE2_KERNEL(Copy, COPY_LOOP,
+                s,
+                CopyScalar)
+
+    SSE2_KERNEL(CopyInverted, COPY_LOOP,
+                _mm_xor_si128(s, _mm_set1_epi32(-1)),
+                CopyInvertedScalar)
+
+    SSE2_KERNEL(And, VECTOR_LOOP,
+                _mm_and_si128(s, d),
+                AndScalar)
+
+    SSE2_KERNEL(AndNot, VECTOR_LOOP,
+                _mm_andnot_si128(s, d),
+                AndNotScalar)
+
+    SSE2_KERNEL(Or, VECTOR_LOOP,
+                _mm_or_si128(s, d),
+                OrScalar)
+
+
+    //
+    // AVX2
+    //
+#define AVX2_KERNEL(NAME, LOOP, EXPRESSION, SCALAR)                         \
+    KERNEL(NAME##AVX2, "avx2", LOOP, __m256i,                               \
+           _mm256_loadu_si256, _mm256_storeu_si256,                         \
+           _mm256_load_si256, _mm256_store_si256,                           \
+           EXPRESSION, SCALAR)
+
+    AVX2_KERNEL(Copy, COPY_LOOP,
+                s,
+                CopyScalar)
+
+    AVX2_KERNEL(CopyInverted, COPY_LOOP,
+                _mm256_xor_si256(s, _mm256_set1_epi32(-1)),
+                CopyInvertedScalar)
+
+    AVX2_KERNEL(And, VECTOR_LOOP,
+                _mm256_and_si256(s, d),
+                AndScalar)
+
+    AVX2_KERNEL(AndNot, VECTOR_LOOP,
+                _mm256_andnot_si256(s, d),
+                AndNotScalar)
+
+    AVX2_KERNEL(Or, VECTOR_LOOP,
+                _mm256_or_si256(s, d),
+                OrScalar)
+
+
+    //
+    // AVX-512
+    //
+#define AVX512_KERNEL(NAME, LOOP, EXPRESSION, SCALAR)                       \
+    KERNEL(NAME##AVX512, "avx512f", LOOP, __m512i,                          \
+           _mm512_loadu_si512, _mm512_storeu_si512,                         \
+           _mm512_load_si512, _mm512_store_si512,                           \
+           EXPRESSION, SCALAR)
+
+    AVX512_KERNEL(Copy, COPY_LOOP,
+                  s,
+                  CopyScalar)
+
+    AVX512_KERNEL(CopyInverted, COPY_LOOP,
+                  _mm512_xor_si512(s, _mm512_set1_epi32(-1)),
+                  CopyInvertedScalar)
+
+    AVX512_KERNEL(And, VECTOR_LOOP,
+                  _mm512_and_si512(s, d),
+                  AndScalar)
+
+    // Not _mm512_andnot_si512(), which in GCC passes an uninitialized merge
+    // operand to its builtin and trips -Wmaybe-uninitialized.
+    AVX512_KERNEL(AndNot, VECTOR_LOOP,
+                  _mm512_and_si512(_mm512_xor_si512(s, _mm512_set1_epi32(-1)), d),
+                  AndNotScalar)
+
+    AVX512_KERNEL(Or, VECTOR_LOOP,
+                  _mm512_or_si512(s, d),
+                  OrScalar)
+
+#undef AVX512_KERNEL
+#undef AVX2_KERNEL
+#undef SSE2_KERNEL
+#undef KERNEL
+#undef COPY_LOOP
+#undef VECTOR_LOOP
+#endif
+
+
+    //*************************************************************************
+    //
+    // RowKernel
+    //
+    //*************************************************************************
+    RowKernel::RowKernel()
+        : RowKernel(GetBestInstructionSet())
+    {
+    }
+
+
+    RowKernel::RowKernel(InstructionSet instructionSet)
+        : m_instructionSet(instructionSet)
+    {
+        if (!IsSupported(instructionSet))
+        {
+            RecoverableError error("RowKernel: instruction set not supported.");
+            throw error;
+        }
+
+        switch (instructionSet)
+        {
+#ifdef BITFUNNEL_CPU_X64
+#define SET_KERNELS(ISA, TYPE)                                              \
+            m_alignment = sizeof(TYPE);                                     \
+            m_unaligned = { Copy##ISA, CopyInverted##ISA, And##ISA, AndNot##ISA, Or##ISA }; \
+            m_aligned = { Copy##ISA##Aligned, CopyInverted##ISA##Aligned,   \
+                          And##ISA##Aligned, AndNot##ISA##Aligned,          \
+                          Or##ISA##Aligned };
+
+        case SSE2:
+            SET_KERNELS(SSE2, __m128i)
+            break;
+        case AVX2:
+            SET_KERNELS(AVX2, __m256i)
+            break;
+        case AVX512:
+            SET_KERNELS(AVX512, __m512i)
+            break;
+
+#undef SET_KERNELS
+#endif
+        default:
+            m_alignment = sizeof(uint64_t);
+            m_unaligned = { CopyScalar, CopyInvertedScalar, AndScalar, AndNotScalar, OrScalar };
+            m_aligned = m_unaligned;
+            break;
+        }
+    }
+
+
+    RowKernel::InstructionSet RowKernel::GetInstructionSet() const
+    {
+        return m_instructionSet;
+    }
+
+
+    size_t RowKernel::GetAlignment() const
+    {
+        return m_alignment;
+    }
+
+
+    RowKernel::InstructionSet RowKernel::GetBestInstructionSet()
+    {
+        static const InstructionSet c_candidates[] = { AVX512, AVX2, SSE2 };
+        for (auto instructionSet : c_candidates)
+        {
+            if (IsSupported(instructionSet))
+            {
+                return instructionSet;
+            }
+        }
+        return Scalar;
+    }
+
+
+    bool RowKernel::IsSupported(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+        case Scalar:
+            return true;
+        case SSE2:
+            return CpuFeatures::HasSSE2();
+        case AVX2:
+            return CpuFeatures::HasAVX2();
+        case AVX512:
+            return CpuFeatures::HasAVX512F();
+        default:
+            return false;
+        }
+    }
+
+
+    char const * RowKernel::GetName(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+        case Scalar:
+            return "Scalar";
+        case SSE2:
+            return "SSE2";
+        case AVX2:
+            return "AVX2";
+        case AVX512:
+            return "AVX512";
+        default:
+            return "Unknown";
+        }
+    }
+
+
+    size_t RowKernel::And(uint64_t const * const * rows,
+                          bool const * inverted,
+                          size_t rowCount,
+                          size_t qwordCount,
+                          uint64_t * bitmap) const
+    {
+        LogAssertB(rowCount > 0, "RowKernel::And() requires at least one row.");
+
+        Functions const & functions = SelectFunctions(rows, rowCount, bitmap);
+
+        size_t total = 0;
+        for (size_t start = 0; start < qwordCount; start += c_tileSize)
+        {
+            const size_t count = (std::min)(c_tileSize, qwordCount - start);
+            uint64_t * const tile = bitmap + start;
+
+            if (inverted != nullptr && inverted[0])
+            {
+                functions.m_copyInverted(rows[0] + start, count, tile);
+            }
+            else
+            {
+                functions.m_copy(rows[0] + start, count, tile);
+            }
+
+            for (size_t r = 1; r < rowCount; ++r)
+            {
+                if (inverted != nullptr && inverted[r])
+                {
+                    functions.m_andNot(rows[r] + start, count, tile);
+                }
+                else
+                {
+                    functions.m_and(rows[r] + start, count, tile);
+                }
+            }
+
+            total += PopCount(tile, count);
+        }
+
+        return total;
+    }
+
+
+    size_t RowKernel::Or(uint64_t const * const * rows,
+                         size_t rowCount,
+                         size_t qwordCount,
+                         uint64_t * bitmap) const
+    {
+        LogAssertB(rowCount > 0, "RowKernel::Or() requires at least one row.");
+
+        Functions const & functions = SelectFunctions(rows, rowCount, bitmap);
+
+        size_t total = 0;
+        for (size_t start = 0; start < qwordCount; start += c_tileSize)
+        {
+            const size_t count = (std::min)(c_tileSize, qwordCount - start);
+            uint64_t * const tile = bitmap + start;
+
+            functions.m_copy(rows[0] + start, count, tile);
+            for (size_t r = 1; r < rowCount; ++r)
+            {
+                functions.m_or(rows[r] + start, count, tile);
+            }
+
+            total += PopCount(tile, count);
+        }
+
+        return total;
+    }
+
+
+    RowKernel::Functions const &
+        RowKernel::SelectFunctions(uint64_t const * const * rows,
+                                   size_t rowCount,
+                                   uint64_t const * bitmap) const
+    {
+        // Tiles start at multiples of c_tileSize quadwords, so the tiles of
+        // aligned rows and bitmaps are aligned as well.
+        uintptr_t addresses = reinterpret_cast<uintptr_t>(bitmap);
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            addresses |= reinterpret_cast<uintptr_t>(rows[r]);
+        }
+
+        return ((addresses & (m_alignment - 1)) == 0) ? m_aligned : m_unaligned;
+    }
+}
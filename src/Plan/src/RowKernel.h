@@ -0,0 +1,138 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                          // size_t parameter.
+#include <cstdint>                          // uint64_t parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // RowKernel performs bitwise operations over entire rows, or long runs
+    // of quadwords within rows, using the widest vector instructions
+    // supported by the processor.
+    //
+    // And() computes the N-way intersection of a set of rows, any of which
+    // may be inverted, and Or() computes the N-way union. Both write the
+    // result to a bitmap and return the number of bits set in the bitmap.
+    //
+    // The instruction set is selected at runtime. The default constructor
+    // picks the best one available. The other constructor forces a specific
+    // instruction set, which is useful for testing and benchmarking.
+    //
+    // DESIGN NOTE: The kernels process the rows in tiles that fit in the L1
+    // cache. Each row is combined into the tile in turn, so the inner loop
+    // is a simple vector load-and-store with no per-row branches, no matter
+    // how many rows there are.
+    //
+    // Each instruction set has two versions of the kernels. When the bitmap
+    // and every row start on a multiple of GetAlignment() bytes, And() and
+    // Or() use aligned loads and stores. Otherwise they use unaligned ones.
+    // Rows are aligned when the slice buffers are laid out with the
+    // rowAlignment parameter of RowTableDescriptor::GetBufferSize() set to
+    // at least GetAlignment().
+    //
+    //*************************************************************************
+    class RowKernel
+    {
+    public:
+        enum InstructionSet
+        {
+            Scalar,
+            SSE2,
+            AVX2,
+            AVX512
+        };
+
+        // Constructs a RowKernel for the best available instruction set.
+        RowKernel();
+
+        // Constructs a RowKernel for a specific instruction set. Throws if
+        // the instruction set is not supported.
+        RowKernel(InstructionSet instructionSet);
+
+        InstructionSet GetInstructionSet() const;
+
+        // Returns the vector width in bytes. Rows and bitmaps that start on
+        // multiples of this value are processed with aligned loads and
+        // stores.
+        size_t GetAlignment() const;
+
+        // Returns the best instruction set supported by the processor and
+        // the operating system.
+        static InstructionSet GetBestInstructionSet();
+
+        // Returns true if the instruction set can be used.
+        static bool IsSupported(InstructionSet instructionSet);
+
+        // Returns the name of an instruction set.
+        static char const * GetName(InstructionSet instructionSet);
+
+        // Sets bitmap[i] to the bitwise-and of rows[r][i], or ~rows[r][i]
+        // when inverted[r] is true, for i in [0, qwordCount). The inverted
+        // array may be nullptr if no rows are inverted. Returns the number
+        // of bits set in bitmap. The rowCount must be at least one.
+        size_t And(uint64_t const * const * rows,
+                   bool const * inverted,
+                   size_t rowCount,
+                   size_t qwordCount,
+                   uint64_t * bitmap) const;
+
+        // Sets bitmap[i] to the bitwise-or of rows[r][i] for i in
+        // [0, qwordCount). Returns the number of bits set in bitmap. The
+        // rowCount must be at least one.
+        size_t Or(uint64_t const * const * rows,
+                  size_t rowCount,
+                  size_t qwordCount,
+                  uint64_t * bitmap) const;
+
+    private:
+        // Combines count quadwords of source into destination.
+        typedef void (*Function)(uint64_t const * source,
+                                 size_t count,
+                                 uint64_t * destination);
+
+        struct Functions
+        {
+            Function m_copy;
+            Function m_copyInverted;
+            Function m_and;
+            Function m_andNot;
+            Function m_or;
+        };
+
+        // Returns m_aligned if the bitmap and all of the rows start on a
+        // multiple of m_alignment bytes. Otherwise returns m_unaligned.
+        Functions const & SelectFunctions(uint64_t const * const * rows,
+                                          size_t rowCount,
+                                          uint64_t const * bitmap) const;
+
+        InstructionSet m_instructionSet;
+        size_t m_alignment;
+
+        Functions m_unaligned;
+        Functions m_aligned;
+    };
+}
@@ -0,0 +1,222 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Index/IShard.h"
+#include "ByteCodeInterpreter.h"
+#include "ConjunctionMatcher.h"
+#include "LoggerInterfaces/Logging.h"
+#include "MatchLimit.h"
+#include "NativeCodeGenerator.h"
+#include "SliceMatcher.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // SliceMatcher
+    //
+    //*************************************************************************
+    SliceMatcher::SliceMatcher(std::vector<AbstractRow> const * conjunction,
+                               RowKernel const & kernel,
+                               ByteCodeGenerator const * byteCode,
+                               MatchLimit * limit)
+      : m_conjunction((conjunction == nullptr) ?
+                          nullptr :
+                          new ConjunctionMatcher(*conjunction, kernel)),
+        m_byteCode(byteCode),
+        m_limit(limit),
+        m_shard(nullptr),
+        m_results(m_matches)
+    {
+        m_results.SetLimit(limit);
+    }
+
+
+    SliceMatcher::~SliceMatcher()
+    {
+    }
+
+
+    void SliceMatcher::Run(ShardContext const & context,
+                           size_t begin,
+                           size_t end)
+    {
+        if (m_limit != nullptr && m_limit->IsExhausted())
+        {
+            return;
+        }
+
+        if (context.m_shard != m_shard)
+        {
+            m_shard = context.m_shard;
+            m_results.SetShard(*m_shard);
+        }
+
+        LogAssertB(begin <= end && end <= context.m_sliceCount,
+                   "SliceMatcher: slice range past end of slice buffers.");
+
+        char * const * buffers = context.m_sliceBuffers + begin;
+        const size_t sliceCount = end - begin;
+
+        if (m_conjunction != nullptr)
+        {
+            m_conjunction->Run(buffers,
+                               sliceCount,
+                               m_shard->GetSliceCapacity() >> 6,
+                               context.m_rowOffsets,
+                               m_results);
+        }
+        else if (context.m_nativeCode != nullptr)
+        {
+            context.m_nativeCode->Run(buffers,
+                                      sliceCount,
+                                      m_results,
+                                      m_nativeResults);
+        }
+        else
+        {
+            if (m_interpreter == nullptr)
+            {
+                m_interpreter.reset(new ByteCodeInterpreter(*m_byteCode));
+            }
+            m_interpreter->Run(buffers,
+                               sliceCount,
+                               context.m_iterationsPerSlice,
+                               context.m_rowOffsets,
+                               m_results);
+        }
+    }
+
+
+    std::vector<DocId> const & SliceMatcher::GetMatches() const
+    {
+        return m_matches;
+    }
+
+
+    //*************************************************************************
+    //
+    // SliceMatcherSet
+    //
+    //*************************************************************************
+    SliceMatcherSet::SliceMatcherSet(size_t workerCount,
+                                     std::vector<AbstractRow> const * conjunction,
+                                     RowKernel const & kernel,
+                                     ByteCodeGenerator const * byteCode,
+                                     MatchLimit * limit)
+      : m_conjunction(conjunction),
+        m_kernel(kernel),
+        m_byteCode(byteCode),
+        m_limit(limit),
+        m_context(),
+        m_matchers(workerCount)
+    {
+    }
+
+
+    void SliceMatcherSet::SetShard(SliceMatcher::ShardContext const & context)
+    {
+        m_context = context;
+    }
+
+
+    void SliceMatcherSet::Run(size_t begin, size_t end)
+    {
+        GetMatcher(0).Run(m_context, begin, end);
+    }
+
+
+    void SliceMatcherSet::GetMatches(std::vector<DocId>& matches) const
+    {
+        for (auto const & matcher : m_matchers)
+        {
+            if (matcher != nullptr)
+            {
+                matches.insert(matches.end(),
+                               matcher->GetMatches().begin(),
+                               matcher->GetMatches().end());
+            }
+        }
+    }
+
+
+    void SliceMatcherSet::ProcessTask(size_t worker, size_t taskId)
+    {
+        GetMatcher(worker).Run(m_context, taskId, taskId + 1);
+    }
+
+
+    SliceMatcher & SliceMatcherSet::GetMatcher(size_t worker)
+    {
+        // Each worker only touches its own slot, so no lock is needed.
+        std::unique_ptr<SliceMatcher> & matcher = m_matchers[worker];
+        if (matcher == nullptr)
+        {
+            matcher.reset(new SliceMatcher(m_conjunction,
+                                           m_kernel,
+                                           m_byteCode,
+                                           m_limit));
+        }
+        return *matcher;
+    }
+
+
+    //*************************************************************************
+    //
+    // SliceMatcherBatch
+    //
+    //*************************************************************************
+    void SliceMatcherBatch::Add(SliceMatcherSet & matchers)
+    {
+        m_matchers.push_back(&matchers);
+    }
+
+
+    void SliceMatcherBatch::Run(size_t begin, size_t end)
+    {
+        // With a single query there are no rows to share between queries,
+        // so match the whole range in one call.
+        if (m_matchers.size() == 1)
+        {
+            m_matchers[0]->Run(begin, end);
+            return;
+        }
+
+        for (size_t slice = begin; slice < end; ++slice)
+        {
+            for (auto matchers : m_matchers)
+            {
+                matchers->Run(slice, slice + 1);
+            }
+        }
+    }
+
+
+    void SliceMatcherBatch::ProcessTask(size_t worker, size_t taskId)
+    {
+        for (auto matchers : m_matchers)
+        {
+            matchers->ProcessTask(worker, taskId);
+        }
+    }
+}
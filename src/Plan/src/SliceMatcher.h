@@ -0,0 +1,186 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>                                  // ptrdiff_t, size_t members.
+#include <cstdint>                                  // uint64_t parameterizes std::vector.
+#include <memory>                                   // std::unique_ptr member.
+#include <vector>                                   // std::vector member.
+
+#include "BitFunnel/BitFunnelTypes.h"               // DocId parameterizes std::vector.
+#include "BitFunnel/NonCopyable.h"                  // Inherits from NonCopyable.
+#include "BitFunnel/Utilities/IWorkStealingPool.h"  // Inherits from IWorkStealingProcessor.
+#include "ResultsProcessor.h"                       // ResultsProcessor member.
+
+
+namespace BitFunnel
+{
+    class AbstractRow;
+    class ByteCodeGenerator;
+    class ByteCodeInterpreter;
+    class ConjunctionMatcher;
+    class MatchLimit;
+    class NativeCodeGenerator;
+    class RowKernel;
+    class IShard;
+
+    //*************************************************************************
+    //
+    // SliceMatcher runs a compiled plan over a range of the slices in a
+    // shard, using whichever matching backend the QueryPipeline selected, and
+    // accumulates the matching DocIds in its own buffer.
+    //
+    // SliceMatcherSet keeps one SliceMatcher per IWorkStealingPool worker so
+    // that the slices of a shard can be matched in parallel without any
+    // synchronization on the results. The per-worker SliceMatchers are
+    // created on first use, so queries that never split pay only for one.
+    //
+    // SliceMatcherBatch runs a batch of queries, each with its own
+    // SliceMatcherSet, over the same slices. Each slice is matched against
+    // every query in the batch before moving on to the next slice, so rows
+    // shared by the queries are still in the cache when the later queries
+    // read them. A batch of one query matches the whole range at once.
+    //
+    // DESIGN NOTE: Since a SliceMatcher may be run one slice at a time, it
+    // keeps its ByteCodeInterpreter, along with that interpreter's stacks,
+    // and the NativeCodeGenerator results buffer across calls to Run().
+    //
+    //*************************************************************************
+    class SliceMatcher : NonCopyable
+    {
+    public:
+        // Describes the shard whose slices are being matched. Exactly one
+        // of the backends in SliceMatcherSet is used. The nativeCode pointer
+        // is set when the plan has been compiled to native code for this
+        // shard.
+        class ShardContext
+        {
+        public:
+            IShard const * m_shard;
+
+            // A snapshot of the shard's slice buffers, taken once so that
+            // every query in a batch sees the same slices.
+            char * const * m_sliceBuffers;
+            size_t m_sliceCount;
+
+            ptrdiff_t const * m_rowOffsets;
+            size_t m_iterationsPerSlice;
+            NativeCodeGenerator const * m_nativeCode;
+        };
+
+        // If conjunction is not nullptr, slices are matched by a
+        // ConjunctionMatcher over its rows. Otherwise byteCode is interpreted unless the
+        // ShardContext supplies native code. If limit is not nullptr,
+        // matching stops once the limit is exhausted.
+        SliceMatcher(std::vector<AbstractRow> const * conjunction,
+                     RowKernel const & kernel,
+                     ByteCodeGenerator const * byteCode,
+                     MatchLimit * limit);
+
+        ~SliceMatcher();
+
+        // Matches slices [begin, end) of the shard described by context,
+        // unless the MatchLimit is exhausted. end must not exceed the
+        // context's m_sliceCount.
+        void Run(ShardContext const & context, size_t begin, size_t end);
+
+        std::vector<DocId> const & GetMatches() const;
+
+    private:
+        std::unique_ptr<ConjunctionMatcher> m_conjunction;
+        ByteCodeGenerator const * m_byteCode;
+        MatchLimit * m_limit;
+
+        IShard const * m_shard;
+        std::vector<DocId> m_matches;
+        ResultsProcessor m_results;
+
+        // Created on first use of the byte code backend.
+        std::unique_ptr<ByteCodeInterpreter> m_interpreter;
+
+        // Scratch buffer for NativeCodeGenerator::Run().
+        std::vector<uint64_t> m_nativeResults;
+    };
+
+
+    class SliceMatcherSet : public IWorkStealingProcessor, NonCopyable
+    {
+    public:
+        // Parameters are passed to each SliceMatcher constructor.
+        SliceMatcherSet(size_t workerCount,
+                        std::vector<AbstractRow> const * conjunction,
+                        RowKernel const & kernel,
+                        ByteCodeGenerator const * byteCode,
+                        MatchLimit * limit);
+
+        // Sets the shard matched by subsequent calls to Run() and
+        // ProcessTask().
+        void SetShard(SliceMatcher::ShardContext const & context);
+
+        // Matches slices [begin, end) on the calling thread as worker 0.
+        void Run(size_t begin, size_t end);
+
+        // Appends the matches from every worker to matches.
+        void GetMatches(std::vector<DocId>& matches) const;
+
+        //
+        // IWorkStealingProcessor methods.
+        //
+
+        // Matches the slice with index taskId.
+        virtual void ProcessTask(size_t worker, size_t taskId) override;
+
+    private:
+        SliceMatcher & GetMatcher(size_t worker);
+
+        std::vector<AbstractRow> const * m_conjunction;
+        RowKernel const & m_kernel;
+        ByteCodeGenerator const * m_byteCode;
+        MatchLimit * m_limit;
+
+        SliceMatcher::ShardContext m_context;
+        std::vector<std::unique_ptr<SliceMatcher>> m_matchers;
+    };
+
+
+    class SliceMatcherBatch : public IWorkStealingProcessor, NonCopyable
+    {
+    public:
+        // Adds a query to the batch. The SliceMatcherSet must already be
+        // set to the shard being matched.
+        void Add(SliceMatcherSet & matchers);
+
+        // Matches slices [begin, end) on the calling thread.
+        void Run(size_t begin, size_t end);
+
+        //
+        // IWorkStealingProcessor methods.
+        //
+
+        // Matches the slice with index taskId against every query.
+        virtual void ProcessTask(size_t worker, size_t taskId) override;
+
+    private:
+        std::vector<SliceMatcherSet *> m_matchers;
+    };
+}
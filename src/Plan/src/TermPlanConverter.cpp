@@ -0,0 +1,257 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>                        // std::max, std::min.
+
+#include "BitFunnel/Allocators/IAllocator.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Plan/IPlanRows.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "BitFunnel/Term.h"
+#include "StringVector.h"
+#include "TermPlanConverter.h"
+
+
+namespace BitFunnel
+{
+    RowMatchNode const &
+        TermPlanConverter::BuildRowPlan(TermMatchNode const & root,
+                                        IConfiguration const & configuration,
+                                        IPlanRows & planRows,
+                                        IAllocator& allocator)
+    {
+        TermPlanConverter converter(configuration, planRows, allocator);
+
+        RowMatchNode::Builder builder(RowMatchNode::AndMatch, allocator);
+        builder.AddChild(converter.BuildMatchTree(root));
+
+        // Every plan must be restricted to documents that are active. System
+        // terms have the same hash in every shard's TermTable.
+        Term documentActive = planRows.GetTermTable(0).GetDocumentActiveTerm();
+        builder.AddChild(converter.AddTerm(documentActive));
+
+        return *builder.Complete();
+    }
+
+
+    TermPlanConverter::TermPlanConverter(IConfiguration const & configuration,
+                                         IPlanRows & planRows,
+                                         IAllocator& allocator)
+      : m_configuration(configuration),
+        m_planRows(planRows),
+        m_allocator(allocator)
+    {
+        if (planRows.GetShardCount() == 0)
+        {
+            RecoverableError error("TermPlanConverter: index has no shards.");
+            throw error;
+        }
+
+        for (ShardId shard = 0; shard < planRows.GetShardCount(); ++shard)
+        {
+            ITermTable const & termTable = planRows.GetTermTable(shard);
+            RowIdSequence rows(termTable.GetMatchAllTerm(), termTable);
+            auto it = rows.begin();
+            if (it == rows.end())
+            {
+                RecoverableError error("TermPlanConverter: expected a match-all row.");
+                throw error;
+            }
+            m_matchAllRows.push_back(*it);
+        }
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::And const &>(node));
+        case TermMatchNode::NotMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::Not const &>(node));
+        case TermMatchNode::OrMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::Or const &>(node));
+        case TermMatchNode::PhraseMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::Phrase const &>(node));
+        case TermMatchNode::UnigramMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::Unigram const &>(node));
+        case TermMatchNode::FactMatch:
+            return BuildMatchTree(dynamic_cast<TermMatchNode::Fact const &>(node));
+        default:
+            RecoverableError error("TermPlanConverter::BuildMatchTree: Invalid node type.");
+            throw error;
+        }
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::And const & node)
+    {
+        RowMatchNode::Builder builder(RowMatchNode::AndMatch, m_allocator);
+        builder.AddChild(BuildMatchTree(node.GetLeft()));
+        builder.AddChild(BuildMatchTree(node.GetRight()));
+        return builder.Complete();
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::Not const & node)
+    {
+        RowMatchNode::Builder builder(RowMatchNode::NotMatch, m_allocator);
+        builder.AddChild(BuildMatchTree(node.GetChild()));
+        return builder.Complete();
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::Or const & node)
+    {
+        RowMatchNode::Builder builder(RowMatchNode::OrMatch, m_allocator);
+        builder.AddChild(BuildMatchTree(node.GetLeft()));
+        builder.AddChild(BuildMatchTree(node.GetRight()));
+        return builder.Complete();
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::Phrase const & node)
+    {
+        StringVector const & grams = node.GetGrams();
+        const size_t gramCount = grams.GetSize();
+        if (gramCount == 0)
+        {
+            RecoverableError error("TermPlanConverter::BuildMatchTree: empty phrase.");
+            throw error;
+        }
+
+        // The index only contains n-grams up to the configured maximum gram
+        // size. Longer phrases are converted to an and-expression of the
+        // overlapping n-grams of maximum size. This may introduce false
+        // positives, but never false negatives.
+        const size_t windowSize =
+            (std::min)(gramCount, m_configuration.GetMaxGramSize());
+
+        RowMatchNode::Builder builder(RowMatchNode::AndMatch, m_allocator);
+        for (size_t start = 0; start + windowSize <= gramCount; ++start)
+        {
+            // Phrases must be formed exactly as they are during ingestion
+            // (see Document::ProcessNGrams()) since Term::AddTerm() is not
+            // commutative.
+            Term term(grams[static_cast<unsigned>(start)],
+                      node.GetStreamId(),
+                      m_configuration);
+            for (size_t i = 1; i < windowSize; ++i)
+            {
+                Term next(grams[static_cast<unsigned>(start + i)],
+                          node.GetStreamId(),
+                          m_configuration);
+                term.AddTerm(next, m_configuration);
+            }
+            builder.AddChild(AddTerm(term));
+        }
+
+        return builder.Complete();
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::Unigram const & node)
+    {
+        Term term(node.GetText(), node.GetStreamId(), m_configuration);
+        return AddTerm(term);
+    }
+
+
+    RowMatchNode const * TermPlanConverter::BuildMatchTree(TermMatchNode::Fact const & node)
+    {
+        // Facts are stored as rank zero terms with the FactHandle as hash.
+        // See Shard::AssertFact().
+        Term term(node.GetFact(), 0u, 0u, 1u);
+        return AddTerm(term);
+    }
+
+
+    RowMatchNode const * TermPlanConverter::AddTerm(Term const & term)
+    {
+        const ShardId shardCount = m_planRows.GetShardCount();
+
+        // Determine the number of AbstractRows needed at each rank. This is
+        // the maximum, over all shards, of the number of RowIds at that rank.
+        unsigned rowCounts[c_maxRankValue + 1] = {};
+        unsigned totalCount = 0;
+        for (ShardId shard = 0; shard < shardCount; ++shard)
+        {
+            unsigned shardCounts[c_maxRankValue + 1] = {};
+            RowIdSequence rows(term, m_planRows.GetTermTable(shard));
+            for (auto row : rows)
+            {
+                ++shardCounts[row.GetRank()];
+            }
+
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                rowCounts[rank] = (std::max)(rowCounts[rank], shardCounts[rank]);
+                totalCount += shardCounts[rank];
+            }
+        }
+
+        if (totalCount == 0)
+        {
+            // A term with no rows in any shard cannot rule out any document.
+            // Represent it with a single match-all row.
+            rowCounts[0] = 1;
+        }
+
+        // Allocate the AbstractRows, initially mapping each of them to the
+        // match-all row in every shard.
+        unsigned firstIds[c_maxRankValue + 1] = {};
+        RowMatchNode::Builder builder(RowMatchNode::AndMatch, m_allocator);
+        for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+        {
+            firstIds[rank] = m_planRows.GetRowCount();
+            for (unsigned i = 0; i < rowCounts[rank]; ++i)
+            {
+                AbstractRow row = m_planRows.AddRow(rank);
+                for (ShardId shard = 0; shard < shardCount; ++shard)
+                {
+                    m_planRows.PhysicalRow(shard, row.GetId()) =
+                        m_matchAllRows[shard];
+                }
+                builder.AddChild(RowMatchNode::Builder::CreateRowNode(row, m_allocator));
+            }
+        }
+
+        // Record the physical rows for each shard.
+        for (ShardId shard = 0; shard < shardCount; ++shard)
+        {
+            unsigned used[c_maxRankValue + 1] = {};
+            RowIdSequence rows(term, m_planRows.GetTermTable(shard));
+            for (auto row : rows)
+            {
+                const Rank rank = row.GetRank();
+                m_planRows.PhysicalRow(shard, firstIds[rank] + used[rank]++) = row;
+            }
+        }
+
+        return builder.Complete();
+    }
+}
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <vector>                           // std::vector member.
+
+#include "BitFunnel/Index/RowId.h"          // RowId parameterizes std::vector.
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/TermMatchNode.h"   // TermMatchNode::And, etc. parameters.
+
+
+namespace BitFunnel
+{
+    class IAllocator;
+    class IConfiguration;
+    class IPlanRows;
+    class RowMatchNode;
+    class Term;
+
+    //*************************************************************************
+    //
+    // TermPlanConverter translates a tree of TermMatchNodes into the tree of
+    // RowMatchNodes that is consumed by the MatchTreeRewriter.
+    //
+    // Each Unigram, Phrase, and Fact leaf is converted to a Term which is
+    // then resolved, in every shard, to the sequence of RowIds supplied by
+    // that shard's ITermTable. The RowIds are grouped by rank and each group
+    // is assigned a block of AbstractRows in the IPlanRows. Since different
+    // shards may use different numbers of rows at a given rank, the number
+    // of AbstractRows is the maximum over the shards. Shards with fewer rows
+    // map the remaining AbstractRows to their match-all row, which is a
+    // no-op in an and-expression.
+    //
+    // The resulting tree is an and-expression of the converted query and the
+    // DocumentActive row, which filters out documents that have not been
+    // committed or have been soft-deleted.
+    //
+    //*************************************************************************
+    class TermPlanConverter : NonCopyable
+    {
+    public:
+        // Converts the TermMatchNode tree to a RowMatchNode tree. RowIds are
+        // recorded in planRows and RowMatchNodes are allocated from
+        // allocator.
+        static RowMatchNode const & BuildRowPlan(TermMatchNode const & root,
+                                                 IConfiguration const & configuration,
+                                                 IPlanRows & planRows,
+                                                 IAllocator& allocator);
+
+    private:
+        TermPlanConverter(IConfiguration const & configuration,
+                          IPlanRows & planRows,
+                          IAllocator& allocator);
+
+        RowMatchNode const * BuildMatchTree(TermMatchNode const & node);
+
+        RowMatchNode const * BuildMatchTree(TermMatchNode::And const & node);
+        RowMatchNode const * BuildMatchTree(TermMatchNode::Not const & node);
+        RowMatchNode const * BuildMatchTree(TermMatchNode::Or const & node);
+        RowMatchNode const * BuildMatchTree(TermMatchNode::Phrase const & node);
+        RowMatchNode const * BuildMatchTree(TermMatchNode::Unigram const & node);
+        RowMatchNode const * BuildMatchTree(TermMatchNode::Fact const & node);
+
+        // Allocates AbstractRows for the rows associated with the term in
+        // each shard and returns an and-expression of these rows.
+        RowMatchNode const * AddTerm(Term const & term);
+
+        IConfiguration const & m_configuration;
+        IPlanRows & m_planRows;
+        IAllocator& m_allocator;
+
+        // The match-all RowId for each shard.
+        std::vector<RowId> m_matchAllRows;
+    };
+}
@@ -0,0 +1,177 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <vector>
+
+#include "Allocator.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "ByteCodeGenerator.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace ByteCodeInterpreterTest
+    {
+        //*********************************************************************
+        //
+        // Records every result, along with the index of its slice.
+        //
+        //*********************************************************************
+        class RecordingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            struct Result
+            {
+                size_t m_slice;
+                size_t m_offset;
+                uint64_t m_accumulator;
+            };
+
+            RecordingResultsProcessor()
+                : m_slice(0)
+            {
+            }
+
+            virtual void AddResult(uint64_t accumulator, size_t offset) override
+            {
+                m_results.push_back({ m_slice, offset, accumulator });
+            }
+
+            virtual bool FinishIteration(void * /*sliceBuffer*/) override
+            {
+                ++m_slice;
+                return false;
+            }
+
+            size_t m_slice;
+            std::vector<Result> m_results;
+        };
+
+
+        void Compile(char const * text,
+                     IAllocator& allocator,
+                     ByteCodeGenerator& code)
+        {
+            std::stringstream input(text);
+            TextObjectParser parser(input, allocator, &CompileNode::GetType);
+            CompileNode const & node = CompileNode::Parse(parser);
+            node.Compile(code);
+            code.Seal();
+        }
+
+
+        TEST(ByteCodeGenerator, UnplacedLabel)
+        {
+            ByteCodeGenerator code;
+            auto label = code.AllocateLabel();
+            code.Jz(label);
+
+            ASSERT_THROW(code.Seal(), RecoverableError);
+        }
+
+
+        // Runs a RankDown plan over synthetic slices and compares the
+        // results with a direct evaluation of the same expression.
+        TEST(ByteCodeInterpreter, RankDown)
+        {
+            // Each slice holds a rank one row with two quadwords, followed
+            // by two rank zero rows with four quadwords each.
+            const size_t c_sliceCount = 3;
+            const size_t c_qwordsPerSlice = 2 + 4 + 4;
+            std::vector<uint64_t> buffers(c_sliceCount * c_qwordsPerSlice);
+            for (size_t i = 0; i < buffers.size(); ++i)
+            {
+                buffers[i] = (0x9E3779B97F4A7C15ull * (i + 1)) ^ (i << 17);
+            }
+
+            // Zero out one rank one quadword so that RankDown is skipped.
+            buffers[c_qwordsPerSlice + 1] = 0;
+
+            std::vector<char *> sliceBuffers;
+            for (size_t s = 0; s < c_sliceCount; ++s)
+            {
+                sliceBuffers.push_back(
+                    reinterpret_cast<char *>(buffers.data() + s * c_qwordsPerSlice));
+            }
+
+            const ptrdiff_t rowOffsets[] = { 0, 16, 48 };
+
+            Allocator allocator(4096);
+            ByteCodeGenerator code;
+            Compile("LoadRowJz {"
+                    "  Row: Row(0, 1, 0, false),"
+                    "  Child: RankDown {"
+                    "    Delta: 1,"
+                    "    Child: AndRowJz {"
+                    "      Row: Row(1, 0, 0, false),"
+                    "      Child: Report {"
+                    "        Child: LoadRow(2, 0, 0, true)"
+                    "      }"
+                    "    }"
+                    "  }"
+                    "}",
+                    allocator,
+                    code);
+
+            RecordingResultsProcessor results;
+            ByteCodeInterpreter interpreter(code);
+            interpreter.Run(sliceBuffers.data(),
+                            c_sliceCount,
+                            2,
+                            rowOffsets,
+                            results);
+
+            EXPECT_EQ(results.m_slice, c_sliceCount);
+
+            std::vector<RecordingResultsProcessor::Result> expected;
+            for (size_t s = 0; s < c_sliceCount; ++s)
+            {
+                uint64_t const * slice = buffers.data() + s * c_qwordsPerSlice;
+                for (size_t offset = 0; offset < 4; ++offset)
+                {
+                    const uint64_t value =
+                        slice[offset >> 1] & slice[2 + offset] & ~slice[6 + offset];
+                    if (value != 0)
+                    {
+                        expected.push_back({ s, offset, value });
+                    }
+                }
+            }
+
+            ASSERT_EQ(results.m_results.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                EXPECT_EQ(results.m_results[i].m_slice, expected[i].m_slice);
+                EXPECT_EQ(results.m_results[i].m_offset, expected[i].m_offset);
+                EXPECT_EQ(results.m_results[i].m_accumulator,
+                          expected[i].m_accumulator);
+            }
+        }
+    }
+}
@@ -0,0 +1,199 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstring>
+#include <sstream>
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IShardDefinition.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IConfiguration.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
+#include "BitFunnel/Index/IIndexedIdfTable.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IRecycler.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "Document.h"
+#include "IngestorWrapper.h"
+#include "Shard.h"
+
+
+namespace BitFunnel
+{
+    // Creates a sealed TermTable that uses the same recipe for every
+    // (IdfX10, GramSize) pair.
+    static std::unique_ptr<ITermTable>
+        CreateTermTable(std::vector<Rank> const & adhocRecipe)
+    {
+        std::unique_ptr<ITermTable> termTable(Factories::CreateTermTable());
+
+        if (!adhocRecipe.empty())
+        {
+            std::vector<size_t> adhocRowCounts(c_maxRankValue + 1, 0);
+            for (Term::IdfX10 idf = 0; idf <= Term::c_maxIdfX10Value; ++idf)
+            {
+                for (Term::GramSize gramSize = 0; gramSize <= Term::c_maxGramSize; ++gramSize)
+                {
+                    termTable->OpenTerm();
+                    for (auto rank : adhocRecipe)
+                    {
+                        termTable->AddRowId(RowId(0, rank, 0));
+                        adhocRowCounts[rank] = IngestorWrapper::c_adhocRowCount;
+                    }
+                    termTable->CloseAdhocTerm(idf, gramSize);
+                }
+            }
+
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                // The system rows are the only explicit rows.
+                const size_t explicitRowCount =
+                    (rank == 0) ? ITermTable::SystemTerm::Count : 0;
+                termTable->SetRowCounts(rank,
+                                        explicitRowCount,
+                                        adhocRowCounts[rank]);
+            }
+        }
+        termTable->Seal();
+
+        return termTable;
+    }
+
+
+    IngestorWrapper::IngestorWrapper(std::vector<Rank> const & adhocRecipe,
+                                     size_t maxGramSize,
+                                     std::vector<size_t> const & shardMaxPostingCounts)
+      : m_recycler(Factories::CreateRecycler()),
+        m_idfTable(Factories::CreateIndexedIdfTable()),
+        m_schema(Factories::CreateDocumentDataSchema()),
+        m_shardDefinition(Factories::CreateShardDefinition()),
+        m_termTable(CreateTermTable(adhocRecipe))
+    {
+        m_recyclerThread = std::async(std::launch::async,
+                                      &IRecycler::Run,
+                                      m_recycler.get());
+
+        m_configuration = Factories::CreateConfiguration(maxGramSize,
+                                                         false,
+                                                         *m_idfTable);
+
+        for (auto count : shardMaxPostingCounts)
+        {
+            m_shardDefinition->AddShard(count);
+        }
+
+
+        const size_t blockSize = Shard::InitializeDescriptors(nullptr,
+                                                              c_sliceCapacity,
+                                                              *m_schema,
+                                                              *m_termTable);
+        const size_t blockCount = 16;
+        m_sliceBufferAllocator =
+            Factories::CreateSliceBufferAllocator(blockSize, blockCount);
+
+        m_ingestor = Factories::CreateIngestor(*m_schema,
+                                               *m_recycler,
+                                               *this,
+                                               *m_shardDefinition,
+                                               *m_sliceBufferAllocator);
+    }
+
+
+    IngestorWrapper::~IngestorWrapper()
+    {
+        m_ingestor.reset();
+        m_recycler->Shutdown();
+        m_recyclerThread.wait();
+    }
+
+
+    void IngestorWrapper::AddDocument(DocId id, char const * text)
+    {
+        std::unique_ptr<Document>
+            document(new Document(*m_configuration, id));
+
+        document->OpenStream(0);
+        std::stringstream words(text);
+        std::string word;
+        while (words >> word)
+        {
+            document->AddTerm(word.c_str());
+        }
+        document->CloseStream();
+        document->CloseDocument(strlen(text));
+
+        m_ingestor->Add(id, *document);
+        m_documents.push_back(std::move(document));
+    }
+
+
+    void IngestorWrapper::ReplaceTermTable(std::vector<Rank> const & adhocRecipe)
+    {
+        std::unique_ptr<ITermTable> termTable(CreateTermTable(adhocRecipe));
+        for (ShardId shard = 0; shard < m_ingestor->GetShardCount(); ++shard)
+        {
+            m_ingestor->GetShard(shard).SetTermTable(*termTable);
+        }
+
+        m_retiredTermTables.push_back(std::move(m_termTable));
+        m_termTable = std::move(termTable);
+    }
+
+
+    IConfiguration const & IngestorWrapper::GetConfiguration() const
+    {
+        return *m_configuration;
+    }
+
+
+    IIngestor & IngestorWrapper::GetIngestor() const
+    {
+        return *m_ingestor;
+    }
+
+
+    size_t IngestorWrapper::GetDocumentCount() const
+    {
+        return m_documents.size();
+    }
+
+
+    IDocument const & IngestorWrapper::GetDocument(size_t index) const
+    {
+        return *m_documents[index];
+    }
+
+
+    ITermTable & IngestorWrapper::GetTermTable(ShardId /*shard*/) const
+    {
+        return *m_termTable;
+    }
+
+
+    size_t IngestorWrapper::size() const
+    {
+        return m_shardDefinition->GetShardCount();
+    }
+}
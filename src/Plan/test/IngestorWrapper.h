@@ -0,0 +1,118 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <future>                           // std::future member.
+#include <memory>                           // std::unique_ptr member.
+#include <vector>                           // std::vector parameter.
+
+#include "BitFunnel/BitFunnelTypes.h"       // DocId, Rank parameters.
+#include "BitFunnel/Index/ITermTableCollection.h"   // Inherits from ITermTableCollection.
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    class Document;
+    class IConfiguration;
+    class IDocument;
+    class IDocumentDataSchema;
+    class IIndexedIdfTable;
+    class IIngestor;
+    class IRecycler;
+    class IShardDefinition;
+    class ISliceBufferAllocator;
+    class ITermTable;
+
+    //*************************************************************************
+    //
+    // IngestorWrapper creates an IIngestor, plus all of the things an
+    // IIngestor depends on, so that Plan tests can ingest small corpora
+    // without a lot of scaffolding.
+    //
+    // Every shard shares a single TermTable in which each adhoc term is
+    // assigned one row at each of the ranks listed in the adhoc recipe. An
+    // empty recipe yields a TermTable with only the system rows.
+    //
+    //*************************************************************************
+    class IngestorWrapper : public ITermTableCollection, NonCopyable
+    {
+    public:
+        // shardMaxPostingCounts is passed to IShardDefinition::AddShard().
+        // An empty vector results in a single shard.
+        IngestorWrapper(std::vector<Rank> const & adhocRecipe,
+                        size_t maxGramSize,
+                        std::vector<size_t> const & shardMaxPostingCounts =
+                            std::vector<size_t>());
+
+        ~IngestorWrapper();
+
+        // Ingests a document consisting of a single stream of space separated
+        // words.
+        void AddDocument(DocId id, char const * text);
+
+        // Gives every shard a new TermTable built from adhocRecipe, which
+        // must assign the same number of rows at each rank as the recipe
+        // passed to the constructor. Documents already ingested keep the
+        // bits they were given under the previous TermTable.
+        void ReplaceTermTable(std::vector<Rank> const & adhocRecipe);
+
+        IConfiguration const & GetConfiguration() const;
+        IIngestor & GetIngestor() const;
+
+        // Returns the documents in the order they were added.
+        size_t GetDocumentCount() const;
+        IDocument const & GetDocument(size_t index) const;
+
+        //
+        // ITermTableCollection methods.
+        //
+        virtual ITermTable & GetTermTable(ShardId shard) const override;
+        virtual size_t size() const override;
+
+        // Number of documents in each slice.
+        static const DocIndex c_sliceCapacity = 4096;
+
+        // Number of adhoc rows at each rank used in the adhoc recipe.
+        static const size_t c_adhocRowCount = 1000;
+
+    private:
+        std::unique_ptr<IRecycler> m_recycler;
+        std::future<void> m_recyclerThread;
+
+        std::unique_ptr<IIndexedIdfTable> m_idfTable;
+        std::unique_ptr<IConfiguration> m_configuration;
+        std::unique_ptr<IDocumentDataSchema> m_schema;
+        std::unique_ptr<IShardDefinition> m_shardDefinition;
+        std::unique_ptr<ITermTable> m_termTable;
+
+        // TermTables replaced by ReplaceTermTable(), which are kept alive
+        // for queries that may still reference them.
+        std::vector<std::unique_ptr<ITermTable>> m_retiredTermTables;
+        std::unique_ptr<ISliceBufferAllocator> m_sliceBufferAllocator;
+        std::unique_ptr<IIngestor> m_ingestor;
+
+        std::vector<std::unique_ptr<Document>> m_documents;
+    };
+}
@@ -0,0 +1,349 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+#include "Allocator.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "ByteCodeGenerator.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "NativeCodeGenerator.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace NativeCodeGeneratorTest
+    {
+        //*********************************************************************
+        //
+        // Records every result, along with the index of its slice. Requests
+        // termination after stopAfter slices.
+        //
+        //*********************************************************************
+        class RecordingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            RecordingResultsProcessor(size_t stopAfter = SIZE_MAX)
+                : m_slice(0),
+                  m_stopAfter(stopAfter)
+            {
+            }
+
+            virtual void AddResult(uint64_t accumulator, size_t offset) override
+            {
+                m_results.push_back(m_slice);
+                m_results.push_back(offset);
+                m_results.push_back(accumulator);
+            }
+
+            virtual bool FinishIteration(void * /*sliceBuffer*/) override
+            {
+                ++m_slice;
+                return m_slice >= m_stopAfter;
+            }
+
+            size_t m_slice;
+            size_t m_stopAfter;
+            std::vector<uint64_t> m_results;
+        };
+
+
+        //*********************************************************************
+        //
+        // Throws from FinishIteration() at the end of slice throwAt.
+        //
+        //*********************************************************************
+        class ThrowingResultsProcessor : public RecordingResultsProcessor
+        {
+        public:
+            ThrowingResultsProcessor(size_t throwAt)
+                : m_throwAt(throwAt)
+            {
+            }
+
+            virtual bool FinishIteration(void * sliceBuffer) override
+            {
+                RecordingResultsProcessor::FinishIteration(sliceBuffer);
+                if (m_slice > m_throwAt)
+                {
+                    RecoverableError error("ThrowingResultsProcessor");
+                    throw error;
+                }
+                return false;
+            }
+
+        private:
+            size_t m_throwAt;
+        };
+
+
+        CompileNode const & Parse(char const * text, IAllocator& allocator)
+        {
+            std::stringstream input(text);
+            TextObjectParser parser(input, allocator, &CompileNode::GetType);
+            return CompileNode::Parse(parser);
+        }
+
+
+        // Plans exercising each of the primitives. Every plan has an initial
+        // rank of three and references rows 0 (rank 3), 1 (rank 1), and
+        // 2 through 4 (rank 0).
+        char const * c_plans[] =
+        {
+            // RankDown with an inverted row and a Report child.
+            "LoadRowJz {"
+            "  Row: Row(0, 3, 0, false),"
+            "  Child: RankDown {"
+            "    Delta: 2,"
+            "    Child: AndRowJz {"
+            "      Row: Row(1, 1, 0, true),"
+            "      Child: RankDown {"
+            "        Delta: 1,"
+            "        Child: AndRowJz {"
+            "          Row: Row(2, 0, 0, false),"
+            "          Child: Report {"
+            "            Child: OrTree {"
+            "              Children: ["
+            "                LoadRow(3, 0, 0, false),"
+            "                Not {"
+            "                  Child: LoadRow(4, 0, 0, false)"
+            "                }"
+            "              ]"
+            "            }"
+            "          }"
+            "        }"
+            "      }"
+            "    }"
+            "  }"
+            "}",
+
+            // Or of two plans, one of which evaluates rows at a higher rank
+            // using rank deltas.
+            "LoadRowJz {"
+            "  Row: Row(0, 3, 0, false),"
+            "  Child: Or {"
+            "    Children: ["
+            "      RankDown {"
+            "        Delta: 3,"
+            "        Child: AndRowJz {"
+            "          Row: Row(1, 0, 1, false),"
+            "          Child: AndRowJz {"
+            "            Row: Row(2, 0, 0, false),"
+            "            Child: Report {"
+            "              Child:"
+            "            }"
+            "          }"
+            "        }"
+            "      },"
+            "      RankDown {"
+            "        Delta: 3,"
+            "        Child: AndRowJz {"
+            "          Row: Row(3, 0, 0, false),"
+            "          Child: Report {"
+            "            Child: AndTree {"
+            "              Children: ["
+            "                LoadRow(4, 0, 0, true),"
+            "                LoadRow(0, 0, 3, false)"
+            "              ]"
+            "            }"
+            "          }"
+            "        }"
+            "      }"
+            "    ]"
+            "  }"
+            "}",
+        };
+
+
+        TEST(NativeCodeGenerator, UnplacedLabel)
+        {
+            if (!NativeCodeGenerator::IsSupported())
+            {
+                return;
+            }
+
+            const ptrdiff_t rowOffsets[] = { 0 };
+            NativeCodeGenerator code(rowOffsets, 1, 1);
+            auto label = code.AllocateLabel();
+            code.Jz(label);
+
+            ASSERT_THROW(code.Seal(), RecoverableError);
+        }
+
+
+        // Runs each plan as native code and as byte code over synthetic
+        // slices and verifies that the results are identical.
+        TEST(NativeCodeGenerator, MatchesInterpreter)
+        {
+            if (!NativeCodeGenerator::IsSupported())
+            {
+                return;
+            }
+
+            // Each slice holds 64 rank zero quadwords: a rank three row, a
+            // rank one row, and three rank zero rows.
+            const size_t c_sliceCount = 5;
+            const size_t c_qwordsPerSlice = 8 + 32 + 3 * 64;
+            const ptrdiff_t rowOffsets[] = {
+                0,
+                8 * 8,
+                (8 + 32) * 8,
+                (8 + 32 + 64) * 8,
+                (8 + 32 + 128) * 8
+            };
+            const size_t c_iterationsPerSlice = 64 >> 3;
+
+            // Fill the rows with sparse, pseudo-random bits, leaving the
+            // last slice empty.
+            std::vector<uint64_t> buffers(c_sliceCount * c_qwordsPerSlice);
+            uint64_t state = 12345;
+            for (size_t i = 0; i < (c_sliceCount - 1) * c_qwordsPerSlice; ++i)
+            {
+                uint64_t value = ~0ull;
+                for (unsigned j = 0; j < 2; ++j)
+                {
+                    state = state * 6364136223846793005ull + 1442695040888963407ull;
+                    value &= state ^ (state >> 29);
+                }
+                buffers[i] = value;
+            }
+
+            std::vector<char *> sliceBuffers;
+            for (size_t s = 0; s < c_sliceCount; ++s)
+            {
+                sliceBuffers.push_back(
+                    reinterpret_cast<char *>(buffers.data() + s * c_qwordsPerSlice));
+            }
+
+            for (auto plan : c_plans)
+            {
+                Allocator allocator(4096);
+                CompileNode const & node = Parse(plan, allocator);
+
+                ByteCodeGenerator byteCode;
+                node.Compile(byteCode);
+                byteCode.Seal();
+
+                RecordingResultsProcessor expected;
+                ByteCodeInterpreter interpreter(byteCode);
+                interpreter.Run(sliceBuffers.data(),
+                                sliceBuffers.size(),
+                                c_iterationsPerSlice,
+                                rowOffsets,
+                                expected);
+
+                NativeCodeGenerator nativeCode(rowOffsets,
+                                               sizeof(rowOffsets) / sizeof(rowOffsets[0]),
+                                               c_iterationsPerSlice);
+                node.Compile(nativeCode);
+                nativeCode.Seal();
+
+                RecordingResultsProcessor observed;
+                nativeCode.Run(sliceBuffers.data(), sliceBuffers.size(), observed);
+
+                EXPECT_EQ(observed.m_slice, c_sliceCount);
+                EXPECT_FALSE(expected.m_results.empty());
+                EXPECT_EQ(observed.m_results, expected.m_results);
+
+                // Both should stop when the IResultsProcessor asks them to.
+                RecordingResultsProcessor expectedPartial(2);
+                interpreter.Run(sliceBuffers.data(),
+                                sliceBuffers.size(),
+                                c_iterationsPerSlice,
+                                rowOffsets,
+                                expectedPartial);
+
+                RecordingResultsProcessor observedPartial(2);
+                nativeCode.Run(sliceBuffers.data(), sliceBuffers.size(), observedPartial);
+
+                EXPECT_EQ(expectedPartial.m_slice, 2u);
+                EXPECT_EQ(observedPartial.m_slice, 2u);
+                EXPECT_LT(observedPartial.m_results.size(), observed.m_results.size());
+                EXPECT_EQ(observedPartial.m_results, expectedPartial.m_results);
+            }
+        }
+
+
+        TEST(NativeCodeGenerator, NoSlices)
+        {
+            if (!NativeCodeGenerator::IsSupported())
+            {
+                return;
+            }
+
+            Allocator allocator(4096);
+            CompileNode const & node = Parse(c_plans[0], allocator);
+
+            const ptrdiff_t rowOffsets[] = { 0, 0, 0, 0, 0 };
+            NativeCodeGenerator nativeCode(rowOffsets, 5, 1);
+            node.Compile(nativeCode);
+            nativeCode.Seal();
+
+            RecordingResultsProcessor observed;
+            nativeCode.Run(nullptr, 0, observed);
+
+            EXPECT_EQ(observed.m_slice, 0u);
+        }
+
+
+        // An exception thrown by the IResultsProcessor stops the generated
+        // code and is rethrown by Run().
+        TEST(NativeCodeGenerator, ResultsProcessorThrows)
+        {
+            if (!NativeCodeGenerator::IsSupported())
+            {
+                return;
+            }
+
+            Allocator allocator(4096);
+            CompileNode const & node = Parse(c_plans[0], allocator);
+
+            const ptrdiff_t rowOffsets[] = { 0, 0, 0, 0, 0 };
+            NativeCodeGenerator nativeCode(rowOffsets, 5, 1);
+            node.Compile(nativeCode);
+            nativeCode.Seal();
+
+            const size_t c_sliceCount = 4;
+            std::vector<uint64_t> buffer(64);
+            std::vector<char *> sliceBuffers(c_sliceCount,
+                                             reinterpret_cast<char *>(buffer.data()));
+
+            // The generator can be run again after an exception.
+            for (unsigned i = 0; i < 2; ++i)
+            {
+                ThrowingResultsProcessor observed(1);
+                EXPECT_THROW(nativeCode.Run(sliceBuffers.data(),
+                                            sliceBuffers.size(),
+                                            observed),
+                             RecoverableError);
+                EXPECT_EQ(observed.m_slice, 2u);
+            }
+        }
+    }
+}
@@ -0,0 +1,293 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <future>
+#include <vector>
+
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Plan/PlanCache.h"
+#include "BitFunnel/Plan/QueryPipeline.h"
+#include "IngestorWrapper.h"
+
+
+namespace BitFunnel
+{
+    namespace PlanCacheTest
+    {
+        void AddDocuments(IngestorWrapper & index, size_t documentCount)
+        {
+            for (DocId id = 0; id < documentCount; ++id)
+            {
+                index.AddDocument(id,
+                                  (id % 2 == 0) ?
+                                      ((id % 3 == 0) ? "all two three" : "all two") :
+                                      ((id % 3 == 0) ? "all three" : "all"));
+            }
+        }
+
+
+        std::vector<DocId> Match(QueryPipeline & pipeline, char const * query)
+        {
+            std::vector<DocId> matches;
+            pipeline.Match(*pipeline.ParseQuery(query), matches);
+            std::sort(matches.begin(), matches.end());
+            return matches;
+        }
+
+
+        TEST(PlanCache, CanonicalKey)
+        {
+            QueryPipeline parser;
+            auto key = [&parser](char const * query)
+            {
+                parser.ResetQueries();
+                return PlanCache::GetCanonicalKey(*parser.ParseQuery(query));
+            };
+
+            // And and Or are commutative and associative.
+            EXPECT_EQ(key("a b"), key("b a"));
+            EXPECT_EQ(key("a (b c)"), key("(c a) b"));
+            EXPECT_EQ(key("a | b | c"), key("c | (b | a)"));
+            EXPECT_EQ(key("a (b | c)"), key("(c | b) a"));
+
+            // Not is not, and neither is the order of words in a phrase.
+            EXPECT_NE(key("a b"), key("a | b"));
+            EXPECT_NE(key("a -b"), key("b -a"));
+            EXPECT_NE(key("\"a b\""), key("\"b a\""));
+            EXPECT_NE(key("a (b | c)"), key("(a b) | c"));
+
+            // Term text can't be confused with the key's punctuation.
+            EXPECT_NE(key("a b"), key("ab"));
+        }
+
+
+        TEST(PlanCache, HitsAndMisses)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            AddDocuments(index, 1000);
+
+            QueryPipeline pipeline(index.GetIngestor(),
+                                   index.GetConfiguration(),
+                                   false);
+            PlanCache & cache = *pipeline.GetPlanCache();
+            EXPECT_EQ(0.0, cache.GetHitRate());
+
+            auto expected = Match(pipeline, "two three");
+            EXPECT_EQ(0u, cache.GetHitCount());
+            EXPECT_EQ(1u, cache.GetMissCount());
+            EXPECT_EQ(1u, cache.GetEntryCount());
+
+            EXPECT_EQ(expected, Match(pipeline, "three two"));
+            EXPECT_EQ(expected, Match(pipeline, "two three"));
+            EXPECT_EQ(2u, cache.GetHitCount());
+            EXPECT_EQ(1u, cache.GetMissCount());
+            EXPECT_EQ(1u, cache.GetEntryCount());
+            EXPECT_DOUBLE_EQ(2.0 / 3.0, cache.GetHitRate());
+
+            // Clear() drops the plans but keeps the counters.
+            cache.Clear();
+            EXPECT_EQ(0u, cache.GetEntryCount());
+            EXPECT_EQ(expected, Match(pipeline, "three two"));
+            EXPECT_EQ(2u, cache.GetHitCount());
+            EXPECT_EQ(2u, cache.GetMissCount());
+
+            // A pipeline without a cache compiles every query.
+            pipeline.SetPlanCache(nullptr);
+            EXPECT_EQ(expected, Match(pipeline, "three two"));
+            EXPECT_EQ(2u, cache.GetMissCount());
+        }
+
+
+        TEST(PlanCache, Eviction)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            AddDocuments(index, 1000);
+
+            PlanCache cache(2);
+            QueryPipeline pipeline(index.GetIngestor(),
+                                   index.GetConfiguration(),
+                                   false);
+            pipeline.SetPlanCache(&cache);
+
+            Match(pipeline, "two");
+            Match(pipeline, "three");
+            Match(pipeline, "two");         // Hit. "three" is now the LRU.
+            Match(pipeline, "all");         // Evicts "three".
+            EXPECT_EQ(2u, cache.GetEntryCount());
+            EXPECT_EQ(1u, cache.GetHitCount());
+            EXPECT_EQ(3u, cache.GetMissCount());
+
+            Match(pipeline, "two");         // Hit.
+            Match(pipeline, "three");       // Miss. Evicts "all".
+            Match(pipeline, "all");         // Miss.
+            EXPECT_EQ(2u, cache.GetHitCount());
+            EXPECT_EQ(5u, cache.GetMissCount());
+            EXPECT_EQ(0u, cache.GetInvalidationCount());
+
+            // A cache with no capacity holds nothing.
+            PlanCache empty(0);
+            pipeline.SetPlanCache(&empty);
+            Match(pipeline, "two");
+            Match(pipeline, "two");
+            EXPECT_EQ(0u, empty.GetEntryCount());
+            EXPECT_EQ(0u, empty.GetHitCount());
+            EXPECT_EQ(2u, empty.GetMissCount());
+        }
+
+
+        // Plans compiled for one set of TermTables must not be used with
+        // another.
+        TEST(PlanCache, Invalidation)
+        {
+            IngestorWrapper index1({ 0 }, 1);
+            AddDocuments(index1, 1000);
+            IngestorWrapper index2({ 0, 3 }, 1);
+            AddDocuments(index2, 5000);
+
+            PlanCache cache(16);
+            QueryPipeline pipeline1(index1.GetIngestor(),
+                                    index1.GetConfiguration(),
+                                    false);
+            pipeline1.SetPlanCache(&cache);
+            QueryPipeline pipeline2(index2.GetIngestor(),
+                                    index2.GetConfiguration(),
+                                    false);
+            pipeline2.SetPlanCache(&cache);
+
+            EXPECT_EQ(167u, Match(pipeline1, "two three").size());
+            EXPECT_EQ(834u, Match(pipeline2, "two three").size());
+            EXPECT_EQ(1u, cache.GetInvalidationCount());
+            EXPECT_EQ(0u, cache.GetHitCount());
+            EXPECT_EQ(1u, cache.GetEntryCount());
+
+            EXPECT_EQ(834u, Match(pipeline2, "three two").size());
+            EXPECT_EQ(1u, cache.GetHitCount());
+        }
+
+
+        // Replacing a shard's TermTable in place must invalidate the plans
+        // compiled against the previous TermTable.
+        TEST(PlanCache, TermTableReplacement)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            AddDocuments(index, 1000);
+
+            PlanCache cache(16);
+            QueryPipeline pipeline(index.GetIngestor(),
+                                   index.GetConfiguration(),
+                                   false);
+            pipeline.SetPlanCache(&cache);
+
+            const uint64_t generation =
+                index.GetIngestor().GetShard(0).GetTermTableGeneration();
+            EXPECT_EQ(167u, Match(pipeline, "two three").size());
+            EXPECT_EQ(1u, cache.GetEntryCount());
+
+            // The new recipe has the same row counts, but gives each term a
+            // second rank 0 row that the ingested documents never set.
+            index.ReplaceTermTable({ 0, 0 });
+            EXPECT_NE(generation,
+                      index.GetIngestor().GetShard(0).GetTermTableGeneration());
+
+            std::vector<DocId> expected;
+            {
+                QueryPipeline uncached(index.GetIngestor(),
+                                       index.GetConfiguration(),
+                                       false);
+                uncached.SetPlanCache(nullptr);
+                expected = Match(uncached, "two three");
+            }
+            EXPECT_LT(expected.size(), 167u);
+
+            EXPECT_EQ(expected, Match(pipeline, "two three"));
+            EXPECT_EQ(1u, cache.GetInvalidationCount());
+            EXPECT_EQ(0u, cache.GetHitCount());
+
+            EXPECT_EQ(expected, Match(pipeline, "three two"));
+            EXPECT_EQ(1u, cache.GetHitCount());
+
+            // A TermTable with a different row layout is rejected.
+            EXPECT_ANY_THROW(index.ReplaceTermTable({ 0, 3 }));
+        }
+
+
+        TEST(PlanCache, Concurrent)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            AddDocuments(index, 20000);
+
+            char const * queries[] = { "two", "three", "two three", "all -two" };
+            const size_t c_queryCount = sizeof(queries) / sizeof(queries[0]);
+
+            PlanCache cache(c_queryCount);
+            std::vector<std::vector<DocId>> expected;
+            {
+                QueryPipeline pipeline(index.GetIngestor(),
+                                       index.GetConfiguration(),
+                                       false);
+                pipeline.SetPlanCache(nullptr);
+                for (auto query : queries)
+                {
+                    expected.push_back(Match(pipeline, query));
+                }
+            }
+
+            const size_t c_threadCount = 4;
+            const size_t c_iterations = 50;
+            std::vector<std::future<bool>> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.push_back(std::async(std::launch::async, [&, t]()
+                {
+                    QueryPipeline pipeline(index.GetIngestor(),
+                                           index.GetConfiguration(),
+                                           false);
+                    pipeline.SetPlanCache(&cache);
+
+                    bool success = true;
+                    for (size_t i = 0; i < c_iterations; ++i)
+                    {
+                        const size_t q = (i + t) % c_queryCount;
+                        success &= (Match(pipeline, queries[q]) == expected[q]);
+                        pipeline.ResetQueries();
+                    }
+                    return success;
+                }));
+            }
+
+            for (auto & thread : threads)
+            {
+                EXPECT_TRUE(thread.get());
+            }
+
+            EXPECT_EQ(c_threadCount * c_iterations,
+                      cache.GetHitCount() + cache.GetMissCount());
+            EXPECT_GE(cache.GetMissCount(), c_queryCount);
+            EXPECT_LE(cache.GetMissCount(), c_threadCount * c_queryCount);
+            EXPECT_EQ(c_queryCount, cache.GetEntryCount());
+        }
+    }
+}
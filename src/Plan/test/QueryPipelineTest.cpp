@@ -0,0 +1,241 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+#include "BitFunnel/Plan/QueryPipeline.h"
+#include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "IngestorWrapper.h"
+#include "NativeCodeGenerator.h"
+
+
+namespace BitFunnel
+{
+    namespace QueryPipelineTest
+    {
+        // Ingests documents whose terms are determined by the divisors of the
+        // DocId and verifies that QueryPipeline::Match() agrees with the
+        // TermMatchTreeEvaluator. If threadCount is not zero, every shard
+        // is split across a pool with that many threads.
+        void VerifyQueries(std::vector<Rank> const & adhocRecipe,
+                           size_t documentCount,
+                           bool useNativeCode,
+                           size_t threadCount = 0)
+        {
+            IngestorWrapper index(adhocRecipe, 1);
+
+            for (DocId id = 0; id < documentCount; ++id)
+            {
+                std::stringstream text;
+                text << "all";
+                if (id % 2 == 0) text << " two";
+                if (id % 3 == 0) text << " three";
+                if (id % 5 == 0) text << " five";
+                if (id % 7 == 0) text << " seven";
+                index.AddDocument(id, text.str().c_str());
+            }
+
+            char const * queries[] = {
+                "all",
+                "two",
+                "two three",
+                "two | five",
+                "two -three",
+                "seven (three | five)",
+                "(two | three) (five | seven)",
+                "-two -three",
+                "missing",
+            };
+
+            std::unique_ptr<IWorkStealingPool> threadPool;
+            if (threadCount > 0)
+            {
+                threadPool = Factories::CreateWorkStealingPool(threadCount);
+            }
+
+            QueryPipeline pipeline(index.GetIngestor(),
+                                   index.GetConfiguration(),
+                                   useNativeCode,
+                                   threadPool.get(),
+                                   0);
+            TermMatchTreeEvaluator evaluator(index.GetConfiguration());
+
+            std::vector<TermMatchNode const *> trees;
+            std::vector<std::vector<DocId>> expectedMatches;
+
+            for (auto query : queries)
+            {
+                SCOPED_TRACE(query);
+                TermMatchNode const * tree = pipeline.ParseQuery(query);
+                ASSERT_NE(tree, nullptr);
+
+                std::vector<DocId> matches;
+                pipeline.Match(*tree, matches);
+                std::sort(matches.begin(), matches.end());
+
+                std::vector<DocId> expected;
+                for (size_t i = 0; i < index.GetDocumentCount(); ++i)
+                {
+                    if (evaluator.Evaluate(*tree, index.GetDocument(i)))
+                    {
+                        expected.push_back(i);
+                    }
+                }
+
+                EXPECT_EQ(matches, expected);
+
+                trees.push_back(tree);
+                expectedMatches.push_back(expected);
+            }
+
+            // The batch should produce the same results as the individual
+            // queries, using the plans they left in the cache.
+            const size_t hitCount = pipeline.GetPlanCache()->GetHitCount();
+            std::vector<std::vector<DocId>> batchMatches;
+            pipeline.MatchBatch(trees, batchMatches);
+            EXPECT_EQ(hitCount + trees.size(),
+                      pipeline.GetPlanCache()->GetHitCount());
+            ASSERT_EQ(trees.size(), batchMatches.size());
+            for (size_t i = 0; i < trees.size(); ++i)
+            {
+                SCOPED_TRACE(queries[i]);
+                std::sort(batchMatches[i].begin(), batchMatches[i].end());
+                EXPECT_EQ(expectedMatches[i], batchMatches[i]);
+            }
+        }
+
+
+        TEST(QueryPipeline, ByteCodeRankZero)
+        {
+            VerifyQueries({ 0 }, 1000, false);
+        }
+
+
+        TEST(QueryPipeline, ByteCodeRankZeroAndThree)
+        {
+            VerifyQueries({ 0, 3 }, 5000, false);
+        }
+
+
+        TEST(QueryPipeline, NativeCodeRankZero)
+        {
+            if (NativeCodeGenerator::IsSupported())
+            {
+                VerifyQueries({ 0 }, 1000, true);
+            }
+        }
+
+
+        TEST(QueryPipeline, NativeCodeRankZeroAndThree)
+        {
+            if (NativeCodeGenerator::IsSupported())
+            {
+                VerifyQueries({ 0, 3 }, 5000, true);
+            }
+        }
+
+
+        TEST(QueryPipeline, ParallelByteCode)
+        {
+            VerifyQueries({ 0 }, 20000, false, 3);
+            VerifyQueries({ 0, 3 }, 20000, false, 3);
+        }
+
+
+        TEST(QueryPipeline, ParallelNativeCode)
+        {
+            if (NativeCodeGenerator::IsSupported())
+            {
+                VerifyQueries({ 0, 3 }, 20000, true, 3);
+            }
+        }
+
+
+        // Verifies that Match() respects the result budget, with and
+        // without a thread pool.
+        TEST(QueryPipeline, Budget)
+        {
+            const size_t c_documentCount = 20000;
+            IngestorWrapper index({ 0 }, 1);
+            for (DocId id = 0; id < c_documentCount; ++id)
+            {
+                index.AddDocument(id, (id % 2 == 0) ? "all two" : "all");
+            }
+
+            auto threadPool = Factories::CreateWorkStealingPool(3);
+            IWorkStealingPool * threadPools[] = { nullptr, threadPool.get() };
+
+            for (auto pool : threadPools)
+            {
+                QueryPipeline pipeline(index.GetIngestor(),
+                                       index.GetConfiguration(),
+                                       true,
+                                       pool,
+                                       0);
+
+                char const * queries[] = { "all", "two", "all -two" };
+                for (auto query : queries)
+                {
+                    SCOPED_TRACE(query);
+                    TermMatchNode const * tree = pipeline.ParseQuery(query);
+
+                    std::vector<DocId> all;
+                    pipeline.Match(*tree, all);
+
+                    // A budget larger than the result set has no effect.
+                    std::vector<DocId> matches;
+                    EXPECT_FALSE(pipeline.Match(*tree,
+                                                matches,
+                                                QueryPipeline::Budget(all.size() + 1)));
+                    EXPECT_EQ(all.size(), matches.size());
+
+                    // A small budget returns exactly that many matches, each
+                    // of which is a real match.
+                    matches.clear();
+                    EXPECT_TRUE(pipeline.Match(*tree,
+                                               matches,
+                                               QueryPipeline::Budget(100)));
+                    EXPECT_EQ(100u, matches.size());
+                    std::sort(all.begin(), all.end());
+                    for (auto id : matches)
+                    {
+                        EXPECT_TRUE(std::binary_search(all.begin(), all.end(), id));
+                    }
+
+                    // A deadline that has already passed stops the match
+                    // after the first slice on each thread.
+                    matches.clear();
+                    EXPECT_TRUE(pipeline.Match(*tree,
+                                               matches,
+                                               QueryPipeline::Budget(SIZE_MAX, 1e-9)));
+                    EXPECT_LT(matches.size(), all.size());
+                }
+            }
+        }
+    }
+}
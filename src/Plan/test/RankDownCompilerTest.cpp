@@ -0,0 +1,343 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "Allocator.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "BitFunnel/Plan/RowPlan.h"
+#include "CompileNode.h"
+#include "RankDownCompiler.h"
+#include "SameExceptForWhitespace.h"
+#include "TextObjectFormatter.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace RankDownCompilerTest
+    {
+        struct InputOutput
+        {
+        public:
+            char const * m_input;
+            char const * m_output;
+            Rank m_initialRank;
+        };
+
+
+        const InputOutput c_cases[] =
+        {
+            // Single rank zero row.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 0, 0, false),"
+                "    Report {"
+                "      Child:"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 0, 0, false),"
+                "  Child: Report {"
+                "    Child:"
+                "  }"
+                "}",
+                0
+            },
+
+            // Rows in descending rank order. Expect a RankDown for each
+            // change in rank, followed by a final RankDown to rank zero
+            // before the Report.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(3, 6, 0, false),"
+                "    Row(2, 6, 0, false),"
+                "    Row(1, 3, 0, false),"
+                "    Row(0, 0, 0, false),"
+                "    Report {"
+                "      Child:"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(3, 6, 0, false),"
+                "  Child: AndRowJz {"
+                "    Row: Row(2, 6, 0, false),"
+                "    Child: RankDown {"
+                "      Delta: 3,"
+                "      Child: AndRowJz {"
+                "        Row: Row(1, 3, 0, false),"
+                "        Child: RankDown {"
+                "          Delta: 3,"
+                "          Child: AndRowJz {"
+                "            Row: Row(0, 0, 0, false),"
+                "            Child: Report {"
+                "              Child:"
+                "            }"
+                "          }"
+                "        }"
+                "      }"
+                "    }"
+                "  }"
+                "}",
+                6
+            },
+
+            // Higher rank rows only. Report requires a RankDown to zero.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 2, 0, false),"
+                "    Report {"
+                "      Child:"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 2, 0, false),"
+                "  Child: RankDown {"
+                "    Delta: 2,"
+                "    Child: Report {"
+                "      Child:"
+                "    }"
+                "  }"
+                "}",
+                2
+            },
+
+            // Report with a child expression is compiled at rank zero.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 0, 0, false),"
+                "    Report {"
+                "      Child: Or {"
+                "        Children: ["
+                "          Row(1, 0, 0, false),"
+                "          Not {"
+                "            Child: Row(2, 0, 3, false)"
+                "          }"
+                "        ]"
+                "      }"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 0, 0, false),"
+                "  Child: Report {"
+                "    Child: OrTree {"
+                "      Children: ["
+                "        LoadRow(1, 0, 0, false),"
+                "        Not {"
+                "          Child: LoadRow(2, 0, 3, false)"
+                "        }"
+                "      ]"
+                "    }"
+                "  }"
+                "}",
+                0
+            },
+
+            // Or of two plans. Each branch starts at the initial rank and
+            // ranks down independently.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 3, 0, false),"
+                "    Or {"
+                "      Children: ["
+                "        And {"
+                "          Children: ["
+                "            Row(1, 3, 0, false),"
+                "            Report {"
+                "              Child:"
+                "            }"
+                "          ]"
+                "        },"
+                "        And {"
+                "          Children: ["
+                "            Row(2, 0, 0, false),"
+                "            Report {"
+                "              Child:"
+                "            }"
+                "          ]"
+                "        }"
+                "      ]"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 3, 0, false),"
+                "  Child: Or {"
+                "    Children: ["
+                "      AndRowJz {"
+                "        Row: Row(1, 3, 0, false),"
+                "        Child: RankDown {"
+                "          Delta: 3,"
+                "          Child: Report {"
+                "            Child:"
+                "          }"
+                "        }"
+                "      },"
+                "      RankDown {"
+                "        Delta: 3,"
+                "        Child: AndRowJz {"
+                "          Row: Row(2, 0, 0, false),"
+                "          Child: Report {"
+                "            Child:"
+                "          }"
+                "        }"
+                "      }"
+                "    ]"
+                "  }"
+                "}",
+                3
+            },
+
+            // Or-tree that was not expanded by the rewriter is evaluated
+            // along with the Report's child.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 0, 0, false),"
+                "    Or {"
+                "      Children: ["
+                "        Row(1, 0, 0, false),"
+                "        Row(2, 0, 0, false)"
+                "      ]"
+                "    },"
+                "    Report {"
+                "      Child: Row(3, 0, 0, true)"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 0, 0, false),"
+                "  Child: Report {"
+                "    Child: AndTree {"
+                "      Children: ["
+                "        OrTree {"
+                "          Children: ["
+                "            LoadRow(1, 0, 0, false),"
+                "            LoadRow(2, 0, 0, false)"
+                "          ]"
+                "        },"
+                "        LoadRow(3, 0, 0, true)"
+                "      ]"
+                "    }"
+                "  }"
+                "}",
+                0
+            },
+
+            // The MatchTreeRewriter joins its rank N and rank zero chains
+            // with an And, so the left side of an And may be an and-chain.
+            {
+                "And {"
+                "  Children: ["
+                "    And {"
+                "      Children: ["
+                "        Row(0, 3, 0, false),"
+                "        Row(1, 3, 0, false)"
+                "      ]"
+                "    },"
+                "    And {"
+                "      Children: ["
+                "        Row(2, 0, 0, false),"
+                "        Report {"
+                "          Child:"
+                "        }"
+                "      ]"
+                "    }"
+                "  ]"
+                "}",
+                "LoadRowJz {"
+                "  Row: Row(0, 3, 0, false),"
+                "  Child: AndRowJz {"
+                "    Row: Row(1, 3, 0, false),"
+                "    Child: RankDown {"
+                "      Delta: 3,"
+                "      Child: AndRowJz {"
+                "        Row: Row(2, 0, 0, false),"
+                "        Child: Report {"
+                "          Child:"
+                "        }"
+                "      }"
+                "    }"
+                "  }"
+                "}",
+                3
+            },
+        };
+
+
+        void VerifyCase(InputOutput const & testCase)
+        {
+            std::stringstream input(testCase.m_input);
+
+            Allocator allocator(4096);
+            TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
+            RowMatchNode const & root = RowMatchNode::Parse(parser);
+
+            RankDownCompiler compiler(allocator);
+            CompileNode const & compiled = compiler.Compile(root);
+
+            EXPECT_EQ(compiler.GetInitialRank(), testCase.m_initialRank);
+
+            std::stringstream output;
+            TextObjectFormatter formatter(output);
+            compiled.Format(formatter);
+
+            EXPECT_TRUE(SameExceptForWhitespace(output.str().c_str(),
+                                                testCase.m_output))
+                << output.str();
+        }
+
+
+        TEST(RankDownCompiler, Basic)
+        {
+            for (unsigned i = 0; i < sizeof(c_cases) / sizeof(InputOutput); ++i)
+            {
+                VerifyCase(c_cases[i]);
+            }
+        }
+
+
+        TEST(RankDownCompiler, NoRowsBeforeReport)
+        {
+            std::stringstream input("Report { Child: Row(0, 0, 0, false) }");
+
+            Allocator allocator(4096);
+            TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
+            RowMatchNode const & root = RowMatchNode::Parse(parser);
+
+            RankDownCompiler compiler(allocator);
+            EXPECT_ANY_THROW(compiler.Compile(root));
+        }
+    }
+}
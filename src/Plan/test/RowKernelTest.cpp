@@ -0,0 +1,317 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Exceptions.h"
+#include "RowKernel.h"
+
+
+namespace BitFunnel
+{
+    namespace RowKernelTest
+    {
+        const RowKernel::InstructionSet c_instructionSets[] = {
+            RowKernel::Scalar,
+            RowKernel::SSE2,
+            RowKernel::AVX2,
+            RowKernel::AVX512
+        };
+
+
+        class Rows
+        {
+        public:
+            Rows(size_t rowCount, size_t qwordCount, unsigned seed)
+            {
+                std::mt19937_64 random(seed);
+                for (size_t r = 0; r < rowCount; ++r)
+                {
+                    // Allocate an extra quadword and start the row on an odd
+                    // quadword to exercise unaligned loads.
+                    m_data.emplace_back(qwordCount + 1);
+                    for (auto & qword : m_data.back())
+                    {
+                        // Combine two values so that the intersection of
+                        // several rows is not always empty.
+                        qword = random() | random();
+                    }
+                    m_rows.push_back(m_data.back().data() + 1);
+                }
+            }
+
+            uint64_t const * const * Get() const
+            {
+                return m_rows.data();
+            }
+
+            size_t GetCount() const
+            {
+                return m_rows.size();
+            }
+
+        private:
+            std::vector<std::vector<uint64_t>> m_data;
+            std::vector<uint64_t const *> m_rows;
+        };
+
+
+        size_t PopCount(std::vector<uint64_t> const & bitmap)
+        {
+            size_t count = 0;
+            for (auto qword : bitmap)
+            {
+                for (; qword != 0; qword &= qword - 1)
+                {
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+
+        TEST(RowKernel, BestInstructionSet)
+        {
+            EXPECT_TRUE(RowKernel::IsSupported(RowKernel::Scalar));
+
+            const RowKernel::InstructionSet best =
+                RowKernel::GetBestInstructionSet();
+            EXPECT_TRUE(RowKernel::IsSupported(best));
+
+            RowKernel kernel;
+            EXPECT_EQ(best, kernel.GetInstructionSet());
+
+            for (auto instructionSet : c_instructionSets)
+            {
+                if (!RowKernel::IsSupported(instructionSet))
+                {
+                    EXPECT_THROW(RowKernel kernel2(instructionSet),
+                                 RecoverableError);
+                }
+            }
+        }
+
+
+        TEST(RowKernel, And)
+        {
+            const size_t qwordCounts[] = { 1, 3, 8, 17, 64, 511, 512, 513, 1500 };
+            const size_t rowCounts[] = { 1, 2, 5 };
+
+            const RowKernel scalar(RowKernel::Scalar);
+
+            for (auto qwordCount : qwordCounts)
+            {
+                for (auto rowCount : rowCounts)
+                {
+                    Rows rows(rowCount, qwordCount, static_cast<unsigned>(qwordCount + rowCount));
+
+                    // Try every combination of inverted rows.
+                    for (unsigned mask = 0; mask < (1u << rowCount); ++mask)
+                    {
+                        std::unique_ptr<bool[]> inverted(new bool[rowCount]);
+                        for (size_t r = 0; r < rowCount; ++r)
+                        {
+                            inverted[r] = ((mask >> r) & 1) != 0;
+                        }
+
+                        // Compute the expected result directly.
+                        std::vector<uint64_t> expected(qwordCount, ~0ull);
+                        for (size_t r = 0; r < rowCount; ++r)
+                        {
+                            for (size_t i = 0; i < qwordCount; ++i)
+                            {
+                                const uint64_t value = rows.Get()[r][i];
+                                expected[i] &= inverted[r] ? ~value : value;
+                            }
+                        }
+
+                        for (auto instructionSet : c_instructionSets)
+                        {
+                            if (!RowKernel::IsSupported(instructionSet))
+                            {
+                                continue;
+                            }
+
+                            RowKernel kernel(instructionSet);
+                            std::vector<uint64_t> bitmap(qwordCount);
+                            const size_t count = kernel.And(rows.Get(),
+                                                            inverted.get(),
+                                                            rowCount,
+                                                            qwordCount,
+                                                            bitmap.data());
+                            EXPECT_EQ(expected, bitmap)
+                                << RowKernel::GetName(instructionSet);
+                            EXPECT_EQ(PopCount(expected), count)
+                                << RowKernel::GetName(instructionSet);
+                        }
+                    }
+
+                    // A null inverted array means no rows are inverted.
+                    std::vector<uint64_t> expected(qwordCount);
+                    scalar.And(rows.Get(), nullptr, rowCount, qwordCount, expected.data());
+                    for (size_t i = 0; i < qwordCount; ++i)
+                    {
+                        uint64_t value = ~0ull;
+                        for (size_t r = 0; r < rowCount; ++r)
+                        {
+                            value &= rows.Get()[r][i];
+                        }
+                        EXPECT_EQ(value, expected[i]);
+                    }
+                }
+            }
+        }
+
+
+        TEST(RowKernel, Or)
+        {
+            const size_t qwordCounts[] = { 1, 7, 64, 600, 1025 };
+
+            for (auto qwordCount : qwordCounts)
+            {
+                Rows rows(4, qwordCount, static_cast<unsigned>(qwordCount));
+
+                std::vector<uint64_t> expected(qwordCount, 0);
+                for (size_t r = 0; r < rows.GetCount(); ++r)
+                {
+                    for (size_t i = 0; i < qwordCount; ++i)
+                    {
+                        expected[i] |= rows.Get()[r][i];
+                    }
+                }
+
+                for (auto instructionSet : c_instructionSets)
+                {
+                    if (!RowKernel::IsSupported(instructionSet))
+                    {
+                        continue;
+                    }
+
+                    RowKernel kernel(instructionSet);
+                    std::vector<uint64_t> bitmap(qwordCount);
+                    const size_t count = kernel.Or(rows.Get(),
+                                                   rows.GetCount(),
+                                                   qwordCount,
+                                                   bitmap.data());
+                    EXPECT_EQ(expected, bitmap)
+                        << RowKernel::GetName(instructionSet);
+                    EXPECT_EQ(PopCount(expected), count)
+                        << RowKernel::GetName(instructionSet);
+                }
+            }
+        }
+
+
+        // Returns a pointer to the first quadword in buffer that starts on a
+        // multiple of alignment bytes. The buffer must be padded with at
+        // least alignment bytes.
+        uint64_t * Align(std::vector<uint64_t> & buffer, size_t alignment)
+        {
+            const uintptr_t address = reinterpret_cast<uintptr_t>(buffer.data());
+            const size_t padding = (alignment - address % alignment) % alignment;
+            return buffer.data() + padding / sizeof(uint64_t);
+        }
+
+
+        // Rows and bitmaps that start on a multiple of GetAlignment() take
+        // the aligned loads and stores, and compute the same results as the
+        // scalar kernels.
+        TEST(RowKernel, Aligned)
+        {
+            const size_t c_qwordCount = 1100;
+            const size_t c_rowCount = 3;
+            const size_t c_maxAlignment = 64;
+
+            Rows source(c_rowCount, c_qwordCount, 1234);
+
+            // Copy the rows into one buffer, with each row starting on a 64
+            // byte boundary.
+            const size_t c_stride = c_qwordCount + c_maxAlignment / sizeof(uint64_t);
+            std::vector<uint64_t> buffer(c_rowCount * c_stride + c_maxAlignment);
+            uint64_t * const start = Align(buffer, c_maxAlignment);
+            std::vector<uint64_t const *> rows;
+            for (size_t r = 0; r < c_rowCount; ++r)
+            {
+                uint64_t * const row = start + r * c_stride;
+                std::copy(source.Get()[r], source.Get()[r] + c_qwordCount, row);
+                rows.push_back(row);
+            }
+
+            const bool inverted[c_rowCount] = { false, true, false };
+
+            const RowKernel scalar(RowKernel::Scalar);
+            EXPECT_EQ(sizeof(uint64_t), scalar.GetAlignment());
+
+            std::vector<uint64_t> expectedAnd(c_qwordCount);
+            const size_t expectedAndCount = scalar.And(rows.data(),
+                                                       inverted,
+                                                       c_rowCount,
+                                                       c_qwordCount,
+                                                       expectedAnd.data());
+            std::vector<uint64_t> expectedOr(c_qwordCount);
+            const size_t expectedOrCount = scalar.Or(rows.data(),
+                                                     c_rowCount,
+                                                     c_qwordCount,
+                                                     expectedOr.data());
+
+            for (auto instructionSet : c_instructionSets)
+            {
+                if (!RowKernel::IsSupported(instructionSet))
+                {
+                    continue;
+                }
+
+                RowKernel kernel(instructionSet);
+                const size_t alignment = kernel.GetAlignment();
+                EXPECT_LE(alignment, c_maxAlignment);
+                EXPECT_EQ(0u, c_maxAlignment % alignment);
+
+                std::vector<uint64_t> bitmapBuffer(c_qwordCount + c_maxAlignment);
+                uint64_t * const bitmap = Align(bitmapBuffer, c_maxAlignment);
+
+                EXPECT_EQ(expectedAndCount,
+                          kernel.And(rows.data(),
+                                     inverted,
+                                     c_rowCount,
+                                     c_qwordCount,
+                                     bitmap))
+                    << RowKernel::GetName(instructionSet);
+                EXPECT_TRUE(std::equal(expectedAnd.begin(), expectedAnd.end(), bitmap))
+                    << RowKernel::GetName(instructionSet);
+
+                EXPECT_EQ(expectedOrCount,
+                          kernel.Or(rows.data(),
+                                    c_rowCount,
+                                    c_qwordCount,
+                                    bitmap))
+                    << RowKernel::GetName(instructionSet);
+                EXPECT_TRUE(std::equal(expectedOr.begin(), expectedOr.end(), bitmap))
+                    << RowKernel::GetName(instructionSet);
+            }
+        }
+    }
+}
@@ -0,0 +1,230 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "Allocator.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "BitFunnel/Term.h"
+#include "IngestorWrapper.h"
+#include "PlanRows.h"
+#include "QueryParser.h"
+#include "SameExceptForWhitespace.h"
+#include "TermPlanConverter.h"
+#include "TextObjectFormatter.h"
+
+
+namespace BitFunnel
+{
+    namespace TermPlanConverterTest
+    {
+        RowMatchNode const & BuildRowPlan(char const * query,
+                                          IngestorWrapper const & index,
+                                          IPlanRows & planRows,
+                                          IAllocator& allocator)
+        {
+            std::stringstream input(query);
+            QueryParser parser(input, allocator);
+            TermMatchNode const * tree = parser.Parse();
+            EXPECT_NE(tree, nullptr);
+
+            return TermPlanConverter::BuildRowPlan(*tree,
+                                                   index.GetConfiguration(),
+                                                   planRows,
+                                                   allocator);
+        }
+
+
+        std::string Format(RowMatchNode const & node)
+        {
+            std::stringstream output;
+            TextObjectFormatter formatter(output);
+            node.Format(formatter);
+            return output.str();
+        }
+
+
+        // Verifies that AbstractRows [start, start + count) map to the
+        // term's rows in every shard.
+        void VerifyTermRows(Term const & term,
+                            PlanRows const & planRows,
+                            unsigned start,
+                            unsigned count)
+        {
+            for (ShardId shard = 0; shard < planRows.GetShardCount(); ++shard)
+            {
+                RowIdSequence rows(term, planRows.GetTermTable(shard));
+                std::vector<RowId> expected(rows.begin(), rows.end());
+                ASSERT_EQ(expected.size(), count);
+
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    bool found = false;
+                    RowId observed = planRows.PhysicalRow(shard, start + i);
+                    for (auto row : expected)
+                    {
+                        found |= (row.GetRank() == observed.GetRank() &&
+                                  row.GetIndex() == observed.GetIndex());
+                    }
+                    EXPECT_TRUE(found);
+                }
+            }
+        }
+
+
+        TEST(TermPlanConverter, Unigram)
+        {
+            IngestorWrapper index({ 0, 0, 3 }, 1);
+            PlanRows planRows(index.GetIngestor());
+            Allocator allocator(4096);
+
+            RowMatchNode const & root =
+                BuildRowPlan("wat", index, planRows, allocator);
+
+            // Three rows for "wat" and one for DocumentActive.
+            EXPECT_EQ(planRows.GetRowCount(), 4u);
+
+            char const * expected =
+                "And {"
+                "  Children: ["
+                "    Row(3, 0, 0, false),"
+                "    Row(2, 3, 0, false),"
+                "    Row(1, 0, 0, false),"
+                "    Row(0, 0, 0, false)"
+                "  ]"
+                "}";
+            EXPECT_TRUE(SameExceptForWhitespace(Format(root).c_str(), expected));
+
+            Term term("wat", 0, index.GetConfiguration());
+            VerifyTermRows(term, planRows, 0, 3);
+
+            ITermTable const & termTable = planRows.GetTermTable(0);
+            VerifyTermRows(termTable.GetDocumentActiveTerm(), planRows, 3, 1);
+        }
+
+
+        TEST(TermPlanConverter, BooleanOperators)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            PlanRows planRows(index.GetIngestor());
+            Allocator allocator(4096);
+
+            RowMatchNode const & root =
+                BuildRowPlan("a (b | -c)", index, planRows, allocator);
+
+            EXPECT_EQ(planRows.GetRowCount(), 4u);
+
+            // The parser visits "-c" first, so it is assigned row 0.
+            char const * expected =
+                "And {"
+                "  Children: ["
+                "    Row(3, 0, 0, false),"
+                "    Row(2, 0, 0, false),"
+                "    Or {"
+                "      Children: ["
+                "        Row(1, 0, 0, false),"
+                "        Row(0, 0, 0, true)"
+                "      ]"
+                "    }"
+                "  ]"
+                "}";
+            EXPECT_TRUE(SameExceptForWhitespace(Format(root).c_str(), expected));
+        }
+
+
+        TEST(TermPlanConverter, Phrase)
+        {
+            // With a maximum gram size of 2, the trigram is converted to the
+            // conjunction of two bigrams.
+            IngestorWrapper index({ 0, 0 }, 2);
+            PlanRows planRows(index.GetIngestor());
+            Allocator allocator(4096);
+
+            BuildRowPlan("\"a b c\"", index, planRows, allocator);
+
+            EXPECT_EQ(planRows.GetRowCount(), 5u);
+
+            IConfiguration const & config = index.GetConfiguration();
+            Term ab("a", 0, config);
+            ab.AddTerm(Term("b", 0, config), config);
+            Term bc("b", 0, config);
+            bc.AddTerm(Term("c", 0, config), config);
+
+            VerifyTermRows(ab, planRows, 0, 2);
+            VerifyTermRows(bc, planRows, 2, 2);
+        }
+
+
+        TEST(TermPlanConverter, NoAdhocRows)
+        {
+            // A TermTable without adhoc recipes has no rows for "wat". The
+            // term is represented by the match-all row.
+            IngestorWrapper index({}, 1);
+            PlanRows planRows(index.GetIngestor());
+            Allocator allocator(4096);
+
+            BuildRowPlan("wat", index, planRows, allocator);
+
+            EXPECT_EQ(planRows.GetRowCount(), 2u);
+
+            ITermTable const & termTable = planRows.GetTermTable(0);
+            VerifyTermRows(termTable.GetMatchAllTerm(), planRows, 0, 1);
+            VerifyTermRows(termTable.GetDocumentActiveTerm(), planRows, 1, 1);
+        }
+
+
+        TEST(TermPlanConverter, MultipleShards)
+        {
+            IngestorWrapper index({ 0, 3 }, 1, { 10, 100 });
+            PlanRows planRows(index.GetIngestor());
+            Allocator allocator(4096);
+
+            EXPECT_EQ(planRows.GetShardCount(), 3u);
+
+            BuildRowPlan("wat", index, planRows, allocator);
+
+            Term term("wat", 0, index.GetConfiguration());
+            VerifyTermRows(term, planRows, 0, 2);
+        }
+
+
+        TEST(TermPlanConverter, TooManyRows)
+        {
+            IngestorWrapper index({ 0 }, 1);
+            PlanRows planRows(index.GetIngestor());
+
+            for (unsigned i = 0; i < PlanRows::c_maxRowsPerQuery; ++i)
+            {
+                planRows.AddRow(0);
+            }
+            EXPECT_TRUE(planRows.IsFull());
+            EXPECT_ANY_THROW(planRows.AddRow(0));
+        }
+    }
+}
@@ -0,0 +1,76 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>    // For GetTempPathA.
+#endif
+
+#include "TemporaryFile.h"
+
+
+namespace BitFunnel
+{
+    static std::string GetTemporaryDirectory()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        // The path returned by GetTempPathA() ends with a backslash.
+        char buffer[MAX_PATH + 1];
+        const DWORD length = GetTempPathA(sizeof(buffer), buffer);
+        return std::string(buffer, length);
+#else
+        char const * directory = getenv("TMPDIR");
+        if (directory == nullptr || *directory == '\0')
+        {
+            directory = "/tmp";
+        }
+        return std::string(directory) + "/";
+#endif
+    }
+
+
+    TemporaryFile::TemporaryFile(char const * name)
+    {
+        std::random_device random;
+        std::stringstream path;
+        path << GetTemporaryDirectory()
+             << name << "-" << std::hex << random() << random();
+        m_path = path.str();
+    }
+
+
+    TemporaryFile::~TemporaryFile()
+    {
+        std::remove(m_path.c_str());
+    }
+
+
+    char const * TemporaryFile::GetPath() const
+    {
+        return m_path.c_str();
+    }
+}
@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <string>                           // std::string member.
+
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // TemporaryFile reserves a unique path in the system's temporary
+    // directory, so that tests which need a file on disk, e.g. to memory
+    // map it, neither depend on nor litter the current directory. The file,
+    // if one was created, is removed when the TemporaryFile is destroyed.
+    //
+    //*************************************************************************
+    class TemporaryFile : NonCopyable
+    {
+    public:
+        // The name appears in the path, to identify the test that left a
+        // file behind.
+        TemporaryFile(char const * name);
+
+        ~TemporaryFile();
+
+        char const * GetPath() const;
+
+    private:
+        std::string m_path;
+    };
+}
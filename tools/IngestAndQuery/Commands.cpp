@@ -20,22 +20,34 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <thread>       // sleep_for, this_thread
 
 #include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IConfiguration.h"
 #include "BitFunnel/Index/IDocument.h"
 #include "BitFunnel/Index/IDocumentCache.h"
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/IngestChunks.h"
 #include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Plan/PlanCache.h"
 #include "BitFunnel/Plan/QueryPipeline.h"
 #include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
 #include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/NonCopyable.h"
 #include "BitFunnel/Term.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
 #include "Commands.h"
 #include "Environment.h"
+#include "TaskPool.h"
 
 
 namespace BitFunnel
@@ -213,6 +225,11 @@ namespace BitFunnel
                          m_cacheDocuments);
 
             std::cout << "Ingestion complete." << std::endl;
+            std::cout
+                << "IDF cache: "
+                << configuration.GetIdfCacheHitCount() << " hits, "
+                << configuration.GetIdfCacheMissCount() << " misses."
+                << std::endl;
         }
     }
 
@@ -282,6 +299,205 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // QueryLogWorker
+    //
+    // Replays queries from a query log on a TaskPool thread. Workers claim
+    // queries one at a time from a shared counter so that a run of slow
+    // queries does not leave the other threads idle. Each worker records its
+    // measurements in its own QueryLogWorker::Results, which the Query
+    // command merges after all of the workers have finished.
+    //
+    //*************************************************************************
+    class QueryLogWorker : public ITask
+    {
+    public:
+        class Results
+        {
+        public:
+            Results()
+              : m_matchCount(0),
+                m_rowCount(0),
+                m_quadwordCount(0),
+                m_failedCount(0),
+                m_unexpectedCount(0)
+            {
+            }
+
+            // Latency in seconds of each query processed by this worker.
+            std::vector<double> m_latencies;
+            size_t m_matchCount;
+            size_t m_rowCount;
+            size_t m_quadwordCount;
+
+            // Queries that threw a RecoverableError, such as a parse error.
+            size_t m_failedCount;
+
+            // Any other exceptions. These are caught so that one bad query
+            // cannot take down the TaskPool thread or leave the Query
+            // command waiting forever.
+            size_t m_unexpectedCount;
+        };
+
+
+        // Tracks the number of workers that have not yet finished.
+        class Completion
+        {
+        public:
+            Completion(size_t workerCount)
+              : m_remaining(workerCount)
+            {
+            }
+
+            void Finish()
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                --m_remaining;
+                m_finished.notify_all();
+            }
+
+            void Wait()
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                while (m_remaining > 0)
+                {
+                    m_finished.wait(lock);
+                }
+            }
+
+            // Calls Finish() when destroyed, so that a worker is counted as
+            // finished however it exits.
+            class Guard : NonCopyable
+            {
+            public:
+                Guard(Completion & completion)
+                  : m_completion(completion)
+                {
+                }
+
+                ~Guard()
+                {
+                    m_completion.Finish();
+                }
+
+            private:
+                Completion & m_completion;
+            };
+
+        private:
+            std::mutex m_lock;
+            std::condition_variable m_finished;
+            size_t m_remaining;
+        };
+
+
+        QueryLogWorker(Environment & environment,
+                       std::vector<std::string> const & queries,
+                       std::atomic<size_t> & nextQuery,
+                       PlanCache & planCache,
+                       Results & results,
+                       Completion & completion)
+          : m_environment(environment),
+            m_queries(queries),
+            m_nextQuery(nextQuery),
+            m_planCache(planCache),
+            m_results(results),
+            m_completion(completion)
+        {
+        }
+
+
+        virtual void Execute() override
+        {
+            Completion::Guard guard(m_completion);
+
+            try
+            {
+                Run();
+            }
+            catch (...)
+            {
+                ++m_results.m_unexpectedCount;
+            }
+        }
+
+    private:
+        void Run()
+        {
+            QueryPipeline pipeline(m_environment.GetIngestor(),
+                                   m_environment.GetConfiguration());
+            pipeline.SetPlanCache(&m_planCache);
+            std::vector<DocId> matches;
+
+            for (;;)
+            {
+                const size_t index = m_nextQuery++;
+                if (index >= m_queries.size())
+                {
+                    break;
+                }
+
+                matches.clear();
+                pipeline.ResetQueries();
+
+                try
+                {
+                    Stopwatch stopwatch;
+                    auto tree = pipeline.ParseQuery(m_queries[index].c_str());
+                    if (tree != nullptr)
+                    {
+                        pipeline.Match(*tree, matches);
+                    }
+                    m_results.m_latencies.push_back(stopwatch.ElapsedTime());
+
+                    if (tree != nullptr)
+                    {
+                        m_results.m_matchCount += matches.size();
+                        m_results.m_rowCount += pipeline.GetRowCount();
+                        m_results.m_quadwordCount += pipeline.GetQuadwordCount();
+                    }
+                }
+                catch (RecoverableError const &)
+                {
+                    ++m_results.m_failedCount;
+                }
+                catch (...)
+                {
+                    ++m_results.m_unexpectedCount;
+                }
+            }
+        }
+
+        Environment & m_environment;
+        std::vector<std::string> const & m_queries;
+        std::atomic<size_t> & m_nextQuery;
+        PlanCache & m_planCache;
+        Results & m_results;
+        Completion & m_completion;
+    };
+
+
+    // Returns the latency at the specified percentile using the nearest-rank
+    // method. The latencies must be sorted.
+    static double Percentile(std::vector<double> const & latencies,
+                             double percentile)
+    {
+        if (latencies.empty())
+        {
+            return 0.0;
+        }
+
+        size_t rank =
+            static_cast<size_t>(std::ceil(percentile / 100.0 * latencies.size()));
+        if (rank > 0)
+        {
+            --rank;
+        }
+        return latencies[(std::min)(rank, latencies.size() - 1)];
+    }
+
+
     //*************************************************************************
     //
     // Query
@@ -290,7 +506,8 @@ namespace BitFunnel
     Query::Query(Environment & environment,
                  Id id,
                  char const * parameters)
-        : TaskBase(environment, id, Type::Synchronous)
+        : TaskBase(environment, id, Type::Synchronous),
+          m_threadCount(0)
     {
         auto command = TaskFactory::GetNextToken(parameters);
         if (command.compare("one") == 0)
@@ -307,6 +524,18 @@ namespace BitFunnel
                 throw error;
             }
             m_query = TaskFactory::GetNextToken(parameters);
+
+            auto threads = TaskFactory::GetNextToken(parameters);
+            if (threads.size() > 0)
+            {
+                char * end = nullptr;
+                m_threadCount = strtoul(threads.c_str(), &end, 10);
+                if (*end != 0 || m_threadCount == 0)
+                {
+                    RecoverableError error("Query log expects a positive thread count.");
+                    throw error;
+                }
+            }
         }
     }
 
@@ -315,19 +544,153 @@ namespace BitFunnel
     {
         if (m_isSingleQuery)
         {
-            std::cout
-                << "Processing query \""
-                << m_query
-                << "\"" << std::endl;
+            ProcessOne();
         }
         else
         {
-            std::cout
-                << "Processing queries from log at \""
-                << m_query
-                << "\"" << std::endl;
+            ProcessLog();
+        }
+    }
+
+
+    void Query::ProcessOne()
+    {
+        std::cout
+            << "Processing query \""
+            << m_query
+            << "\"" << std::endl;
+
+        auto & environment = GetEnvironment();
+        QueryPipeline pipeline(environment.GetIngestor(),
+                               environment.GetConfiguration(),
+                               true,
+                               &environment.GetMatchPool());
+
+        Stopwatch stopwatch;
+        auto tree = pipeline.ParseQuery(m_query.c_str());
+        if (tree == nullptr)
+        {
+            std::cout << "Empty query." << std::endl;
+            return;
+        }
+
+        std::vector<DocId> matches;
+        pipeline.Match(*tree, matches);
+        const double elapsedTime = stopwatch.ElapsedTime();
+
+        std::sort(matches.begin(), matches.end());
+        for (auto docId : matches)
+        {
+            std::cout << "  DocId(" << docId << ")" << std::endl;
+        }
+
+        std::cout
+            << matches.size() << " match(es)." << std::endl
+            << pipeline.GetRowCount() << " row(s), "
+            << pipeline.GetQuadwordCount() << " quadword(s) in plan." << std::endl
+            << "Elapsed time: " << elapsedTime * 1000.0 << "ms" << std::endl;
+    }
+
+
+    void Query::ProcessLog()
+    {
+        std::cout
+            << "Processing queries from log at \""
+            << m_query
+            << "\"" << std::endl;
+
+        std::ifstream input(m_query);
+        if (!input.is_open())
+        {
+            RecoverableError error("Query: unable to open query log.");
+            throw error;
         }
-        std::cout << "NOT IMPLEMENTED" << std::endl;
+
+        std::vector<std::string> queries;
+        std::string line;
+        while (std::getline(input, line))
+        {
+            if (line.size() > 0)
+            {
+                queries.push_back(line);
+            }
+        }
+
+        auto & environment = GetEnvironment();
+        TaskPool & taskPool = environment.GetTaskPool();
+        const size_t threadCount =
+            (m_threadCount == 0) ?
+                taskPool.GetThreadCount() :
+                (std::min)(m_threadCount, taskPool.GetThreadCount());
+
+        std::cout
+            << "Running " << queries.size() << " queries on "
+            << threadCount << " thread(s)." << std::endl;
+
+        std::vector<QueryLogWorker::Results> results(threadCount);
+        QueryLogWorker::Completion completion(threadCount);
+        std::atomic<size_t> nextQuery(0);
+
+        // The workers share one cache so that a query compiled by one of
+        // them can be reused by the others.
+        PlanCache planCache(QueryPipeline::c_defaultPlanCacheCapacity);
+
+        Stopwatch stopwatch;
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            std::unique_ptr<ITask>
+                worker(new QueryLogWorker(environment,
+                                          queries,
+                                          nextQuery,
+                                          planCache,
+                                          results[i],
+                                          completion));
+            if (!taskPool.TryEnqueue(std::move(worker)))
+            {
+                // The pool is shutting down. Account for the worker that
+                // will never run.
+                completion.Finish();
+            }
+        }
+        completion.Wait();
+        const double elapsedTime = stopwatch.ElapsedTime();
+
+        QueryLogWorker::Results total;
+        for (auto const & result : results)
+        {
+            total.m_latencies.insert(total.m_latencies.end(),
+                                     result.m_latencies.begin(),
+                                     result.m_latencies.end());
+            total.m_matchCount += result.m_matchCount;
+            total.m_rowCount += result.m_rowCount;
+            total.m_quadwordCount += result.m_quadwordCount;
+            total.m_failedCount += result.m_failedCount;
+            total.m_unexpectedCount += result.m_unexpectedCount;
+        }
+        std::sort(total.m_latencies.begin(), total.m_latencies.end());
+
+        const size_t queryCount = total.m_latencies.size();
+        const double perQuery = (queryCount == 0) ? 0.0 : 1.0 / queryCount;
+
+        std::cout
+            << "Queries: " << queryCount
+            << " (" << total.m_failedCount << " failed, "
+            << total.m_unexpectedCount << " unexpected errors)" << std::endl
+            << "Elapsed time: " << elapsedTime << "s" << std::endl
+            << "QPS: "
+            << ((elapsedTime > 0.0) ? queryCount / elapsedTime : 0.0)
+            << std::endl
+            << "Latency (ms): p50 = " << Percentile(total.m_latencies, 50.0) * 1000.0
+            << ", p95 = " << Percentile(total.m_latencies, 95.0) * 1000.0
+            << ", p99 = " << Percentile(total.m_latencies, 99.0) * 1000.0
+            << ", p99.9 = " << Percentile(total.m_latencies, 99.9) * 1000.0
+            << std::endl
+            << "Matches/query: " << total.m_matchCount * perQuery << std::endl
+            << "Rows/query: " << total.m_rowCount * perQuery << std::endl
+            << "Quadwords/query: " << total.m_quadwordCount * perQuery << std::endl
+            << "Plan cache hit rate: " << planCache.GetHitRate() * 100.0
+            << "% (" << planCache.GetHitCount() << " hit(s), "
+            << planCache.GetMissCount() << " miss(es))" << std::endl;
     }
 
 
@@ -335,11 +698,15 @@ namespace BitFunnel
     {
         return Documentation(
             "query",
-            "Process a single query or list of queries. (TODO)",
-            "query (one <expression>) | (log <file>)\n"
+            "Process a single query or list of queries.",
+            "query (one <expression>) | (log <file> [<threads>])\n"
             "  Processes a single query or a list of queries\n"
-            "  specified by a file.\n"
-            "  NOT IMPLEMENTED"
+            "  specified by a file with one query per line.\n"
+            "  Query logs are replayed on <threads> TaskPool\n"
+            "  threads (default: all of them), and the command\n"
+            "  reports QPS, latency percentiles, matches per\n"
+            "  query, plan rows and quadwords per query, and\n"
+            "  the compiled plan cache hit rate."
             );
     }
 
@@ -121,8 +121,15 @@ namespace BitFunnel
         static ICommand::Documentation GetDocumentation();
 
     private:
+        void ProcessOne();
+        void ProcessLog();
+
         bool m_isSingleQuery;
         std::string m_query;
+
+        // Number of TaskPool threads used to replay a query log. Zero means
+        // use every thread in the pool.
+        size_t m_threadCount;
     };
 
 
@@ -22,6 +22,7 @@
 
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/IRecycler.h"
+#include "BitFunnel/Utilities/Factories.h"
 #include "Commands.h"
 #include "Environment.h"
 #include "TaskFactory.h"
@@ -32,13 +33,23 @@ namespace BitFunnel
 {
     Environment::Environment(char const * directory,
                              size_t gramSize,
-                             size_t threadCount)
+                             size_t threadCount,
+                             size_t rowAlignment)
         // TODO: Don't like passing *this to TaskFactory.
         // What if TaskFactory calls back before Environment is fully initialized?
         : m_taskFactory(new TaskFactory(*this)),
           // Start one extra thread for the Recycler.
           m_taskPool(new TaskPool(threadCount + 1)),
-          m_index(Factories::CreateSimpleIndex(directory, gramSize, false))
+          // The thread that runs a query also matches slices, so the pool
+          // needs one fewer thread.
+          m_matchPool(Factories::CreateWorkStealingPool(
+              (threadCount > 0) ? threadCount - 1 : 0)),
+          // Give each ingestion thread its own active Slice.
+          m_index(Factories::CreateSimpleIndex(directory,
+                                               gramSize,
+                                               false,
+                                               (threadCount > 0) ? threadCount : 1,
+                                               rowAlignment))
     {
         RegisterCommands();
     }
@@ -71,6 +82,12 @@ namespace BitFunnel
     }
 
 
+    IWorkStealingPool & Environment::GetMatchPool() const
+    {
+        return *m_matchPool;
+    }
+
+
     void Environment::StartIndex()
     {
         m_index->StartIndex(false);
@@ -26,6 +26,7 @@
 
 #include "BitFunnel/Index/ISimpleIndex.h"           // Parameterizes std::unique_ptr.
 #include "BitFunnel/NonCopyable.h"                  // Base class.
+#include "BitFunnel/Utilities/IWorkStealingPool.h"  // Parameterizes std::unique_ptr.
 #include "BitFunnel/Term.h"                         // Term::GramSize embedded.
 #include "TaskFactory.h"                            // Parameterizes std::unique_ptr.
 #include "TaskPool.h"                               // Parameterizes std::unique_ptr.
@@ -41,12 +42,16 @@ namespace BitFunnel
     public:
         Environment(char const * directory,
                     size_t gramSize,
-                    size_t threadCount);
+                    size_t threadCount,
+                    size_t rowAlignment);
 
         TaskFactory & GetTaskFactory() const;
 
         TaskPool & GetTaskPool() const;
 
+        // Threads used to split a single query across slices.
+        IWorkStealingPool & GetMatchPool() const;
+
         void StartIndex();
 
         IConfiguration const & GetConfiguration() const;
@@ -58,6 +63,7 @@ namespace BitFunnel
 
         std::unique_ptr<TaskFactory> m_taskFactory;
         std::unique_ptr<TaskPool> m_taskPool;
+        std::unique_ptr<IWorkStealingPool> m_matchPool;
         std::unique_ptr<ISimpleIndex> m_index;
     };
 }
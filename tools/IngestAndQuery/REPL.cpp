@@ -46,7 +46,8 @@ namespace BitFunnel
 
     void REPL(char const * directory,
               size_t gramSize,
-              size_t threadCount)
+              size_t threadCount,
+              size_t rowAlignment)
     {
         std::cout
             << "Welcome to BitFunnel!" << std::endl
@@ -56,11 +57,13 @@ namespace BitFunnel
             << std::endl
             << "directory = \"" << directory << "\"" << std::endl
             << "gram size = " << gramSize << std::endl
+            << "row alignment = " << rowAlignment << std::endl
             << std::endl;
 
         Environment environment(directory,
                                 gramSize,
-                                threadCount);
+                                threadCount,
+                                rowAlignment);
 
         std::cout
             << "Starting index ..."
@@ -30,5 +30,6 @@ namespace BitFunnel
     // and running queries.
     void REPL(char const * directory,
               size_t gramSize,
-              size_t threadCount);
+              size_t threadCount,
+              size_t rowAlignment);
 }
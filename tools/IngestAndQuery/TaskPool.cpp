@@ -51,6 +51,12 @@ namespace BitFunnel
     }
 
 
+    size_t TaskPool::GetThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+
     TaskPool::Thread::Thread(TaskPool& pool, size_t id)
       : m_pool(pool),
         m_id(id)
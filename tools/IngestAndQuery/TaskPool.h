@@ -40,6 +40,8 @@ namespace BitFunnel
 
         bool TryEnqueue(std::unique_ptr<ITask> task);
 
+        size_t GetThreadCount() const;
+
         void Shutdown();
 
     private:
@@ -51,9 +51,19 @@ int main(int argc, char** argv)
         "Set the thread count for ingestion and query processing.",
         1u);
 
+    // TODO: This parameter should be unsigned, but it doesn't seem to work
+    // with CmdLineParser.
+    CmdLine::OptionalParameter<int> rowAlignment(
+        "rowalignment",
+        "Set the byte alignment of rows in the slice buffers. "
+        "Must be a power of two no less than 8. "
+        "Use 32 or 64 to let the matcher use aligned vector loads.",
+        8u);
+
     parser.AddParameter(path);
     parser.AddParameter(gramSize);
     parser.AddParameter(threadCount);
+    parser.AddParameter(rowAlignment);
 
     int returnCode = 0;
 
@@ -61,8 +71,19 @@ int main(int argc, char** argv)
     {
         try
         {
-            BitFunnel::REPL(path, gramSize, threadCount);
-            returnCode = 0;
+            const int alignment = rowAlignment;
+            if (alignment < 8 || (alignment & (alignment - 1)) != 0)
+            {
+                std::cout
+                    << "rowalignment must be a power of two no less than 8."
+                    << std::endl;
+                returnCode = 1;
+            }
+            else
+            {
+                BitFunnel::REPL(path, gramSize, threadCount, alignment);
+                returnCode = 0;
+            }
         }
         catch (...)
         {
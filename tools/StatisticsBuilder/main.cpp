@@ -20,10 +20,12 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "BitFunnel/Index/IConfiguration.h"
@@ -57,11 +59,14 @@ namespace BitFunnel
                                        // TODO: gramSize should be unsigned once CmdLineParser supports unsigned.
                                        int gramSize,
                                        bool generateStatistics,
-                                       bool generateTermToText)
+                                       bool generateTermToText,
+                                       size_t threadCount)
     {
+        // Give each posting thread its own active Slice.
         auto index = Factories::CreateSimpleIndex(intermediateDirectory,
                                                   gramSize,
-                                                  generateTermToText);
+                                                  generateTermToText,
+                                                  threadCount);
         index->StartIndex(true);
 
 
@@ -82,9 +87,13 @@ namespace BitFunnel
 
         Stopwatch stopwatch;
 
-        // TODO: Use correct thread count.
-        const size_t threadCount = 1;
-        IngestChunks(filePaths, configuration, ingestor, threadCount, false);
+        IngestionPipelineOptions options(threadCount);
+        IngestChunksPipelined(filePaths,
+                              configuration,
+                              ingestor,
+                              options,
+                              false,
+                              &std::cout);
 
         const double elapsedTime = stopwatch.ElapsedTime();
         const size_t totalSourceBytes = ingestor.GetTotalSouceBytesIngested();
@@ -142,11 +151,19 @@ int main(int argc, char** argv)
         "Set the maximum ngram size for phrases.",
         1u);
 
+    // TODO: This parameter should be unsigned, but it doesn't seem to work
+    // with CmdLineParser.
+    CmdLine::OptionalParameter<int> threadCount(
+        "threads",
+        "Set the number of parser and posting threads used for ingestion.",
+        (std::max)(1u, std::thread::hardware_concurrency()));
+
     parser.AddParameter(chunkListFileName);
     parser.AddParameter(tempPath);
     parser.AddParameter(statistics);
     parser.AddParameter(termToText);
     parser.AddParameter(gramSize);
+    parser.AddParameter(threadCount);
 
     int returnCode = 0;
 
@@ -158,7 +175,8 @@ int main(int argc, char** argv)
                                               chunkListFileName,
                                               gramSize,
                                               statistics.IsActivated(),
-                                              termToText.IsActivated());
+                                              termToText.IsActivated(),
+                                              (std::max)(1, static_cast<int>(threadCount)));
             returnCode = 0;
         }
         catch (...)